@@ -9,6 +9,11 @@
 #include <time.h>
 #include <cinttypes>
 
+#if REPLAY_MMAP_ENABLED
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #ifndef PRIu64
 #define PRIu64 "llu"
 #endif
@@ -19,24 +24,198 @@ AP_LoggerFileReader::AP_LoggerFileReader()
 AP_LoggerFileReader::~AP_LoggerFileReader()
 {
     ::printf("Replay counts: %" PRIu64 " bytes  %u entries\n", bytes_read, message_count);
+#if REPLAY_MMAP_ENABLED
+    if (map_data != nullptr) {
+        munmap(map_data, map_length);
+    }
+#endif
+    delete[] window;
 }
 
 bool AP_LoggerFileReader::open_log(const char *logfile)
 {
-    fd = AP::FS().open(logfile, O_RDONLY);
-    if (fd == -1) {
+#if REPLAY_MMAP_ENABLED
+    const bool mapped = use_mmap && map_log(logfile);
+#else
+    const bool mapped = false;
+#endif
+    if (!mapped) {
+        fd = AP::FS().open(logfile, O_RDONLY);
+        if (fd == -1) {
+            return false;
+        }
+    }
+    return open_compressed();
+}
+
+/*
+  check for the header of a compressed log, returning false if the log
+  is compressed but can't be read
+ */
+bool AP_LoggerFileReader::open_compressed()
+{
+    struct log_compress_header header;
+    if (!read_file(&header, sizeof(header)) || header.magic != LOG_COMPRESS_MAGIC) {
+        return seek_file(0);
+    }
+    if (header.version != LOG_COMPRESS_VERSION || header.block_size > LOG_COMPRESS_BLOCK_SIZE) {
+        ::printf("Unsupported compressed log version %u\n", (unsigned)header.version);
+        return false;
+    }
+    // room for two blocks, as the last message read is kept when
+    // another block is decoded
+    window = new uint8_t[2*LOG_COMPRESS_BLOCK_SIZE];
+    window_start = 0;
+    window_len = 0;
+    window_pos = 0;
+    decompressor.reset();
+    ::printf("Reading compressed log\n");
+    return true;
+}
+
+// read bytes of the log file itself
+bool AP_LoggerFileReader::read_file(void *buf, uint32_t count)
+{
+#if REPLAY_MMAP_ENABLED
+    if (map_data != nullptr) {
+        if (map_length - map_offset < count) {
+            return false;
+        }
+        memcpy(buf, &map_data[map_offset], count);
+        map_offset += count;
+        return true;
+    }
+#endif
+    return read_input(buf, count) == ssize_t(count);
+}
+
+bool AP_LoggerFileReader::seek_file(uint32_t offset)
+{
+#if REPLAY_MMAP_ENABLED
+    if (map_data != nullptr) {
+        if (offset > map_length) {
+            return false;
+        }
+        map_offset = offset;
+        return true;
+    }
+#endif
+    // AP_Filesystem offsets are signed 32 bit
+    return offset <= INT32_MAX && AP::FS().lseek(fd, offset, SEEK_SET) == int32_t(offset);
+}
+
+/*
+  decode blocks until count bytes can be read from window_pos
+ */
+bool AP_LoggerFileReader::fill_window(uint32_t count)
+{
+    while (window_len - window_pos < count) {
+        // keep enough before window_pos to hold the message being read
+        const uint32_t drop = window_pos > 256 ? window_pos - 256 : 0;
+        memmove(window, &window[drop], window_len - drop);
+        window_start += drop;
+        window_len -= drop;
+        window_pos -= drop;
+
+        struct log_compress_block hdr;
+        uint8_t data[LOG_COMPRESS_BLOCK_SIZE];
+        if (!read_file(&hdr, sizeof(hdr))) {
+            return false;
+        }
+        if (hdr.length > sizeof(data) || !read_file(data, hdr.length)) {
+            return false;
+        }
+        const int32_t n = decompressor.decode(hdr, data, &window[window_len]);
+        if (n < 0) {
+            ::printf("Corrupt compressed block at %u\n", (unsigned)(window_start + window_len));
+            return false;
+        }
+        window_len += n;
+    }
+    return true;
+}
+
+#if REPLAY_MMAP_ENABLED
+/*
+  map the whole log. The mapping is private and writable as the
+  message handlers are given non-const pointers into it
+ */
+bool AP_LoggerFileReader::map_log(const char *logfile)
+{
+    const int map_fd = ::open(logfile, O_RDONLY|O_CLOEXEC);
+    if (map_fd == -1) {
         return false;
     }
+    struct stat st;
+    if (fstat(map_fd, &st) != 0 || st.st_size <= 0) {
+        ::close(map_fd);
+        return false;
+    }
+    void *data = mmap(nullptr, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, map_fd, 0);
+    ::close(map_fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    // the log is parsed once from start to end
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    map_data = (uint8_t *)data;
+    map_length = st.st_size;
+    map_offset = 0;
     return true;
 }
+#endif
+
+bool AP_LoggerFileReader::is_mapped() const
+{
+#if REPLAY_MMAP_ENABLED
+    return map_data != nullptr;
+#else
+    return false;
+#endif
+}
 
 ssize_t AP_LoggerFileReader::read_input(void *buffer, const size_t count)
 {
-    uint64_t ret = AP::FS().read(fd, buffer, count);
-    bytes_read += ret;
+    ssize_t ret = AP::FS().read(fd, buffer, count);
+    if (ret > 0) {
+        bytes_read += ret;
+    }
     return ret;
 }
 
+/*
+  return a pointer to the next count bytes of the log, or nullptr at
+  the end of the log. A mapped or compressed log is returned in place,
+  otherwise the bytes are read into buf
+ */
+uint8_t *AP_LoggerFileReader::next_input(uint8_t *buf, size_t count)
+{
+    if (window != nullptr) {
+        if (!fill_window(count)) {
+            return nullptr;
+        }
+        uint8_t *ret = &window[window_pos];
+        window_pos += count;
+        bytes_read += count;
+        return ret;
+    }
+#if REPLAY_MMAP_ENABLED
+    if (map_data != nullptr) {
+        if (map_length - map_offset < count) {
+            return nullptr;
+        }
+        uint8_t *ret = &map_data[map_offset];
+        map_offset += count;
+        bytes_read += count;
+        return ret;
+    }
+#endif
+    if (read_input(buf, count) != (ssize_t)count) {
+        return nullptr;
+    }
+    return buf;
+}
+
 void AP_LoggerFileReader::format_type(uint16_t type, char dest[5])
 {
     const struct log_Format &f = formats[type];
@@ -51,52 +230,73 @@ void AP_LoggerFileReader::get_packet_counts(uint64_t dest[])
     memcpy(dest, packet_counts, sizeof(packet_counts));
 }
 
-bool AP_LoggerFileReader::update()
+/*
+  read the next message into buf, or return it in place for a mapped
+  log. Returns nullptr at the end of the log
+ */
+uint8_t *AP_LoggerFileReader::next_message(uint8_t buf[256])
 {
-    uint8_t hdr[3];
-    if (read_input(hdr, 3) != 3) {
-        return false;
+    uint8_t *hdr = next_input(buf, 3);
+    if (hdr == nullptr) {
+        return nullptr;
     }
     if (hdr[0] != HEAD_BYTE1 || hdr[1] != HEAD_BYTE2) {
         printf("bad log header\n");
-        return false;
+        return nullptr;
     }
 
-#if CONFIG_HAL_BOARD == HAL_BOARD_CHIBIOS
-    // running on stm32 is slow enough it is nice to see progress
-    if (message_count % 500 == 0) {
-        ::printf("line %u pkt 0x%02x t=%u\n", message_count, hdr[2], AP_HAL::millis());
-    }
-#endif
-    packet_counts[hdr[2]]++;
-
+    uint8_t length;
     if (hdr[2] == LOG_FORMAT_MSG) {
-        struct log_Format f;
-        memcpy(&f, hdr, 3);
-        if (read_input(&f.type, sizeof(f)-3) != sizeof(f)-3) {
-            return false;
+        length = sizeof(struct log_Format);
+    } else {
+        length = formats[hdr[2]].length;
+        if (length == 0) {
+            // can't just throw these away as the format specifies the
+            // number of bytes in the message
+            ::printf("No format defined for type (%d)\n", hdr[2]);
+            exit(1);
         }
-        memcpy(&formats[f.type], &f, sizeof(formats[f.type]));
-
-        message_count++;
-        return handle_log_format_msg(f);
     }
 
-    const struct log_Format &f = formats[hdr[2]];
-    if (f.length == 0) {
-        // can't just throw these away as the format specifies the
-        // number of bytes in the message
-        ::printf("No format defined for type (%d)\n", hdr[2]);
-        exit(1);
+    uint8_t *body = next_input(&buf[3], length-3);
+    if (body == nullptr) {
+        return nullptr;
     }
+    if (body == &buf[3]) {
+        return buf;
+    }
+    // mapped messages are contiguous with their header
+    return body - 3;
+}
 
-    uint8_t msg[f.length];
+// record a format message and pass it on
+bool AP_LoggerFileReader::handle_format(const uint8_t *msg)
+{
+    struct log_Format f;
+    memcpy(&f, msg, sizeof(f));
+    memcpy(&formats[f.type], &f, sizeof(formats[f.type]));
+    return handle_log_format_msg(f);
+}
 
-    memcpy(msg, hdr, 3);
-    if (read_input(&msg[3], f.length-3) != f.length-3) {
+bool AP_LoggerFileReader::update()
+{
+    uint8_t buf[256];
+    uint8_t *msg = next_message(buf);
+    if (msg == nullptr) {
         return false;
     }
 
+#if CONFIG_HAL_BOARD == HAL_BOARD_CHIBIOS
+    // running on stm32 is slow enough it is nice to see progress
+    if (message_count % 500 == 0) {
+        ::printf("line %u pkt 0x%02x t=%u\n", message_count, msg[2], AP_HAL::millis());
+    }
+#endif
+    packet_counts[msg[2]]++;
     message_count++;
-    return handle_msg(f, msg);
+
+    if (msg[2] == LOG_FORMAT_MSG) {
+        return handle_format(msg);
+    }
+    return handle_msg(formats[msg[2]], msg);
 }
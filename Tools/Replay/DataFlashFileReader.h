@@ -1,9 +1,16 @@
 #pragma once
 
 #include <AP_Logger/AP_Logger.h>
+#include <AP_Logger/LogCompress.h>
 
 #define LOGREADER_MAX_FORMATS 255 // must be >= highest MESSAGE
 
+// on Linux and SITL the log is parsed in place from a memory mapping
+// rather than read a message at a time
+#ifndef REPLAY_MMAP_ENABLED
+#define REPLAY_MMAP_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX)
+#endif
+
 class AP_LoggerFileReader
 {
 public:
@@ -14,6 +21,14 @@ public:
     bool open_log(const char *logfile);
     bool update();
 
+    // read the log with AP_Filesystem reads even where it could be mapped
+    void set_use_mmap(bool enable) { use_mmap = enable; }
+    // true if the open log is memory mapped
+    bool is_mapped() const;
+
+    // true if the open log is block compressed (LOG_FILE_COMPRESS)
+    bool is_compressed() const { return window != nullptr; }
+
     virtual bool handle_log_format_msg(const struct log_Format &f) = 0;
     virtual bool handle_msg(const struct log_Format &f, uint8_t *msg) = 0;
 
@@ -27,6 +42,30 @@ protected:
 
 private:
     ssize_t read_input(void *buf, size_t count);
+    uint8_t *next_input(uint8_t *buf, size_t count);
+    uint8_t *next_message(uint8_t buf[256]);
+    bool handle_format(const uint8_t *msg);
+
+    // compressed logs are decoded a block at a time into a window
+    // which is then read like a mapped log
+    bool open_compressed();
+    bool read_file(void *buf, uint32_t count);
+    bool seek_file(uint32_t offset);
+    bool fill_window(uint32_t count);
+    LogDecompressor decompressor;
+    uint8_t *window = nullptr;
+    // offset in the decoded log of window[0]
+    uint32_t window_start;
+    uint32_t window_len;
+    uint32_t window_pos;
+
+    bool use_mmap = true;
+#if REPLAY_MMAP_ENABLED
+    bool map_log(const char *logfile);
+    uint8_t *map_data = nullptr;
+    size_t map_length;
+    size_t map_offset;
+#endif
 
     uint64_t bytes_read = 0;
     uint32_t message_count = 0;
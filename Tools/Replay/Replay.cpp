@@ -38,6 +38,7 @@ static ReplayVehicle replayvehicle;
 user_parameter *user_parameters;
 bool replay_force_ekf2;
 bool replay_force_ekf3;
+static bool replay_no_mmap;
 
 #define GSCALAR(v, name, def) { replayvehicle.g.v.vtype, name, Parameters::k_param_ ## v, &replayvehicle.g.v, {def_value : def} }
 #define GOBJECT(v, name, class) { AP_PARAM_GROUP, name, Parameters::k_param_ ## v, &replayvehicle.v, {group_info : class::var_info} }
@@ -131,11 +132,13 @@ void Replay::usage(void)
     ::printf("\t--param-file FILENAME  load parameters from a file\n");
     ::printf("\t--force-ekf2 force enable EKF2\n");
     ::printf("\t--force-ekf3 force enable EKF3\n");
+    ::printf("\t--no-mmap read the log with file reads rather than a memory mapping\n");
 }
 
 enum param_key : uint8_t {
     FORCE_EKF2 = 1,
     FORCE_EKF3,
+    NO_MMAP,
 };
 
 void Replay::_parse_command_line(uint8_t argc, char * const argv[])
@@ -147,6 +150,7 @@ void Replay::_parse_command_line(uint8_t argc, char * const argv[])
         {"param-file",      true,   0, 'F'},
         {"force-ekf2",      false,  0, param_key::FORCE_EKF2},
         {"force-ekf3",      false,  0, param_key::FORCE_EKF3},
+        {"no-mmap",         false,  0, param_key::NO_MMAP},
         {"help",            false,  0, 'h'},
         {0, false, 0, 0}
     };
@@ -182,6 +186,10 @@ void Replay::_parse_command_line(uint8_t argc, char * const argv[])
             replay_force_ekf3 = true;
             break;
 
+        case param_key::NO_MMAP:
+            replay_no_mmap = true;
+            break;
+
         case 'h':
         default:
             usage();
@@ -236,10 +244,14 @@ void Replay::setup()
 #endif
     }
     // LogReader reader = LogReader(log_structure);
+    reader.set_use_mmap(!replay_no_mmap);
     if (!reader.open_log(filename)) {
         ::printf("open(%s): %m\n", filename);
         exit(1);
     }
+    if (reader.is_mapped()) {
+        ::printf("Reading %s from memory mapping\n", filename);
+    }
 }
 
 void Replay::loop()
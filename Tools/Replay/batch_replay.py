@@ -0,0 +1,177 @@
+#!/usr/bin/env python
+
+'''
+run Replay over many logs in parallel and check that each replay
+produced identical results
+
+Each log is replayed by a separate Replay process, in a working
+directory per worker process so that the output logs don't collide.
+The output log is then checked with check_replay in the same worker.
+Throughput is reported in logs/minute and MB/s of input log.
+'''
+
+from __future__ import print_function
+
+import multiprocessing
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+import check_replay
+
+
+def find_replay():
+    '''find the Replay binary built by waf'''
+    topdir = os.path.realpath(os.path.join(os.path.dirname(__file__), '..', '..'))
+    return os.path.join(topdir, 'build', 'sitl', 'tools', 'Replay')
+
+
+def output_log_path(workdir):
+    '''return the path of the last log written by Replay in workdir'''
+    logdir = os.path.join(workdir, 'logs')
+    with open(os.path.join(logdir, 'LASTLOG.TXT')) as f:
+        lognum = int(f.read().strip())
+    return os.path.join(logdir, '%08u.BIN' % lognum)
+
+
+class ReplayJob(object):
+    '''settings shared by all the logs in a batch'''
+    def __init__(self, args, use_mmap):
+        self.replay = os.path.realpath(args.replay)
+        self.replay_args = args.replay_args
+        self.use_mmap = use_mmap
+        self.ekf2_only = args.ekf2_only
+        self.ekf3_only = args.ekf3_only
+        self.keep_logs = args.keep_logs
+        self.workdir = args.workdir
+
+    def __call__(self, logfile):
+        '''replay and check one log, returning (logfile, passed, messages)'''
+        workdir = os.path.join(self.workdir, 'worker-%u' % os.getpid())
+        if not os.path.isdir(workdir):
+            os.makedirs(workdir)
+        messages = []
+
+        cmd = [self.replay]
+        if not self.use_mmap:
+            cmd.append('--no-mmap')
+        cmd.extend(self.replay_args)
+        cmd.append(os.path.realpath(logfile))
+        with open(os.devnull, 'w') as devnull:
+            ret = subprocess.call(cmd, cwd=workdir, stdout=devnull, stderr=subprocess.STDOUT)
+        if ret != 0:
+            messages.append("Replay exited with %d" % ret)
+            return (logfile, False, messages)
+
+        try:
+            replay_log = output_log_path(workdir)
+        except (IOError, ValueError) as ex:
+            messages.append("No replay output: %s" % ex)
+            return (logfile, False, messages)
+
+        try:
+            passed = check_replay.check_log(replay_log, messages.append,
+                                            ekf2_only=self.ekf2_only,
+                                            ekf3_only=self.ekf3_only)
+        except Exception as ex:
+            # a corrupt log fails on its own rather than stopping the batch
+            messages.append("check_replay failed: %s" % ex)
+            passed = False
+        if not self.keep_logs:
+            os.unlink(replay_log)
+        return (logfile, passed, messages)
+
+
+def run_batch(args, logs, use_mmap):
+    '''replay all logs, returning (failed logs, elapsed seconds)'''
+    job = ReplayJob(args, use_mmap)
+    pool = multiprocessing.Pool(args.jobs)
+    failed = []
+    done = 0
+    tstart = time.time()
+    try:
+        for (logfile, passed, messages) in pool.imap_unordered(job, logs):
+            done += 1
+            if not passed:
+                failed.append(logfile)
+            if args.verbose or not passed:
+                for m in messages:
+                    print("  %s" % m)
+            print("[%u/%u] %s %s" % (done, len(logs), "OK" if passed else "FAILED", logfile))
+    finally:
+        pool.close()
+        pool.join()
+    return (failed, time.time() - tstart)
+
+
+def report(name, logs, total_bytes, elapsed):
+    '''print throughput of a batch'''
+    print("%s: %u logs, %.1f MB in %.1fs: %.1f logs/minute, %.2f MB/s" % (
+        name,
+        len(logs),
+        total_bytes / 1.0e6,
+        elapsed,
+        len(logs) * 60.0 / elapsed,
+        total_bytes / 1.0e6 / elapsed))
+
+
+if __name__ == '__main__':
+    from argparse import ArgumentParser
+    parser = ArgumentParser(description=__doc__)
+    parser.add_argument("--replay", default=find_replay(), help="Replay binary")
+    parser.add_argument("-j", "--jobs", type=int, default=multiprocessing.cpu_count(), help="number of parallel replays")
+    parser.add_argument("--workdir", default=None, help="directory for the replay output, default is a temporary directory")
+    parser.add_argument("--keep-logs", action='store_true', help="keep the replay output logs")
+    parser.add_argument("--no-mmap", action='store_true', help="read the logs with file reads rather than memory mapping them")
+    parser.add_argument("--compare-reader", action='store_true', help="replay the logs with and without memory mapping and compare throughput")
+    parser.add_argument("--replay-arg", dest='replay_args', action='append', default=[], help="extra argument to pass to Replay, e.g. --replay-arg=--force-ekf3, may be repeated")
+    parser.add_argument("--ekf2-only", action='store_true', help="only check EKF2")
+    parser.add_argument("--ekf3-only", action='store_true', help="only check EKF3")
+    parser.add_argument("--verbose", action='store_true', help="show check_replay output for all logs")
+    parser.add_argument("logs", metavar="LOG", nargs="+")
+
+    args = parser.parse_args()
+
+    if not os.path.exists(args.replay):
+        print("Replay binary %s not found, build it with ./waf --target tools/Replay" % args.replay)
+        sys.exit(1)
+
+    remove_workdir = False
+    if args.workdir is None:
+        args.workdir = tempfile.mkdtemp(prefix='batch_replay.')
+        remove_workdir = not args.keep_logs
+
+    total_bytes = sum([os.path.getsize(f) for f in args.logs])
+    print("Replaying %u logs (%.1f MB) with %u jobs" % (len(args.logs), total_bytes / 1.0e6, args.jobs))
+
+    if args.compare_reader:
+        readers = [("mmap", True), ("read", False)]
+    else:
+        readers = [("read" if args.no_mmap else "mmap", not args.no_mmap)]
+
+    all_failed = set()
+    results = []
+    for (name, use_mmap) in readers:
+        (failed, elapsed) = run_batch(args, args.logs, use_mmap)
+        all_failed.update(failed)
+        results.append((name, elapsed))
+
+    print("")
+    for (name, elapsed) in results:
+        report(name, args.logs, total_bytes, elapsed)
+    if len(results) == 2:
+        print("mmap reader speedup: %.2f" % (results[1][1] / results[0][1]))
+
+    if remove_workdir:
+        shutil.rmtree(args.workdir, ignore_errors=True)
+
+    if len(all_failed) != 0:
+        print("FAILED %u/%u logs:" % (len(all_failed), len(args.logs)))
+        for f in sorted(all_failed):
+            print("  %s" % f)
+        sys.exit(1)
+    print("Passed")
+    sys.exit(0)
@@ -4719,6 +4719,16 @@ class AutoTestCopter(AutoTest):
             self.hover_and_check_matched_frequency(-15, 100, 350, 256, 250)
             self.set_parameter("FFT_WINDOW_SIZE", 128)
 
+            # Step 1c: run the same test analysing all three axes together each cycle
+            self.set_parameter("FFT_OPTIONS", 1)
+            self.start_subtest("Inject noise at 250Hz and check the FFT can find the noise with batched axes")
+
+            self.reboot_sitl()
+
+            # find a motor peak
+            self.hover_and_check_matched_frequency(-15, 100, 350, 128, 250)
+            self.set_parameter("FFT_OPTIONS", 0)
+
             # Step 2: inject actual motor noise and use the standard length FFT to track it
             self.start_subtest("Hover and check that the FFT can find the motor noise")
             self.set_parameters({
@@ -0,0 +1,180 @@
+#!/usr/bin/env python
+
+'''
+Run each vehicle type in lockstep SITL and report the speedup achieved
+
+Each vehicle is started with --lockstep in a scratch directory and
+left to run on the ground for a fixed wall clock time. The speedup is
+taken from the last "Lockstep" report that SITL prints.
+
+With --check-reproducible each vehicle is run twice, and the logs of
+the two runs must be identical up to the length of the shorter one.
+
+AP_FLAKE8_CLEAN
+'''
+
+from __future__ import print_function
+
+import filecmp
+import optparse
+import os
+import re
+import shutil
+import subprocess
+import tempfile
+import time
+
+# (name, binary, model, defaults file)
+VEHICLES = [
+    ("Copter", "arducopter", "quad", "copter.parm"),
+    ("Helicopter", "arducopter-heli", "heli", "copter-heli.parm"),
+    ("Plane", "arduplane", "plane", "plane.parm"),
+    ("QuadPlane", "arduplane", "quadplane", "quadplane.parm"),
+    ("Rover", "ardurover", "rover", "rover.parm"),
+    ("Sub", "ardusub", "vectored", "sub.parm"),
+    ("Blimp", "blimp", "blimp", "blimp.parm"),
+]
+
+
+def topdir():
+    return os.path.realpath(os.path.join(os.path.dirname(__file__), '..', '..'))
+
+
+class LockstepSpeedup(object):
+    def __init__(self, duration=30, check_reproducible=False, keep=False):
+        self.duration = duration
+        self.check_reproducible = check_reproducible
+        self.keep = keep
+
+    def progress(self, message):
+        print("PROGRESS: %s" % (message,))
+
+    def run_vehicle(self, binary, model, defaults, workdir):
+        '''run one vehicle for the wall clock duration, returning the
+        last (simulated, wall, speedup) report'''
+        cmd = [
+            binary,
+            "--lockstep",
+            "-w",
+            "--model", model,
+            "--defaults", defaults,
+            # don't wait for a GCS to connect
+            "--uartA=tcp:0",
+        ]
+        self.progress("Running (%s) in %s" % (" ".join(cmd), workdir))
+        p = subprocess.Popen(cmd,
+                             cwd=workdir,
+                             stdin=None,
+                             close_fds=True,
+                             stdout=subprocess.PIPE,
+                             stderr=subprocess.STDOUT)
+        report = None
+        tstart = time.time()
+        while time.time() - tstart < self.duration:
+            x = p.stdout.readline()
+            if len(x) == 0:
+                break
+            if type(x) == bytes:
+                x = x.decode('utf-8')
+            match = re.match(r"Lockstep \S+: ([0-9.]+)s simulated in ([0-9.]+)s, speedup ([0-9.]+)", x)
+            if match is not None:
+                report = (float(match.group(1)), float(match.group(2)), float(match.group(3)))
+        p.terminate()
+        p.wait()
+        return report
+
+    def first_log(self, workdir):
+        logdir = os.path.join(workdir, "logs")
+        if not os.path.isdir(logdir):
+            return None
+        logs = sorted([f for f in os.listdir(logdir) if f.endswith(".BIN")])
+        if len(logs) == 0:
+            return None
+        return os.path.join(logdir, logs[0])
+
+    def logs_match(self, log1, log2):
+        '''true if the logs are identical up to the length of the shorter'''
+        if log1 is None or log2 is None:
+            return False
+        if filecmp.cmp(log1, log2, shallow=False):
+            return True
+        length = min(os.path.getsize(log1), os.path.getsize(log2))
+        with open(log1, 'rb') as f1, open(log2, 'rb') as f2:
+            while length > 0:
+                n = min(length, 65536)
+                if f1.read(n) != f2.read(n):
+                    return False
+                length -= n
+        return True
+
+    def run(self):
+        results = []
+        failed = []
+        for (name, binary_name, model, defaults) in VEHICLES:
+            binary = os.path.join(topdir(), "build", "sitl", "bin", binary_name)
+            if not os.path.exists(binary):
+                self.progress("Skipping %s, %s is not built" % (name, binary))
+                continue
+            defaults = os.path.join(topdir(), "Tools", "autotest", "default_params", defaults)
+            runs = 2 if self.check_reproducible else 1
+            workdirs = []
+            report = None
+            for i in range(runs):
+                workdir = tempfile.mkdtemp(prefix="lockstep-%s." % name)
+                workdirs.append(workdir)
+                report = self.run_vehicle(binary, model, defaults, workdir)
+                if report is None:
+                    self.progress("%s: no lockstep report" % name)
+            reproducible = None
+            if self.check_reproducible:
+                reproducible = self.logs_match(self.first_log(workdirs[0]),
+                                               self.first_log(workdirs[1]))
+                if not reproducible:
+                    failed.append(name)
+            results.append((name, model, report, reproducible))
+            if not self.keep:
+                for workdir in workdirs:
+                    shutil.rmtree(workdir, ignore_errors=True)
+
+        print("")
+        print("%-12s %-10s %10s %8s %8s" % ("Vehicle", "Model", "Simulated", "Wall", "Speedup"))
+        for (name, model, report, reproducible) in results:
+            if report is None:
+                line = "%-12s %-10s %10s %8s %8s" % (name, model, "-", "-", "-")
+            else:
+                line = "%-12s %-10s %9.1fs %7.1fs %8.1f" % (name, model, report[0], report[1], report[2])
+            if reproducible is not None:
+                line += "  %s" % ("reproducible" if reproducible else "NOT REPRODUCIBLE")
+            print(line)
+        return len(failed) == 0
+
+
+if __name__ == '__main__':
+    parser = optparse.OptionParser(
+        "lockstep_speedup.py",
+        epilog=""
+        "e.g. ./Tools/autotest/lockstep_speedup.py --duration=60 --check-reproducible"
+    )
+    parser.add_option("--duration",
+                      type=int,
+                      default=30,
+                      help='wall clock seconds to run each vehicle for')
+    parser.add_option("--check-reproducible",
+                      action='store_true',
+                      default=False,
+                      help='run each vehicle twice and compare the logs')
+    parser.add_option("--keep",
+                      action='store_true',
+                      default=False,
+                      help='keep the working directories')
+
+    opts, args = parser.parse_args()
+
+    checker = LockstepSpeedup(
+        duration=opts.duration,
+        check_reproducible=opts.check_reproducible,
+        keep=opts.keep
+    )
+
+    if not checker.run():
+        raise SystemExit(1)
@@ -0,0 +1,320 @@
+#!/usr/bin/env python
+
+'''
+Run a swarm of lockstep SITL vehicles behind one MAVLink router
+
+Every vehicle is its own SITL process started with --lockstep, in its
+own directory so that it has its own parameters and storage, and with
+its own SYSID_THISMAV. Rather than a MAVProxy per vehicle, one router
+in this process connects to SERIAL0 of every vehicle and forwards:
+
+ - all vehicle traffic to a single GCS address
+ - GCS traffic to the vehicle it targets, or to all vehicles
+ - optionally, vehicle traffic to the other vehicles (e.g. for FOLLOW)
+
+The vehicles can be restricted to a set of CPUs, which the kernel
+then shares among them.
+
+With --benchmark the router isn't started (unless --benchmark-router
+is given), and the swarm is run for each combination of vehicle count
+and CPU count. The table reports the speedup each vehicle achieved
+and the total simulated vehicle seconds per wall clock second.
+
+e.g. ./Tools/autotest/sim_swarm.py -n 20 --gcs 127.0.0.1:14550
+     ./Tools/autotest/sim_swarm.py --benchmark --vehicles 1,10,50 --cpus 1,4,16
+
+AP_FLAKE8_CLEAN
+'''
+
+from __future__ import print_function
+
+import math
+import multiprocessing
+import optparse
+import os
+import re
+import select
+import shutil
+import socket
+import subprocess
+import tempfile
+import threading
+import time
+
+import lockstep_speedup
+
+# CMAC, as in locations.txt
+DEFAULT_HOME = (-35.363261, 149.165230, 584, 353)
+
+
+def parse_list(s):
+    return [int(x) for x in s.split(",")]
+
+
+def spawn_location(home, instance, spacing):
+    '''vehicles are spaced along a line to the east of home'''
+    (lat, lng, alt, hdg) = home
+    east = spacing * instance
+    dlng = math.degrees(east / (6378137.0 * math.cos(math.radians(lat))))
+    return "%.7f,%.7f,%.1f,%.0f" % (lat, lng + dlng, alt, hdg)
+
+
+class SwarmVehicle(object):
+    '''one SITL process in the swarm'''
+    def __init__(self, binary, model, defaults, instance, home, spacing, basedir, cpus):
+        self.instance = instance
+        self.sysid = instance + 1
+        self.workdir = os.path.join(basedir, "%u" % instance)
+        if not os.path.isdir(self.workdir):
+            os.makedirs(self.workdir)
+        self.cmd = [
+            binary,
+            "--lockstep",
+            "-w",
+            "-I%u" % instance,
+            "--sysid", str(self.sysid),
+            "--model", model,
+            "--defaults", defaults,
+            "--home", spawn_location(home, instance, spacing),
+        ]
+        self.cpus = cpus
+        self.process = None
+        self.report = None
+
+    def start(self, wait_for_gcs):
+        cmd = list(self.cmd)
+        if not wait_for_gcs:
+            cmd.append("--uartA=tcp:0")
+        preexec_fn = None
+        if self.cpus is not None:
+            cpus = self.cpus
+
+            def preexec_fn():
+                os.sched_setaffinity(0, cpus)
+        self.process = subprocess.Popen(cmd,
+                                        cwd=self.workdir,
+                                        stdin=None,
+                                        close_fds=True,
+                                        preexec_fn=preexec_fn,
+                                        stdout=subprocess.PIPE,
+                                        stderr=subprocess.STDOUT)
+        t = threading.Thread(target=self.read_output)
+        t.daemon = True
+        t.start()
+
+    def read_output(self):
+        '''keep the last lockstep report, and keep the pipe drained'''
+        regex = re.compile(r"Lockstep \S+: ([0-9.]+)s simulated in ([0-9.]+)s, speedup ([0-9.]+)")
+        for line in iter(self.process.stdout.readline, b''):
+            match = regex.match(line.decode('utf-8', 'replace'))
+            if match is not None:
+                self.report = (float(match.group(1)), float(match.group(2)), float(match.group(3)))
+
+    def stop(self):
+        if self.process is not None:
+            self.process.terminate()
+            self.process.wait()
+            self.process = None
+
+    def port(self):
+        return 5760 + 10 * self.instance
+
+
+class SwarmRouter(object):
+    '''route MAVLink between the vehicles and one GCS'''
+    def __init__(self, vehicles, gcs, vehicle_broadcast=False):
+        from pymavlink import mavutil
+        self.mavutil = mavutil
+        self.vehicle_broadcast = vehicle_broadcast
+        self.links = []
+        for v in vehicles:
+            self.links.append(self.connect(v.port()))
+        self.by_sysid = {}
+        self.gcs = mavutil.mavlink_connection("udpout:%s" % gcs, source_system=255)
+        self.packets = 0
+
+    def connect(self, port):
+        '''connect to a vehicle's SERIAL0, waiting for it to start'''
+        tstart = time.time()
+        while True:
+            try:
+                return self.mavutil.mavlink_connection("tcp:127.0.0.1:%u" % port, retries=0)
+            except socket.error:
+                if time.time() - tstart > 30:
+                    raise
+                time.sleep(0.1)
+
+    def messages(self, link):
+        while True:
+            m = link.recv_msg()
+            if m is None:
+                return
+            if m.get_type() == 'BAD_DATA':
+                continue
+            yield m
+
+    def route_from_vehicle(self, link):
+        for m in self.messages(link):
+            self.by_sysid[m.get_srcSystem()] = link
+            buf = m.get_msgbuf()
+            self.gcs.write(buf)
+            if self.vehicle_broadcast:
+                for other in self.links:
+                    if other is not link:
+                        other.write(buf)
+            self.packets += 1
+
+    def route_from_gcs(self):
+        for m in self.messages(self.gcs):
+            buf = m.get_msgbuf()
+            target = getattr(m, 'target_system', 0)
+            if target != 0 and target in self.by_sysid:
+                self.by_sysid[target].write(buf)
+            else:
+                for link in self.links:
+                    link.write(buf)
+            self.packets += 1
+
+    def run(self, duration=None):
+        tstart = time.time()
+        fds = {}
+        for link in self.links:
+            fds[link.fd] = link
+        fds[self.gcs.fd] = self.gcs
+        while duration is None or time.time() - tstart < duration:
+            (readable, _, _) = select.select(list(fds.keys()), [], [], 0.1)
+            for fd in readable:
+                link = fds[fd]
+                if link is self.gcs:
+                    self.route_from_gcs()
+                else:
+                    self.route_from_vehicle(link)
+
+
+class Swarm(object):
+    def __init__(self, vehicle_type, count, home, spacing, cpus=None, basedir=None, keep=False):
+        (name, binary_name, model, defaults) = [v for v in lockstep_speedup.VEHICLES if v[0] == vehicle_type][0]
+        binary = os.path.join(lockstep_speedup.topdir(), "build", "sitl", "bin", binary_name)
+        if not os.path.exists(binary):
+            raise ValueError("Binary (%s) does not exist" % binary)
+        defaults = os.path.join(lockstep_speedup.topdir(), "Tools", "autotest", "default_params", defaults)
+        self.remove_basedir = basedir is None and not keep
+        if basedir is None:
+            basedir = tempfile.mkdtemp(prefix="swarm.")
+        self.basedir = basedir
+        self.vehicles = [SwarmVehicle(binary, model, defaults, i, home, spacing, basedir, cpus)
+                         for i in range(count)]
+
+    def start(self, wait_for_gcs):
+        for v in self.vehicles:
+            v.start(wait_for_gcs)
+
+    def stop(self):
+        for v in self.vehicles:
+            v.stop()
+        if self.remove_basedir:
+            shutil.rmtree(self.basedir, ignore_errors=True)
+
+    def reports(self):
+        return [v.report for v in self.vehicles if v.report is not None]
+
+
+def benchmark(opts):
+    print("%8s %5s %10s %10s %10s %12s" % ("Vehicles", "CPUs", "Min", "Mean", "Max", "Total"))
+    cpu_counts = sorted(set([min(n, multiprocessing.cpu_count()) for n in parse_list(opts.cpus)]))
+    for ncpus in cpu_counts:
+        cpus = set(range(ncpus))
+        for count in parse_list(opts.vehicles):
+            swarm = Swarm(opts.vehicle, count, DEFAULT_HOME, opts.spacing, cpus=cpus, keep=opts.keep)
+            try:
+                swarm.start(wait_for_gcs=opts.benchmark_router)
+                if opts.benchmark_router:
+                    router = SwarmRouter(swarm.vehicles, opts.gcs, opts.vehicle_broadcast)
+                    router.run(duration=opts.duration)
+                else:
+                    time.sleep(opts.duration)
+                speedups = [r[2] for r in swarm.reports()]
+            finally:
+                swarm.stop()
+            if len(speedups) == 0:
+                print("%8u %5u %10s" % (count, len(cpus), "no reports"))
+                continue
+            print("%8u %5u %10.1f %10.1f %10.1f %12.1f" % (
+                count,
+                len(cpus),
+                min(speedups),
+                sum(speedups) / len(speedups),
+                max(speedups),
+                sum(speedups)))
+
+
+if __name__ == '__main__':
+    parser = optparse.OptionParser("sim_swarm.py", epilog="")
+    parser.add_option("--vehicle",
+                      default="Copter",
+                      help='vehicle type, one of %s' % ",".join([v[0] for v in lockstep_speedup.VEHICLES]))
+    parser.add_option("-n", "--count",
+                      type=int,
+                      default=10,
+                      help='number of vehicles')
+    parser.add_option("--gcs",
+                      default="127.0.0.1:14550",
+                      help='GCS address to route vehicle traffic to')
+    parser.add_option("--vehicle-broadcast",
+                      action='store_true',
+                      default=False,
+                      help='also route each vehicle\'s traffic to the other vehicles')
+    parser.add_option("--spacing",
+                      type=float,
+                      default=20.0,
+                      help='distance in metres between the vehicles')
+    parser.add_option("--cpu-limit",
+                      type=int,
+                      default=None,
+                      help='restrict the vehicles to this many CPUs')
+    parser.add_option("--basedir",
+                      default=None,
+                      help='directory for the vehicle directories, default is a temporary directory')
+    parser.add_option("--keep",
+                      action='store_true',
+                      default=False,
+                      help='keep the vehicle directories')
+    parser.add_option("--benchmark",
+                      action='store_true',
+                      default=False,
+                      help='measure speedup for each vehicle count and CPU count')
+    parser.add_option("--benchmark-router",
+                      action='store_true',
+                      default=False,
+                      help='run the router during the benchmark')
+    parser.add_option("--vehicles",
+                      default="1,2,5,10,20,50",
+                      help='vehicle counts for the benchmark')
+    parser.add_option("--cpus",
+                      default=",".join([str(x) for x in [1, 2, 4, 8, 16, 32, 64] if x <= multiprocessing.cpu_count()]),
+                      help='CPU counts for the benchmark')
+    parser.add_option("--duration",
+                      type=int,
+                      default=30,
+                      help='wall clock seconds to run each benchmark for')
+
+    opts, args = parser.parse_args()
+
+    if opts.benchmark:
+        benchmark(opts)
+        raise SystemExit(0)
+
+    cpus = None
+    if opts.cpu_limit is not None:
+        cpus = set(range(opts.cpu_limit))
+    swarm = Swarm(opts.vehicle, opts.count, DEFAULT_HOME, opts.spacing,
+                  cpus=cpus, basedir=opts.basedir, keep=opts.keep)
+    try:
+        swarm.start(wait_for_gcs=True)
+        router = SwarmRouter(swarm.vehicles, opts.gcs, opts.vehicle_broadcast)
+        print("Routing %u vehicles to %s" % (opts.count, opts.gcs))
+        router.run()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        swarm.stop()
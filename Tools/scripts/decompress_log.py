@@ -0,0 +1,163 @@
+#!/usr/bin/env python
+'''
+decompress a log written with LOG_FILE_COMPRESS=1 (NN.BNZ) to a plain
+log (NN.BIN), so it can be read by tools which only understand plain
+logs
+
+See libraries/AP_Logger/LogCompress.h for the format
+
+AP_FLAKE8_CLEAN
+'''
+
+from __future__ import print_function
+
+import struct
+import sys
+
+from argparse import ArgumentParser
+
+LOG_COMPRESS_MAGIC = 0x5A4C5041
+LOG_COMPRESS_VERSION = 1
+LOG_COMPRESS_BLOCK_MAGIC = 0xC5
+LOG_COMPRESS_FLAG_DELTA = 1
+LOG_COMPRESS_FLAG_STORED = 2
+
+HEAD_BYTE1 = 0xA3
+HEAD_BYTE2 = 0x95
+LOG_FORMAT_MSG = 128
+LOG_FORMAT_LEN = 89
+
+
+class CorruptLog(Exception):
+    pass
+
+
+def lz_length(data, ip, value):
+    '''read a length continued in 255 bytes'''
+    while True:
+        if ip >= len(data):
+            raise CorruptLog("truncated length")
+        b = data[ip]
+        ip += 1
+        value += b
+        if b != 255:
+            return (ip, value)
+
+
+def lz_decompress(data):
+    out = bytearray()
+    ip = 0
+    while ip < len(data):
+        token = data[ip]
+        ip += 1
+        num_literals = token >> 4
+        if num_literals == 15:
+            (ip, num_literals) = lz_length(data, ip, num_literals)
+        if ip + num_literals > len(data):
+            raise CorruptLog("truncated literals")
+        out += data[ip:ip+num_literals]
+        ip += num_literals
+        if ip == len(data):
+            break
+        if ip + 2 > len(data):
+            raise CorruptLog("truncated offset")
+        offset = data[ip] | (data[ip+1] << 8)
+        ip += 2
+        match_len = token & 0xF
+        if match_len == 15:
+            (ip, match_len) = lz_length(data, ip, match_len)
+        match_len += 4
+        if offset == 0 or offset > len(out):
+            raise CorruptLog("bad offset")
+        start = len(out) - offset
+        for i in range(match_len):
+            out.append(out[start + i])
+    return out
+
+
+class TimeDelta(object):
+    '''undo the TimeUS delta transform'''
+    def __init__(self):
+        self.length = {LOG_FORMAT_MSG: LOG_FORMAT_LEN}
+        self.has_time = {}
+        self.last_time = {}
+
+    def learn_format(self, msg):
+        (msg_type, length) = struct.unpack("<BB", msg[3:5])
+        if msg_type == LOG_FORMAT_MSG:
+            return
+        fmt = msg[9:25].split(b'\0')[0]
+        labels = msg[25:89].split(b'\0')[0]
+        self.length[msg_type] = length
+        self.has_time[msg_type] = (length >= 11 and fmt.startswith(b'Q') and
+                                   labels.split(b',')[0] == b'TimeUS')
+        self.last_time[msg_type] = 0
+
+    def decode(self, buf):
+        ofs = 0
+        while ofs < len(buf):
+            if len(buf) - ofs < 3 or buf[ofs] != HEAD_BYTE1 or buf[ofs+1] != HEAD_BYTE2:
+                raise CorruptLog("bad message header")
+            msg_type = buf[ofs+2]
+            length = self.length.get(msg_type, 0)
+            if length < 3 or length > len(buf) - ofs:
+                raise CorruptLog("bad message length")
+            if msg_type == LOG_FORMAT_MSG:
+                self.learn_format(buf[ofs:ofs+length])
+            elif self.has_time.get(msg_type, False):
+                (delta,) = struct.unpack("<Q", buf[ofs+3:ofs+11])
+                t = (delta + self.last_time[msg_type]) & 0xFFFFFFFFFFFFFFFF
+                self.last_time[msg_type] = t
+                buf[ofs+3:ofs+11] = struct.pack("<Q", t)
+            ofs += length
+
+
+def decompress(infile, outfile):
+    data = bytearray(open(infile, 'rb').read())
+    (magic, version, block_size) = struct.unpack("<IHH", data[0:8])
+    if magic != LOG_COMPRESS_MAGIC:
+        print("%s is not a compressed log" % infile)
+        return False
+    if version != LOG_COMPRESS_VERSION:
+        print("Unsupported version %u" % version)
+        return False
+    delta = TimeDelta()
+    ofs = 8
+    with open(outfile, 'wb') as out:
+        while ofs + 6 <= len(data):
+            (block_magic, flags, raw_length, length) = struct.unpack("<BBHH", data[ofs:ofs+6])
+            ofs += 6
+            if block_magic != LOG_COMPRESS_BLOCK_MAGIC or length > raw_length or ofs + length > len(data):
+                print("Log truncated at offset %u" % (ofs - 6))
+                break
+            block = data[ofs:ofs+length]
+            ofs += length
+            try:
+                if flags & LOG_COMPRESS_FLAG_STORED:
+                    raw = bytearray(block)
+                else:
+                    raw = lz_decompress(block)
+                if len(raw) != raw_length:
+                    raise CorruptLog("bad block length")
+                if flags & LOG_COMPRESS_FLAG_DELTA:
+                    delta.decode(raw)
+            except CorruptLog as ex:
+                print("Corrupt block at offset %u: %s" % (ofs - length - 6, ex))
+                break
+            out.write(raw)
+    return True
+
+
+if __name__ == '__main__':
+    parser = ArgumentParser(description=__doc__)
+    parser.add_argument("infile", metavar="LOG")
+    parser.add_argument("outfile", metavar="OUTPUT", nargs='?', default=None,
+                        help="defaults to LOG with a .BIN extension")
+    args = parser.parse_args()
+    if args.outfile is None:
+        base = args.infile
+        if base.upper().endswith(".BNZ"):
+            base = base[:-4]
+        args.outfile = base + ".BIN"
+    if not decompress(args.infile, args.outfile):
+        sys.exit(1)
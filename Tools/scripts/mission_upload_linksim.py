@@ -0,0 +1,140 @@
+#!/usr/bin/env python
+'''
+model the time taken to upload a mission over a slow full duplex
+telemetry link, with the MISSION_ITEM_INT protocol and with a windowed
+MAVFTP upload of @MISSION/mission.dat
+
+The link is 8N1 at the given baud rate carrying mavlink2 with no
+signing. Each direction is serialised separately, packets are lost at
+random with the given probability and arrive after the given one-way
+latency. The vehicle re-requests a mission item after 1s and the GCS
+retransmits an unacknowledged FTP write after 1s. Times are averaged
+over a number of seeds
+
+AP_FLAKE8_CLEAN
+'''
+
+from __future__ import print_function
+
+import heapq
+import random
+
+from argparse import ArgumentParser
+
+MAVLINK2_OVERHEAD = 12   # header and crc
+FTP_OVERHEAD = 12        # FILE_TRANSFER_PROTOCOL target and FTP header
+FTP_MAX_DATA = 239
+MISSION_ITEM_INT_LEN = 38
+MISSION_HEADER_LEN = 10
+
+
+class Link(object):
+    '''a full duplex serial link, direction 0 is up (GCS to vehicle) and 1 is down'''
+    def __init__(self, baud, latency, loss, rng):
+        self.bytes_per_s = baud / 10.0
+        self.latency = latency
+        self.loss = loss
+        self.rng = rng
+        self.free = [0.0, 0.0]
+
+    def send(self, direction, t, nbytes):
+        '''send a packet at time t, returns its arrival time or None if it is lost'''
+        start = max(t, self.free[direction])
+        self.free[direction] = start + nbytes / self.bytes_per_s
+        if self.rng.random() < self.loss:
+            return None
+        return self.free[direction] + self.latency
+
+
+def mission_item_upload(link, nitems, loop_time=0.0025, retry=1.0):
+    '''upload with MISSION_COUNT, then a MISSION_REQUEST_INT and MISSION_ITEM_INT per item'''
+    t = 0.0
+    while True:
+        arrival = link.send(0, t, MAVLINK2_OVERHEAD + 5)
+        if arrival is not None:
+            t = arrival + loop_time
+            break
+        t += retry
+    seq = 0
+    while seq < nitems:
+        requested = t
+        arrival = link.send(1, t, MAVLINK2_OVERHEAD + 5)
+        if arrival is not None:
+            arrival = link.send(0, arrival + 0.001, MAVLINK2_OVERHEAD + MISSION_ITEM_INT_LEN)
+            if arrival is not None:
+                t = arrival + loop_time
+                seq += 1
+                continue
+        t = requested + retry
+    link.send(1, t, MAVLINK2_OVERHEAD + 4)
+    return t
+
+
+def ftp_upload(link, nitems, window, worker_time=0.002, retry=1.0):
+    '''upload mission.dat with up to window WriteFile requests in flight'''
+    def request(t, up, down):
+        while True:
+            arrival = link.send(0, t, up)
+            if arrival is not None:
+                arrival = link.send(1, arrival + worker_time, down)
+                if arrival is not None:
+                    return arrival
+            t += retry
+
+    # CreateFile
+    now = request(0.0, MAVLINK2_OVERHEAD + FTP_OVERHEAD + 20, MAVLINK2_OVERHEAD + FTP_OVERHEAD + 4)
+
+    size = MISSION_HEADER_LEN + MISSION_ITEM_INT_LEN * nitems
+    chunks = [min(FTP_MAX_DATA, size - ofs) for ofs in range(0, size, FTP_MAX_DATA)]
+    pending = list(range(len(chunks)))
+    acked = set()
+    inflight = {}
+    acks = []
+    while len(acked) < len(chunks):
+        while pending and len(inflight) < window:
+            i = pending.pop(0)
+            inflight[i] = now + retry
+            arrival = link.send(0, now, MAVLINK2_OVERHEAD + FTP_OVERHEAD + chunks[i])
+            if arrival is not None:
+                arrival = link.send(1, arrival + worker_time, MAVLINK2_OVERHEAD + FTP_OVERHEAD)
+                if arrival is not None:
+                    heapq.heappush(acks, (arrival, i))
+        timeout = min(inflight.values()) if inflight else float('inf')
+        if acks and acks[0][0] <= timeout:
+            now, i = heapq.heappop(acks)
+            if i in inflight:
+                del inflight[i]
+                acked.add(i)
+        else:
+            now = timeout
+            for i, deadline in list(inflight.items()):
+                if deadline <= now:
+                    del inflight[i]
+                    pending.insert(0, i)
+
+    # TerminateSession, which loads the mission
+    return request(now, MAVLINK2_OVERHEAD + FTP_OVERHEAD, MAVLINK2_OVERHEAD + FTP_OVERHEAD)
+
+
+def average(fn, args, nitems, latency, loss, seeds):
+    total = 0.0
+    for seed in range(seeds):
+        link = Link(args.baud, latency, loss, random.Random(seed))
+        total += fn(link, nitems)
+    return total / seeds
+
+
+parser = ArgumentParser(description=__doc__)
+parser.add_argument("--baud", type=int, default=57600, help="link baud rate")
+parser.add_argument("--window", type=int, default=16, help="FTP writes in flight")
+parser.add_argument("--seeds", type=int, default=5, help="runs to average over")
+parser.add_argument("--items", type=int, nargs='+', default=[100, 1000, 5000], help="mission sizes")
+args = parser.parse_args()
+
+for latency, loss in [(0.0, 0.0), (0.05, 0.02)]:
+    print("one-way latency %dms, loss %d%%" % (latency * 1000, loss * 100))
+    print("%6s %12s %12s" % ("items", "MISSION_ITEM", "FTP w=%u" % args.window))
+    for nitems in args.items:
+        t_mission = average(mission_item_upload, args, nitems, latency, loss, args.seeds)
+        t_ftp = average(lambda link, n: ftp_upload(link, n, args.window), args, nitems, latency, loss, args.seeds)
+        print("%6d %11.1fs %11.1fs" % (nitems, t_mission, t_ftp))
@@ -31,6 +31,8 @@ const float OA_BENDYRULER_LOOKAHEAD_STEP2_RATIO = 1.0f; // step2's lookahead len
 const float OA_BENDYRULER_LOOKAHEAD_STEP2_MIN = 2.0f;   // step2 checks at least this many meters past step1's location
 const float OA_BENDYRULER_LOOKAHEAD_PAST_DEST = 2.0f;   // lookahead length will be at least this many meters past the destination
 const float OA_BENDYRULER_LOW_SPEED_SQUARED = (0.2f * 0.2f);    // when ground course is below this speed squared, vehicle's heading will be used
+const uint8_t OA_BENDYRULER_DB_SEARCH_MAX = 64;        // maximum number of nearby database objects checked before falling back to checking all objects
+const uint8_t OA_BENDYRULER_DB_SEARCH_ATTEMPTS = 3;     // number of times the database search radius is widened before checking all objects
 
 #define VERTICAL_ENABLED APM_BUILD_TYPE(APM_BUILD_ArduCopter)
 
@@ -659,15 +661,44 @@ bool AP_OABendyRuler::calc_margin_from_object_database(const Location &start, co
         return false;
     }
 
-    // check each obstacle's distance from segment
+    // search for obstacles near the segment, widening the search until the obstacle with the smallest margin must have been found
+    // an obstacle further than search_radius from the segment has a margin of at least search_radius minus the largest obstacle radius
+    const Vector3f start_m = start_NEU * 0.01f;
+    const Vector3f end_m = end_NEU * 0.01f;
+    const float radius_max = oaDb->get_radius_max();
+    float search_radius = MAX(_margin_max, 1.0f) + radius_max;
     float smallest_margin = FLT_MAX;
-    for (uint16_t i=0; i<oaDb->database_count(); i++) {
-        const AP_OADatabase::OA_DbItem& item = oaDb->get_item(i);
-        const Vector3f point_cm = item.pos * 100.0f;
-        // margin is distance between line segment and obstacle minus obstacle's radius
-        const float m = Vector3f::closest_distance_between_line_and_point(start_NEU, end_NEU, point_cm) * 0.01f - item.radius;
-        if (m < smallest_margin) {
-            smallest_margin = m;
+    bool search_complete = false;
+    uint16_t indices[OA_BENDYRULER_DB_SEARCH_MAX];
+    for (uint8_t attempt = 0; (attempt < OA_BENDYRULER_DB_SEARCH_ATTEMPTS) && !search_complete; attempt++) {
+        const uint16_t num_found = oaDb->find_items_near_segment(start_m, end_m, search_radius, indices, ARRAY_SIZE(indices));
+        if (num_found > ARRAY_SIZE(indices)) {
+            // too many obstacles nearby, check them all below
+            break;
+        }
+        for (uint16_t i=0; i<num_found; i++) {
+            const AP_OADatabase::OA_DbItem& item = oaDb->get_item(indices[i]);
+            // margin is distance between line segment and obstacle minus obstacle's radius
+            const float m = Vector3f::closest_distance_between_line_and_point(start_m, end_m, item.pos) - item.radius;
+            if (m < smallest_margin) {
+                smallest_margin = m;
+            }
+        }
+        search_complete = (smallest_margin <= search_radius - radius_max) || (num_found == oaDb->database_count());
+        search_radius *= 4.0f;
+    }
+
+    // check each obstacle's distance from segment
+    if (!search_complete) {
+        smallest_margin = FLT_MAX;
+        for (uint16_t i=0; i<oaDb->database_count(); i++) {
+            const AP_OADatabase::OA_DbItem& item = oaDb->get_item(i);
+            const Vector3f point_cm = item.pos * 100.0f;
+            // margin is distance between line segment and obstacle minus obstacle's radius
+            const float m = Vector3f::closest_distance_between_line_and_point(start_NEU, end_NEU, point_cm) * 0.01f - item.radius;
+            if (m < smallest_margin) {
+                smallest_margin = m;
+            }
         }
     }
 
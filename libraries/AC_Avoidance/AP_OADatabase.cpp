@@ -35,6 +35,12 @@ extern const AP_HAL::HAL& hal;
     #define AP_OADATABASE_DISTANCE_FROM_HOME 3
 #endif
 
+#ifndef AP_OADATABASE_GRID_CELL_SIZE
+    #define AP_OADATABASE_GRID_CELL_SIZE 4.0f   // length (in meters) of the sides of the cubes used to spatially index the database
+#endif
+
+#define AP_OADATABASE_GRID_NONE UINT16_MAX      // index used to indicate the end of a spatial hash bucket's list
+
 const AP_Param::GroupInfo AP_OADatabase::var_info[] = {
 
     // @Param: SIZE
@@ -127,6 +133,8 @@ void AP_OADatabase::init()
         gcs().send_text(MAV_SEVERITY_INFO, "DB init failed . Sizes queue:%u, db:%u", (unsigned int)_queue.size, (unsigned int)_database.size);
         delete _queue.items;
         delete[] _database.items;
+        delete[] _database.grid_head;
+        delete[] _database.grid_next;
         return;
     }
 }
@@ -198,6 +206,15 @@ void AP_OADatabase::init_database()
     }
 
     _database.items = new OA_DbItem[_database.size];
+
+    // use at least one spatial hash bucket per item
+    _database.grid_num_buckets = 16;
+    while ((_database.grid_num_buckets < _database.size) && (_database.grid_num_buckets < 0x8000)) {
+        _database.grid_num_buckets <<= 1;
+    }
+    _database.grid_head = new uint16_t[_database.grid_num_buckets];
+    _database.grid_next = new uint16_t[_database.size];
+    grid_init();
 }
 
 // get bitmask of gcs channels item should be sent to based on its importance
@@ -257,9 +274,15 @@ bool AP_OADatabase::process_queue()
 
         item.send_to_gcs = get_send_to_gcs_flags(item.importance);
 
-        // compare item to all items in database. If found a similar item, update the existing, else add it as a new one
+        // compare item to nearby items in database. If found a similar item, update the existing, else add it as a new one
+        // items can only be close if they are within the larger of the two item's radius
+        const float search_radius = MAX(item.radius, _database.radius_max);
+        const Vector3f search_offset(search_radius, search_radius, search_radius);
+        GridSearch search;
+        grid_search_start(search, item.pos - search_offset, item.pos + search_offset);
         bool found = false;
-        for (uint16_t i=0; i<_database.count; i++) {
+        uint16_t i;
+        while (grid_search_next(search, i)) {
             if (is_close_to_item_in_database(i, item)) {
                 database_item_refresh(i, item.timestamp_ms, item.radius);
                 found = true;
@@ -281,7 +304,9 @@ void AP_OADatabase::database_item_add(const OA_DbItem &item)
     }
     _database.items[_database.count] = item;
     _database.items[_database.count].send_to_gcs = get_send_to_gcs_flags(_database.items[_database.count].importance);
+    grid_insert(_database.count);
     _database.count++;
+    _database.radius_max = MAX(_database.radius_max, item.radius);
 }
 
 void AP_OADatabase::database_item_remove(const uint16_t index)
@@ -294,6 +319,7 @@ void AP_OADatabase::database_item_remove(const uint16_t index)
     // radius of 0 tells the GCS we don't care about it any more (aka it expired)
     _database.items[index].radius = 0;
     _database.items[index].send_to_gcs = get_send_to_gcs_flags(_database.items[index].importance);
+    grid_remove(index);
 
     _database.count--;
     if (_database.count == 0) {
@@ -304,6 +330,7 @@ void AP_OADatabase::database_item_remove(const uint16_t index)
         // copy last object in array over expired object
         _database.items[index] = _database.items[_database.count];
         _database.items[index].send_to_gcs = get_send_to_gcs_flags(_database.items[index].importance);
+        grid_move(_database.count, index);
     }
 }
 
@@ -324,6 +351,7 @@ void AP_OADatabase::database_item_refresh(const uint16_t index, const uint32_t t
         _database.items[index].timestamp_ms = timestamp_ms;
         _database.items[index].radius = radius;
         _database.items[index].send_to_gcs = get_send_to_gcs_flags(_database.items[index].importance);
+        _database.radius_max = MAX(_database.radius_max, radius);
     }
 }
 
@@ -340,13 +368,16 @@ void AP_OADatabase::database_items_remove_all_expired()
     const uint32_t now_ms = AP_HAL::millis();
     const uint32_t expiry_ms = (uint32_t)_database_expiry_seconds * 1000;
     uint16_t index = 0;
+    float radius_max = 0.0f;
     while (index < _database.count) {
         if (now_ms - _database.items[index].timestamp_ms > expiry_ms) {
             database_item_remove(index);
         } else {
+            radius_max = MAX(radius_max, _database.items[index].radius);
             index++;
         }
     }
+    _database.radius_max = radius_max;
 }
 
 // returns true if a similar object already exists in database. When true, the object timer is also reset
@@ -361,6 +392,150 @@ bool AP_OADatabase::is_close_to_item_in_database(const uint16_t index, const OA_
     return ((distance_sq < sq(item.radius)) || (distance_sq < sq(_database.items[index].radius)));
 }
 
+// find items whose position is within radius meters of the line segment from start to end
+// start and end are offsets in meters from the EKF origin
+// up to max_indices item indices are written to indices.  returns the number of items found which may be more than max_indices
+uint16_t AP_OADatabase::find_items_near_segment(const Vector3f &start, const Vector3f &end, float radius, uint16_t *indices, uint16_t max_indices) const
+{
+    if (!healthy()) {
+        return 0;
+    }
+
+    // search box around segment
+    const Vector3f pos_min(MIN(start.x, end.x) - radius, MIN(start.y, end.y) - radius, MIN(start.z, end.z) - radius);
+    const Vector3f pos_max(MAX(start.x, end.x) + radius, MAX(start.y, end.y) + radius, MAX(start.z, end.z) + radius);
+
+    uint16_t num_found = 0;
+    GridSearch search;
+    grid_search_start(search, pos_min, pos_max);
+    uint16_t i;
+    while (grid_search_next(search, i)) {
+        if (Vector3f::closest_distance_between_line_and_point(start, end, _database.items[i].pos) > radius) {
+            continue;
+        }
+        if (num_found < max_indices) {
+            indices[num_found] = i;
+        }
+        num_found++;
+    }
+    return num_found;
+}
+
+// clear spatial hash
+void AP_OADatabase::grid_init()
+{
+    if (_database.grid_head == nullptr) {
+        return;
+    }
+    for (uint16_t i = 0; i < _database.grid_num_buckets; i++) {
+        _database.grid_head[i] = AP_OADATABASE_GRID_NONE;
+    }
+}
+
+// get cube holding position (an offset in meters from the EKF origin)
+Vector3l AP_OADatabase::grid_cell(const Vector3f &pos) const
+{
+    return Vector3l(floorf(pos.x / AP_OADATABASE_GRID_CELL_SIZE),
+                    floorf(pos.y / AP_OADATABASE_GRID_CELL_SIZE),
+                    floorf(pos.z / AP_OADATABASE_GRID_CELL_SIZE));
+}
+
+// get spatial hash bucket for a cube
+uint16_t AP_OADatabase::grid_bucket(const Vector3l &cell) const
+{
+    const uint32_t hash = ((uint32_t)cell.x * 73856093U) ^ ((uint32_t)cell.y * 19349663U) ^ ((uint32_t)cell.z * 83492791U);
+    return hash & (_database.grid_num_buckets - 1);
+}
+
+// add database item to the spatial hash
+void AP_OADatabase::grid_insert(const uint16_t index)
+{
+    const uint16_t bucket = grid_bucket(grid_cell(_database.items[index].pos));
+    _database.grid_next[index] = _database.grid_head[bucket];
+    _database.grid_head[bucket] = index;
+}
+
+// remove database item from the spatial hash
+void AP_OADatabase::grid_remove(const uint16_t index)
+{
+    uint16_t *link = &_database.grid_head[grid_bucket(grid_cell(_database.items[index].pos))];
+    while (*link != AP_OADATABASE_GRID_NONE) {
+        if (*link == index) {
+            *link = _database.grid_next[index];
+            return;
+        }
+        link = &_database.grid_next[*link];
+    }
+}
+
+// update spatial hash after a database item has been copied from old_index to new_index
+void AP_OADatabase::grid_move(const uint16_t old_index, const uint16_t new_index)
+{
+    uint16_t *link = &_database.grid_head[grid_bucket(grid_cell(_database.items[new_index].pos))];
+    while (*link != AP_OADATABASE_GRID_NONE) {
+        if (*link == old_index) {
+            *link = new_index;
+            _database.grid_next[new_index] = _database.grid_next[old_index];
+            return;
+        }
+        link = &_database.grid_next[*link];
+    }
+}
+
+// start a search for items within the box from pos_min to pos_max (offsets in meters from the EKF origin)
+// items are then retrieved with grid_search_next which may also return items slightly outside the box
+void AP_OADatabase::grid_search_start(GridSearch &search, const Vector3f &pos_min, const Vector3f &pos_max) const
+{
+    search.cell_min = grid_cell(pos_min);
+    search.cell_max = grid_cell(pos_max);
+    search.cell = search.cell_min;
+
+    // if the box covers more cubes than there are items it is quicker to check every item
+    const float num_cells = (float)(search.cell_max.x - search.cell_min.x + 1) *
+                            (float)(search.cell_max.y - search.cell_min.y + 1) *
+                            (float)(search.cell_max.z - search.cell_min.z + 1);
+    search.all_items = num_cells > _database.count;
+    search.next = search.all_items ? 0 : _database.grid_head[grid_bucket(search.cell)];
+}
+
+// get next item found by a search started with grid_search_start
+// returns false once all items have been found
+bool AP_OADatabase::grid_search_next(GridSearch &search, uint16_t &index) const
+{
+    if (search.all_items) {
+        if (search.next >= _database.count) {
+            return false;
+        }
+        index = search.next++;
+        return true;
+    }
+
+    while (true) {
+        // return items in the current cube, skipping items from other cubes which share the same bucket
+        while (search.next != AP_OADATABASE_GRID_NONE) {
+            const uint16_t i = search.next;
+            search.next = _database.grid_next[i];
+            const Vector3l cell = grid_cell(_database.items[i].pos);
+            if ((cell.x == search.cell.x) && (cell.y == search.cell.y) && (cell.z == search.cell.z)) {
+                index = i;
+                return true;
+            }
+        }
+
+        // move to next cube
+        if (++search.cell.x > search.cell_max.x) {
+            search.cell.x = search.cell_min.x;
+            if (++search.cell.y > search.cell_max.y) {
+                search.cell.y = search.cell_min.y;
+                if (++search.cell.z > search.cell_max.z) {
+                    return false;
+                }
+            }
+        }
+        search.next = _database.grid_head[grid_bucket(search.cell)];
+    }
+}
+
 // send ADSB_VEHICLE mavlink messages
 void AP_OADatabase::send_adsb_vehicle(mavlink_channel_t chan, uint16_t interval_ms)
 {
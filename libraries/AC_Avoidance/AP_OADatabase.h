@@ -38,7 +38,7 @@ public:
     void queue_push(const Vector3f &pos, uint32_t timestamp_ms, float distance);
 
     // returns true if database is healthy
-    bool healthy() const { return (_queue.items != nullptr) && (_database.items != nullptr); }
+    bool healthy() const { return (_queue.items != nullptr) && (_database.items != nullptr) && (_database.grid_head != nullptr) && (_database.grid_next != nullptr); }
 
     // fetch an item in database. Undefined result when i >= _database.count.
     const OA_DbItem& get_item(uint32_t i) const { return _database.items[i]; }
@@ -46,6 +46,14 @@ public:
     // get number of items in the database
     uint16_t database_count() const { return _database.count; }
 
+    // get largest radius (in meters) of any item in the database.  may be larger than the actual largest radius until expired items are removed
+    float get_radius_max() const { return _database.radius_max; }
+
+    // find items whose position is within radius meters of the line segment from start to end
+    // start and end are offsets in meters from the EKF origin
+    // up to max_indices item indices are written to indices.  returns the number of items found which may be more than max_indices
+    uint16_t find_items_near_segment(const Vector3f &start, const Vector3f &end, float radius, uint16_t *indices, uint16_t max_indices) const;
+
     // empty queue and try and put into database. Return true if there's more work to do
     bool process_queue();
 
@@ -73,6 +81,27 @@ private:
     // returns true if database item "index" is close to "item"
     bool is_close_to_item_in_database(const uint16_t index, const OA_DbItem &item) const;
 
+    // spatial hash of database items. Space is divided into cubes and each cube is hashed
+    // to a bucket holding a linked list of the items within it
+    struct GridSearch {
+        Vector3l cell_min;  // lowest corner cube of search
+        Vector3l cell_max;  // highest corner cube of search
+        Vector3l cell;      // cube currently being searched
+        uint16_t next;      // next item to check
+        bool all_items;     // true if all items are being checked because the search covers too many cubes
+    };
+    void grid_init();
+    Vector3l grid_cell(const Vector3f &pos) const;
+    uint16_t grid_bucket(const Vector3l &cell) const;
+    void grid_insert(const uint16_t index);
+    void grid_remove(const uint16_t index);
+    void grid_move(const uint16_t old_index, const uint16_t new_index);
+
+    // start a search for items within the box from pos_min to pos_max (offsets in meters from the EKF origin)
+    // items are then retrieved with grid_search_next which may also return items slightly outside the box
+    void grid_search_start(GridSearch &search, const Vector3f &pos_min, const Vector3f &pos_max) const;
+    bool grid_search_next(GridSearch &search, uint16_t &index) const;
+
     // enum for use with _OUTPUT parameter
     enum class OA_DbOutputLevel {
         OUTPUT_LEVEL_DISABLED = 0,
@@ -102,6 +131,10 @@ private:
         OA_DbItem       *items;                             // array of objects in the database
         uint16_t        count;                              // number of objects in the items array
         uint16_t        size;                               // cached value of _database_size_param that sticks after initialized
+        float           radius_max;                         // largest radius of any object in the database
+        uint16_t        *grid_head;                         // index of first object in each spatial hash bucket
+        uint16_t        *grid_next;                         // index of next object in the same spatial hash bucket
+        uint16_t        grid_num_buckets;                   // number of spatial hash buckets, always a power of two
     } _database;
 
     uint16_t _next_index_to_send[MAVLINK_COMM_NUM_BUFFERS]; // index of next object in _database to send to GCS
@@ -17,6 +17,7 @@
 
 #include <AC_Fence/AC_Fence.h>
 #include <AP_AHRS/AP_AHRS.h>
+#include <AP_Common/Bitmask.h>
 #include <AP_Logger/AP_Logger.h>
 
 #define OA_DIJKSTRA_EXPANDING_ARRAY_ELEMENTS_PER_CHUNK  32      // expanding arrays for fence points and paths to destination will grow in increments of 20 elements
@@ -28,6 +29,10 @@ AP_OADijkstra::AP_OADijkstra() :
         _inclusion_polygon_pts(OA_DIJKSTRA_EXPANDING_ARRAY_ELEMENTS_PER_CHUNK),
         _exclusion_polygon_pts(OA_DIJKSTRA_EXPANDING_ARRAY_ELEMENTS_PER_CHUNK),
         _exclusion_circle_pts(OA_DIJKSTRA_EXPANDING_ARRAY_ELEMENTS_PER_CHUNK),
+        _fence_visgraph_pts(OA_DIJKSTRA_EXPANDING_ARRAY_ELEMENTS_PER_CHUNK),
+        _fence_visgraph_pt_map(OA_DIJKSTRA_EXPANDING_ARRAY_ELEMENTS_PER_CHUNK),
+        _fence_items(OA_DIJKSTRA_EXPANDING_ARRAY_ELEMENTS_PER_CHUNK),
+        _fence_changed_boxes(OA_DIJKSTRA_EXPANDING_ARRAY_ELEMENTS_PER_CHUNK),
         _short_path_data(OA_DIJKSTRA_EXPANDING_ARRAY_ELEMENTS_PER_CHUNK),
         _path(OA_DIJKSTRA_EXPANDING_ARRAY_ELEMENTS_PER_CHUNK)
 {
@@ -587,7 +592,182 @@ bool AP_OADijkstra::intersects_fence(const Vector2f &seg_start, const Vector2f &
     return false;
 }
 
+// returns total number of inclusion and exclusion polygons and circles
+uint16_t AP_OADijkstra::total_fence_items() const
+{
+    const AC_Fence *fence = AC_Fence::get_singleton();
+    if (fence == nullptr) {
+        return 0;
+    }
+    return fence->polyfence().get_inclusion_polygon_count() +
+           fence->polyfence().get_exclusion_polygon_count() +
+           fence->polyfence().get_exclusion_circle_count() +
+           fence->polyfence().get_inclusion_circle_count();
+}
+
+// get hash and bounding box for a single fence item across the total list of items from all fence types
+// returns false if the item could not be retrieved
+bool AP_OADijkstra::get_fence_item(uint16_t index, FenceItem &item) const
+{
+    const AC_Fence *fence = AC_Fence::get_singleton();
+    if (fence == nullptr) {
+        return false;
+    }
+
+    // FNV-1a hash of the item's type and shape
+    uint32_t hash = 2166136261U;
+    const auto hash_add = [&hash](const void *data, uint16_t len) {
+        const uint8_t *b = (const uint8_t *)data;
+        for (uint16_t i = 0; i < len; i++) {
+            hash = (hash ^ b[i]) * 16777619U;
+        }
+    };
+    item.affects_all = false;
+
+    // inclusion and exclusion polygons only affect lines which cross their edges
+    const uint8_t num_inclusion_polygons = fence->polyfence().get_inclusion_polygon_count();
+    const uint8_t num_exclusion_polygons = fence->polyfence().get_exclusion_polygon_count();
+    if (index < num_inclusion_polygons + num_exclusion_polygons) {
+        const bool inclusion = index < num_inclusion_polygons;
+        uint16_t num_points;
+        const Vector2f* boundary = inclusion ? fence->polyfence().get_inclusion_polygon(index, num_points) :
+                                               fence->polyfence().get_exclusion_polygon(index - num_inclusion_polygons, num_points);
+        if ((boundary == nullptr) || (num_points == 0)) {
+            return false;
+        }
+        hash_add(&inclusion, sizeof(inclusion));
+        item.box.min_cm = item.box.max_cm = boundary[0];
+        for (uint16_t i = 0; i < num_points; i++) {
+            hash_add(&boundary[i], sizeof(boundary[i]));
+            item.box.min_cm.x = MIN(item.box.min_cm.x, boundary[i].x);
+            item.box.min_cm.y = MIN(item.box.min_cm.y, boundary[i].y);
+            item.box.max_cm.x = MAX(item.box.max_cm.x, boundary[i].x);
+            item.box.max_cm.y = MAX(item.box.max_cm.y, boundary[i].y);
+        }
+        item.hash = hash;
+        return true;
+    }
+    index -= num_inclusion_polygons + num_exclusion_polygons;
+
+    // exclusion circles only affect lines which pass within their radius
+    // inclusion circles affect any line which leaves the circle
+    const uint8_t num_exclusion_circles = fence->polyfence().get_exclusion_circle_count();
+    const bool inclusion = index >= num_exclusion_circles;
+    Vector2f center_pos_cm;
+    float radius;
+    if (inclusion) {
+        if (!fence->polyfence().get_inclusion_circle(index - num_exclusion_circles, center_pos_cm, radius)) {
+            return false;
+        }
+        item.affects_all = true;
+    } else if (!fence->polyfence().get_exclusion_circle(index, center_pos_cm, radius)) {
+        return false;
+    }
+    const uint8_t item_type = inclusion ? 3 : 2;
+    hash_add(&item_type, sizeof(item_type));
+    hash_add(&center_pos_cm, sizeof(center_pos_cm));
+    hash_add(&radius, sizeof(radius));
+    const Vector2f radius_cm(radius * 100.0f, radius * 100.0f);
+    item.box.min_cm = center_pos_cm - radius_cm;
+    item.box.max_cm = center_pos_cm + radius_cm;
+    item.hash = hash;
+    return true;
+}
+
+// update list of fence items and changed boxes, returns false if all lines must be re-tested
+// requires _fence_items and _fence_items_numitems to hold the items from the previous call
+bool AP_OADijkstra::update_fence_items(AP_OADijkstra_Error &err_id)
+{
+    const uint16_t old_numitems = _fence_items_numitems;
+    const uint16_t new_numitems = total_fence_items();
+    _fence_changed_numboxes = 0;
+
+    // latest items are placed after the previous items
+    if (!_fence_items.expand_to_hold(old_numitems + new_numitems)) {
+        reset_fence_visgraph();
+        err_id = AP_OADijkstra_Error::DIJKSTRA_ERROR_OUT_OF_MEMORY;
+        return false;
+    }
+    for (uint16_t i = 0; i < old_numitems; i++) {
+        _fence_items[i].matched = false;
+    }
+
+    // match each latest item with an identical previous item
+    bool retest_all = false;
+    for (uint16_t i = 0; i < new_numitems; i++) {
+        FenceItem &item = _fence_items[old_numitems + i];
+        if (!get_fence_item(i, item)) {
+            item.hash = 0;
+            item.box = {};
+            item.affects_all = true;
+        }
+        item.matched = false;
+        for (uint16_t j = 0; j < old_numitems; j++) {
+            FenceItem &old_item = _fence_items[j];
+            if (!old_item.matched && (old_item.hash == item.hash)) {
+                old_item.matched = true;
+                item.matched = true;
+                break;
+            }
+        }
+    }
+
+    // any previous or latest item without a match has been removed or added
+    // removed items may have blocked lines which are now clear, added items may block lines which were clear
+    for (uint16_t i = 0; i < old_numitems + new_numitems; i++) {
+        const FenceItem &item = _fence_items[i];
+        if (item.matched) {
+            continue;
+        }
+        if (item.affects_all) {
+            retest_all = true;
+        }
+        if (!_fence_changed_boxes.expand_to_hold(_fence_changed_numboxes + 1)) {
+            reset_fence_visgraph();
+            err_id = AP_OADijkstra_Error::DIJKSTRA_ERROR_OUT_OF_MEMORY;
+            return false;
+        }
+        _fence_changed_boxes[_fence_changed_numboxes++] = item.box;
+    }
+
+    // keep the latest items for the next call
+    for (uint16_t i = 0; i < new_numitems; i++) {
+        _fence_items[i] = _fence_items[old_numitems + i];
+    }
+    _fence_items_numitems = new_numitems;
+
+    return !retest_all;
+}
+
+// returns true if line segment may be affected by any of the changed fence items
+bool AP_OADijkstra::intersects_changed_fence(const Vector2f &seg_start, const Vector2f &seg_end) const
+{
+    const Vector2f seg_min(MIN(seg_start.x, seg_end.x), MIN(seg_start.y, seg_end.y));
+    const Vector2f seg_max(MAX(seg_start.x, seg_end.x), MAX(seg_start.y, seg_end.y));
+
+    // a line can only cross a polygon edge or pass within a circle's radius if their bounding boxes overlap
+    for (uint16_t i = 0; i < _fence_changed_numboxes; i++) {
+        const FenceBox &box = _fence_changed_boxes[i];
+        if ((seg_max.x >= box.min_cm.x) && (seg_min.x <= box.max_cm.x) &&
+            (seg_max.y >= box.min_cm.y) && (seg_min.y <= box.max_cm.y)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// forget the fence points and items used to build _fence_visgraph so that it is completely rebuilt next time
+void AP_OADijkstra::reset_fence_visgraph()
+{
+    _fence_visgraph.clear();
+    _fence_visgraph_numpoints = 0;
+    _fence_items_numitems = 0;
+    _fence_changed_numboxes = 0;
+    _destination_visgraph_ok = false;
+}
+
 // create visibility graph for all fence (with margin) points
+// only lines affected by fence points or fence items that have changed since the last call are re-tested
 // returns true on success.  returns false on failure and err_id is updated
 // requires these functions to have been run create_inclusion_polygon_with_margin, create_exclusion_polygon_with_margin, create_exclusion_circle_with_margin
 bool AP_OADijkstra::create_fence_visgraph(AP_OADijkstra_Error &err_id)
@@ -595,32 +775,92 @@ bool AP_OADijkstra::create_fence_visgraph(AP_OADijkstra_Error &err_id)
     // exit immediately if fence is not enabled
     const AC_Fence *fence = AC_Fence::get_singleton();
     if (fence == nullptr) {
+        reset_fence_visgraph();
         err_id = AP_OADijkstra_Error::DIJKSTRA_ERROR_FENCE_DISABLED;
         return false;
     }
 
     // fail if more fence points than algorithm can handle
     if (total_numpoints() >= OA_DIJKSTRA_POLYGON_SHORTPATH_NOTSET_IDX) {
+        reset_fence_visgraph();
         err_id = AP_OADijkstra_Error::DIJKSTRA_ERROR_TOO_MANY_FENCE_POINTS;
         return false;
     }
 
-    // clear fence points visibility graph
-    _fence_visgraph.clear();
+    // find which fence items have been added or removed.  If the change may affect any line forget the previous points so all lines are re-tested
+    if (!update_fence_items(err_id)) {
+        if (err_id == AP_OADijkstra_Error::DIJKSTRA_ERROR_OUT_OF_MEMORY) {
+            return false;
+        }
+        _fence_visgraph_numpoints = 0;
+    }
+    _destination_visgraph_ok = false;
+
+    // match points with the points used to build the previous visgraph
+    // points which have not moved usually keep their index so check that first
+    const uint8_t numpoints = total_numpoints();
+    Bitmask<OA_DIJKSTRA_POLYGON_SHORTPATH_NOTSET_IDX> unchanged_pts;
+    for (uint8_t i = 0; i < _fence_visgraph_numpoints; i++) {
+        Vector2f pt;
+        if ((i < numpoints) && get_point(i, pt) && (_fence_visgraph_pts[i] == pt)) {
+            _fence_visgraph_pt_map[i] = i;
+            unchanged_pts.set(i);
+        } else {
+            _fence_visgraph_pt_map[i] = OA_DIJKSTRA_POLYGON_SHORTPATH_NOTSET_IDX;
+        }
+    }
+    for (uint8_t j = 0; j < numpoints; j++) {
+        Vector2f pt;
+        if (unchanged_pts.get(j) || !get_point(j, pt)) {
+            continue;
+        }
+        for (uint8_t i = 0; i < _fence_visgraph_numpoints; i++) {
+            if ((_fence_visgraph_pt_map[i] == OA_DIJKSTRA_POLYGON_SHORTPATH_NOTSET_IDX) && (_fence_visgraph_pts[i] == pt)) {
+                _fence_visgraph_pt_map[i] = j;
+                unchanged_pts.set(j);
+                break;
+            }
+        }
+    }
+
+    // keep lines between unchanged points which do not pass near changed fence items, remove all others
+    // iterate backwards because removing an item moves the last item into its place
+    if (_fence_visgraph_numpoints == 0) {
+        _fence_visgraph.clear();
+    }
+    for (int32_t i = _fence_visgraph.num_items() - 1; i >= 0; i--) {
+        AP_OAVisGraph::VisGraphItem &item = _fence_visgraph[i];
+        const uint8_t id1 = item.id1.id_num;
+        const uint8_t id2 = item.id2.id_num;
+        if ((id1 < _fence_visgraph_numpoints) && (id2 < _fence_visgraph_numpoints) &&
+            (_fence_visgraph_pt_map[id1] != OA_DIJKSTRA_POLYGON_SHORTPATH_NOTSET_IDX) &&
+            (_fence_visgraph_pt_map[id2] != OA_DIJKSTRA_POLYGON_SHORTPATH_NOTSET_IDX) &&
+            !intersects_changed_fence(_fence_visgraph_pts[id1], _fence_visgraph_pts[id2])) {
+            item.id1.id_num = _fence_visgraph_pt_map[id1];
+            item.id2.id_num = _fence_visgraph_pt_map[id2];
+        } else {
+            _fence_visgraph.remove_item(i);
+        }
+    }
 
     // calculate distance from each point to all other points
-    for (uint8_t i = 0; i < total_numpoints() - 1; i++) {
+    for (uint8_t i = 0; i < numpoints - 1; i++) {
         Vector2f start_seg;
         if (get_point(i, start_seg)) {
-            for (uint8_t j = i + 1; j < total_numpoints(); j++) {
+            for (uint8_t j = i + 1; j < numpoints; j++) {
                 Vector2f end_seg;
                 if (get_point(j, end_seg)) {
+                    // lines between unchanged points which do not pass near changed fence items were kept above if they were visible
+                    if (unchanged_pts.get(i) && unchanged_pts.get(j) && !intersects_changed_fence(start_seg, end_seg)) {
+                        continue;
+                    }
                     // if line segment does not intersect with any inclusion or exclusion zones add to visgraph
                     if (!intersects_fence(start_seg, end_seg)) {
                         if (!_fence_visgraph.add_item({AP_OAVisGraph::OATYPE_INTERMEDIATE_POINT, i},
                                                       {AP_OAVisGraph::OATYPE_INTERMEDIATE_POINT, j},
                                                       (start_seg - end_seg).length())) {
                             // failure to add a point can only be caused by out-of-memory
+                            reset_fence_visgraph();
                             err_id = AP_OADijkstra_Error::DIJKSTRA_ERROR_OUT_OF_MEMORY;
                             return false;
                         }
@@ -630,6 +870,20 @@ bool AP_OADijkstra::create_fence_visgraph(AP_OADijkstra_Error &err_id)
         }
     }
 
+    // record points used to build this visgraph for the next update
+    if (!_fence_visgraph_pts.expand_to_hold(numpoints) || !_fence_visgraph_pt_map.expand_to_hold(numpoints)) {
+        reset_fence_visgraph();
+        err_id = AP_OADijkstra_Error::DIJKSTRA_ERROR_OUT_OF_MEMORY;
+        return false;
+    }
+    for (uint8_t i = 0; i < numpoints; i++) {
+        if (!get_point(i, _fence_visgraph_pts[i])) {
+            // should never happen but ensure this point is never matched
+            _fence_visgraph_pts[i] = Vector2f(FLT_MAX, FLT_MAX);
+        }
+    }
+    _fence_visgraph_numpoints = numpoints;
+
     return true;
 }
 
@@ -709,6 +963,10 @@ void AP_OADijkstra::update_visible_node_distances(node_index curr_node_idx)
                         // update item's distance and set "distance_from_idx" to current node's index
                         _short_path_data[item_node_idx].distance_cm = dist_to_item_via_current_node;
                         _short_path_data[item_node_idx].distance_from_idx = curr_node_idx;
+                        // add item to heap of unvisited nodes or move it up the heap
+                        if (!_short_path_data[item_node_idx].visited) {
+                            _short_path_heap.push(item_node_idx, dist_to_item_via_current_node);
+                        }
                     }
                 }
             }
@@ -749,25 +1007,16 @@ bool AP_OADijkstra::find_node_from_id(const AP_OAVisGraph::OAItemID &id, node_in
 }
 
 // find index of node with lowest tentative distance (ignore visited nodes)
+// node is removed from _short_path_heap so the caller should mark it as visited
 // returns true if successful and node_idx argument is updated
-bool AP_OADijkstra::find_closest_node_idx(node_index &node_idx) const
+bool AP_OADijkstra::find_closest_node_idx(node_index &node_idx)
 {
-    node_index lowest_idx = 0;
-    float lowest_dist = FLT_MAX;
-
-    // scan through all nodes looking for closest
-    for (node_index i=0; i<_short_path_data_numpoints; i++) {
-        const ShortPathNode &node = _short_path_data[i];
-        if (!node.visited && (node.distance_cm < lowest_dist)) {
-            lowest_idx = i;
-            lowest_dist = node.distance_cm;
+    // nodes are only added to the heap once they have a tentative distance so the top of the heap is the closest
+    while (_short_path_heap.pop(node_idx)) {
+        if (!_short_path_data[node_idx].visited) {
+            return true;
         }
     }
-
-    if (lowest_dist < FLT_MAX) {
-        node_idx = lowest_idx;
-        return true;
-    }
     return false;
 }
 
@@ -784,14 +1033,26 @@ bool AP_OADijkstra::calc_shortest_path(const Location &origin, const Location &d
         return false;
     }
 
+    return calc_shortest_path(origin_NE, destination_NE, err_id);
+}
+
+// calculate shortest path from origin to destination given as offsets (in cm) from the EKF origin
+// returns true on success.  returns false on failure and err_id is updated
+bool AP_OADijkstra::calc_shortest_path(const Vector2f &origin_NE, const Vector2f &destination_NE, AP_OADijkstra_Error &err_id)
+{
     // create visgraphs of origin and destination to fence points
     if (!update_visgraph(_source_visgraph, {AP_OAVisGraph::OATYPE_SOURCE, 0}, origin_NE, true, destination_NE)) {
         err_id = AP_OADijkstra_Error::DIJKSTRA_ERROR_OUT_OF_MEMORY;
         return false;
     }
-    if (!update_visgraph(_destination_visgraph, {AP_OAVisGraph::OATYPE_DESTINATION, 0}, destination_NE)) {
-        err_id = AP_OADijkstra_Error::DIJKSTRA_ERROR_OUT_OF_MEMORY;
-        return false;
+    // destination visgraph only needs to be rebuilt if the destination or fence has changed
+    if (!_destination_visgraph_ok || (_destination_visgraph_pos != destination_NE)) {
+        _destination_visgraph_ok = update_visgraph(_destination_visgraph, {AP_OAVisGraph::OATYPE_DESTINATION, 0}, destination_NE);
+        if (!_destination_visgraph_ok) {
+            err_id = AP_OADijkstra_Error::DIJKSTRA_ERROR_OUT_OF_MEMORY;
+            return false;
+        }
+        _destination_visgraph_pos = destination_NE;
     }
 
     // expand _short_path_data if necessary
@@ -802,12 +1063,18 @@ bool AP_OADijkstra::calc_shortest_path(const Location &origin, const Location &d
 
     // add origin and destination (node_type, id, visited, distance_from_idx, distance_cm) to short_path_data array
     _short_path_data[0] = {{AP_OAVisGraph::OATYPE_SOURCE, 0}, false, 0, 0};
-    _short_path_data[1] = {{AP_OAVisGraph::OATYPE_DESTINATION, 0}, false, OA_DIJKSTRA_POLYGON_SHORTPATH_NOTSET_IDX, FLT_MAX};
+    _short_path_data[1] = {{AP_OAVisGraph::OATYPE_DESTINATION, 0}, false, NODE_NOTSET, FLT_MAX};
     _short_path_data_numpoints = 2;
 
     // add all inclusion and exclusion fence points to short_path_data array (node_type, id, visited, distance_from_idx, distance_cm)
     for (uint8_t i=0; i<total_numpoints(); i++) {
-        _short_path_data[_short_path_data_numpoints++] = {{AP_OAVisGraph::OATYPE_INTERMEDIATE_POINT, i}, false, OA_DIJKSTRA_POLYGON_SHORTPATH_NOTSET_IDX, FLT_MAX};
+        _short_path_data[_short_path_data_numpoints++] = {{AP_OAVisGraph::OATYPE_INTERMEDIATE_POINT, i}, false, NODE_NOTSET, FLT_MAX};
+    }
+
+    // prepare heap used to find the closest unvisited node
+    if (!_short_path_heap.init(_short_path_data_numpoints)) {
+        err_id = AP_OADijkstra_Error::DIJKSTRA_ERROR_OUT_OF_MEMORY;
+        return false;
     }
 
     // start algorithm from source point
@@ -819,6 +1086,7 @@ bool AP_OADijkstra::calc_shortest_path(const Location &origin, const Location &d
         if (find_node_from_id(_source_visgraph[i].id2, node_idx)) {
             _short_path_data[node_idx].distance_cm = _source_visgraph[i].distance_cm;
             _short_path_data[node_idx].distance_from_idx = current_node_idx;
+            _short_path_heap.push(node_idx, _source_visgraph[i].distance_cm);
         } else {
             err_id = AP_OADijkstra_Error::DIJKSTRA_ERROR_COULD_NOT_FIND_PATH;
             return false;
@@ -850,7 +1118,7 @@ bool AP_OADijkstra::calc_shortest_path(const Location &origin, const Location &d
             return false;
         }
         // fail if newest node has invalid distance_from_index
-        if ((_short_path_data[nidx].distance_from_idx == OA_DIJKSTRA_POLYGON_SHORTPATH_NOTSET_IDX) ||
+        if ((_short_path_data[nidx].distance_from_idx == NODE_NOTSET) ||
             (_short_path_data[nidx].distance_cm >= FLT_MAX)) {
             break;
         } else {
@@ -5,6 +5,7 @@
 #include <AP_Math/AP_Math.h>
 #include <AP_HAL/AP_HAL.h>
 #include "AP_OAVisGraph.h"
+#include "AP_OANodeHeap.h"
 
 /*
  * Dijkstra's algorithm for path planning around polygon fence
@@ -36,10 +37,9 @@ public:
     // returns DIJKSTRA_STATE_SUCCESS and populates origin_new and destination_new if avoidance is required
     AP_OADijkstra_State update(const Location &current_loc, const Location &destination, Location& origin_new, Location& destination_new);
 
-private:
+protected:
 
-    // returns true if at least one inclusion or exclusion zone is enabled
-    bool some_fences_enabled() const;
+    // the individual steps of update(), so they can be run and timed separately
 
     enum class AP_OADijkstra_Error : uint8_t {
         DIJKSTRA_ERROR_NONE = 0,
@@ -53,6 +53,30 @@ private:
         DIJKSTRA_ERROR_COULD_NOT_FIND_PATH
     };
 
+    // create polygons around existing exclusion circles
+    // returns true on success.  returns false on failure and err_id is updated
+    bool create_exclusion_circle_with_margin(float margin_cm, AP_OADijkstra_Error &err_id);
+
+    // create visibility graph for all fence (with margin) points
+    // only lines affected by fence points or fence items that have changed since the last call are re-tested
+    // returns true on success.  returns false on failure and err_id is updated
+    bool create_fence_visgraph(AP_OADijkstra_Error &err_id);
+
+    // forget the fence points and items used to build _fence_visgraph so that it is completely rebuilt next time
+    void reset_fence_visgraph();
+
+    // calculate shortest path from origin to destination
+    // returns true on success.  returns false on failure and err_id is updated
+    // requires create_polygon_fence_with_margin and create_polygon_fence_visgraph to have been run
+    // resulting path is stored in _shortest_path array as vector offsets from EKF origin
+    bool calc_shortest_path(const Location &origin, const Location &destination, AP_OADijkstra_Error &err_id);
+    bool calc_shortest_path(const Vector2f &origin_NE, const Vector2f &destination_NE, AP_OADijkstra_Error &err_id);
+
+private:
+
+    // returns true if at least one inclusion or exclusion zone is enabled
+    bool some_fences_enabled() const;
+
     // return error message for a given error id
     const char* get_error_msg(AP_OADijkstra_Error error_id) const;
 
@@ -91,10 +115,6 @@ private:
     // returns true if changed
     bool check_exclusion_circle_updated() const;
 
-    // create polygons around existing exclusion circles
-    // returns true on success.  returns false on failure and err_id is updated
-    bool create_exclusion_circle_with_margin(float margin_cm, AP_OADijkstra_Error &err_id);
-
     //
     // other methods
     //
@@ -109,15 +129,33 @@ private:
     // returns true if line segment intersects polygon or circular fence
     bool intersects_fence(const Vector2f &seg_start, const Vector2f &seg_end) const;
 
-    // create visibility graph for all fence (with margin) points
-    // returns true on success.  returns false on failure and err_id is updated
-    bool create_fence_visgraph(AP_OADijkstra_Error &err_id);
+    // bounding box of a fence item (i.e. polygon or circle) in cm from the ekf origin
+    struct FenceBox {
+        Vector2f min_cm;
+        Vector2f max_cm;
+    };
 
-    // calculate shortest path from origin to destination
-    // returns true on success.  returns false on failure and err_id is updated
-    // requires create_polygon_fence_with_margin and create_polygon_fence_visgraph to have been run
-    // resulting path is stored in _shortest_path array as vector offsets from EKF origin
-    bool calc_shortest_path(const Location &origin, const Location &destination, AP_OADijkstra_Error &err_id);
+    // fence item details used to find which items have changed between calls to create_fence_visgraph
+    struct FenceItem {
+        uint32_t hash;      // hash of the item's type and shape
+        FenceBox box;       // bounding box of item
+        bool affects_all;   // true if adding or removing this item may affect lines outside its bounding box
+        bool matched;       // true if an identical item was found in the other list
+    };
+
+    // returns total number of inclusion and exclusion polygons and circles
+    uint16_t total_fence_items() const;
+
+    // get hash and bounding box for a single fence item across the total list of items from all fence types
+    // returns false if the item could not be retrieved
+    bool get_fence_item(uint16_t index, FenceItem &item) const;
+
+    // update list of fence items and changed boxes, returns false if all lines must be re-tested
+    // requires _fence_items and _fence_items_numitems to hold the items from the previous call
+    bool update_fence_items(AP_OADijkstra_Error &err_id);
+
+    // returns true if line segment may be affected by any of the changed fence items
+    bool intersects_changed_fence(const Vector2f &seg_start, const Vector2f &seg_end) const;
 
     // shortest path state variables
     bool _inclusion_polygon_with_margin_ok;
@@ -150,21 +188,36 @@ private:
     AP_OAVisGraph _source_visgraph;         // holds distances from source point to all other nodes
     AP_OAVisGraph _destination_visgraph;    // holds distances from the destination to all other nodes
 
+    // variables used to update the fence visgraph incrementally
+    AP_ExpandingArray<Vector2f> _fence_visgraph_pts;    // fence points (with margin) used to build _fence_visgraph
+    AP_ExpandingArray<uint8_t> _fence_visgraph_pt_map;  // new index of each point in _fence_visgraph_pts or 255 if point has moved or been removed
+    uint8_t _fence_visgraph_numpoints;                  // number of points held in above arrays
+    AP_ExpandingArray<FenceItem> _fence_items;          // fence items used to build _fence_visgraph followed by the latest fence items
+    uint16_t _fence_items_numitems;                     // number of fence items used to build _fence_visgraph
+    AP_ExpandingArray<FenceBox> _fence_changed_boxes;   // bounding boxes of fence items added or removed since _fence_visgraph was last built
+    uint16_t _fence_changed_numboxes;                   // number of boxes held in above array
+
+    // destination visgraph is only rebuilt when the destination moves or the fence changes
+    bool _destination_visgraph_ok;          // true if _destination_visgraph is valid for _destination_visgraph_pos
+    Vector2f _destination_visgraph_pos;     // destination used to build _destination_visgraph (offset in cm from EKF origin)
+
     // updates visibility graph for a given position which is an offset (in cm) from the ekf origin
     // to add an additional position (i.e. the destination) set add_extra_position = true and provide the position in the extra_position argument
     // requires create_polygon_fence_with_margin to have been run
     // returns true on success
     bool update_visgraph(AP_OAVisGraph& visgraph, const AP_OAVisGraph::OAItemID& oaid, const Vector2f &position, bool add_extra_position = false, Vector2f extra_position = Vector2f(0,0));
 
-    typedef uint8_t node_index;         // indices into short path data
+    typedef uint16_t node_index;        // indices into short path data
     struct ShortPathNode {
         AP_OAVisGraph::OAItemID id;     // unique id for node (combination of type and id number)
         bool visited;                   // true if all this node's neighbour's distances have been updated
-        node_index distance_from_idx;   // index into _short_path_data from where distance was updated (or 255 if not set)
+        node_index distance_from_idx;   // index into _short_path_data from where distance was updated (or NODE_NOTSET if not set)
         float distance_cm;              // distance from source (number is tentative until this node is the current node and/or visited = true)
     };
+    static const node_index NODE_NOTSET = UINT16_MAX;  // distance_from_idx value used when a node has no tentative short path
     AP_ExpandingArray<ShortPathNode> _short_path_data;
     node_index _short_path_data_numpoints;  // number of elements in _short_path_data array
+    AP_OANodeHeap _short_path_heap;         // unvisited nodes with a tentative distance ordered by distance
 
     // update total distance for all nodes visible from current node
     // curr_node_idx is an index into the _short_path_data array
@@ -175,8 +228,9 @@ private:
     bool find_node_from_id(const AP_OAVisGraph::OAItemID &id, node_index &node_idx) const;
 
     // find index of node with lowest tentative distance (ignore visited nodes)
+    // node is removed from _short_path_heap so the caller should mark it as visited
     // returns true if successful and node_idx argument is updated
-    bool find_closest_node_idx(node_index &node_idx) const;
+    bool find_closest_node_idx(node_index &node_idx);
 
     // final path variables and functions
     AP_ExpandingArray<AP_OAVisGraph::OAItemID> _path;   // ids of points on return path in reverse order (i.e. destination is first element)
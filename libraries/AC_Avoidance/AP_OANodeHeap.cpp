@@ -0,0 +1,123 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AP_OANodeHeap.h"
+
+#define OA_NODEHEAP_EXPANDING_ARRAY_ELEMENTS_PER_CHUNK  32
+
+// constructor initialises expanding arrays
+AP_OANodeHeap::AP_OANodeHeap() :
+    _items(OA_NODEHEAP_EXPANDING_ARRAY_ELEMENTS_PER_CHUNK),
+    _node_pos(OA_NODEHEAP_EXPANDING_ARRAY_ELEMENTS_PER_CHUNK)
+{
+}
+
+// empty the heap and prepare it to hold nodes with indices 0 ~ num_nodes-1
+// returns false if out of memory
+bool AP_OANodeHeap::init(uint16_t num_nodes)
+{
+    _num_items = 0;
+    _num_nodes = 0;
+
+    if (!_items.expand_to_hold(num_nodes) || !_node_pos.expand_to_hold(num_nodes)) {
+        return false;
+    }
+    for (uint16_t i = 0; i < num_nodes; i++) {
+        _node_pos[i] = NODE_NONE;
+    }
+    _num_nodes = num_nodes;
+    return true;
+}
+
+// add a node to the heap or, if it is already in the heap, reduce its distance
+// distance_cm must not be higher than the node's current distance in the heap
+void AP_OANodeHeap::push(node_index node, float distance_cm)
+{
+    if (node >= _num_nodes) {
+        return;
+    }
+
+    node_index pos = _node_pos[node];
+    if (pos == NODE_NONE) {
+        // add to bottom of heap
+        pos = _num_items++;
+    }
+    set_item(pos, {distance_cm, node});
+    sift_up(pos);
+}
+
+// remove and return the node with the lowest distance
+// returns false if heap is empty
+bool AP_OANodeHeap::pop(node_index &node)
+{
+    if (_num_items == 0) {
+        return false;
+    }
+
+    node = _items[0].node;
+    _node_pos[node] = NODE_NONE;
+    _num_items--;
+
+    // move bottom item to top and restore ordering
+    if (_num_items > 0) {
+        set_item(0, _items[_num_items]);
+        sift_down(0);
+    }
+    return true;
+}
+
+// move item up the heap until its parent is closer
+void AP_OANodeHeap::sift_up(node_index pos)
+{
+    const HeapItem item = _items[pos];
+    while (pos > 0) {
+        const node_index parent = (pos - 1) / 2;
+        if (_items[parent].distance_cm <= item.distance_cm) {
+            break;
+        }
+        set_item(pos, _items[parent]);
+        pos = parent;
+    }
+    set_item(pos, item);
+}
+
+// move item down the heap until both children are further away
+void AP_OANodeHeap::sift_down(node_index pos)
+{
+    const HeapItem item = _items[pos];
+    while (true) {
+        uint32_t child = 2 * (uint32_t)pos + 1;
+        if (child >= _num_items) {
+            break;
+        }
+        // pick closer of the two children
+        if ((child + 1 < _num_items) && (_items[child + 1].distance_cm < _items[child].distance_cm)) {
+            child++;
+        }
+        if (item.distance_cm <= _items[child].distance_cm) {
+            break;
+        }
+        set_item(pos, _items[child]);
+        pos = child;
+    }
+    set_item(pos, item);
+}
+
+// place item at pos and update the node's position
+void AP_OANodeHeap::set_item(node_index pos, const HeapItem &item)
+{
+    _items[pos] = item;
+    _node_pos[item.node] = pos;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <AP_Common/AP_Common.h>
+#include <AP_Common/AP_ExpandingArray.h>
+
+/*
+ * Binary min-heap of node indices ordered by each node's tentative distance.
+ * Used by Dijkstra's algorithm to find the closest unvisited node without scanning every node
+ */
+class AP_OANodeHeap {
+public:
+    AP_OANodeHeap();
+
+    /* Do not allow copies */
+    AP_OANodeHeap(const AP_OANodeHeap &other) = delete;
+    AP_OANodeHeap &operator=(const AP_OANodeHeap&) = delete;
+
+    // node indices are limited to 0 ~ 65534, 65535 is used to indicate a node is not in the heap
+    typedef uint16_t node_index;
+    static const node_index NODE_NONE = UINT16_MAX;
+
+    // empty the heap and prepare it to hold nodes with indices 0 ~ num_nodes-1
+    // returns false if out of memory
+    bool init(uint16_t num_nodes);
+
+    // returns true if heap holds no nodes
+    bool empty() const { return _num_items == 0; }
+
+    // add a node to the heap or, if it is already in the heap, reduce its distance
+    // distance_cm must not be higher than the node's current distance in the heap
+    void push(node_index node, float distance_cm);
+
+    // remove and return the node with the lowest distance
+    // returns false if heap is empty
+    bool pop(node_index &node);
+
+private:
+
+    struct HeapItem {
+        float distance_cm;      // tentative distance of node
+        node_index node;        // node's index into caller's node array
+    };
+
+    // move item up or down the heap to restore heap ordering
+    void sift_up(node_index pos);
+    void sift_down(node_index pos);
+
+    // place item at pos and update the node's position
+    void set_item(node_index pos, const HeapItem &item);
+
+    AP_ExpandingArray<HeapItem> _items;         // heap ordered items, lowest distance first
+    AP_ExpandingArray<node_index> _node_pos;     // each node's position in _items or NODE_NONE if not in heap
+    uint16_t _num_nodes;                        // number of nodes the heap was initialised for
+    node_index _num_items;                      // number of items in the heap
+};
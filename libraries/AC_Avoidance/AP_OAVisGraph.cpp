@@ -39,3 +39,15 @@ bool AP_OAVisGraph::add_item(const OAItemID &id1, const OAItemID &id2, float dis
     _num_items++;
     return true;
 }
+
+// remove item from visibility graph.  The last item is moved into its place so item order is not preserved
+void AP_OAVisGraph::remove_item(uint16_t i)
+{
+    if (i >= _num_items) {
+        return;
+    }
+    _num_items--;
+    if (i != _num_items) {
+        _items[i] = _items[_num_items];
+    }
+}
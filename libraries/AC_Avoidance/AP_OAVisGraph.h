@@ -48,9 +48,13 @@ public:
     // add item to visiblity graph, returns true on success, false if graph is full
     bool add_item(const OAItemID &id1, const OAItemID &id2, float distance_cm);
 
+    // remove item from visibility graph.  The last item is moved into its place so item order is not preserved
+    void remove_item(uint16_t i);
+
     // allow accessing graph as an array, 0 indexed
     // Note: no protection against out-of-bounds accesses so use with num_items()
     const VisGraphItem& operator[](uint16_t i) const { return _items[i]; }
+    VisGraphItem& operator[](uint16_t i) { return _items[i]; }
 
 private:
 
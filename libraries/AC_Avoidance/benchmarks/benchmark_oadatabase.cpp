@@ -0,0 +1,132 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Param/AP_Param.h>
+#include <AC_Avoidance/AP_OADatabase.h>
+#include <GCS_MAVLink/GCS_Dummy.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+/*
+  database of 1000 objects spread over a 200m square, fed by a 360
+  degree lidar returning one point per degree at 10Hz
+ */
+#define BENCH_DB_SIZE           1000
+#define BENCH_DB_AREA_M         200.0f
+#define BENCH_LIDAR_POINTS      360
+#define BENCH_LIDAR_RANGE_M     20.0f
+
+static AP_Int16 format_version;
+static AP_OADatabase oadb;
+
+static const struct AP_Param::Info var_info[] = {
+    { AP_PARAM_INT16, "FORMAT_VERSION", 0, (const void *)&format_version, {def_value : 0} },
+    { AP_PARAM_GROUP, "OA_DB_", 1, (const void *)&oadb, {group_info : AP_OADatabase::var_info} },
+    AP_VAREND
+};
+
+static AP_Param param_loader{var_info};
+
+static void set_param(const char *name, float value)
+{
+    enum ap_var_type ptype;
+    AP_Param *p = AP_Param::find(name, &ptype);
+    if (p != nullptr) {
+        p->set_float(value, ptype);
+    }
+}
+
+static void push_and_process(const Vector3f &pos, float distance, uint32_t timestamp_ms)
+{
+    oadb.queue_push(pos, timestamp_ms, distance);
+    while (oadb.process_queue()) {}
+}
+
+// fill database with objects on a grid
+static void setup_database()
+{
+    static bool done;
+    if (done) {
+        return;
+    }
+    done = true;
+
+    set_param("OA_DB_SIZE", BENCH_DB_SIZE);
+    set_param("OA_DB_QUEUE_SIZE", 200);
+    set_param("OA_DB_EXPIRE", 0);
+    oadb.init();
+
+    const uint16_t per_side = sqrtf(BENCH_DB_SIZE);
+    const float spacing = BENCH_DB_AREA_M / per_side;
+    for (uint16_t x = 0; x < per_side; x++) {
+        for (uint16_t y = 0; y < per_side; y++) {
+            const Vector3f pos(x * spacing - BENCH_DB_AREA_M * 0.5f, y * spacing - BENCH_DB_AREA_M * 0.5f, 0.0f);
+            push_and_process(pos, BENCH_LIDAR_RANGE_M * 0.25f, 0);
+        }
+    }
+}
+
+// one full lidar scan from the middle of the database
+static void BM_OADatabaseLidarScan(benchmark::State& state)
+{
+    setup_database();
+    uint32_t timestamp_ms = 0;
+    while (state.KeepRunning()) {
+        timestamp_ms += 100;
+        for (uint16_t i = 0; i < BENCH_LIDAR_POINTS; i++) {
+            const float angle = radians(i);
+            const Vector3f pos(cosf(angle) * BENCH_LIDAR_RANGE_M, sinf(angle) * BENCH_LIDAR_RANGE_M, 0.0f);
+            oadb.queue_push(pos, timestamp_ms, BENCH_LIDAR_RANGE_M);
+            if ((i % 100) == 99) {
+                while (oadb.process_queue()) {}
+            }
+        }
+        while (oadb.process_queue()) {}
+    }
+    state.SetLabel(std::to_string(oadb.database_count()) + " objects");
+}
+
+// BendyRuler style query: objects within 5m of a 15m lookahead in each of 72 directions
+static void BM_OADatabaseSegmentQuery(benchmark::State& state)
+{
+    setup_database();
+    uint16_t indices[64];
+    while (state.KeepRunning()) {
+        uint32_t total = 0;
+        for (uint16_t bearing = 0; bearing < 360; bearing += 5) {
+            const float angle = radians(bearing);
+            const Vector3f end(cosf(angle) * 15.0f, sinf(angle) * 15.0f, 0.0f);
+            total += oadb.find_items_near_segment(Vector3f(), end, 5.0f + oadb.get_radius_max(), indices, ARRAY_SIZE(indices));
+        }
+        gbenchmark_escape(&total);
+    }
+}
+
+// linear scan of every object in each of 72 directions as BendyRuler did before the spatial index
+static void BM_OADatabaseSegmentLinear(benchmark::State& state)
+{
+    setup_database();
+    while (state.KeepRunning()) {
+        float smallest_margin = FLT_MAX;
+        for (uint16_t bearing = 0; bearing < 360; bearing += 5) {
+            const float angle = radians(bearing);
+            const Vector3f end(cosf(angle) * 15.0f, sinf(angle) * 15.0f, 0.0f);
+            for (uint16_t i = 0; i < oadb.database_count(); i++) {
+                const AP_OADatabase::OA_DbItem& item = oadb.get_item(i);
+                smallest_margin = MIN(smallest_margin, Vector3f::closest_distance_between_line_and_point(Vector3f(), end, item.pos) - item.radius);
+            }
+        }
+        gbenchmark_escape(&smallest_margin);
+    }
+}
+
+BENCHMARK(BM_OADatabaseLidarScan);
+BENCHMARK(BM_OADatabaseSegmentQuery);
+BENCHMARK(BM_OADatabaseSegmentLinear);
+
+const AP_Param::GroupInfo GCS_MAVLINK_Parameters::var_info[] = {
+    AP_GROUPEND
+};
+GCS_Dummy _gcs;
+
+BENCHMARK_MAIN();
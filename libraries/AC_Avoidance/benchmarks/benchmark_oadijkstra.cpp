@@ -0,0 +1,189 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <AC_Fence/AC_Fence.h>
+#include <AC_Avoidance/AP_OADijkstra.h>
+#include <GCS_MAVLink/GCS_Dummy.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+/*
+  exclusion circles of 30m radius scattered over a 1.2km square.  Each
+  circle becomes 6 fence points so 10, 21 and 42 circles give 60, 126
+  and 252 points, the last being close to the most AP_OADijkstra
+  accepts.  The circles are written to fence storage and loaded as they
+  are in flight so the planner runs exactly as it does in the vehicle
+ */
+#define BENCH_AREA_CM           120000.0f
+#define BENCH_CIRCLE_RADIUS_M   30.0f
+#define BENCH_MAX_CIRCLES       42
+#define BENCH_FENCE_MARGIN_M    10.0f
+
+static AC_Fence fence;
+
+// EKF origin the fence is loaded relative to
+static const Location bench_origin{-353632610, 1491652300, 58400, Location::AltFrame::ABSOLUTE};
+
+class AP_OADijkstra_Benchmark : public AP_OADijkstra {
+public:
+    AP_OADijkstra_Benchmark() {
+        set_fence_margin(BENCH_FENCE_MARGIN_M);
+    }
+
+    // load num_circles exclusion circles into the fence and create the planner's points around them
+    bool load_circles(uint8_t num_circles)
+    {
+        for (uint8_t i = 0; i < num_circles; i++) {
+            // golden angle spiral spreads the circles evenly without a regular grid
+            const float angle = i * 2.39996f;
+            const float dist = 0.45f * BENCH_AREA_CM * sqrtf((i + 0.5f) / num_circles);
+            circles_cm[i] = Vector2f(cosf(angle), sinf(angle)) * dist;
+        }
+        num_loaded = num_circles;
+        reset_fence_visgraph();
+        return store_circles() && create_circle_points();
+    }
+
+    // move the first circle by offset_cm, as when a single fence item is
+    // edited.  Writing and loading the fence is not timed
+    bool move_circle(benchmark::State& state, const Vector2f &offset_cm)
+    {
+        state.PauseTiming();
+        circles_cm[0] += offset_cm;
+        const bool stored = store_circles();
+        state.ResumeTiming();
+        return stored && create_circle_points();
+    }
+
+    bool create_fence_visgraph()
+    {
+        Error err;
+        return AP_OADijkstra::create_fence_visgraph(err);
+    }
+
+    using AP_OADijkstra::reset_fence_visgraph;
+
+    bool calc_shortest_path(const Vector2f &origin_NE, const Vector2f &destination_NE)
+    {
+        Error err;
+        return AP_OADijkstra::calc_shortest_path(origin_NE, destination_NE, err);
+    }
+
+private:
+    typedef AP_OADijkstra::AP_OADijkstra_Error Error;
+
+    // write the circles to fence storage and load them back
+    bool store_circles()
+    {
+        AC_PolyFenceItem items[BENCH_MAX_CIRCLES];
+        for (uint8_t i = 0; i < num_loaded; i++) {
+            Location loc = bench_origin;
+            loc.offset(circles_cm[i].x * 0.01f, circles_cm[i].y * 0.01f);
+            items[i].type = AC_PolyFenceType::CIRCLE_EXCLUSION;
+            items[i].loc = Vector2l(loc.lat, loc.lng);
+            items[i].radius = BENCH_CIRCLE_RADIUS_M;
+        }
+        AC_PolyFence_loader &polyfence = fence.polyfence();
+        const uint32_t last_load_ms = polyfence.get_exclusion_circle_update_ms();
+        if (!polyfence.write_fence(items, num_loaded)) {
+            return false;
+        }
+        // the planner only sees a change when the load time moves on.
+        // Spin rather than delay as there is no SITL clock here
+        while (AP_HAL::millis() == last_load_ms) {
+        }
+        return polyfence.load_from_eeprom(bench_origin);
+    }
+
+    // create the planner's points around the loaded circles
+    bool create_circle_points()
+    {
+        Error err;
+        return create_exclusion_circle_with_margin(BENCH_FENCE_MARGIN_M * 100.0f, err);
+    }
+
+    Vector2f circles_cm[BENCH_MAX_CIRCLES];
+    uint8_t num_loaded;
+};
+
+static void BM_OADijkstraShortestPath(benchmark::State& state)
+{
+    AP_OADijkstra_Benchmark oa;
+    if (!oa.load_circles(state.range_x())) {
+        state.SkipWithError("load_circles failed");
+        return;
+    }
+    if (!oa.create_fence_visgraph()) {
+        state.SkipWithError("create_fence_visgraph failed");
+        return;
+    }
+    // path across the whole area
+    const Vector2f origin_NE(-0.5f * BENCH_AREA_CM, -0.5f * BENCH_AREA_CM);
+    const Vector2f destination_NE(0.5f * BENCH_AREA_CM, 0.5f * BENCH_AREA_CM);
+    while (state.KeepRunning()) {
+        if (!oa.calc_shortest_path(origin_NE, destination_NE)) {
+            state.SkipWithError("calc_shortest_path failed");
+            return;
+        }
+    }
+}
+
+static void BM_OADijkstraVisGraphFullRebuild(benchmark::State& state)
+{
+    AP_OADijkstra_Benchmark oa;
+    if (!oa.load_circles(state.range_x())) {
+        state.SkipWithError("load_circles failed");
+        return;
+    }
+    uint8_t n = 0;
+    while (state.KeepRunning()) {
+        // move one circle back and forth then rebuild the whole graph
+        if (!oa.move_circle(state, Vector2f((n++ & 1) ? 1000.0f : -1000.0f, 0))) {
+            state.SkipWithError("move_circle failed");
+            return;
+        }
+        oa.reset_fence_visgraph();
+        if (!oa.create_fence_visgraph()) {
+            state.SkipWithError("create_fence_visgraph failed");
+            return;
+        }
+    }
+}
+
+static void BM_OADijkstraVisGraphIncremental(benchmark::State& state)
+{
+    AP_OADijkstra_Benchmark oa;
+    if (!oa.load_circles(state.range_x())) {
+        state.SkipWithError("load_circles failed");
+        return;
+    }
+    if (!oa.create_fence_visgraph()) {
+        state.SkipWithError("create_fence_visgraph failed");
+        return;
+    }
+    uint8_t n = 0;
+    while (state.KeepRunning()) {
+        // move one circle back and forth and only re-test lines near it
+        if (!oa.move_circle(state, Vector2f((n++ & 1) ? 1000.0f : -1000.0f, 0))) {
+            state.SkipWithError("move_circle failed");
+            return;
+        }
+        if (!oa.create_fence_visgraph()) {
+            state.SkipWithError("create_fence_visgraph failed");
+            return;
+        }
+    }
+}
+
+// argument is the number of exclusion circles
+BENCHMARK(BM_OADijkstraShortestPath)->Arg(10)->Arg(21)->Arg(BENCH_MAX_CIRCLES);
+BENCHMARK(BM_OADijkstraVisGraphFullRebuild)->Arg(10)->Arg(21)->Arg(BENCH_MAX_CIRCLES);
+BENCHMARK(BM_OADijkstraVisGraphIncremental)->Arg(10)->Arg(21)->Arg(BENCH_MAX_CIRCLES);
+
+const AP_Param::GroupInfo GCS_MAVLINK_Parameters::var_info[] = {
+    AP_GROUPEND
+};
+GCS_Dummy _gcs;
+
+BENCHMARK_MAIN();
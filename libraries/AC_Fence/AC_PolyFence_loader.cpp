@@ -618,6 +618,19 @@ bool AC_PolyFence_loader::load_from_eeprom()
         return false;
     }
 
+    return load_from_eeprom(ekf_origin);
+}
+
+bool AC_PolyFence_loader::load_from_eeprom(const Location &ekf_origin)
+{
+    if (!check_indexed()) {
+        return false;
+    }
+
+    if (_load_attempted) {
+        return _load_time_ms != 0;
+    }
+
     // find indexes of each fence:
     if (!get_loaded_fence_semaphore().take_nonblocking()) {
         return false;
@@ -152,6 +152,9 @@ public:
     // _loaded_offsets_from_origin and perform validation.  returns
     // true if load successfully completed
     bool load_from_eeprom() WARN_IF_UNUSED;
+    // as above but with the EKF origin supplied by the caller rather
+    // than taken from AHRS
+    bool load_from_eeprom(const Location &ekf_origin) WARN_IF_UNUSED;
 
     // allow threads to lock against AHRS update
     HAL_Semaphore &get_loaded_fence_semaphore(void) {
@@ -280,6 +280,25 @@ uint32_t AP_Filesystem_Mission::get_num_items(enum MAV_MISSION_TYPE mtype) const
     return 0;
 }
 
+// get number of items that can be uploaded
+uint32_t AP_Filesystem_Mission::get_max_items(enum MAV_MISSION_TYPE mtype) const
+{
+    switch (mtype) {
+    case MAV_MISSION_TYPE_MISSION: {
+        auto *mission = AP::mission();
+        if (!mission) {
+            return 0;
+        }
+        return mission->num_commands_max();
+    }
+
+    default:
+        // only missions can be uploaded
+        break;
+    }
+    return 0;
+}
+
 /*
   support mission upload
  */
@@ -299,6 +318,15 @@ int32_t AP_Filesystem_Mission::write(int fd, const void *buf, uint32_t count)
     if (r.file_ofs == 0 && count >= sizeof(hdr)) {
         // pre-expand the buffer to the full size when we get the header
         memcpy(&hdr, buf, sizeof(hdr));
+        if (hdr.magic != mission_magic) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (uint32_t(hdr.start) + hdr.num_items > get_max_items(r.mtype)) {
+            // fail now rather than after the whole file is sent
+            errno = ENOSPC;
+            return -1;
+        }
         if (hdr.num_items < 0xFFFF) {
             const uint32_t flen = sizeof(hdr) + hdr.num_items * MAVLINK_MSG_ID_MISSION_ITEM_INT_LEN;
             if (flen > r.writebuf->get_length()) {
@@ -334,10 +362,42 @@ bool AP_Filesystem_Mission::all_zero(const uint8_t *b, uint8_t len) const
 }
 
 /*
-  finish mission upload
+  convert one uploaded item, returns false if it is invalid
+ */
+bool AP_Filesystem_Mission::get_upload_item(const uint8_t *b, uint32_t i, uint16_t num_commands, AP_Mission::Mission_Command &cmd) const
+{
+    const uint8_t item_size = MAVLINK_MSG_ID_MISSION_ITEM_INT_LEN;
+    mavlink_mission_item_int_t m {};
+    memcpy(&m, &b[sizeof(struct header)+i*item_size], item_size);
+    cmd = {};
+    const MAV_MISSION_RESULT res = AP_Mission::mavlink_int_to_mission_cmd(m, cmd);
+    if (res != MAV_MISSION_ACCEPTED) {
+        return false;
+    }
+    if (cmd.id == MAV_CMD_DO_JUMP &&
+        (cmd.content.jump.target >= num_commands || cmd.content.jump.target == 0)) {
+        return false;
+    }
+    return true;
+}
+
+/*
+  finish mission upload. The upload is staged in RAM and every item is
+  checked before the mission is touched, then the items are written and
+  the new mission is switched to with a single save of the number of
+  commands, so a bad upload leaves the old mission in place.
+
+  The switch-over is not crash-atomic: the items overwrite the old
+  mission's slots in storage before the number of commands changes, so
+  a reset or a storage write failure part way through leaves a mix of
+  old and new items. Surviving that would need a second copy of the
+  mission in storage, which most boards don't have room for
  */
 bool AP_Filesystem_Mission::finish_upload(const rfile &r)
 {
+    if (r.mtype != MAV_MISSION_TYPE_MISSION) {
+        return false;
+    }
     const uint32_t flen = r.writebuf->get_length();
     const uint8_t *b = (const uint8_t *)r.writebuf->get_string();
     struct header hdr;
@@ -369,31 +429,38 @@ bool AP_Filesystem_Mission::finish_upload(const rfile &r)
         return false;
     }
     WITH_SEMAPHORE(mission->get_semaphore());
-    if ((hdr.options & unsigned(Options::NO_CLEAR)) == 0) {
-        mission->clear();
+
+    // without NO_CLEAR the file is the whole mission, otherwise it
+    // replaces and appends to the current mission from start
+    const bool no_clear = (hdr.options & unsigned(Options::NO_CLEAR)) != 0;
+    const uint32_t end = uint32_t(hdr.start) + nitems;
+    if (no_clear ? (hdr.start > mission->num_commands()) : (hdr.start != 0)) {
+        return false;
     }
+    if (end > mission->num_commands_max()) {
+        return false;
+    }
+    const uint16_t num_commands = no_clear ? MAX(end, mission->num_commands()) : end;
+
+    AP_Mission::Mission_Command cmd;
     for (uint32_t i=0; i<nitems; i++) {
-        mavlink_mission_item_int_t m {};
-        AP_Mission::Mission_Command cmd;
-        memcpy(&m, &b[sizeof(hdr)+i*item_size], item_size);
-        const MAV_MISSION_RESULT res = AP_Mission::mavlink_int_to_mission_cmd(m, cmd);
-        if (res != MAV_MISSION_ACCEPTED) {
+        if (!get_upload_item(b, i, num_commands, cmd)) {
             return false;
         }
-        if (cmd.id == MAV_CMD_DO_JUMP &&
-            (cmd.content.jump.target >= nitems || cmd.content.jump.target == 0)) {
+    }
+
+    for (uint32_t i=0; i<nitems; i++) {
+        if (!get_upload_item(b, i, num_commands, cmd) ||
+            !mission->write_cmd_to_storage(i + hdr.start, cmd)) {
             return false;
         }
-        uint16_t idx = i + hdr.start;
-        if (idx == mission->num_commands()) {
-            if (!mission->add_cmd(cmd)) {
-                return false;
-            }
-        } else {
-            if (!mission->replace_cmd(idx, cmd)) {
-                return false;
-            }
-        }
+    }
+    if (!mission->set_num_commands(num_commands)) {
+        return false;
+    }
+    if (!no_clear && mission->state() != AP_Mission::MISSION_RUNNING) {
+        // start the new mission from the beginning
+        mission->reset();
     }
     return true;
 }
@@ -18,6 +18,7 @@
 #include "AP_Filesystem_backend.h"
 #include <GCS_MAVLink/GCS_MAVLink.h>
 #include <AP_Common/ExpandingString.h>
+#include <AP_Mission/AP_Mission.h>
 
 class AP_Filesystem_Mission : public AP_Filesystem_Backend
 {
@@ -66,9 +67,15 @@ private:
     // get number of items
     uint32_t get_num_items(enum MAV_MISSION_TYPE mtype) const;
 
+    // get number of items that can be uploaded
+    uint32_t get_max_items(enum MAV_MISSION_TYPE mtype) const;
+
     // finish loading items
     bool finish_upload(const rfile &r);
 
+    // convert one uploaded item, returns false if it is invalid
+    bool get_upload_item(const uint8_t *b, uint32_t i, uint16_t num_commands, AP_Mission::Mission_Command &cmd) const;
+
     // see if a block of memory is all zero
     bool all_zero(const uint8_t *b, uint8_t size) const;
 };
@@ -0,0 +1,312 @@
+#include <AP_gtest.h>
+
+#include <AP_Filesystem/AP_Filesystem.h>
+#include <AP_Mission/AP_Mission.h>
+#include <GCS_MAVLink/GCS_Dummy.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  upload missions through @MISSION/mission.dat and check what is
+  accepted and what is left in the mission
+ */
+
+static bool start_cmd(const AP_Mission::Mission_Command &) { return true; }
+static bool verify_cmd(const AP_Mission::Mission_Command &) { return true; }
+static void mission_complete() {}
+
+static AP_Mission mission{
+    FUNCTOR_BIND(&start_cmd, bool, const AP_Mission::Mission_Command &),
+    FUNCTOR_BIND(&verify_cmd, bool, const AP_Mission::Mission_Command &),
+    FUNCTOR_BIND(&mission_complete, void)};
+
+static const uint16_t mission_magic = 0x763d;
+static const uint16_t option_no_clear = 1U<<0;
+static const uint8_t header_size = 10;
+static const uint8_t item_size = MAVLINK_MSG_ID_MISSION_ITEM_INT_LEN;
+
+// a mission.dat file
+class MissionFile {
+public:
+    MissionFile(uint16_t num_items, uint16_t start=0, uint16_t options=0, uint16_t magic=mission_magic) :
+        len(header_size + num_items * item_size)
+    {
+        data = new uint8_t[len] {};
+        const uint16_t hdr[] { magic, MAV_MISSION_TYPE_MISSION, options, start, num_items };
+        memcpy(data, hdr, header_size);
+    }
+    ~MissionFile() { delete[] data; }
+
+    void set_item(uint16_t i, const mavlink_mission_item_int_t &item)
+    {
+        memcpy(&data[header_size + i * item_size], &item, item_size);
+    }
+
+    uint8_t *data;
+    const uint32_t len;
+};
+
+static mavlink_mission_item_int_t waypoint(uint16_t seq, int32_t lat)
+{
+    mavlink_mission_item_int_t item {};
+    item.seq = seq;
+    item.command = MAV_CMD_NAV_WAYPOINT;
+    item.frame = MAV_FRAME_GLOBAL_RELATIVE_ALT_INT;
+    item.x = lat;
+    item.y = 1491652370;
+    item.z = 50;
+    return item;
+}
+
+static mavlink_mission_item_int_t jump(uint16_t seq, uint16_t target)
+{
+    mavlink_mission_item_int_t item {};
+    item.seq = seq;
+    item.command = MAV_CMD_DO_JUMP;
+    item.frame = MAV_FRAME_MISSION;
+    item.param1 = target;
+    item.param2 = 2;
+    return item;
+}
+
+// a file of count waypoints from start, with latitudes from lat
+static void fill(MissionFile &f, uint16_t start, uint16_t count, int32_t lat)
+{
+    for (uint16_t i = 0; i < count; i++) {
+        f.set_item(i, waypoint(start + i, lat + i));
+    }
+}
+
+// write the file in chunks of chunk bytes, the second chunk last as
+// a windowed upload may deliver it, returns the result of close()
+static int upload(const char *name, const MissionFile &f, uint32_t chunk=100)
+{
+    const int fd = AP::FS().open(name, O_WRONLY|O_CREAT|O_TRUNC);
+    if (fd == -1) {
+        return -1;
+    }
+    bool ok = true;
+    for (uint32_t ofs = 0; ok && ofs < f.len; ofs += chunk) {
+        if (ofs == chunk) {
+            continue;
+        }
+        const uint32_t n = MIN(chunk, f.len - ofs);
+        ok = AP::FS().lseek(fd, ofs, SEEK_SET) == int32_t(ofs) &&
+             AP::FS().write(fd, &f.data[ofs], n) == int32_t(n);
+    }
+    if (ok && f.len > chunk) {
+        const uint32_t n = MIN(chunk, f.len - chunk);
+        ok = AP::FS().lseek(fd, chunk, SEEK_SET) == int32_t(chunk) &&
+             AP::FS().write(fd, &f.data[chunk], n) == int32_t(n);
+    }
+    const int ret = AP::FS().close(fd);
+    return ok ? ret : -1;
+}
+
+// latitude of the waypoint at index
+static int32_t lat_at(uint16_t index)
+{
+    AP_Mission::Mission_Command cmd;
+    if (!mission.read_cmd_from_storage(index, cmd)) {
+        return 0;
+    }
+    return cmd.content.location.lat;
+}
+
+// replace the mission with home and count waypoints from lat
+static void load(uint16_t count, int32_t lat)
+{
+    MissionFile f(count + 1);
+    fill(f, 0, count + 1, lat);
+    ASSERT_EQ(0, upload("@MISSION/mission.dat", f));
+    ASSERT_EQ(count + 1, mission.num_commands());
+}
+
+TEST(AP_Filesystem_Mission, upload)
+{
+    load(20, -353630000);
+    for (uint16_t i = 1; i <= 20; i++) {
+        EXPECT_EQ(-353630000 + i, lat_at(i));
+    }
+
+    // a shorter mission replaces it completely
+    load(3, -353640000);
+    EXPECT_EQ(-353640003, lat_at(3));
+}
+
+TEST(AP_Filesystem_Mission, reject_leaves_mission)
+{
+    load(6, -353630000);
+
+    // an item missing from the middle
+    {
+        MissionFile f(10);
+        fill(f, 0, 10, -353650000);
+        memset(&f.data[header_size + 5 * item_size], 0, item_size);
+        EXPECT_EQ(-1, upload("@MISSION/mission.dat", f));
+    }
+    EXPECT_EQ(7, mission.num_commands());
+    EXPECT_EQ(-353630001, lat_at(1));
+    EXPECT_EQ(-353630006, lat_at(6));
+
+    // an item which doesn't convert
+    {
+        MissionFile f(4);
+        fill(f, 0, 4, -353650000);
+        mavlink_mission_item_int_t bad = waypoint(2, -353650002);
+        bad.param1 = nanf("");
+        f.set_item(2, bad);
+        EXPECT_EQ(-1, upload("@MISSION/mission.dat", f));
+    }
+    EXPECT_EQ(7, mission.num_commands());
+    EXPECT_EQ(-353630001, lat_at(1));
+
+    // a header with the wrong magic is rejected at the header, not as
+    // being too big
+    {
+        MissionFile f(4, 0, 0, 0x1234);
+        fill(f, 0, 4, -353650000);
+        const int fd = AP::FS().open("@MISSION/mission.dat", O_WRONLY);
+        ASSERT_NE(-1, fd);
+        errno = 0;
+        EXPECT_EQ(-1, AP::FS().write(fd, f.data, f.len));
+        EXPECT_EQ(EINVAL, errno);
+        EXPECT_EQ(-1, AP::FS().close(fd));
+    }
+
+    // a mission bigger than storage fails at the header
+    {
+        MissionFile f(0);
+        const uint16_t hdr[] { mission_magic, MAV_MISSION_TYPE_MISSION, 0, 0, uint16_t(mission.num_commands_max() + 1) };
+        memcpy(f.data, hdr, header_size);
+        const int fd = AP::FS().open("@MISSION/mission.dat", O_WRONLY);
+        ASSERT_NE(-1, fd);
+        errno = 0;
+        EXPECT_EQ(-1, AP::FS().write(fd, f.data, f.len));
+        EXPECT_EQ(ENOSPC, errno);
+        EXPECT_EQ(-1, AP::FS().close(fd));
+    }
+    EXPECT_EQ(7, mission.num_commands());
+    EXPECT_EQ(-353630006, lat_at(6));
+}
+
+TEST(AP_Filesystem_Mission, jump_target)
+{
+    load(6, -353630000);
+
+    // the target is checked against the new mission, which is shorter
+    {
+        MissionFile f(4);
+        fill(f, 0, 4, -353650000);
+        f.set_item(3, jump(3, 5));
+        EXPECT_EQ(-1, upload("@MISSION/mission.dat", f));
+        EXPECT_EQ(7, mission.num_commands());
+    }
+    {
+        MissionFile f(4);
+        fill(f, 0, 4, -353650000);
+        f.set_item(3, jump(3, 0));
+        EXPECT_EQ(-1, upload("@MISSION/mission.dat", f));
+    }
+    {
+        MissionFile f(4);
+        fill(f, 0, 4, -353650000);
+        f.set_item(3, jump(3, 1));
+        EXPECT_EQ(0, upload("@MISSION/mission.dat", f));
+        EXPECT_EQ(4, mission.num_commands());
+    }
+
+    // with NO_CLEAR the rest of the old mission is kept, so the target
+    // can be past the uploaded items
+    load(6, -353630000);
+    {
+        MissionFile f(2, 2, option_no_clear);
+        fill(f, 2, 2, -353660000);
+        f.set_item(1, jump(3, 5));
+        EXPECT_EQ(0, upload("@MISSION/mission.dat", f));
+        EXPECT_EQ(7, mission.num_commands());
+    }
+}
+
+TEST(AP_Filesystem_Mission, no_clear)
+{
+    load(6, -353630000);
+
+    // replace part of the mission
+    {
+        MissionFile f(2, 3, option_no_clear);
+        fill(f, 3, 2, -353660000);
+        EXPECT_EQ(0, upload("@MISSION/mission.dat", f));
+    }
+    EXPECT_EQ(7, mission.num_commands());
+    EXPECT_EQ(-353630002, lat_at(2));
+    EXPECT_EQ(-353660000, lat_at(3));
+    EXPECT_EQ(-353660001, lat_at(4));
+    EXPECT_EQ(-353630005, lat_at(5));
+
+    // append to it
+    {
+        MissionFile f(3, 7, option_no_clear);
+        fill(f, 7, 3, -353670000);
+        EXPECT_EQ(0, upload("@MISSION/mission.dat", f));
+    }
+    EXPECT_EQ(10, mission.num_commands());
+    EXPECT_EQ(-353630006, lat_at(6));
+    EXPECT_EQ(-353670002, lat_at(9));
+
+    // leaving a gap is refused
+    {
+        MissionFile f(1, 11, option_no_clear);
+        fill(f, 11, 1, -353680000);
+        EXPECT_EQ(-1, upload("@MISSION/mission.dat", f));
+    }
+    EXPECT_EQ(10, mission.num_commands());
+
+    // without NO_CLEAR the upload has to start at 0
+    {
+        MissionFile f(2, 3);
+        fill(f, 3, 2, -353680000);
+        EXPECT_EQ(-1, upload("@MISSION/mission.dat", f));
+    }
+    EXPECT_EQ(10, mission.num_commands());
+    EXPECT_EQ(-353660000, lat_at(3));
+}
+
+TEST(AP_Filesystem_Mission, mission_state)
+{
+    load(6, -353630000);
+    ASSERT_TRUE(mission.set_current_cmd(4));
+    EXPECT_EQ(4, mission.get_current_nav_index());
+    EXPECT_EQ(AP_Mission::MISSION_STOPPED, mission.state());
+
+    // a partial upload leaves the current command alone
+    {
+        MissionFile f(1, 2, option_no_clear);
+        fill(f, 2, 1, -353660000);
+        EXPECT_EQ(0, upload("@MISSION/mission.dat", f));
+    }
+    EXPECT_EQ(4, mission.get_current_nav_index());
+
+    // a full upload to a stopped mission starts it from the beginning
+    load(6, -353640000);
+    EXPECT_EQ(0, mission.get_current_nav_index());
+    EXPECT_EQ(AP_Mission::MISSION_STOPPED, mission.state());
+}
+
+TEST(AP_Filesystem_Mission, fence_rally_refused)
+{
+    load(3, -353630000);
+    MissionFile f(3);
+    fill(f, 0, 3, -353650000);
+    EXPECT_EQ(-1, upload("@MISSION/fence.dat", f));
+    EXPECT_EQ(-1, upload("@MISSION/rally.dat", f));
+    EXPECT_EQ(4, mission.num_commands());
+    EXPECT_EQ(-353630001, lat_at(1));
+}
+
+const AP_Param::GroupInfo GCS_MAVLINK_Parameters::var_info[] = {
+    AP_GROUPEND
+};
+GCS_Dummy _gcs;
+
+AP_GTEST_MAIN()
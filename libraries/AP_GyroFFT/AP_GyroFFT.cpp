@@ -155,6 +155,14 @@ const AP_Param::GroupInfo AP_GyroFFT::var_info[] = {
     // @User: Advanced
     AP_GROUPINFO("HMNC_PEAK", 13, AP_GyroFFT, _harmonic_peak, 0),
 
+    // @Param: OPTIONS
+    // @DisplayName: FFT options
+    // @Description: FFT analysis options. Batch axes analyses the roll, pitch and yaw windows together each cycle rather than one axis per cycle in turn, so that a change in the noise frequency reaches all axes in one cycle at the cost of three times the memory for FFT state and a longer cycle. FTN1.Lat shows the resulting detection latency.
+    // @Bitmask: 0:Batch axes
+    // @User: Advanced
+    // @RebootRequired: True
+    AP_GROUPINFO("OPTIONS", 14, AP_GyroFFT, _options, 0),
+
     AP_GROUPEND
 };
 
@@ -209,9 +217,12 @@ void AP_GyroFFT::init(uint32_t target_looptime_us)
     // 16 gives a maximum output rate of 2Khz / 16 = 125Hz per axis or 375Hz in aggregate
     _samples_per_frame = MAX(FFT_MIN_SAMPLES_PER_FRAME, 1 << lrintf(log2f(_samples_per_frame)));
 
+    _batch_axes = option_is_set(Options::BATCH_AXES);
+    const uint8_t num_states = _batch_axes ? XYZ_AXIS_COUNT : 1;
+
     // check that we have enough memory for the window size requested
-    // INS: XYZ_AXIS_COUNT * INS_MAX_INSTANCES * _window_size, DSP: 3 * _window_size, FFT: XYZ_AXIS_COUNT + 3 * _window_size
-    const uint32_t allocation_count = (XYZ_AXIS_COUNT * INS_MAX_INSTANCES + 3 + XYZ_AXIS_COUNT + 3) * sizeof(float);
+    // INS: XYZ_AXIS_COUNT * INS_MAX_INSTANCES * _window_size, DSP: 3 * _window_size per state, FFT: XYZ_AXIS_COUNT + 3 * _window_size
+    const uint32_t allocation_count = (XYZ_AXIS_COUNT * INS_MAX_INSTANCES + 3 * num_states + XYZ_AXIS_COUNT + 3) * sizeof(float);
     if (allocation_count * FFT_DEFAULT_WINDOW_SIZE > hal.util->available_memory() / 2) {
         gcs().send_text(MAV_SEVERITY_WARNING, "AP_GyroFFT: disabled, required %u bytes", (unsigned int)allocation_count * FFT_DEFAULT_WINDOW_SIZE);
         return;
@@ -273,12 +284,20 @@ void AP_GyroFFT::init(uint32_t target_looptime_us)
         }
     }
 
-    // initialise the HAL DSP subsystem
-    _state = hal.dsp->fft_init(_window_size, _fft_sampling_rate_hz, _harmonics);
-    if (_state == nullptr) {
-        gcs().send_text(MAV_SEVERITY_WARNING, "Failed to initialize DSP engine");
-        return;
+    // initialise the HAL DSP subsystem, with a separate state for each axis when they are batched
+    for (uint8_t axis = 0; axis < num_states; axis++) {
+        _axis_state[axis] = hal.dsp->fft_init(_window_size, _fft_sampling_rate_hz, _harmonics);
+        if (_axis_state[axis] == nullptr) {
+            // free the states of the axes already initialised
+            for (uint8_t i = 0; i < axis; i++) {
+                delete _axis_state[i];
+                _axis_state[i] = nullptr;
+            }
+            gcs().send_text(MAV_SEVERITY_WARNING, "Failed to initialize DSP engine");
+            return;
+        }
     }
+    _state = _axis_state[0];
 
     // per-axis frame time
     _frame_time_ms = _samples_per_frame * 1000 / _fft_sampling_rate_hz;
@@ -392,7 +411,7 @@ uint16_t AP_GyroFFT::run_cycle()
 
     // do we have enough samples for another pass?
     if (!start_analysis()) {
-        uint16_t new_sample_count =  get_available_samples(_update_axis);
+        uint16_t new_sample_count = get_cycle_samples();
         _sem.give();
         return new_sample_count;
     }
@@ -404,37 +423,107 @@ uint16_t AP_GyroFFT::run_cycle()
 
     uint32_t now = AP_HAL::micros();
 
-    // get the appropriate gyro buffer
-    FloatBuffer& gyro_buffer = (_sample_mode == 0 ?_ins->get_raw_gyro_window(_update_axis) : _downsampled_gyro_data[_update_axis]);
-    // if we have many more samples than the window size then we are struggling to 
-    // stay ahead of the gyro loop so drop samples so that this cycle will use all available samples
-    if (gyro_buffer.available() > uint32_t(_state->_window_size + uint16_t(_samples_per_frame >> 1))) { // half the frame size is a heuristic
-        gyro_buffer.advance(gyro_buffer.available() - _state->_window_size);
+    // calculate FFT and update filters outside the semaphore
+    if (_batch_axes) {
+        run_batch_cycle(config, now);
+    } else {
+        run_axis_cycle(config, now);
+    }
+
+    // record how we are doing
+    const uint32_t done_us = AP_HAL::micros();
+    _output_cycle_micros = done_us - now;
+    // the output now depends on the oldest window of any axis, in round-robin that is the axis
+    // analysed two cycles ago
+    uint32_t oldest_window_us = now;
+    for (uint8_t axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        if (_window_end_us[axis] != 0 && int32_t(_window_end_us[axis] - oldest_window_us) < 0) {
+            oldest_window_us = _window_end_us[axis];
+        }
     }
+    _thread_state._output_latency_us = done_us - oldest_window_us;
+
+    // ready to receive another frame, because lock contention is so expensive we don't lock
+    // around this flag but rather rely on the semaphore at the beginning of the loop to
+    // ensure eventual visibility to the main loop
+    _thread_state._analysis_started = false;
+
+    // samples remaining for the next cycle
+    return get_cycle_samples();
+}
+
+// analyse the current axis and move onto the next one
+// called from FFT thread
+void AP_GyroFFT::run_axis_cycle(const EngineConfig& config, uint32_t now)
+{
+    // get the appropriate gyro buffer
+    FloatBuffer& gyro_buffer = get_analysis_buffer(_update_axis);
+    _window_end_us[_update_axis] = now;
     // let's go!
     hal.dsp->fft_start(_state, gyro_buffer, _samples_per_frame);
 
-    // calculate FFT and update filters outside the semaphore
     uint16_t bin_max = hal.dsp->fft_analyse(_state, config._fft_start_bin, config._fft_end_bin, config._attenuation_cutoff);
 
     // something has been detected, update the peak frequency and associated metrics
     update_ref_energy(bin_max);
     calculate_noise(false, config);
 
-    // record how we are doing
     _thread_state._last_output_us[_update_axis] = AP_HAL::micros();
-    _output_cycle_micros = _thread_state._last_output_us[_update_axis] - now;
 
     // move onto the next axis
     _update_axis = (_update_axis + 1) % XYZ_AXIS_COUNT;
+}
 
-    // ready to receive another frame, because lock contention is so expensive we don't lock
-    // around this flag but rather rely on the semaphore at the beginning of the loop to
-    // ensure eventual visibility to the main loop
-    _thread_state._analysis_started = false;
+// analyse the same window of all three axes, the windowing and FFT are interleaved across axes by the HAL
+// called from FFT thread
+void AP_GyroFFT::run_batch_cycle(const EngineConfig& config, uint32_t now)
+{
+    FloatBuffer* gyro_buffers[XYZ_AXIS_COUNT];
+    for (uint8_t axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        gyro_buffers[axis] = &get_analysis_buffer(axis);
+    }
+
+    // the windows hold the previous cycle's samples if any axis is short, skip the analysis
+    if (!hal.dsp->fft_start_batch(_axis_state, gyro_buffers, XYZ_AXIS_COUNT, _samples_per_frame)) {
+        return;
+    }
+    for (uint8_t axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        _window_end_us[axis] = now;
+    }
 
-    // samples remaining in the next axis
-    return get_available_samples(_update_axis);
+    uint16_t bin_max[XYZ_AXIS_COUNT];
+    hal.dsp->fft_analyse_batch(_axis_state, XYZ_AXIS_COUNT, config._fft_start_bin, config._fft_end_bin, config._attenuation_cutoff, bin_max);
+
+    // peak tracking works on one axis at a time
+    for (_update_axis = 0; _update_axis < XYZ_AXIS_COUNT; _update_axis++) {
+        _state = _axis_state[_update_axis];
+        update_ref_energy(bin_max[_update_axis]);
+        calculate_noise(false, config);
+        _thread_state._last_output_us[_update_axis] = AP_HAL::micros();
+    }
+    _update_axis = 0;
+    _state = _axis_state[0];
+}
+
+// return samples available for the next analysis cycle
+uint16_t AP_GyroFFT::get_cycle_samples()
+{
+    if (!_batch_axes) {
+        return get_available_samples(_update_axis);
+    }
+    return MIN(get_available_samples(0), MIN(get_available_samples(1), get_available_samples(2)));
+}
+
+// return the gyro buffer to analyse for an axis
+FloatBuffer& AP_GyroFFT::get_analysis_buffer(uint8_t axis)
+{
+    FloatBuffer& gyro_buffer = (_sample_mode == 0 ?_ins->get_raw_gyro_window(axis) : _downsampled_gyro_data[axis]);
+    // if we have many more samples than the window size then we are struggling to
+    // stay ahead of the gyro loop so drop samples so that this cycle will use all available samples
+    if (gyro_buffer.available() > uint32_t(_state->_window_size + uint16_t(_samples_per_frame >> 1))) { // half the frame size is a heuristic
+        gyro_buffer.advance(gyro_buffer.available() - _state->_window_size);
+    }
+    return gyro_buffer;
 }
 
 // whether analysis can be run again or not
@@ -448,7 +537,7 @@ bool AP_GyroFFT::start_analysis() {
         return false;
     }
 
-    if (get_available_samples(_update_axis) >= _state->_window_size) {
+    if (get_cycle_samples() >= _state->_window_size) {
         _thread_state._analysis_started = true;
         return true;
     }
@@ -774,6 +863,7 @@ float AP_GyroFFT::calculate_weighted_freq_hz(const Vector3f& energy, const Vecto
 // @Field: FtZ: harmonic fit on yaw of the highest noise peak to the second highest noise peak
 // @Field: FH: FFT health
 // @Field: Tc: FFT cycle time
+// @Field: Lat: FFT detection latency, the age of the oldest analysed axis window when the last cycle completed
 
 // log gyro fft messages
 void AP_GyroFFT::write_log_messages()
@@ -786,10 +876,10 @@ void AP_GyroFFT::write_log_messages()
 
     AP::logger().Write(
         "FTN1",
-        "TimeUS,PkAvg,BwAvg,DnF,SnX,SnY,SnZ,FtX,FtY,FtZ,FH,Tc",
-        "szzz---%%%-s",
-        "F----------F",
-        "QfffffffffBI",
+        "TimeUS,PkAvg,BwAvg,DnF,SnX,SnY,SnZ,FtX,FtY,FtZ,FH,Tc,Lat",
+        "szzz---%%%-ss",
+        "F----------FF",
+        "QfffffffffBII",
         AP_HAL::micros64(),
         get_weighted_noise_center_freq_hz(),
         get_weighted_noise_center_bandwidth_hz(),
@@ -800,7 +890,7 @@ void AP_GyroFFT::write_log_messages()
         get_raw_noise_harmonic_fit().x,
         get_raw_noise_harmonic_fit().y,
         get_raw_noise_harmonic_fit().z,
-        _health, _output_cycle_micros);
+        _health, _output_cycle_micros, _global_state._output_latency_us);
 
     const float* notches = _ins->get_gyro_dynamic_notch_center_frequencies_hz();
 
@@ -839,11 +929,12 @@ void AP_GyroFFT::write_log_messages()
 // @Field: EnX: power spectral density bin energy of the peak on roll
 // @Field: EnY: power spectral density bin energy of the peak on roll
 // @Field: EnZ: power spectral density bin energy of the peak on roll
+// @Field: Lat: FFT detection latency, as FTN1.Lat
 
 // write a single log message
 void AP_GyroFFT::log_noise_peak(uint8_t id, FrequencyPeak peak, float notch) const
 {
-    AP::logger().Write("FTN2", "TimeUS,Id,PkX,PkY,PkZ,DnF,BwX,BwY,BwZ,EnX,EnY,EnZ", "s#zzzzzzz---", "F-----------", "QBffffffffff",
+    AP::logger().Write("FTN2", "TimeUS,Id,PkX,PkY,PkZ,DnF,BwX,BwY,BwZ,EnX,EnY,EnZ,Lat", "s#zzzzzzz---s", "F-----------F", "QBffffffffffI",
         AP_HAL::micros64(),
         id,
         get_noise_center_freq_hz(peak).x,
@@ -855,7 +946,8 @@ void AP_GyroFFT::log_noise_peak(uint8_t id, FrequencyPeak peak, float notch) con
         get_noise_center_bandwidth_hz(peak).z,
         get_center_freq_energy(peak).x,
         get_center_freq_energy(peak).y,
-        get_center_freq_energy(peak).z);
+        get_center_freq_energy(peak).z,
+        _global_state._output_latency_us);
 }
 
 // return an average noise bandwidth weighted by bin energy
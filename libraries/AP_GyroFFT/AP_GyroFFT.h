@@ -107,6 +107,12 @@ public:
     static AP_GyroFFT *get_singleton() { return _singleton; }
 
 private:
+    // options
+    enum class Options : uint8_t {
+        BATCH_AXES = (1U<<0),
+    };
+    bool option_is_set(Options option) const { return (_options & uint8_t(option)) != 0; }
+
     // configuration data local to the FFT thread but set from the main thread
     struct EngineConfig {
         // whether the analyzer should be run
@@ -203,10 +209,18 @@ private:
     bool analysis_enabled() const { return _initialized && _analysis_enabled && _thread_created; };
     // whether analysis can be run again or not
     bool start_analysis();
+    // analyse the current axis
+    void run_axis_cycle(const EngineConfig& config, uint32_t now);
+    // analyse all three axes in one batch
+    void run_batch_cycle(const EngineConfig& config, uint32_t now);
     // return samples available in the gyro window
     uint16_t get_available_samples(uint8_t axis) {
         return _sample_mode == 0 ?_ins->get_raw_gyro_window(axis).available() : _downsampled_gyro_data[axis].available();
     }
+    // return samples available for the next analysis cycle
+    uint16_t get_cycle_samples();
+    // return the gyro buffer to analyse for an axis, dropping samples if we are falling behind
+    FloatBuffer& get_analysis_buffer(uint8_t axis);
     // semaphore for access to shared FFT data
     HAL_Semaphore _sem;
 
@@ -225,6 +239,8 @@ private:
         Vector3ul _health_ms;
         // fft engine output rate
         uint32_t _output_cycle_ms;
+        // age of the oldest axis window when the last cycle completed
+        uint32_t _output_latency_us;
         // tracked frequency peak
         Vector3<uint8_t> _tracked_peak;
         // signal to noise ratio of PSD at the detected centre frequency
@@ -263,8 +279,14 @@ private:
     // count of oversamples
     uint16_t _oversampled_gyro_count;
 
-    // state of the FFT engine
+    // state of the FFT engine for the axis being analysed
     AP_HAL::DSP::FFTWindowState* _state;
+    // state of the FFT engine for each axis, only the first is used unless axes are batched
+    AP_HAL::DSP::FFTWindowState* _axis_state[XYZ_AXIS_COUNT];
+    // whether all axes are analysed together each cycle
+    bool _batch_axes;
+    // time at which the newest samples of each axis were analysed
+    uint32_t _window_end_us[XYZ_AXIS_COUNT];
     // update state machine step information
     uint8_t _update_axis;
     // noise base of the gyros
@@ -334,6 +356,8 @@ private:
     AP_Int8 _harmonic_fit;
     // harmonic peak target
     AP_Int8 _harmonic_peak;
+    // engine options
+    AP_Int8 _options;
     AP_InertialSensor* _ins;
 #if DEBUG_FFT
     uint32_t _last_output_ms;
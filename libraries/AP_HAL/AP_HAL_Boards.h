@@ -185,6 +185,8 @@
 #endif
 
 #ifndef HAL_WITH_DSP
+// Linux boards which can spare the CPU for GyroFFT enable HAL_WITH_DSP
+// in board/linux.h and get the RealFFT backend in AP_HAL/RealFFTDSP
 #if CONFIG_HAL_BOARD == HAL_BOARD_LINUX || defined(HAL_BOOTLOADER_BUILD) || defined(HAL_BUILD_AP_PERIPH) || BOARD_FLASH_SIZE <= 1024
 #define HAL_WITH_DSP 0
 #else
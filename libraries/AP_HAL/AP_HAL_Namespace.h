@@ -30,8 +30,10 @@ namespace AP_HAL {
     class EventHandle;
     class EventSource;
     class Semaphore;
+    class BinarySemaphore;
     class OpticalFlow;
     class DSP;
+    class RealFFTDSP;
 
     class CANIface;
     class CANFrame;
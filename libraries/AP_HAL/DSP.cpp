@@ -76,6 +76,29 @@ DSP::FFTWindowState::~FFTWindowState()
     _rfft_data = nullptr;
 }
 
+// start FFT analyses of count windows, backends that can process the windows
+// together override this
+bool DSP::fft_start_batch(FFTWindowState* const states[], FloatBuffer* const samples[], uint8_t count, uint16_t advance)
+{
+    for (uint8_t i = 0; i < count; i++) {
+        if (samples[i]->available() < states[i]->_window_size) {
+            return false;
+        }
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        fft_start(states[i], *samples[i], advance);
+    }
+    return true;
+}
+
+// perform remaining steps of count FFT analyses
+void DSP::fft_analyse_batch(FFTWindowState* const states[], uint8_t count, uint16_t start_bin, uint16_t end_bin, float noise_att_cutoff, uint16_t* max_bins)
+{
+    for (uint8_t i = 0; i < count; i++) {
+        max_bins[i] = fft_analyse(states[i], start_bin, end_bin, noise_att_cutoff);
+    }
+}
+
 // step 3: find the magnitudes of the complex data
 void DSP::step_cmplx_mag(FFTWindowState* fft, uint16_t start_bin, uint16_t end_bin, float noise_att_cutoff)
 {
@@ -26,6 +26,8 @@
 #define DSP_MEM_REGION AP_HAL::Util::MEM_FAST
 // Maximum tolerated number of cycles with missing signal
 #define FFT_MAX_MISSED_UPDATES 5
+// Maximum number of windows that backends process together in a batch
+#define FFT_MAX_BATCH_WINDOWS 3
 
 class AP_HAL::DSP {
 #if HAL_WITH_DSP
@@ -79,6 +81,11 @@ public:
     virtual void fft_start(FFTWindowState* state, FloatBuffer& samples, uint16_t advance) = 0;
     // perform remaining steps of an FFT analysis
     virtual uint16_t fft_analyse(FFTWindowState* state, uint16_t start_bin, uint16_t end_bin, float noise_att_cutoff) = 0;
+    // start FFT analyses of count windows of the same size, for instance all three gyro axes
+    // returns false without starting any analysis if a window of samples is not available
+    virtual bool fft_start_batch(FFTWindowState* const states[], FloatBuffer* const samples[], uint8_t count, uint16_t advance) WARN_IF_UNUSED;
+    // perform remaining steps of count FFT analyses, returning the peak bin of each in max_bins
+    virtual void fft_analyse_batch(FFTWindowState* const states[], uint8_t count, uint16_t start_bin, uint16_t end_bin, float noise_att_cutoff, uint16_t* max_bins);
 
 protected:
     // step 3: find the magnitudes of the complex data
@@ -0,0 +1,189 @@
+/*
+ * This file is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Code by Andy Piper
+ */
+
+#include "AP_HAL.h"
+#include "RealFFTDSP.h"
+
+#if HAL_WITH_REAL_FFT_DSP
+
+#include <AP_Math/AP_Math.h>
+#include <GCS_MAVLink/GCS.h>
+
+using namespace AP_HAL;
+
+extern const AP_HAL::HAL& hal;
+
+// The algorithms originally came from betaflight but are now substantially modified based on theory and experiment.
+// https://holometer.fnal.gov/GH_FFT.pdf "Spectrum and spectral density estimation by the Discrete Fourier transform (DFT),
+// including a comprehensive list of window functions and some new flat-top windows." - Heinzel et. al is a great reference
+// for understanding the underlying theory although we do not use spectral density here since time resolution is equally
+// important as frequency resolution. Referred to as [Heinz] throughout the code.
+
+// initialize the FFT state machine
+AP_HAL::DSP::FFTWindowState* RealFFTDSP::fft_init(uint16_t window_size, uint16_t sample_rate, uint8_t harmonics)
+{
+    RealFFTDSP::FFTWindowStateRealFFT* fft = new RealFFTDSP::FFTWindowStateRealFFT(window_size, sample_rate, harmonics);
+    if (fft == nullptr || fft->_hanning_window == nullptr || fft->_rfft_data == nullptr || fft->_freq_bins == nullptr || fft->_derivative_freq_bins == nullptr || fft->rfft.length() == 0) {
+        delete fft;
+        return nullptr;
+    }
+    return fft;
+}
+
+// start an FFT analysis
+void RealFFTDSP::fft_start(AP_HAL::DSP::FFTWindowState* state, FloatBuffer& samples, uint16_t advance)
+{
+    step_hanning((FFTWindowStateRealFFT*)state, samples, advance);
+}
+
+// perform remaining steps of an FFT analysis
+uint16_t RealFFTDSP::fft_analyse(AP_HAL::DSP::FFTWindowState* state, uint16_t start_bin, uint16_t end_bin, float noise_att_cutoff)
+{
+    FFTWindowStateRealFFT* fft = (FFTWindowStateRealFFT*)state;
+    step_fft(fft);
+    step_cmplx_mag(fft, start_bin, end_bin, noise_att_cutoff);
+    return step_calc_frequencies(fft, start_bin, end_bin);
+}
+
+// start FFT analyses of count windows of the same size
+bool RealFFTDSP::fft_start_batch(AP_HAL::DSP::FFTWindowState* const states[], FloatBuffer* const samples[], uint8_t count, uint16_t advance)
+{
+    if (count > FFT_MAX_BATCH_WINDOWS) {
+        return AP_HAL::DSP::fft_start_batch(states, samples, count, advance);
+    }
+
+    const uint16_t window_size = states[0]->_window_size;
+    for (uint8_t i = 0; i < count; i++) {
+        if (samples[i]->peek(&states[i]->_freq_bins[0], window_size) != window_size) {
+            return false;
+        }
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        samples[i]->advance(advance);
+    }
+
+    // apply the hanning window to all windows with a single pass over it
+    const float* hanning = states[0]->_hanning_window;
+    for (uint16_t n = 0; n < window_size; n++) {
+        for (uint8_t i = 0; i < count; i++) {
+            states[i]->_freq_bins[n] *= hanning[n];
+        }
+    }
+    return true;
+}
+
+// perform remaining steps of count FFT analyses
+void RealFFTDSP::fft_analyse_batch(AP_HAL::DSP::FFTWindowState* const states[], uint8_t count, uint16_t start_bin, uint16_t end_bin, float noise_att_cutoff, uint16_t* max_bins)
+{
+    if (count > FFT_MAX_BATCH_WINDOWS) {
+        AP_HAL::DSP::fft_analyse_batch(states, count, start_bin, end_bin, noise_att_cutoff, max_bins);
+        return;
+    }
+
+    RealFFT* rffts[FFT_MAX_BATCH_WINDOWS];
+    const float* in[FFT_MAX_BATCH_WINDOWS];
+    float* out[FFT_MAX_BATCH_WINDOWS];
+    for (uint8_t i = 0; i < count; i++) {
+        rffts[i] = &((FFTWindowStateRealFFT*)states[i])->rfft;
+        in[i] = states[i]->_freq_bins;
+        out[i] = states[i]->_rfft_data;
+    }
+    RealFFT::transform_batch(rffts, in, out, count);
+
+    for (uint8_t i = 0; i < count; i++) {
+        FFTWindowState* fft = states[i];
+        RealFFT::magnitude_squared(fft->_rfft_data, fft->_freq_bins, fft->_bin_count);
+        step_cmplx_mag(fft, start_bin, end_bin, noise_att_cutoff);
+        max_bins[i] = step_calc_frequencies(fft, start_bin, end_bin);
+    }
+}
+
+// create an instance of the FFT state machine
+RealFFTDSP::FFTWindowStateRealFFT::FFTWindowStateRealFFT(uint16_t window_size, uint16_t sample_rate, uint8_t harmonics)
+    : AP_HAL::DSP::FFTWindowState::FFTWindowState(window_size, sample_rate, harmonics)
+{
+    if (_freq_bins == nullptr || _hanning_window == nullptr || _rfft_data == nullptr || _derivative_freq_bins == nullptr) {
+        GCS_SEND_TEXT(MAV_SEVERITY_WARNING, "Failed to allocate window for DSP");
+        return;
+    }
+
+    // twiddle factors are calculated once here rather than on every FFT
+    if (!rfft.init(window_size)) {
+        GCS_SEND_TEXT(MAV_SEVERITY_WARNING, "Failed to allocate FFT for DSP");
+    }
+}
+
+// step 1: filter the incoming samples through a Hanning window
+void RealFFTDSP::step_hanning(FFTWindowStateRealFFT* fft, FloatBuffer& samples, uint16_t advance)
+{
+    // 5us
+    // apply hanning window to gyro samples and store result in _freq_bins
+    // hanning starts and ends with 0, could be skipped for minor speed improvement
+    uint32_t read_window = samples.peek(&fft->_freq_bins[0], fft->_window_size);
+    if (read_window != fft->_window_size) {
+        return;
+    }
+    samples.advance(advance);
+    mult_f32(&fft->_freq_bins[0], &fft->_hanning_window[0], &fft->_freq_bins[0], fft->_window_size);
+}
+
+// step 2: perform a real FFT on the windowed data
+void RealFFTDSP::step_fft(FFTWindowStateRealFFT* fft)
+{
+    // complex bins 0 to _bin_count, components at the nyquist frequency are real only
+    fft->rfft.transform(fft->_freq_bins, fft->_rfft_data);
+
+    RealFFT::magnitude_squared(fft->_rfft_data, fft->_freq_bins, fft->_bin_count);
+}
+
+void RealFFTDSP::mult_f32(const float* v1, const float* v2, float* vout, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++) {
+        vout[i] = v1[i] * v2[i];
+    }
+}
+
+void RealFFTDSP::vector_max_float(const float* vin, uint16_t len, float* maxValue, uint16_t* maxIndex) const
+{
+    *maxValue = vin[0];
+    *maxIndex = 0;
+    for (uint16_t i = 1; i < len; i++) {
+        if (vin[i] > *maxValue) {
+            *maxValue = vin[i];
+            *maxIndex = i;
+        }
+    }
+}
+
+void RealFFTDSP::vector_scale_float(const float* vin, float scale, float* vout, uint16_t len) const
+{
+    for (uint16_t i = 0; i < len; i++) {
+        vout[i] = vin[i] * scale;
+    }
+}
+
+float RealFFTDSP::vector_mean_float(const float* vin, uint16_t len) const
+{
+    float mean_value = 0.0f;
+    for (uint16_t i = 0; i < len; i++) {
+        mean_value += vin[i];
+    }
+    mean_value /= len;
+    return mean_value;
+}
+
+#endif // HAL_WITH_REAL_FFT_DSP
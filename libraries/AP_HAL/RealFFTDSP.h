@@ -0,0 +1,65 @@
+/*
+ * This file is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  DSP backend on AP_Math's RealFFT, shared by the SITL and Linux HALs
+ */
+#pragma once
+
+#include "AP_HAL_Boards.h"
+#include <AP_Math/real_fft.h>
+
+#ifndef HAL_WITH_REAL_FFT_DSP
+#define HAL_WITH_REAL_FFT_DSP (HAL_WITH_DSP && AP_MATH_REAL_FFT_ENABLED)
+#endif
+
+#if HAL_WITH_REAL_FFT_DSP
+
+#include "AP_HAL_Namespace.h"
+#include "DSP.h"
+
+class AP_HAL::RealFFTDSP : public AP_HAL::DSP {
+public:
+    // initialise an FFT instance
+    virtual FFTWindowState* fft_init(uint16_t window_size, uint16_t sample_rate, uint8_t harmonics) override;
+    // start an FFT analysis with an ObjectBuffer
+    virtual void fft_start(FFTWindowState* state, FloatBuffer& samples, uint16_t advance) override;
+    // perform remaining steps of an FFT analysis
+    virtual uint16_t fft_analyse(FFTWindowState* state, uint16_t start_bin, uint16_t end_bin, float noise_att_cutoff) override;
+    // start FFT analyses of count windows, applying the Hanning window to all of them in one pass
+    virtual bool fft_start_batch(FFTWindowState* const states[], FloatBuffer* const samples[], uint8_t count, uint16_t advance) override WARN_IF_UNUSED;
+    // perform remaining steps of count FFT analyses, interleaving the windows through the FFT
+    virtual void fft_analyse_batch(FFTWindowState* const states[], uint8_t count, uint16_t start_bin, uint16_t end_bin, float noise_att_cutoff, uint16_t* max_bins) override;
+
+    // FFT state with the twiddle factors for its window size
+    class FFTWindowStateRealFFT : public AP_HAL::DSP::FFTWindowState {
+        friend class AP_HAL::RealFFTDSP;
+
+    public:
+        FFTWindowStateRealFFT(uint16_t window_size, uint16_t sample_rate, uint8_t harmonics);
+
+    private:
+        RealFFT rfft;
+    };
+
+private:
+    void step_hanning(FFTWindowStateRealFFT* fft, FloatBuffer& samples, uint16_t advance);
+    void step_fft(FFTWindowStateRealFFT* fft);
+    void mult_f32(const float* v1, const float* v2, float* vout, uint16_t len);
+    void vector_max_float(const float* vin, uint16_t len, float* maxValue, uint16_t* maxIndex) const override;
+    void vector_scale_float(const float* vin, float scale, float* vout, uint16_t len) const override;
+    float vector_mean_float(const float* vin, uint16_t len) const override;
+};
+
+#endif // HAL_WITH_REAL_FFT_DSP
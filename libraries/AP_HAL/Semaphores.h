@@ -28,6 +28,27 @@ public:
     virtual ~Semaphore(void) {}
 };
 
+/*
+  a binary semaphore, for a thread to sleep until another thread
+  signals that there is work for it
+ */
+class AP_HAL::BinarySemaphore {
+public:
+    BinarySemaphore() {}
+
+    // do not allow copying
+    BinarySemaphore(const BinarySemaphore &other) = delete;
+    BinarySemaphore &operator=(const BinarySemaphore&) = delete;
+
+    // wait up to timeout_us for a signal, returns true if signalled
+    virtual bool wait(uint32_t timeout_us) WARN_IF_UNUSED = 0;
+
+    // signal a waiting thread, or the next thread to wait
+    virtual void signal() = 0;
+
+    virtual ~BinarySemaphore(void) {}
+};
+
 /*
   a method to make semaphores less error prone. The WITH_SEMAPHORE()
   macro will block forever for a semaphore, and will automatically
@@ -353,5 +353,6 @@
 
 #include <AP_HAL_Linux/Semaphores.h>
 #define HAL_Semaphore Linux::Semaphore
+#define HAL_BinarySemaphore Linux::BinarySemaphore
 #include <AP_HAL/EventHandle.h>
 #define HAL_EventHandle AP_HAL::EventHandle
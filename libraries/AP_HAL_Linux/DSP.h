@@ -0,0 +1,30 @@
+/*
+ * This file is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/RealFFTDSP.h>
+
+#if HAL_WITH_DSP
+
+namespace Linux {
+
+// Linux implementation of FFT analysis, see AP_HAL/RealFFTDSP.cpp
+class DSP : public AP_HAL::RealFFTDSP {
+};
+
+}
+
+#endif // HAL_WITH_DSP
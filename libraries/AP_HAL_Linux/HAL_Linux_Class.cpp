@@ -16,6 +16,7 @@
 #include "AnalogIn_ADS1115.h"
 #include "AnalogIn_IIO.h"
 #include "AnalogIn_Navio2.h"
+#include "DSP.h"
 #include "GPIO.h"
 #include "I2CDevice.h"
 #include "OpticalFlow_Onboard.h"
@@ -221,7 +222,11 @@ static OpticalFlow_Onboard opticalFlow;
 static Empty::OpticalFlow opticalFlow;
 #endif
 
+#if HAL_WITH_DSP
+static DSP dspDriver;
+#else
 static Empty::DSP dspDriver;
+#endif
 static Empty::Flash flashDriver;
 
 #if HAL_NUM_CAN_IFACES
@@ -2,6 +2,8 @@
 
 #include "Semaphores.h"
 
+#include <time.h>
+
 extern const AP_HAL::HAL& hal;
 
 using namespace Linux;
@@ -43,3 +45,40 @@ bool Semaphore::take_nonblocking()
     return pthread_mutex_trylock(&_lock) == 0;
 }
 
+BinarySemaphore::BinarySemaphore()
+{
+    pthread_mutex_init(&_lock, nullptr);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&_cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+bool BinarySemaphore::wait(uint32_t timeout_us)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    const uint64_t nsec = ts.tv_nsec + uint64_t(timeout_us) * 1000ULL;
+    ts.tv_sec += nsec / 1000000000ULL;
+    ts.tv_nsec = nsec % 1000000000ULL;
+
+    pthread_mutex_lock(&_lock);
+    while (!_pending) {
+        if (pthread_cond_timedwait(&_cond, &_lock, &ts) != 0) {
+            break;
+        }
+    }
+    const bool ret = _pending;
+    _pending = false;
+    pthread_mutex_unlock(&_lock);
+    return ret;
+}
+
+void BinarySemaphore::signal()
+{
+    pthread_mutex_lock(&_lock);
+    _pending = true;
+    pthread_cond_signal(&_cond);
+    pthread_mutex_unlock(&_lock);
+}
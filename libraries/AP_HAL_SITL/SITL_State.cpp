@@ -213,8 +213,10 @@ void SITL_State::wait_clock(uint64_t wait_time_usec)
     // check the outbound TCP queue size.  If it is too long then
     // MAVProxy/pymavlink take too long to process packets and it ends
     // up seeing traffic well into our past and hits time-out
-    // conditions.
-    if (sitl_model->get_speedup() > 1) {
+    // conditions. In lockstep this is the only wait on the wall
+    // clock, and as the vehicle runs on simulated time it doesn't
+    // change what the vehicle sees.
+    if (sitl_model->get_speedup() > 1 || _lockstep) {
         while (true) {
             const int queue_length = ((HALSITL::UARTDriver*)hal.serial(0))->get_system_outqueue_length();
             // ::fprintf(stderr, "queue_length=%d\n", (signed)queue_length);
@@ -211,6 +211,8 @@ private:
     float _current;
 
     bool _synthetic_clock_mode;
+    // step as fast as possible on simulated time only
+    bool _lockstep;
 
     bool _use_rtscts;
     bool _use_fg_view;
@@ -76,6 +76,7 @@ void SITL_State::_usage(void)
            "\t--instance|-I N          set instance of SITL (adds 10*instance to all port numbers)\n"
            // "\t--param|-P NAME=VALUE    set some param\n"  CURRENTLY BROKEN!
            "\t--synthetic-clock|-S     set synthetic clock mode\n"
+           "\t--lockstep               run as fast as possible on simulated time only, with reproducible results\n"
            "\t--home|-O HOME           set start location (lat,lng,alt,yaw) or location name\n"
            "\t--model|-M MODEL         set simulation model\n"
            "\t--config string          set additional simulation config string\n"
@@ -195,6 +196,7 @@ void SITL_State::_parse_command_line(int argc, char * const argv[])
     float speedup = 1.0f;
     _instance = 0;
     _synthetic_clock_mode = false;
+    _lockstep = false;
     // default to CMAC
     const char *home_str = nullptr;
     const char *model_str = nullptr;
@@ -224,6 +226,7 @@ void SITL_State::_parse_command_line(int argc, char * const argv[])
     static struct timeval first_tv;
     gettimeofday(&first_tv, nullptr);
     time_t start_time_UTC = first_tv.tv_sec;
+    bool start_time_set = false;
     const bool is_replay = APM_BUILD_TYPE(APM_BUILD_Replay);
 
     enum long_options {
@@ -258,6 +261,7 @@ void SITL_State::_parse_command_line(int argc, char * const argv[])
         CMDLINE_IRLOCK_PORT,
         CMDLINE_START_TIME,
         CMDLINE_SYSID,
+        CMDLINE_LOCKSTEP,
     };
 
     const struct GetOptLong::option options[] = {
@@ -305,6 +309,7 @@ void SITL_State::_parse_command_line(int argc, char * const argv[])
         {"irlock-port",     true,   0, CMDLINE_IRLOCK_PORT},
         {"start-time",      true,   0, CMDLINE_START_TIME},
         {"sysid",           true,   0, CMDLINE_SYSID},
+        {"lockstep",        false,  0, CMDLINE_LOCKSTEP},
         {0, false, 0, 0}
     };
 
@@ -445,6 +450,7 @@ void SITL_State::_parse_command_line(int argc, char * const argv[])
             break;
         case CMDLINE_START_TIME:
             start_time_UTC = atoi(gopt.optarg);
+            start_time_set = true;
             break;
         case CMDLINE_SYSID: {
             const int32_t sysid = atoi(gopt.optarg);
@@ -457,6 +463,9 @@ void SITL_State::_parse_command_line(int argc, char * const argv[])
             printf("Setting SYSID_THISMAV=%d\n", sysid);
             break;
         }
+        case CMDLINE_LOCKSTEP:
+            _lockstep = true;
+            break;
         default:
             _usage();
             exit(1);
@@ -497,6 +506,7 @@ void SITL_State::_parse_command_line(int argc, char * const argv[])
             sitl_model->set_instance(_instance);
             sitl_model->set_autotest_dir(autotest_dir);
             sitl_model->set_config(config);
+            sitl_model->set_lockstep(_lockstep);
             _synthetic_clock_mode = true;
             break;
         }
@@ -506,6 +516,20 @@ void SITL_State::_parse_command_line(int argc, char * const argv[])
         exit(1);
     }
 
+    if (_lockstep) {
+        /*
+          nothing that the vehicle sees may depend on the wall clock
+          or on the previous run. The simulated sensor noise comes from
+          rand() and random(), which share their state in glibc
+         */
+        if (!start_time_set) {
+            // 2020-01-01 00:00:00 UTC
+            start_time_UTC = 1577836800;
+        }
+        srandom(1);
+        printf("Lockstep enabled, start time %ld\n", (long)start_time_UTC);
+    }
+
     if (AP::sitl()) {
         // Set SITL start time.
         AP::sitl()->start_time_UTC = start_time_UTC;
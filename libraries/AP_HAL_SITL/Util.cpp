@@ -1,6 +1,7 @@
 #include "Util.h"
 #include <sys/time.h>
 #include <AP_Param/AP_Param.h>
+#include <SITL/SITL.h>
 
 #ifdef WITH_SITL_TONEALARM
 HALSITL::ToneAlarm_SF HALSITL::Util::_toneAlarm;
@@ -8,6 +9,13 @@ HALSITL::ToneAlarm_SF HALSITL::Util::_toneAlarm;
 
 uint64_t HALSITL::Util::get_hw_rtc() const
 {
+#if !defined(HAL_BUILD_AP_PERIPH)
+    if (sitlState->_lockstep && AP::sitl() != nullptr) {
+        // the clock runs from the start time on simulated time, so
+        // that log names and timestamps are reproducible
+        return AP::sitl()->start_time_UTC * 1000000ULL + AP_HAL::micros64();
+    }
+#endif
 #ifndef CLOCK_REALTIME
     struct timeval ts;
     gettimeofday(&ts, nullptr);
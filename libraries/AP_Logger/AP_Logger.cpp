@@ -114,6 +114,16 @@ const AP_Param::GroupInfo AP_Logger::var_info[] = {
     // @User: Standard
     AP_GROUPINFO("_FILE_MB_FREE",  7, AP_Logger, _params.min_MB_free, 500),
 
+#if HAL_LOGGER_FILE_COMPRESSION_ENABLED
+    // @Param: _FILE_COMPRESS
+    // @DisplayName: Compress log files
+    // @Description: When enabled, log files are written block compressed, which reduces the bandwidth needed on the SD card at high log rates. Compressed logs can be read by Replay, for other tools decompress them with Tools/scripts/decompress_log.py. Compressed logs are not indexed.
+    // @Values: 0:Disabled,1:Enabled
+    // @RebootRequired: True
+    // @User: Advanced
+    AP_GROUPINFO("_FILE_COMPRESS",  8, AP_Logger, _params.file_compress, 0),
+#endif
+
     AP_GROUPEND
 };
 
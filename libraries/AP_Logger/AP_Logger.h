@@ -30,6 +30,10 @@
     #endif
 #endif
 
+#ifndef HAL_LOGGER_FILE_COMPRESSION_ENABLED
+    #define HAL_LOGGER_FILE_COMPRESSION_ENABLED (HAL_LOGGING_FILESYSTEM_ENABLED && !HAL_MINIMIZE_FEATURES)
+#endif
+
 #ifndef HAL_LOGGING_SITL_ENABLED
     #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
         #define HAL_LOGGING_SITL_ENABLED 1
@@ -385,6 +389,9 @@ public:
         AP_Int8 mav_bufsize; // in kilobytes
         AP_Int16 file_timeout; // in seconds
         AP_Int16 min_MB_free;
+#if HAL_LOGGER_FILE_COMPRESSION_ENABLED
+        AP_Int8 file_compress;
+#endif
     } _params;
 
     const struct LogStructure *structure(uint16_t num) const;
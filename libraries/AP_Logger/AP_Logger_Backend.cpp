@@ -577,12 +577,20 @@ void AP_Logger_Backend::Write_AP_Logger_Stats_File(const struct df_stats &_stats
         buf_space_min   : _stats.buf_space_min,
         buf_space_max   : _stats.buf_space_max,
         buf_space_avg   : (_stats.blocks) ? (_stats.buf_space_sigma / _stats.blocks) : 0,
+        queue_max       : _stats.queue_max,
+        io_time_max     : _stats.io_time_max,
+        io_hist_1ms     : _stats.io_hist[0],
+        io_hist_10ms    : _stats.io_hist[1],
+        io_hist_100ms   : _stats.io_hist[2],
+        io_hist_slow    : _stats.io_hist[3],
     };
     WriteBlock(&pkt, sizeof(pkt));
 }
 
 void AP_Logger_Backend::df_stats_gather(const uint16_t bytes_written, uint32_t space_remaining)
 {
+    WITH_SEMAPHORE(stats_sem);
+
     if (space_remaining < stats.buf_space_min) {
         stats.buf_space_min = space_remaining;
     }
@@ -595,12 +603,44 @@ void AP_Logger_Backend::df_stats_gather(const uint16_t bytes_written, uint32_t s
     stats.blocks++;
 }
 
+void AP_Logger_Backend::df_stats_gather_io(uint32_t pending_bytes, uint32_t io_time_us)
+{
+    WITH_SEMAPHORE(stats_sem);
+
+    if (pending_bytes > stats.queue_max) {
+        stats.queue_max = pending_bytes;
+    }
+    if (io_time_us > stats.io_time_max) {
+        stats.io_time_max = io_time_us;
+    }
+    uint8_t bucket;
+    if (io_time_us < 1000) {
+        bucket = 0;
+    } else if (io_time_us < 10000) {
+        bucket = 1;
+    } else if (io_time_us < 100000) {
+        bucket = 2;
+    } else {
+        bucket = 3;
+    }
+    if (stats.io_hist[bucket] < UINT16_MAX) {
+        stats.io_hist[bucket]++;
+    }
+}
+
 void AP_Logger_Backend::df_stats_clear() {
+    WITH_SEMAPHORE(stats_sem);
     memset(&stats, '\0', sizeof(stats));
     stats.buf_space_min = -1;
 }
 
 void AP_Logger_Backend::df_stats_log() {
-    Write_AP_Logger_Stats_File(stats);
-    df_stats_clear();
+    // take a snapshot, as writing the message gathers stats itself
+    struct df_stats snapshot;
+    {
+        WITH_SEMAPHORE(stats_sem);
+        snapshot = stats;
+        df_stats_clear();
+    }
+    Write_AP_Logger_Stats_File(snapshot);
 }
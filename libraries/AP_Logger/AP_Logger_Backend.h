@@ -192,6 +192,9 @@ protected:
     bool _initialised;
 
     void df_stats_gather(uint16_t bytes_written, uint32_t space_remaining);
+    // record a write to storage, with the number of bytes that were
+    // waiting to be written and how long the write took
+    void df_stats_gather_io(uint32_t pending_bytes, uint32_t io_time_us);
     void df_stats_log();
     void df_stats_clear();
 
@@ -203,8 +206,13 @@ private:
         uint32_t buf_space_min;
         uint32_t buf_space_max;
         uint32_t buf_space_sigma;
+        uint32_t queue_max;
+        uint32_t io_time_max;
+        uint16_t io_hist[4]; // <1ms, <10ms, <100ms, slower
     };
     struct df_stats stats;
+    // stats are gathered on the IO thread and logged on the main thread
+    HAL_Semaphore stats_sem;
 
     uint32_t _last_periodic_1Hz;
     uint32_t _last_periodic_10Hz;
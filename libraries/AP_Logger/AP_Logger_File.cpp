@@ -87,8 +87,29 @@ void AP_Logger_File::Init()
 
     hal.console->printf("AP_Logger_File: buffer size=%u\n", (unsigned)bufsize);
 
+#if HAL_LOGGER_FILE_INDEX_ENABLED
+    if (!_index.init()) {
+        hal.console->printf("AP_Logger_File: no memory for index\n");
+    }
+#endif
+
+#if HAL_LOGGER_FILE_COMPRESSION_ENABLED && !APM_BUILD_TYPE(APM_BUILD_Replay)
+    if (_front._params.file_compress && !_compressor.init()) {
+        hal.console->printf("AP_Logger_File: no memory for compression\n");
+    }
+#endif
+
     _initialised = true;
 
+#if HAL_LOGGER_FILE_WRITER_THREAD && !APM_BUILD_TYPE(APM_BUILD_Replay)
+    if (hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&AP_Logger_File::writer_thread, void),
+                                     "log_io", 4096, AP_HAL::Scheduler::PRIORITY_IO, 1)) {
+        _writer_thread_started = true;
+    } else {
+        hal.console->printf("AP_Logger_File: failed to start writer thread\n");
+    }
+#endif
+
     const char* custom_dir = hal.util->get_custom_log_directory();
     if (custom_dir != nullptr){
         _log_directory = custom_dir;
@@ -109,6 +130,14 @@ bool AP_Logger_File::file_exists(const char *filename) const
     return true;
 }
 
+// return true if filename ends in ext
+static bool has_extension(const char *filename, const char *ext)
+{
+    const size_t len = strlen(filename);
+    const size_t ext_len = strlen(ext);
+    return len >= ext_len && strcmp(&filename[len-ext_len], ext) == 0;
+}
+
 bool AP_Logger_File::log_exists(const uint16_t lognum) const
 {
     char *filename = _log_file_name(lognum);
@@ -231,7 +260,7 @@ uint16_t AP_Logger_File::find_oldest_log()
         return 0;
     }
 
-    // we only remove files which look like xxx.BIN
+    // we only remove files which look like xxx.BIN or xxx.BNZ
     EXPECT_DELAY_MS(3000);
     for (struct dirent *de=AP::FS().readdir(d); de; de=AP::FS().readdir(d)) {
         EXPECT_DELAY_MS(3000);
@@ -240,8 +269,12 @@ uint16_t AP_Logger_File::find_oldest_log()
             // not long enough for \d+[.]BIN
             continue;
         }
-        if (strncmp(&de->d_name[length-4], ".BIN", 4)) {
-            // doesn't end in .BIN
+        if (!has_extension(de->d_name, LOG_FILE_EXT)
+#if HAL_LOGGER_FILE_COMPRESSION_ENABLED
+            && !has_extension(de->d_name, LOG_FILE_EXT_COMPRESSED)
+#endif
+            ) {
+            // doesn't end in .BIN or .BNZ
             continue;
         }
 
@@ -330,6 +363,9 @@ void AP_Logger_File::Prep_MinSpace()
                     break;
                 }
             } else {
+#if HAL_LOGGER_FILE_INDEX_ENABLED
+                remove_index(filename_to_remove);
+#endif
                 free(filename_to_remove);
             }
         }
@@ -341,28 +377,28 @@ void AP_Logger_File::Prep_MinSpace()
 }
 
 /*
-  construct a log file name given a log number. 
+  construct a log file name given a log number and extension.
   The number in the log filename will *not* be zero-padded.
   Note: Caller must free.
  */
-char *AP_Logger_File::_log_file_name_short(const uint16_t log_num) const
+char *AP_Logger_File::_log_file_name_short(const uint16_t log_num, const char *ext) const
 {
     char *buf = nullptr;
-    if (asprintf(&buf, "%s/%u.BIN", _log_directory, (unsigned)log_num) == -1) {
+    if (asprintf(&buf, "%s/%u%s", _log_directory, (unsigned)log_num, ext) == -1) {
         return nullptr;
     }
     return buf;
 }
 
 /*
-  construct a log file name given a log number.
+  construct a log file name given a log number and extension.
   The number in the log filename will be zero-padded.
   Note: Caller must free.
  */
-char *AP_Logger_File::_log_file_name_long(const uint16_t log_num) const
+char *AP_Logger_File::_log_file_name_long(const uint16_t log_num, const char *ext) const
 {
     char *buf = nullptr;
-    if (asprintf(&buf, "%s/%08u.BIN", _log_directory, (unsigned)log_num) == -1) {
+    if (asprintf(&buf, "%s/%08u%s", _log_directory, (unsigned)log_num, ext) == -1) {
         return nullptr;
     }
     return buf;
@@ -371,12 +407,22 @@ char *AP_Logger_File::_log_file_name_long(const uint16_t log_num) const
 /*
   return a log filename appropriate for the supplied log_num if a
   filename exists with the short (not-zero-padded name) then it is the
-  appropirate name, otherwise the long (zero-padded) version is.
+  appropirate name, otherwise if a compressed log exists it is,
+  otherwise the long (zero-padded) version is.
   Note: Caller must free.
  */
 char *AP_Logger_File::_log_file_name(const uint16_t log_num) const
 {
-    char *filename = _log_file_name_short(log_num);
+    char *filename = _log_file_name_short(log_num, LOG_FILE_EXT);
+    if (filename == nullptr) {
+        return nullptr;
+    }
+    if (file_exists(filename)) {
+        return filename;
+    }
+    free(filename);
+#if HAL_LOGGER_FILE_COMPRESSION_ENABLED
+    filename = _log_file_name_long(log_num, LOG_FILE_EXT_COMPRESSED);
     if (filename == nullptr) {
         return nullptr;
     }
@@ -384,7 +430,8 @@ char *AP_Logger_File::_log_file_name(const uint16_t log_num) const
         return filename;
     }
     free(filename);
-    return _log_file_name_long(log_num);
+#endif
+    return _log_file_name_long(log_num, LOG_FILE_EXT);
 }
 
 /*
@@ -452,6 +499,11 @@ bool AP_Logger_File::_WritePrioritisedBlock(const void *pBuffer, uint16_t size,
     if (AP::FS().write(_write_fd, pBuffer, size) != size) {
         AP_HAL::panic("Short write");
     }
+#if HAL_LOGGER_FILE_INDEX_ENABLED
+    _index.add((const uint8_t *)pBuffer, size, _queued_offset, AP_HAL::micros64());
+    _queued_offset += size;
+    write_index_data();
+#endif
     return true;
 #endif
 
@@ -488,6 +540,19 @@ bool AP_Logger_File::_WritePrioritisedBlock(const void *pBuffer, uint16_t size,
 
     _writebuf.write((uint8_t*)pBuffer, size);
     df_stats_gather(size, _writebuf.space());
+#if HAL_LOGGER_FILE_WRITER_THREAD
+    // wake the writer when this message completes a chunk; it keeps
+    // writing without sleeping while there is a chunk waiting
+    if (_writer_thread_started &&
+        _writebuf.available() >= _writebuf_chunk &&
+        _writebuf.available() < _writebuf_chunk + size) {
+        _writer_wake.signal();
+    }
+#endif
+#if HAL_LOGGER_FILE_INDEX_ENABLED
+    _index.add((const uint8_t *)pBuffer, size, _queued_offset, AP_HAL::micros64());
+    _queued_offset += size;
+#endif
     return true;
 }
 
@@ -699,6 +764,13 @@ void AP_Logger_File::stop_logging(void)
         _write_fd = -1;
         AP::FS().close(fd);
     }
+#if HAL_LOGGER_FILE_INDEX_ENABLED
+    if (_index_fd != -1) {
+        _index.stop();
+        AP::FS().close(_index_fd);
+        _index_fd = -1;
+    }
+#endif
     if (have_sem) {
         write_fd_semaphore.give();
     }
@@ -766,6 +838,22 @@ void AP_Logger_File::start_new_log(void)
         write_fd_semaphore.give();
         return;
     }
+#if HAL_LOGGER_FILE_COMPRESSION_ENABLED
+    // compressed logs get their own extension so tools expecting a
+    // plain log never pick one up. If the log we are about to replace
+    // was written with the other setting of LOG_FILE_COMPRESS then
+    // remove it and write under the matching name
+    if (compressing() != has_extension(_write_filename, LOG_FILE_EXT_COMPRESSED)) {
+        EXPECT_DELAY_MS(3000);
+        AP::FS().unlink(_write_filename);
+        free(_write_filename);
+        _write_filename = _log_file_name_long(log_num, compressing() ? LOG_FILE_EXT_COMPRESSED : LOG_FILE_EXT);
+        if (_write_filename == nullptr) {
+            write_fd_semaphore.give();
+            return;
+        }
+    }
+#endif
 
 #if CONFIG_HAL_BOARD == HAL_BOARD_CHIBIOS
     // remember if we had utc time when we opened the file
@@ -795,6 +883,31 @@ void AP_Logger_File::start_new_log(void)
     _open_error_ms = 0;
     _write_offset = 0;
     _writebuf.clear();
+#if HAL_LOGGER_FILE_COMPRESSION_ENABLED
+    if (compressing()) {
+        _compressor.start();
+    }
+#endif
+#if HAL_LOGGER_FILE_INDEX_ENABLED
+    // a log without its index is still a good log, so failing to
+    // open the index is not an open error. Index offsets are into
+    // the uncompressed log, so compressed logs aren't indexed
+    if (compressing()) {
+        remove_index(_write_filename);
+    } else {
+        char *index_filename = _index_file_name(_write_filename);
+        if (index_filename != nullptr) {
+            _index_fd = AP::FS().open(index_filename, O_WRONLY|O_CREAT|O_TRUNC);
+            free(index_filename);
+        }
+    }
+    _queued_offset = 0;
+    if (_index_fd != -1) {
+        _index.start();
+    } else {
+        _index.stop();
+    }
+#endif
     write_fd_semaphore.give();
 
     // now update lastlog.txt with the new log number
@@ -855,6 +968,15 @@ void AP_Logger_File::flush(void)
 void AP_Logger_File::io_timer(void)
 {
     uint32_t tnow = AP_HAL::millis();
+
+#if HAL_LOGGER_FILE_WRITER_THREAD
+    if (_writer_thread_started && erase.log_num == 0) {
+        // writes are done by writer_thread(), which also maintains
+        // the heartbeat so a stalled write is noticed
+        return;
+    }
+#endif
+
     _io_timer_heartbeat = tnow;
 
     if (erase.log_num != 0) {
@@ -863,19 +985,49 @@ void AP_Logger_File::io_timer(void)
         return;
     }
 
+    write_buffered_data(tnow);
+}
+
+#if HAL_LOGGER_FILE_WRITER_THREAD
+/*
+  dedicated thread for writing to storage, so blocking writes don't
+  hold up other users of the IO timer
+ */
+void AP_Logger_File::writer_thread(void)
+{
+    while (true) {
+        const uint32_t tnow = AP_HAL::millis();
+        _io_timer_heartbeat = tnow;
+        if (erase.log_num != 0 || !write_buffered_data(tnow)) {
+            // nothing to do; erase is handled by io_timer(). Sleep
+            // until a chunk is ready, waking at least every 100ms to
+            // keep the heartbeat and the two second flush going
+            UNUSED_RESULT(_writer_wake.wait(100000));
+        }
+    }
+}
+#endif
+
+bool AP_Logger_File::write_buffered_data(uint32_t tnow)
+{
     if (_write_fd == -1 || !_initialised || recent_open_error()) {
-        return;
+        return false;
     }
 
     uint32_t nbytes = _writebuf.available();
+#if HAL_LOGGER_FILE_COMPRESSION_ENABLED
+    if (compressing()) {
+        nbytes += _compressor.pending();
+    }
+#endif
     if (nbytes == 0) {
-        return;
+        return false;
     }
     if (nbytes < _writebuf_chunk && 
         tnow - _last_write_time < 2000UL) {
         // write in _writebuf_chunk-sized chunks, but always write at
         // least once per 2 seconds if data is available
-        return;
+        return false;
     }
     if (tnow - _free_space_last_check_time > _free_space_check_interval) {
         _free_space_last_check_time = tnow;
@@ -885,38 +1037,76 @@ void AP_Logger_File::io_timer(void)
             stop_logging();
             _open_error_ms = AP_HAL::millis(); // prevent logging starting again for 5s
             last_io_operation = "";
-            return;
+            return false;
         }
         last_io_operation = "";
     }
 
     _last_write_time = tnow;
-    if (nbytes > _writebuf_chunk) {
+    if (nbytes > _writebuf_chunk * HAL_LOGGER_WRITE_CHUNKS_MAX) {
         // be kind to the filesystem layer
-        nbytes = _writebuf_chunk;
+        nbytes = _writebuf_chunk * HAL_LOGGER_WRITE_CHUNKS_MAX;
     }
 
-    uint32_t size;
-    const uint8_t *head = _writebuf.readptr(size);
-    nbytes = MIN(nbytes, size);
-
-    // try to align writes on a 512 byte boundary to avoid filesystem reads
-    if ((nbytes + _write_offset) % 512 != 0) {
-        uint32_t ofs = (nbytes + _write_offset) % 512;
-        if (ofs < nbytes) {
-            nbytes -= ofs;
+    ByteBuffer::IoVec vec[2];
+    uint8_t n_vec = 0;
+    if (!compressing()) {
+        // try to align writes on a 512 byte boundary to avoid filesystem reads
+        if ((nbytes + _write_offset) % 512 != 0) {
+            uint32_t ofs = (nbytes + _write_offset) % 512;
+            if (ofs < nbytes) {
+                nbytes -= ofs;
+            }
         }
+
+        // get both parts of the buffer if it has wrapped, so a batch is
+        // written in one pass rather than one contiguous piece per call
+        n_vec = _writebuf.peekiovec(vec, nbytes);
     }
 
     last_io_operation = "write";
     if (!write_fd_semaphore.take(1)) {
-        return;
+        return false;
     }
     if (_write_fd == -1) {
         write_fd_semaphore.give();
-        return;
+        return false;
+    }
+#if HAL_LOGGER_FILE_COMPRESSION_ENABLED
+    if (compressing()) {
+        // a block is compressed once and held until it has all been
+        // written, so a short write doesn't lose part of it
+        if (_compressor.pending() == 0) {
+            last_io_operation = "compress";
+            _writebuf.advance(_compressor.compress(_writebuf));
+        }
+        vec[0].data = _compressor.pending_data();
+        vec[0].len = _compressor.pending();
+        n_vec = vec[0].len > 0 ? 1 : 0;
+        if (n_vec == 0) {
+            write_fd_semaphore.give();
+            last_io_operation = "";
+            return false;
+        }
+    }
+#endif
+    const uint32_t pending = _writebuf.available();
+    const uint32_t io_start_us = AP_HAL::micros();
+    ssize_t nwritten = 0;
+    for (uint8_t i=0; i<n_vec; i++) {
+        const ssize_t ret = AP::FS().write(_write_fd, vec[i].data, vec[i].len);
+        if (ret <= 0) {
+            if (nwritten == 0) {
+                nwritten = ret;
+            }
+            break;
+        }
+        nwritten += ret;
+        if (uint32_t(ret) < vec[i].len) {
+            // short write, try the rest next time
+            break;
+        }
     }
-    ssize_t nwritten = AP::FS().write(_write_fd, head, nbytes);
     last_io_operation = "";
     if (nwritten <= 0) {
         if ((tnow - _last_write_ms)/1000U > unsigned(_front._params.file_timeout)) {
@@ -925,6 +1115,13 @@ void AP_Logger_File::io_timer(void)
             // failures caused by directory listing
             last_io_operation = "close";
             AP::FS().close(_write_fd);
+#if HAL_LOGGER_FILE_INDEX_ENABLED
+            if (_index_fd != -1) {
+                _index.stop();
+                AP::FS().close(_index_fd);
+                _index_fd = -1;
+            }
+#endif
             last_io_operation = "";
             _write_fd = -1;
             printf("Failed to write to File: %s\n", strerror(errno));
@@ -934,18 +1131,33 @@ void AP_Logger_File::io_timer(void)
         _last_write_failed = false;
         _last_write_ms = tnow;
         _write_offset += nwritten;
+#if HAL_LOGGER_FILE_COMPRESSION_ENABLED
+        if (compressing()) {
+            _compressor.written(nwritten);
+        } else {
+            _writebuf.advance(nwritten);
+        }
+#else
         _writebuf.advance(nwritten);
+#endif
         /*
           the best strategy for minimizing corruption on microSD cards
           seems to be to write in 4k chunks and fsync the file on each
-          chunk, ensuring the directory entry is updated after each
-          write.
+          batch of chunks, ensuring the directory entry is updated
+          after each write.
          */
 #if CONFIG_HAL_BOARD != HAL_BOARD_SITL && CONFIG_HAL_BOARD_SUBTYPE != HAL_BOARD_SUBTYPE_LINUX_NONE
         last_io_operation = "fsync";
         AP::FS().fsync(_write_fd);
         last_io_operation = "";
 #endif
+        df_stats_gather_io(pending, AP_HAL::micros() - io_start_us);
+
+#if HAL_LOGGER_FILE_INDEX_ENABLED
+        last_io_operation = "index";
+        write_index_data();
+        last_io_operation = "";
+#endif
 
 #if CONFIG_HAL_BOARD == HAL_BOARD_CHIBIOS
         // ChibiOS does not update mtime on writes, so if we opened
@@ -961,8 +1173,66 @@ void AP_Logger_File::io_timer(void)
     }
 
     write_fd_semaphore.give();
+
+    return nwritten > 0;
+}
+
+#if HAL_LOGGER_FILE_INDEX_ENABLED
+/*
+  write out closed index buckets. Called with write_fd_semaphore held,
+  except in Replay where there is no IO thread
+ */
+void AP_Logger_File::write_index_data(void)
+{
+    if (_index_fd == -1) {
+        return;
+    }
+    ByteBuffer &pending = _index.pending();
+    ByteBuffer::IoVec vec[2];
+    const uint8_t n_vec = pending.peekiovec(vec, pending.available());
+    for (uint8_t i=0; i<n_vec; i++) {
+        const ssize_t ret = AP::FS().write(_index_fd, vec[i].data, vec[i].len);
+        if (ret != ssize_t(vec[i].len)) {
+            // the index must not have gaps, so give up on it for
+            // this log
+            _index.stop();
+            AP::FS().close(_index_fd);
+            _index_fd = -1;
+            return;
+        }
+        pending.advance(ret);
+    }
 }
 
+/*
+  return the index file name for a log file name, logs/NN.BIN ->
+  logs/NN.IDX. Caller must free.
+ */
+char *AP_Logger_File::_index_file_name(const char *log_filename) const
+{
+    const size_t len = strlen(log_filename);
+    if (!has_extension(log_filename, LOG_FILE_EXT)) {
+        return nullptr;
+    }
+    char *ret = strdup(log_filename);
+    if (ret == nullptr) {
+        return nullptr;
+    }
+    memcpy(&ret[len-4], ".IDX", 4);
+    return ret;
+}
+
+// remove the index of a log, if it has one
+void AP_Logger_File::remove_index(const char *log_filename) const
+{
+    char *index_filename = _index_file_name(log_filename);
+    if (index_filename != nullptr) {
+        AP::FS().unlink(index_filename);
+        free(index_filename);
+    }
+}
+#endif // HAL_LOGGER_FILE_INDEX_ENABLED
+
 bool AP_Logger_File::io_thread_alive() const
 {
     if (!hal.scheduler->is_system_initialized()) {
@@ -1016,6 +1286,9 @@ void AP_Logger_File::erase_next(void)
     }
 
     AP::FS().unlink(fname);
+#if HAL_LOGGER_FILE_INDEX_ENABLED
+    remove_index(fname);
+#endif
     free(fname);
 
     erase.log_num++;
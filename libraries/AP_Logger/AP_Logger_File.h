@@ -10,6 +10,8 @@
 
 #include <AP_HAL/utility/RingBuffer.h>
 #include "AP_Logger_Backend.h"
+#include "LogIndex.h"
+#include "LogCompress.h"
 
 #if HAL_LOGGING_FILESYSTEM_ENABLED
 
@@ -17,6 +19,34 @@
 #define HAL_LOGGER_WRITE_CHUNK_SIZE 4096
 #endif
 
+// maximum number of chunks written by one call to io_timer() when the
+// buffer is backing up
+#ifndef HAL_LOGGER_WRITE_CHUNKS_MAX
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX || CONFIG_HAL_BOARD == HAL_BOARD_SITL
+#define HAL_LOGGER_WRITE_CHUNKS_MAX 8
+#else
+#define HAL_LOGGER_WRITE_CHUNKS_MAX 1
+#endif
+#endif
+
+// log file extensions. Compressed logs (LOG_FILE_COMPRESS) are not
+// readable by tools expecting a plain log so get their own
+#define LOG_FILE_EXT ".BIN"
+#define LOG_FILE_EXT_COMPRESSED ".BNZ"
+
+/*
+  on Linux boards writes to storage are done from a dedicated thread
+  rather than the shared IO timer, as slow SD cards can block in
+  write() and fsync() for hundreds of milliseconds
+ */
+#ifndef HAL_LOGGER_FILE_WRITER_THREAD
+#define HAL_LOGGER_FILE_WRITER_THREAD (CONFIG_HAL_BOARD == HAL_BOARD_LINUX)
+#endif
+
+#if HAL_LOGGER_FILE_WRITER_THREAD && !defined(HAL_BinarySemaphore)
+#error "HAL_LOGGER_FILE_WRITER_THREAD needs a HAL_BinarySemaphore"
+#endif
+
 class AP_Logger_File : public AP_Logger_Backend
 {
 public:
@@ -80,6 +110,39 @@ private:
 
     uint32_t _io_timer_heartbeat;
     bool io_thread_alive() const;
+
+    // write buffered data to storage, returning true if anything was written
+    bool write_buffered_data(uint32_t tnow);
+
+#if HAL_LOGGER_FILE_INDEX_ENABLED
+    // sidecar index of the log being written, see LogIndex.h
+    LogIndexWriter _index;
+    int _index_fd = -1;
+    // offset in the log of the next message queued
+    uint32_t _queued_offset;
+    void write_index_data(void);
+    char *_index_file_name(const char *log_filename) const;
+    void remove_index(const char *log_filename) const;
+#endif
+
+#if HAL_LOGGER_FILE_COMPRESSION_ENABLED
+    LogCompressor _compressor;
+#endif
+    // true if log files are written compressed
+    bool compressing(void) const {
+#if HAL_LOGGER_FILE_COMPRESSION_ENABLED
+        return _compressor.enabled();
+#else
+        return false;
+#endif
+    }
+
+#if HAL_LOGGER_FILE_WRITER_THREAD
+    bool _writer_thread_started;
+    // signalled when a chunk is ready for writer_thread()
+    HAL_BinarySemaphore _writer_wake;
+    void writer_thread(void);
+#endif
     uint8_t io_thread_warning_decimation_counter;
 
     // do we have a recent open error?
@@ -102,8 +165,8 @@ private:
 
     /* construct a file name given a log number. Caller must free. */
     char *_log_file_name(const uint16_t log_num) const;
-    char *_log_file_name_long(const uint16_t log_num) const;
-    char *_log_file_name_short(const uint16_t log_num) const;
+    char *_log_file_name_long(const uint16_t log_num, const char *ext) const;
+    char *_log_file_name_short(const uint16_t log_num, const char *ext) const;
     char *_lastlog_file_name() const;
     uint32_t _get_log_size(const uint16_t log_num);
     uint32_t _get_log_time(const uint16_t log_num);
@@ -0,0 +1,344 @@
+/*
+  block compressed log files, see LogCompress.h
+ */
+
+#include "LogCompress.h"
+
+#include <AP_Math/AP_Math.h>
+
+#include <string.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 0xFFFFU
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - HAL_LOGGER_COMPRESS_HASH_BITS);
+}
+
+// write a length which didn't fit in a token nibble
+static bool lz_put_length(uint8_t *out, uint32_t out_size, uint32_t &op, uint32_t len)
+{
+    while (len >= 255) {
+        if (op >= out_size) {
+            return false;
+        }
+        out[op++] = 255;
+        len -= 255;
+    }
+    if (op >= out_size) {
+        return false;
+    }
+    out[op++] = len;
+    return true;
+}
+
+static bool lz_get_length(const uint8_t *in, uint32_t len, uint32_t &ip, uint32_t &value)
+{
+    uint8_t b;
+    do {
+        if (ip >= len) {
+            return false;
+        }
+        b = in[ip++];
+        value += b;
+    } while (b == 255);
+    return true;
+}
+
+/*
+  write a sequence of literals followed by a match, or just literals
+  for the last sequence when match_len is zero
+ */
+static bool lz_put_sequence(uint8_t *out, uint32_t out_size, uint32_t &op,
+                            const uint8_t *literals, uint32_t num_literals,
+                            uint16_t offset, uint32_t match_len)
+{
+    if (op >= out_size) {
+        return false;
+    }
+    const uint32_t match_code = match_len ? match_len - LZ_MIN_MATCH : 0;
+    uint8_t &token = out[op++];
+    token = (MIN(num_literals, 15U) << 4) | MIN(match_code, 15U);
+    if (num_literals >= 15 && !lz_put_length(out, out_size, op, num_literals - 15)) {
+        return false;
+    }
+    if (out_size - op < num_literals) {
+        return false;
+    }
+    memcpy(&out[op], literals, num_literals);
+    op += num_literals;
+    if (match_len == 0) {
+        return true;
+    }
+    if (out_size - op < 2) {
+        return false;
+    }
+    out[op++] = offset & 0xFF;
+    out[op++] = offset >> 8;
+    if (match_code >= 15 && !lz_put_length(out, out_size, op, match_code - 15)) {
+        return false;
+    }
+    return true;
+}
+
+uint32_t LogLZ::compress(const uint8_t *in, uint32_t len, uint8_t *out, uint32_t out_size, uint16_t *table)
+{
+    memset(table, 0, sizeof(table[0]) << HAL_LOGGER_COMPRESS_HASH_BITS);
+    uint32_t op = 0;
+    uint32_t anchor = 0;
+    uint32_t i = 0;
+    while (i + LZ_MIN_MATCH <= len) {
+        const uint32_t seq = read32(&in[i]);
+        const uint32_t h = lz_hash(seq);
+        const uint32_t candidate = table[h];
+        table[h] = i;
+        if (candidate >= i || i - candidate > LZ_MAX_OFFSET || read32(&in[candidate]) != seq) {
+            i++;
+            continue;
+        }
+        uint32_t match_len = LZ_MIN_MATCH;
+        while (i + match_len < len && in[candidate + match_len] == in[i + match_len]) {
+            match_len++;
+        }
+        if (!lz_put_sequence(out, out_size, op, &in[anchor], i - anchor, i - candidate, match_len)) {
+            return 0;
+        }
+        i += match_len;
+        anchor = i;
+    }
+    if (!lz_put_sequence(out, out_size, op, &in[anchor], len - anchor, 0, 0)) {
+        return 0;
+    }
+    return op;
+}
+
+int32_t LogLZ::decompress(const uint8_t *in, uint32_t len, uint8_t *out, uint32_t out_size)
+{
+    uint32_t ip = 0;
+    uint32_t op = 0;
+    while (ip < len) {
+        const uint8_t token = in[ip++];
+        uint32_t num_literals = token >> 4;
+        if (num_literals == 15 && !lz_get_length(in, len, ip, num_literals)) {
+            return -1;
+        }
+        if (len - ip < num_literals || out_size - op < num_literals) {
+            return -1;
+        }
+        memcpy(&out[op], &in[ip], num_literals);
+        ip += num_literals;
+        op += num_literals;
+        if (ip == len) {
+            // the last sequence has no match
+            break;
+        }
+        if (len - ip < 2) {
+            return -1;
+        }
+        const uint32_t offset = in[ip] | (in[ip+1] << 8);
+        ip += 2;
+        uint32_t match_len = token & 0xF;
+        if (match_len == 15 && !lz_get_length(in, len, ip, match_len)) {
+            return -1;
+        }
+        match_len += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || out_size - op < match_len) {
+            return -1;
+        }
+        // matches may overlap the bytes they produce
+        const uint8_t *src = &out[op - offset];
+        for (uint32_t i=0; i<match_len; i++) {
+            out[op+i] = src[i];
+        }
+        op += match_len;
+    }
+    return op;
+}
+
+void LogTimeDelta::reset(void)
+{
+    memset(_types, 0, sizeof(_types));
+    _types[LOG_FORMAT_MSG].length = sizeof(struct log_Format);
+    _synced = true;
+}
+
+void LogTimeDelta::learn_format(const uint8_t *msg)
+{
+    struct log_Format f;
+    memcpy(&f, msg, sizeof(f));
+    if (f.type == LOG_FORMAT_MSG) {
+        // the FMT message describing itself doesn't change anything
+        return;
+    }
+    _types[f.type].length = f.length;
+    _types[f.type].has_time = f.length >= 3 + sizeof(uint64_t) &&
+                              f.format[0] == 'Q' &&
+                              strncmp(f.labels, "TimeUS", 6) == 0 &&
+                              (f.labels[6] == ',' || f.labels[6] == '\0');
+    _types[f.type].last_time = 0;
+}
+
+uint8_t LogTimeDelta::message_length(const uint8_t *buf, uint32_t len) const
+{
+    if (len < 3 || buf[0] != HEAD_BYTE1 || buf[1] != HEAD_BYTE2) {
+        return 0;
+    }
+    const uint8_t length = _types[buf[2]].length;
+    return length < 3 ? 0 : length;
+}
+
+uint32_t LogTimeDelta::encode(uint8_t *buf, uint32_t len)
+{
+    uint32_t ofs = 0;
+    while (_synced && len - ofs >= 3) {
+        uint8_t *msg = &buf[ofs];
+        const uint8_t length = message_length(msg, len - ofs);
+        if (length == 0) {
+            _synced = false;
+            break;
+        }
+        if (length > len - ofs) {
+            // the rest of the message goes in the next block
+            break;
+        }
+        if (msg[2] == LOG_FORMAT_MSG) {
+            learn_format(msg);
+        } else if (_types[msg[2]].has_time) {
+            uint64_t t;
+            memcpy(&t, &msg[3], sizeof(t));
+            const uint64_t delta = t - _types[msg[2]].last_time;
+            _types[msg[2]].last_time = t;
+            memcpy(&msg[3], &delta, sizeof(delta));
+        }
+        ofs += length;
+    }
+    return ofs;
+}
+
+bool LogTimeDelta::decode(uint8_t *buf, uint32_t len)
+{
+    uint32_t ofs = 0;
+    while (ofs < len) {
+        uint8_t *msg = &buf[ofs];
+        const uint8_t length = message_length(msg, len - ofs);
+        if (length == 0 || length > len - ofs) {
+            return false;
+        }
+        if (msg[2] == LOG_FORMAT_MSG) {
+            learn_format(msg);
+        } else if (_types[msg[2]].has_time) {
+            uint64_t t;
+            memcpy(&t, &msg[3], sizeof(t));
+            t += _types[msg[2]].last_time;
+            _types[msg[2]].last_time = t;
+            memcpy(&msg[3], &t, sizeof(t));
+        }
+        ofs += length;
+    }
+    return true;
+}
+
+LogCompressor::~LogCompressor(void)
+{
+    delete[] _in;
+    delete[] _out;
+    delete[] _table;
+}
+
+bool LogCompressor::init(void)
+{
+    _in = new uint8_t[LOG_COMPRESS_BLOCK_SIZE];
+    _out = new uint8_t[sizeof(struct log_compress_block) + LOG_COMPRESS_BLOCK_SIZE];
+    _table = new uint16_t[1U << HAL_LOGGER_COMPRESS_HASH_BITS];
+    if (_in == nullptr || _out == nullptr || _table == nullptr) {
+        delete[] _in;
+        delete[] _out;
+        delete[] _table;
+        _in = nullptr;
+        _out = nullptr;
+        _table = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void LogCompressor::start(void)
+{
+    _delta.reset();
+    const struct log_compress_header header {
+        LOG_COMPRESS_MAGIC,
+        LOG_COMPRESS_VERSION,
+        LOG_COMPRESS_BLOCK_SIZE
+    };
+    memcpy(_out, &header, sizeof(header));
+    _out_len = sizeof(header);
+    _out_ofs = 0;
+}
+
+uint32_t LogCompressor::compress(ByteBuffer &buf)
+{
+    if (pending() != 0) {
+        return 0;
+    }
+    uint32_t raw_length = buf.peekbytes(_in, LOG_COMPRESS_BLOCK_SIZE);
+    if (raw_length == 0) {
+        return 0;
+    }
+
+    struct log_compress_block block {};
+    block.magic = LOG_COMPRESS_BLOCK_MAGIC;
+    if (_delta.synced()) {
+        const uint32_t encoded = _delta.encode(_in, raw_length);
+        if (encoded != 0) {
+            block.flags |= LOG_COMPRESS_FLAG_DELTA;
+            raw_length = encoded;
+        } else if (_delta.synced()) {
+            // not a whole message yet
+            return 0;
+        }
+    }
+    block.raw_length = raw_length;
+
+    uint8_t *data = &_out[sizeof(block)];
+    // only keep the compressed data if it is smaller
+    uint32_t length = LogLZ::compress(_in, raw_length, data, raw_length - 1, _table);
+    if (length == 0) {
+        block.flags |= LOG_COMPRESS_FLAG_STORED;
+        memcpy(data, _in, raw_length);
+        length = raw_length;
+    }
+    block.length = length;
+    memcpy(_out, &block, sizeof(block));
+    _out_len = sizeof(block) + length;
+    _out_ofs = 0;
+    return raw_length;
+}
+
+int32_t LogDecompressor::decode(const struct log_compress_block &hdr, const uint8_t *in, uint8_t *out)
+{
+    if (hdr.magic != LOG_COMPRESS_BLOCK_MAGIC ||
+        hdr.raw_length > LOG_COMPRESS_BLOCK_SIZE ||
+        hdr.length > hdr.raw_length) {
+        return -1;
+    }
+    if (hdr.flags & LOG_COMPRESS_FLAG_STORED) {
+        if (hdr.length != hdr.raw_length) {
+            return -1;
+        }
+        memcpy(out, in, hdr.raw_length);
+    } else if (LogLZ::decompress(in, hdr.length, out, hdr.raw_length) != hdr.raw_length) {
+        return -1;
+    }
+    if ((hdr.flags & LOG_COMPRESS_FLAG_DELTA) && !_delta.decode(out, hdr.raw_length)) {
+        return -1;
+    }
+    return hdr.raw_length;
+}
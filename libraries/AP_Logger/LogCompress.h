@@ -0,0 +1,153 @@
+/*
+  block compressed log files
+
+  With LOG_FILE_COMPRESS set AP_Logger_File writes a
+  log_compress_header followed by blocks, each a log_compress_block
+  and then length bytes of data which decode to raw_length bytes of
+  the normal log stream.
+
+  Two transforms are applied to each block:
+
+   - the TimeUS of each message which starts with one is replaced by
+     its difference from the TimeUS of the previous message of the
+     same type. The message lengths and which types have a TimeUS are
+     learnt from the FMT messages in the stream, so the encoder and
+     decoder need nothing but the stream. Blocks with this transform
+     applied always end on a message boundary. If the encoder sees a
+     message it has no format for it stops the transform for the rest
+     of the log
+
+   - the block is compressed with a byte oriented LZ77 codec in the
+     style of LZ4: sequences of a token byte, literals, a 16 bit offset
+     and a match length. Blocks which don't compress are stored
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/utility/RingBuffer.h>
+#include "LogStructure.h"
+
+#define LOG_COMPRESS_MAGIC 0x5A4C5041 // "APLZ"
+#define LOG_COMPRESS_VERSION 1
+#define LOG_COMPRESS_BLOCK_MAGIC 0xC5
+// maximum bytes of log stream in one block
+#define LOG_COMPRESS_BLOCK_SIZE 4096U
+
+#define LOG_COMPRESS_FLAG_DELTA  (1U<<0) // TimeUS fields are deltas
+#define LOG_COMPRESS_FLAG_STORED (1U<<1) // data is not LZ compressed
+
+// log2 of the number of entries in the compressor match table
+#ifndef HAL_LOGGER_COMPRESS_HASH_BITS
+#define HAL_LOGGER_COMPRESS_HASH_BITS 11
+#endif
+
+struct PACKED log_compress_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t block_size;
+};
+
+struct PACKED log_compress_block {
+    uint8_t magic;
+    uint8_t flags;
+    uint16_t raw_length;
+    uint16_t length;
+};
+
+/*
+  LZ block codec
+ */
+class LogLZ {
+public:
+    // compress len bytes of in, returning the compressed length or
+    // zero if it doesn't fit in out_size bytes. table must have
+    // 1<<HAL_LOGGER_COMPRESS_HASH_BITS entries
+    static uint32_t compress(const uint8_t *in, uint32_t len, uint8_t *out, uint32_t out_size, uint16_t *table);
+
+    // decompress len bytes of in, returning the decompressed length
+    // or -1 if the data is corrupt or doesn't fit in out_size bytes
+    static int32_t decompress(const uint8_t *in, uint32_t len, uint8_t *out, uint32_t out_size);
+};
+
+/*
+  TimeUS delta transform, applied in place to whole messages
+ */
+class LogTimeDelta {
+public:
+    LogTimeDelta(void) { reset(); }
+
+    void reset(void);
+
+    // transform the whole messages at the start of buf, returning how
+    // many bytes they are. A message which can't be parsed ends the
+    // transform for good
+    uint32_t encode(uint8_t *buf, uint32_t len);
+
+    // undo encode(), returning false if buf isn't whole messages
+    bool decode(uint8_t *buf, uint32_t len);
+
+    // false once encode() has found a message it can't parse
+    bool synced(void) const { return _synced; }
+
+private:
+    // learn the format of a message type from a FMT message
+    void learn_format(const uint8_t *msg);
+    // length of the message at buf, or zero if it can't be parsed
+    uint8_t message_length(const uint8_t *buf, uint32_t len) const;
+
+    struct {
+        uint8_t length;
+        bool has_time;
+        uint64_t last_time;
+    } _types[256];
+    bool _synced;
+};
+
+/*
+  compresses the log stream a block at a time, for the IO thread
+ */
+class LogCompressor {
+public:
+    ~LogCompressor(void);
+
+    // allocate buffers, returning false if out of memory
+    bool init(void);
+    bool enabled(void) const { return _in != nullptr; }
+
+    // start a new log, queueing the file header
+    void start(void);
+
+    // compress up to a block of data from buf, returning the number
+    // of bytes of buf which are now in the output and may be
+    // discarded. Must only be called when nothing is pending
+    uint32_t compress(ByteBuffer &buf);
+
+    // compressed data not yet written
+    uint32_t pending(void) const { return _out_len - _out_ofs; }
+    uint8_t *pending_data(void) { return &_out[_out_ofs]; }
+    void written(uint32_t n) { _out_ofs += n; }
+
+private:
+    LogTimeDelta _delta;
+    uint8_t *_in = nullptr;
+    uint8_t *_out = nullptr;
+    uint16_t *_table = nullptr;
+    uint32_t _out_len = 0;
+    uint32_t _out_ofs = 0;
+};
+
+/*
+  decodes the blocks of a compressed log
+ */
+class LogDecompressor {
+public:
+    void reset(void) { _delta.reset(); }
+
+    // decode a block with header hdr, returning the number of bytes
+    // written to out or -1 if the block is corrupt. out must have
+    // room for LOG_COMPRESS_BLOCK_SIZE bytes
+    int32_t decode(const struct log_compress_block &hdr, const uint8_t *in, uint8_t *out);
+
+private:
+    LogTimeDelta _delta;
+};
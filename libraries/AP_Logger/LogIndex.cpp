@@ -0,0 +1,198 @@
+/*
+  sidecar index for log files, see LogIndex.h
+ */
+
+#include "LogIndex.h"
+#include "LogStructure.h"
+
+#include <stddef.h>
+#include <string.h>
+
+bool LogIndexWriter::init(void)
+{
+    return _pending.set_size(HAL_LOGGER_INDEX_BUFFER_SIZE);
+}
+
+/*
+  start the index of a new log. The caller makes sure the pending
+  data isn't being written at the same time
+ */
+void LogIndexWriter::start(void)
+{
+    _pending.clear();
+    memset(_slot, 0, sizeof(_slot));
+    _bucket.num_types = 0;
+    _active = _pending.get_size() != 0;
+    if (!_active) {
+        return;
+    }
+    const struct log_index_header header {
+        LOG_INDEX_MAGIC,
+        LOG_INDEX_VERSION,
+        LOG_INDEX_INTERVAL_US / 1000U
+    };
+    _pending.write((const uint8_t *)&header, sizeof(header));
+}
+
+void LogIndexWriter::add(const uint8_t *msg, uint16_t size, uint32_t offset, uint64_t time_us)
+{
+    if (!_active || size < 3 || msg[0] != HEAD_BYTE1 || msg[1] != HEAD_BYTE2) {
+        return;
+    }
+    const uint8_t type = msg[2];
+
+    if (_bucket.num_types != 0 &&
+        (time_us - _bucket.time_us >= LOG_INDEX_INTERVAL_US ||
+         (_slot[type] == 0 && _bucket.num_types == LOG_INDEX_MAX_TYPES))) {
+        close_bucket();
+        if (!_active) {
+            return;
+        }
+    }
+
+    if (_bucket.num_types == 0) {
+        _bucket.time_us = time_us;
+        _bucket.start_offset = offset;
+    }
+    if (_slot[type] == 0) {
+        struct log_index_type &entry = _types[_bucket.num_types++];
+        entry.type = type;
+        entry.count = 0;
+        entry.first_offset = offset;
+        _slot[type] = _bucket.num_types;
+    }
+    struct log_index_type &entry = _types[_slot[type]-1];
+    entry.count++;
+    entry.last_offset = offset;
+    _bucket.end_offset = offset + size;
+}
+
+/*
+  queue the bucket for writing. If there isn't room the index stops
+  here, so that it never has a gap
+ */
+void LogIndexWriter::close_bucket(void)
+{
+    const uint32_t types_size = _bucket.num_types * sizeof(_types[0]);
+    if (_pending.space() < sizeof(_bucket) + types_size) {
+        _active = false;
+        return;
+    }
+    _bucket.magic = LOG_INDEX_BUCKET_MAGIC;
+    _pending.write((const uint8_t *)&_bucket, sizeof(_bucket));
+    _pending.write((const uint8_t *)_types, types_size);
+
+    for (uint8_t i=0; i<_bucket.num_types; i++) {
+        _slot[_types[i].type] = 0;
+    }
+    _bucket.num_types = 0;
+}
+
+LogIndex::~LogIndex(void)
+{
+    delete[] _data;
+    delete[] _bucket_ofs;
+}
+
+bool LogIndex::load(const uint8_t *data, uint32_t length, uint32_t log_length)
+{
+    delete[] _data;
+    delete[] _bucket_ofs;
+    _data = nullptr;
+    _bucket_ofs = nullptr;
+    _num_buckets = 0;
+    _end_offset = 0;
+
+    struct log_index_header header;
+    if (length < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != LOG_INDEX_MAGIC || header.version != LOG_INDEX_VERSION) {
+        return false;
+    }
+
+    // count the complete buckets which are within the log
+    uint32_t count = 0;
+    uint32_t ofs = sizeof(header);
+    uint32_t end_offset = 0;
+    while (length - ofs >= sizeof(log_index_bucket)) {
+        struct log_index_bucket bucket;
+        memcpy(&bucket, &data[ofs], sizeof(bucket));
+        const uint32_t record_length = sizeof(bucket) + bucket.num_types * sizeof(log_index_type);
+        if (bucket.magic != LOG_INDEX_BUCKET_MAGIC ||
+            length - ofs < record_length ||
+            bucket.end_offset > log_length ||
+            bucket.start_offset < end_offset) {
+            break;
+        }
+        end_offset = bucket.end_offset;
+        ofs += record_length;
+        count++;
+    }
+    if (count == 0) {
+        return false;
+    }
+
+    _data = new uint8_t[ofs];
+    _bucket_ofs = new uint32_t[count];
+    if (_data == nullptr || _bucket_ofs == nullptr) {
+        delete[] _data;
+        delete[] _bucket_ofs;
+        _data = nullptr;
+        _bucket_ofs = nullptr;
+        return false;
+    }
+    memcpy(_data, data, ofs);
+
+    ofs = sizeof(header);
+    for (uint32_t i=0; i<count; i++) {
+        _bucket_ofs[i] = ofs;
+        ofs += sizeof(log_index_bucket) + _data[ofs+1] * sizeof(log_index_type);
+    }
+    _num_buckets = count;
+    _end_offset = end_offset;
+    return true;
+}
+
+void LogIndex::get_bucket(uint32_t idx, struct log_index_bucket &bucket) const
+{
+    memcpy(&bucket, &_data[_bucket_ofs[idx]], sizeof(bucket));
+}
+
+bool LogIndex::find_type(uint32_t idx, uint8_t type, struct log_index_type &entry) const
+{
+    const uint8_t *p = &_data[_bucket_ofs[idx]];
+    const uint8_t num_types = p[1];
+    p += sizeof(log_index_bucket);
+    for (uint8_t i=0; i<num_types; i++, p += sizeof(log_index_type)) {
+        if (p[0] == type) {
+            memcpy(&entry, p, sizeof(entry));
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t LogIndex::bucket_for_time(uint64_t time_us) const
+{
+    // buckets are in time order, so binary search for the first
+    // bucket after time_us
+    uint32_t lo = 0, hi = _num_buckets;
+    while (lo < hi) {
+        const uint32_t mid = (lo + hi) / 2;
+        uint64_t t;
+        memcpy(&t, &_data[_bucket_ofs[mid] + offsetof(log_index_bucket, time_us)], sizeof(t));
+        if (t <= time_us) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo > 0 ? lo - 1 : 0;
+}
+
+uint32_t LogIndex::end_offset(void) const
+{
+    return _end_offset;
+}
@@ -0,0 +1,127 @@
+/*
+  sidecar index for log files
+
+  AP_Logger_File writes NN.IDX alongside NN.BIN so that a reader can
+  find messages by type and by time without parsing the whole log. The
+  index is a log_index_header followed by one record per time bucket:
+  a log_index_bucket and then num_types log_index_type entries, one for
+  each message type written in the bucket. Offsets are bytes from the
+  start of the log.
+
+  A bucket is closed and queued for writing once LOG_INDEX_INTERVAL_US
+  has passed since its first message, or when it has
+  LOG_INDEX_MAX_TYPES types. Times are when the message was queued,
+  which is never before the TimeUS of the message. The last bucket of
+  a log is not written, and if the index buffer overflows indexing
+  stops for the rest of the log; readers scan the log from the end of
+  the last bucket.
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/utility/RingBuffer.h>
+
+// the index costs a second open file and a buffer per log, so it is
+// only written by default where logs are large and read by tools
+#ifndef HAL_LOGGER_FILE_INDEX_ENABLED
+#define HAL_LOGGER_FILE_INDEX_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX)
+#endif
+
+// bytes of closed buckets waiting to be written to the index file
+#ifndef HAL_LOGGER_INDEX_BUFFER_SIZE
+#define HAL_LOGGER_INDEX_BUFFER_SIZE 2048
+#endif
+
+#define LOG_INDEX_MAGIC 0x58495041 // "APIX"
+#define LOG_INDEX_VERSION 1
+#define LOG_INDEX_BUCKET_MAGIC 0xB5
+#define LOG_INDEX_INTERVAL_US 1000000U
+#define LOG_INDEX_MAX_TYPES 64
+
+struct PACKED log_index_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t interval_ms;
+};
+
+struct PACKED log_index_bucket {
+    uint8_t magic;
+    uint8_t num_types;
+    uint64_t time_us;       // time the first message was queued
+    uint32_t start_offset;  // offset of the first message
+    uint32_t end_offset;    // offset just after the last message
+};
+
+struct PACKED log_index_type {
+    uint8_t type;
+    uint32_t count;
+    uint32_t first_offset;
+    uint32_t last_offset;
+};
+
+/*
+  builds the index as messages are queued for the log
+ */
+class LogIndexWriter {
+public:
+    // allocate the buffer, returning false if out of memory
+    bool init(void);
+
+    // start the index of a new log
+    void start(void);
+
+    // stop indexing until the next start()
+    void stop(void) { _active = false; }
+
+    // a message of size bytes has been queued at offset in the log
+    void add(const uint8_t *msg, uint16_t size, uint32_t offset, uint64_t time_us);
+
+    // index data waiting to be written to the index file
+    ByteBuffer &pending(void) { return _pending; }
+
+    // false if the index for this log has stopped
+    bool active(void) const { return _active; }
+
+private:
+    void close_bucket(void);
+
+    ByteBuffer _pending{0};
+    bool _active = false;
+
+    struct log_index_bucket _bucket;
+    struct log_index_type _types[LOG_INDEX_MAX_TYPES];
+    // index+1 into _types of each message type in the bucket
+    uint8_t _slot[256];
+};
+
+/*
+  index of a log loaded for reading
+ */
+class LogIndex {
+public:
+    ~LogIndex(void);
+
+    // load an index for a log of log_length bytes, returning false
+    // if it isn't a valid index. Buckets beyond the end of the log
+    // are dropped
+    bool load(const uint8_t *data, uint32_t length, uint32_t log_length);
+
+    uint32_t num_buckets(void) const { return _num_buckets; }
+
+    void get_bucket(uint32_t idx, struct log_index_bucket &bucket) const;
+
+    // find the entry for a message type in a bucket
+    bool find_type(uint32_t idx, uint8_t type, struct log_index_type &entry) const;
+
+    // the last bucket started at or before time_us, or zero
+    uint32_t bucket_for_time(uint64_t time_us) const;
+
+    // offset just after the last indexed message
+    uint32_t end_offset(void) const;
+
+private:
+    uint8_t *_data = nullptr;
+    uint32_t *_bucket_ofs = nullptr;
+    uint32_t _num_buckets = 0;
+    uint32_t _end_offset = 0;
+};
@@ -201,6 +201,12 @@ struct PACKED log_DSF {
     uint32_t buf_space_min;
     uint32_t buf_space_max;
     uint32_t buf_space_avg;
+    uint32_t queue_max;
+    uint32_t io_time_max;
+    uint16_t io_hist_1ms;
+    uint16_t io_hist_10ms;
+    uint16_t io_hist_100ms;
+    uint16_t io_hist_slow;
 };
 
 struct PACKED log_Event {
@@ -817,6 +823,12 @@ struct PACKED log_PSCZ {
 // @Field: FMn: Minimum free space in write buffer in last time period
 // @Field: FMx: Maximum free space in write buffer in last time period
 // @Field: FAv: Average free space in write buffer in last time period
+// @Field: QMx: Maximum number of bytes waiting to be written in last time period
+// @Field: IOMx: Maximum time taken by a single write to storage in last time period
+// @Field: IO1: Number of writes to storage taking less than 1ms
+// @Field: IO10: Number of writes to storage taking between 1ms and 10ms
+// @Field: IO100: Number of writes to storage taking between 10ms and 100ms
+// @Field: IOS: Number of writes to storage taking 100ms or more
 
 // @LoggerMessage: DSTL
 // @Description: Deepstall Landing data
@@ -1142,6 +1154,23 @@ struct PACKED log_PSCZ {
 // @Field: Pending: Number of tile requests outstanding
 // @Field: Loaded: Number of tiles in memory
 
+// @LoggerMessage: TSKH
+// @Description: Scheduler per-task timing histograms
+// @Field: TimeUS: Time since system startup
+// @Field: Id: task index, the fast loop is the last index
+// @Field: T16: runs taking less than 16us
+// @Field: T32: runs taking 16us to 31us
+// @Field: T64: runs taking 32us to 63us
+// @Field: T128: runs taking 64us to 127us
+// @Field: T256: runs taking 128us to 255us
+// @Field: T512: runs taking 256us to 511us
+// @Field: T1K: runs taking 512us to 1023us
+// @Field: TL: runs taking 1024us or more
+// @Field: O1: runs exceeding the allowed time by less than 2x
+// @Field: O2: runs exceeding the allowed time by 2x to 4x
+// @Field: O4: runs exceeding the allowed time by 4x to 8x
+// @Field: O8: runs exceeding the allowed time by 8x or more
+
 // @LoggerMessage: TSYN
 // @Description: Time synchronisation response information
 // @Field: TimeUS: Time since system startup
@@ -1291,7 +1320,7 @@ LOG_STRUCTURE_FROM_NAVEKF3 \
 LOG_STRUCTURE_FROM_NAVEKF \
 LOG_STRUCTURE_FROM_AHRS \
     { LOG_DF_FILE_STATS, sizeof(log_DSF), \
-      "DSF", "QIHIIII", "TimeUS,Dp,Blk,Bytes,FMn,FMx,FAv", "s--b---", "F--0---" }, \
+      "DSF", "QIHIIIIIIHHHH", "TimeUS,Dp,Blk,Bytes,FMn,FMx,FAv,QMx,IOMx,IO1,IO10,IO100,IOS", "s--b---bs----", "F--0---0F----" }, \
     { LOG_RPM_MSG, sizeof(log_RPM), \
       "RPM",  "Qff", "TimeUS,rpm1,rpm2", "sqq", "F00" }, \
     { LOG_RALLY_MSG, sizeof(log_Rally), \
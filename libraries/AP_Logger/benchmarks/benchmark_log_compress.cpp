@@ -0,0 +1,261 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Logger/LogCompress.h>
+#include <AP_Math/AP_Math.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/*
+  measure the cost of LOG_FILE_COMPRESS: compression as done by the
+  IO thread, decompression as done by Replay, and the ratio achieved.
+
+  By default a synthetic log of IMU, RATE and PID messages at typical
+  rates is used. Set LOG_BENCHMARK_FILE to the path of a .BIN log to
+  measure a recorded log instead.
+ */
+
+static const uint32_t buffer_size = 16384;
+
+struct PACKED log_bm_imu {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint8_t instance;
+    float gyr[3];
+    float acc[3];
+    uint32_t gyr_err;
+    uint32_t acc_err;
+    float temp;
+    uint8_t gyr_health;
+    uint8_t acc_health;
+    uint16_t gyr_rate;
+    uint16_t acc_rate;
+};
+
+struct PACKED log_bm_rate {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    float values[12];
+};
+
+struct PACKED log_bm_pid {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    float values[9];
+    uint8_t flags;
+};
+
+static void add_format(std::vector<uint8_t> &log, uint8_t type, uint8_t length,
+                       const char *name, const char *format, const char *labels)
+{
+    struct log_Format f {};
+    f.head1 = HEAD_BYTE1;
+    f.head2 = HEAD_BYTE2;
+    f.msgid = LOG_FORMAT_MSG;
+    f.type = type;
+    f.length = length;
+    memcpy(f.name, name, MIN(strlen(name), sizeof(f.name)));
+    strncpy(f.format, format, sizeof(f.format)-1);
+    strncpy(f.labels, labels, sizeof(f.labels)-1);
+    const uint8_t *p = (const uint8_t *)&f;
+    log.insert(log.end(), p, p + sizeof(f));
+}
+
+template <typename T>
+static void add_message(std::vector<uint8_t> &log, const T &msg)
+{
+    const uint8_t *p = (const uint8_t *)&msg;
+    log.insert(log.end(), p, p + sizeof(msg));
+}
+
+// a slowly varying signal with sensor noise
+static float signal(float t, float freq, float noise)
+{
+    return sinf(t * freq) + noise * ((random() % 2001) - 1000) * 0.001f;
+}
+
+/*
+  synthetic log: two IMUs at 400Hz, RATE and three PID controllers at
+  400Hz, the way a copter logs with fast attitude logging
+ */
+static std::vector<uint8_t> synthetic_log(void)
+{
+    std::vector<uint8_t> log;
+    add_format(log, 10, sizeof(log_bm_imu), "IMU", "QBffffffIIfBBHH",
+               "TimeUS,I,GyrX,GyrY,GyrZ,AccX,AccY,AccZ,EG,EA,T,GH,AH,GHz,AHz");
+    add_format(log, 11, sizeof(log_bm_rate), "RATE", "Qffffffffffff",
+               "TimeUS,RDes,R,ROut,PDes,P,POut,YDes,Y,YOut,ADes,A,AOut");
+    add_format(log, 12, sizeof(log_bm_pid), "PIDR", "QfffffffffB",
+               "TimeUS,Tar,Act,Err,P,I,D,FF,Dmod,SRate,Flags");
+
+    uint64_t time_us = 60000000;
+    srandom(1);
+    for (uint32_t i=0; i<40000; i++) {
+        time_us += 2500;
+        const float t = i * 0.0025f;
+        for (uint8_t instance=0; instance<2; instance++) {
+            const uint64_t imu_time = time_us + instance * 7 + (random() % 20);
+            const struct log_bm_imu imu {
+                LOG_PACKET_HEADER_INIT(10),
+                imu_time,
+                instance,
+                { signal(t, 1.1f, 0.01f), signal(t, 0.7f, 0.01f), signal(t, 0.3f, 0.01f) },
+                { signal(t, 0.5f, 0.2f), signal(t, 0.4f, 0.2f), -9.8f + signal(t, 0.2f, 0.2f) },
+                0, 0,
+                45.0f + signal(t, 0.01f, 0.05f),
+                1, 1,
+                400, 400
+            };
+            add_message(log, imu);
+        }
+        struct log_bm_rate rate {
+            LOG_PACKET_HEADER_INIT(11),
+            time_us + 100,
+            {}
+        };
+        for (uint8_t j=0; j<12; j++) {
+            rate.values[j] = signal(t, 0.1f * (j+1), 0.02f);
+        }
+        add_message(log, rate);
+        for (uint8_t axis=0; axis<3; axis++) {
+            struct log_bm_pid pid {
+                LOG_PACKET_HEADER_INIT(12),
+                time_us + 150,
+                {},
+                0
+            };
+            for (uint8_t j=0; j<9; j++) {
+                pid.values[j] = signal(t, 0.2f * (j+1), 0.01f);
+            }
+            // FF and Dmod are often constant
+            pid.values[6] = 0;
+            pid.values[7] = 1;
+            add_message(log, pid);
+        }
+    }
+    return log;
+}
+
+static const std::vector<uint8_t> &test_log(void)
+{
+    static std::vector<uint8_t> log;
+    if (!log.empty()) {
+        return log;
+    }
+    const char *path = getenv("LOG_BENCHMARK_FILE");
+    if (path == nullptr) {
+        log = synthetic_log();
+        return log;
+    }
+    FILE *f = fopen(path, "rb");
+    if (f == nullptr) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        exit(1);
+    }
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        log.insert(log.end(), buf, buf + n);
+    }
+    fclose(f);
+    return log;
+}
+
+/*
+  compress a log the way the IO thread does, returning the compressed
+  length
+ */
+static uint64_t compress_log(LogCompressor &compressor, ByteBuffer &buf, const std::vector<uint8_t> &log,
+                             std::vector<uint8_t> *out)
+{
+    compressor.start();
+    buf.clear();
+    uint64_t length = 0;
+    size_t ofs = 0;
+    while (ofs < log.size() || buf.available() != 0 || compressor.pending() != 0) {
+        // the logger only queues whole messages, but the compressor
+        // doesn't rely on that so fill in arbitrary pieces
+        const uint32_t n = MIN(buf.space(), uint32_t(log.size() - ofs));
+        buf.write(&log[ofs], n);
+        ofs += n;
+        if (compressor.pending() == 0) {
+            const uint32_t used = compressor.compress(buf);
+            if (used == 0 && ofs == log.size() && compressor.pending() == 0) {
+                // a partial message at the end of the log
+                break;
+            }
+            buf.advance(used);
+        }
+        if (out != nullptr) {
+            out->insert(out->end(), compressor.pending_data(), compressor.pending_data() + compressor.pending());
+        }
+        length += compressor.pending();
+        compressor.written(compressor.pending());
+    }
+    return length;
+}
+
+static void BM_LogCompress(benchmark::State& state)
+{
+    const std::vector<uint8_t> &log = test_log();
+    ByteBuffer buf{buffer_size};
+    LogCompressor compressor;
+    if (!compressor.init()) {
+        state.SkipWithError("out of memory");
+        return;
+    }
+    uint64_t compressed = 0;
+    while (state.KeepRunning()) {
+        compressed = compress_log(compressor, buf, log, nullptr);
+        gbenchmark_escape(&compressed);
+    }
+    state.SetBytesProcessed(state.iterations() * log.size());
+    char label[64];
+    snprintf(label, sizeof(label), "%.1fMB ratio %.2f", log.size() * 1.0e-6, double(log.size()) / compressed);
+    state.SetLabel(label);
+}
+
+static void BM_LogDecompress(benchmark::State& state)
+{
+    const std::vector<uint8_t> &log = test_log();
+    ByteBuffer buf{buffer_size};
+    LogCompressor compressor;
+    if (!compressor.init()) {
+        state.SkipWithError("out of memory");
+        return;
+    }
+    std::vector<uint8_t> compressed;
+    compress_log(compressor, buf, log, &compressed);
+
+    LogDecompressor decompressor;
+    uint8_t out[LOG_COMPRESS_BLOCK_SIZE];
+    uint64_t decoded = 0;
+    while (state.KeepRunning()) {
+        decompressor.reset();
+        decoded = 0;
+        size_t ofs = sizeof(struct log_compress_header);
+        while (ofs + sizeof(struct log_compress_block) <= compressed.size()) {
+            struct log_compress_block block;
+            memcpy(&block, &compressed[ofs], sizeof(block));
+            ofs += sizeof(block);
+            const int32_t n = decompressor.decode(block, &compressed[ofs], out);
+            if (n < 0) {
+                state.SkipWithError("corrupt block");
+                return;
+            }
+            ofs += block.length;
+            decoded += n;
+        }
+        gbenchmark_escape(out);
+    }
+    state.SetBytesProcessed(state.iterations() * decoded);
+}
+
+BENCHMARK(BM_LogCompress);
+BENCHMARK(BM_LogDecompress);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,126 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/utility/RingBuffer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+
+/*
+  a model of the AP_Logger_File write buffer, for choosing the number
+  of chunks io_timer() drains per pass (HAL_LOGGER_WRITE_CHUNKS_MAX).
+  AP_Logger_File itself isn't run: it needs the logger, its parameters
+  and a vehicle. Instead a 200kB ByteBuffer, the largest default
+  LOG_FILE_BUFSIZE, is filled by the benchmark thread, standing in for
+  a 400Hz main loop writing a burst of IMU sized log messages each
+  loop, and drained to a file by a writer thread at the 1kHz
+  io_timer() rate, in chunks the same way io_timer() does. Messages which don't fit are counted as dropped, so
+  the result is only as good as the model: it leaves out the reserved
+  space for critical messages, the log compressor and the writer
+  thread waking early on a full chunk
+ */
+
+static const uint32_t buffer_size = 200 * 1024;
+static const uint32_t chunk_size = 4096;
+static const auto loop_period = std::chrono::microseconds(2500);
+static const auto io_period = std::chrono::microseconds(1000);
+
+struct drain_result {
+    uint64_t written;
+    int error;
+};
+
+static void drain(ByteBuffer &buf, std::atomic<bool> &running, uint32_t chunks_max, drain_result &result)
+{
+    char path[] = "/tmp/logbufXXXXXX";
+    const int fd = mkstemp(path);
+    if (fd == -1) {
+        result.error = errno;
+        return;
+    }
+    unlink(path);
+    auto next = std::chrono::steady_clock::now();
+    while (running) {
+        next += io_period;
+        std::this_thread::sleep_until(next);
+        uint32_t nbytes = std::min(buf.available(), chunk_size * chunks_max);
+        while (nbytes > 0) {
+            ByteBuffer::IoVec vec[2];
+            const uint8_t n_vec = buf.peekiovec(vec, std::min(nbytes, chunk_size));
+            uint32_t nwritten = 0;
+            bool short_write = false;
+            for (uint8_t i=0; i<n_vec && !short_write; i++) {
+                const ssize_t ret = write(fd, vec[i].data, vec[i].len);
+                if (ret == -1) {
+                    result.error = errno;
+                    close(fd);
+                    return;
+                }
+                nwritten += ret;
+                short_write = uint32_t(ret) < vec[i].len;
+            }
+            buf.advance(nwritten);
+            result.written += nwritten;
+            nbytes -= nwritten;
+            if (short_write) {
+                break;
+            }
+        }
+    }
+    close(fd);
+}
+
+static void BM_LoggerBufferModel(benchmark::State& state)
+{
+    ByteBuffer buf{buffer_size};
+    std::atomic<bool> running{true};
+    drain_result result {};
+    std::thread writer(drain, std::ref(buf), std::ref(running), uint32_t(state.range_x()), std::ref(result));
+
+    const uint32_t msgs_per_loop = state.range_y();
+    uint8_t msg[48] {};
+    uint64_t written = 0;
+    uint64_t dropped = 0;
+
+    auto next = std::chrono::steady_clock::now();
+    while (state.KeepRunning()) {
+        for (uint32_t i=0; i<msgs_per_loop; i++) {
+            if (buf.space() < sizeof(msg)) {
+                dropped++;
+                continue;
+            }
+            buf.write(msg, sizeof(msg));
+            written++;
+        }
+        next += loop_period;
+        std::this_thread::sleep_until(next);
+    }
+
+    running = false;
+    writer.join();
+
+    state.SetBytesProcessed(result.written);
+    char label[64];
+    if (result.error != 0) {
+        snprintf(label, sizeof(label), "write failed: %s", strerror(result.error));
+    } else {
+        snprintf(label, sizeof(label), "dropped %.3f%%",
+                 written + dropped > 0 ? 100.0 * dropped / (written + dropped) : 0.0);
+    }
+    state.SetLabel(label);
+}
+
+// arguments are the maximum number of chunks drained per pass and the
+// number of messages written per 400Hz loop: 10 is a typical copter
+// with fast IMU logging (~190kB/s), 50 is the replay logging rate and
+// 250 is beyond what one chunk per 1kHz pass can drain
+BENCHMARK(BM_LoggerBufferModel)->ArgPair(1, 10)->ArgPair(8, 10)->ArgPair(1, 50)->ArgPair(8, 50)->ArgPair(1, 250)->ArgPair(8, 250)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,210 @@
+#include <AP_gtest.h>
+
+#include <AP_Logger/LogCompress.h>
+#include <AP_Math/AP_Math.h>
+#include <stdlib.h>
+#include <string.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+struct PACKED log_test {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    float value;
+};
+
+#define TEST_MSG 10
+
+static uint32_t write_format(uint8_t *buf)
+{
+    struct log_Format f {};
+    f.head1 = HEAD_BYTE1;
+    f.head2 = HEAD_BYTE2;
+    f.msgid = LOG_FORMAT_MSG;
+    f.type = TEST_MSG;
+    f.length = sizeof(log_test);
+    memcpy(f.name, "TEST", sizeof(f.name));
+    strncpy(f.format, "Qf", sizeof(f.format));
+    strncpy(f.labels, "TimeUS,Value", sizeof(f.labels));
+    memcpy(buf, &f, sizeof(f));
+    return sizeof(f);
+}
+
+static uint32_t write_test(uint8_t *buf, uint64_t time_us, float value)
+{
+    const struct log_test msg {
+        LOG_PACKET_HEADER_INIT(TEST_MSG),
+        time_us,
+        value
+    };
+    memcpy(buf, &msg, sizeof(msg));
+    return sizeof(msg);
+}
+
+TEST(LogCompress, LZRoundTrip)
+{
+    uint8_t in[LOG_COMPRESS_BLOCK_SIZE];
+    uint8_t out[LOG_COMPRESS_BLOCK_SIZE];
+    uint8_t decoded[LOG_COMPRESS_BLOCK_SIZE];
+    uint16_t table[1U << HAL_LOGGER_COMPRESS_HASH_BITS];
+
+    // repetitive data with some noise, including long literal and
+    // match runs
+    for (uint32_t i=0; i<sizeof(in); i++) {
+        in[i] = (i % 300 < 40) ? (random() & 0xFF) : (i % 7);
+    }
+    const uint32_t length = LogLZ::compress(in, sizeof(in), out, sizeof(out), table);
+    EXPECT_GT(length, 0U);
+    EXPECT_LT(length, sizeof(in) / 2);
+    EXPECT_EQ(LogLZ::decompress(out, length, decoded, sizeof(decoded)), int32_t(sizeof(in)));
+    EXPECT_EQ(memcmp(in, decoded, sizeof(in)), 0);
+
+    // doesn't fit
+    EXPECT_EQ(LogLZ::compress(in, sizeof(in), out, length - 1, table), 0U);
+    // too small for the output
+    EXPECT_EQ(LogLZ::decompress(out, length, decoded, sizeof(in) - 1), -1);
+    // truncated
+    EXPECT_EQ(LogLZ::decompress(out, length / 2, decoded, sizeof(decoded)), -1);
+
+    // random data doesn't compress
+    for (uint32_t i=0; i<sizeof(in); i++) {
+        in[i] = random() & 0xFF;
+    }
+    EXPECT_EQ(LogLZ::compress(in, sizeof(in), out, sizeof(in) - 1, table), 0U);
+
+    // short inputs
+    for (uint32_t len=0; len<8; len++) {
+        const uint32_t n = LogLZ::compress(in, len, out, sizeof(out), table);
+        EXPECT_GT(n, 0U);
+        EXPECT_EQ(LogLZ::decompress(out, n, decoded, sizeof(decoded)), int32_t(len));
+        EXPECT_EQ(memcmp(in, decoded, len), 0);
+    }
+}
+
+TEST(LogCompress, TimeDelta)
+{
+    uint8_t buf[1024];
+    uint32_t len = write_format(buf);
+    for (uint8_t i=0; i<10; i++) {
+        len += write_test(&buf[len], 1000000000ULL + i * 2500U, i);
+    }
+    uint8_t encoded[sizeof(buf)];
+    memcpy(encoded, buf, len);
+
+    LogTimeDelta encoder;
+    // a partial message is left for the next block
+    EXPECT_EQ(encoder.encode(encoded, len - 1), len - sizeof(log_test));
+    EXPECT_EQ(encoder.encode(&encoded[len - sizeof(log_test)], sizeof(log_test)), sizeof(log_test));
+    EXPECT_TRUE(encoder.synced());
+
+    uint64_t t;
+    memcpy(&t, &encoded[sizeof(log_Format) + sizeof(log_test) + 3], sizeof(t));
+    EXPECT_EQ(t, 2500U);
+
+    LogTimeDelta decoder;
+    EXPECT_TRUE(decoder.decode(encoded, len));
+    EXPECT_EQ(memcmp(buf, encoded, len), 0);
+
+    // a message without a format stops the transform
+    LogTimeDelta unsynced;
+    EXPECT_EQ(unsynced.encode(&buf[sizeof(log_Format)], sizeof(log_test)), 0U);
+    EXPECT_FALSE(unsynced.synced());
+    EXPECT_FALSE(decoder.decode(buf, len - 1));
+}
+
+TEST(LogCompress, Stream)
+{
+    ByteBuffer buf{16384};
+    uint8_t msg[sizeof(log_Format)];
+    uint8_t raw[65536];
+    uint32_t raw_len = 0;
+
+    uint32_t n = write_format(msg);
+    buf.write(msg, n);
+    memcpy(&raw[raw_len], msg, n);
+    raw_len += n;
+
+    LogCompressor compressor;
+    EXPECT_TRUE(compressor.init());
+    compressor.start();
+
+    uint8_t file[65536];
+    uint32_t file_len = 0;
+    uint64_t t = 5000000;
+    for (uint32_t i=0; i<2000; i++) {
+        if (buf.space() >= sizeof(log_test)) {
+            t += 2500 + (random() % 5);
+            n = write_test(msg, t, sinf(i * 0.01f));
+            buf.write(msg, n);
+            memcpy(&raw[raw_len], msg, n);
+            raw_len += n;
+        }
+        if (i == 1500) {
+            // a message of unknown type, which ends the delta transform
+            n = write_test(msg, t, 0);
+            msg[2] = TEST_MSG + 1;
+            buf.write(msg, n);
+            memcpy(&raw[raw_len], msg, n);
+            raw_len += n;
+        }
+        if (compressor.pending() == 0 && (i % 50 == 0 || i == 1999)) {
+            buf.advance(compressor.compress(buf));
+        }
+        // write out a few bytes at a time
+        const uint32_t w = MIN(compressor.pending(), 1000U);
+        memcpy(&file[file_len], compressor.pending_data(), w);
+        file_len += w;
+        compressor.written(w);
+    }
+    while (compressor.pending() != 0 || buf.available() != 0) {
+        if (compressor.pending() == 0) {
+            buf.advance(compressor.compress(buf));
+        }
+        const uint32_t w = compressor.pending();
+        memcpy(&file[file_len], compressor.pending_data(), w);
+        file_len += w;
+        compressor.written(w);
+    }
+    EXPECT_LT(file_len, raw_len * 3 / 4);
+
+    struct log_compress_header header;
+    memcpy(&header, file, sizeof(header));
+    EXPECT_EQ(header.magic, uint32_t(LOG_COMPRESS_MAGIC));
+
+    LogDecompressor decompressor;
+    uint8_t decoded[65536];
+    uint32_t decoded_len = 0;
+    uint32_t ofs = sizeof(header);
+    bool saw_delta = false, saw_plain = false;
+    while (ofs < file_len) {
+        struct log_compress_block block;
+        memcpy(&block, &file[ofs], sizeof(block));
+        ofs += sizeof(block);
+        const int32_t ret = decompressor.decode(block, &file[ofs], &decoded[decoded_len]);
+        EXPECT_GT(ret, 0);
+        if (ret <= 0) {
+            break;
+        }
+        if (block.flags & LOG_COMPRESS_FLAG_DELTA) {
+            saw_delta = true;
+            EXPECT_FALSE(saw_plain);
+        } else {
+            saw_plain = true;
+        }
+        ofs += block.length;
+        decoded_len += ret;
+    }
+    EXPECT_TRUE(saw_delta);
+    EXPECT_TRUE(saw_plain);
+    EXPECT_EQ(decoded_len, raw_len);
+    EXPECT_EQ(memcmp(raw, decoded, raw_len), 0);
+
+    // corrupt data is detected
+    struct log_compress_block block;
+    memcpy(&block, &file[sizeof(header)], sizeof(block));
+    block.raw_length++;
+    decompressor.reset();
+    EXPECT_EQ(decompressor.decode(block, &file[sizeof(header) + sizeof(block)], decoded), -1);
+}
+
+AP_GTEST_MAIN()
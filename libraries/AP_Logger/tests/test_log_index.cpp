@@ -0,0 +1,132 @@
+#include <AP_gtest.h>
+
+#include <AP_Logger/LogIndex.h>
+#include <AP_Logger/LogStructure.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#define MSG_SIZE 20U
+
+/*
+  queue count messages, alternating between types 10 and 11 and one
+  every 100ms, returning the length of the log
+ */
+static uint32_t add_messages(LogIndexWriter &writer, uint32_t count)
+{
+    uint8_t msg[MSG_SIZE] {};
+    msg[0] = HEAD_BYTE1;
+    msg[1] = HEAD_BYTE2;
+    uint32_t offset = 0;
+    for (uint32_t i=0; i<count; i++) {
+        msg[2] = 10 + (i % 2);
+        writer.add(msg, sizeof(msg), offset, 5000000ULL + i * 100000ULL);
+        offset += sizeof(msg);
+    }
+    return offset;
+}
+
+static uint32_t take_pending(LogIndexWriter &writer, uint8_t *buf, uint32_t size)
+{
+    return writer.pending().read(buf, size);
+}
+
+TEST(LogIndex, RoundTrip)
+{
+    LogIndexWriter writer;
+    EXPECT_TRUE(writer.init());
+    writer.start();
+    // 3.5 seconds of messages, the fourth bucket isn't closed
+    const uint32_t log_length = add_messages(writer, 35);
+
+    uint8_t buf[HAL_LOGGER_INDEX_BUFFER_SIZE];
+    const uint32_t length = take_pending(writer, buf, sizeof(buf));
+
+    LogIndex index;
+    EXPECT_TRUE(index.load(buf, length, log_length));
+    EXPECT_EQ(index.num_buckets(), 3U);
+    EXPECT_EQ(index.end_offset(), 30 * MSG_SIZE);
+
+    struct log_index_bucket bucket;
+    index.get_bucket(1, bucket);
+    EXPECT_EQ(bucket.time_us, 6000000ULL);
+    EXPECT_EQ(bucket.start_offset, 10 * MSG_SIZE);
+    EXPECT_EQ(bucket.end_offset, 20 * MSG_SIZE);
+
+    struct log_index_type entry;
+    EXPECT_TRUE(index.find_type(1, 11, entry));
+    EXPECT_EQ(entry.count, 5U);
+    EXPECT_EQ(entry.first_offset, 11 * MSG_SIZE);
+    EXPECT_EQ(entry.last_offset, 19 * MSG_SIZE);
+    EXPECT_FALSE(index.find_type(1, 12, entry));
+
+    EXPECT_EQ(index.bucket_for_time(0), 0U);
+    EXPECT_EQ(index.bucket_for_time(5999999), 0U);
+    EXPECT_EQ(index.bucket_for_time(6000000), 1U);
+    EXPECT_EQ(index.bucket_for_time(100000000), 2U);
+}
+
+TEST(LogIndex, TruncatedLog)
+{
+    LogIndexWriter writer;
+    EXPECT_TRUE(writer.init());
+    writer.start();
+    add_messages(writer, 35);
+
+    uint8_t buf[HAL_LOGGER_INDEX_BUFFER_SIZE];
+    const uint32_t length = take_pending(writer, buf, sizeof(buf));
+
+    // buckets past the end of the log are dropped
+    LogIndex index;
+    EXPECT_TRUE(index.load(buf, length, 25 * MSG_SIZE));
+    EXPECT_EQ(index.num_buckets(), 2U);
+    EXPECT_EQ(index.end_offset(), 20 * MSG_SIZE);
+
+    // as is a partly written bucket
+    EXPECT_TRUE(index.load(buf, length - 1, 35 * MSG_SIZE));
+    EXPECT_EQ(index.num_buckets(), 2U);
+
+    // nothing indexed
+    EXPECT_FALSE(index.load(buf, length, 5 * MSG_SIZE));
+    EXPECT_EQ(index.num_buckets(), 0U);
+
+    buf[0] ^= 1;
+    EXPECT_FALSE(index.load(buf, length, 35 * MSG_SIZE));
+}
+
+TEST(LogIndex, ManyTypes)
+{
+    LogIndexWriter writer;
+    EXPECT_TRUE(writer.init());
+    writer.start();
+
+    // more types than a bucket holds, all at the same time
+    uint8_t msg[MSG_SIZE] {};
+    msg[0] = HEAD_BYTE1;
+    msg[1] = HEAD_BYTE2;
+    const uint32_t num_types = LOG_INDEX_MAX_TYPES + 10;
+    for (uint32_t i=0; i<num_types; i++) {
+        msg[2] = i;
+        writer.add(msg, sizeof(msg), i * MSG_SIZE, 1000);
+    }
+    // close the second bucket
+    writer.add(msg, sizeof(msg), num_types * MSG_SIZE, 1000 + LOG_INDEX_INTERVAL_US);
+
+    uint8_t buf[HAL_LOGGER_INDEX_BUFFER_SIZE];
+    const uint32_t length = take_pending(writer, buf, sizeof(buf));
+
+    LogIndex index;
+    EXPECT_TRUE(index.load(buf, length, (num_types + 1) * MSG_SIZE));
+    EXPECT_EQ(index.num_buckets(), 2U);
+    struct log_index_type entry;
+    EXPECT_TRUE(index.find_type(0, LOG_INDEX_MAX_TYPES - 1, entry));
+    EXPECT_FALSE(index.find_type(0, LOG_INDEX_MAX_TYPES, entry));
+    EXPECT_TRUE(index.find_type(1, LOG_INDEX_MAX_TYPES, entry));
+    EXPECT_EQ(entry.first_offset, LOG_INDEX_MAX_TYPES * MSG_SIZE);
+
+    // messages which aren't logger messages are ignored
+    msg[0] = 0;
+    writer.add(msg, sizeof(msg), 0, 10000000);
+    EXPECT_EQ(writer.pending().available(), 0U);
+}
+
+AP_GTEST_MAIN()
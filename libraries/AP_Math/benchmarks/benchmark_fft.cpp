@@ -0,0 +1,143 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AP_Math/real_fft.h>
+
+#include <complex>
+
+/*
+  FFT of one hanning windowed gyro axis for each FFT_WINDOW_SIZE, as
+  done by the SITL and Linux DSP backends
+ */
+#define BENCH_FFT_MAX_WINDOW    1024
+
+static float samples[BENCH_FFT_MAX_WINDOW];
+static float rfft_data[BENCH_FFT_MAX_WINDOW + 2];
+static float freq_bins[BENCH_FFT_MAX_WINDOW];
+
+static void fill_samples(uint16_t window_size)
+{
+    for (uint16_t i = 0; i < window_size; i++) {
+        const float hanning = 0.5f - 0.5f * cosf(M_2PI * i / (window_size - 1));
+        samples[i] = hanning * (sinf(M_2PI * 95.0f * i / 1000.0f) + 0.3f * sinf(M_2PI * 190.0f * i / 1000.0f));
+    }
+}
+
+// radix-2 complex FFT of the real samples, as used by the SITL DSP backend before RealFFT
+static void complex_fft(std::complex<float> *buf, uint16_t fftlen)
+{
+    uint16_t m = 0;
+    while ((1U << m) < fftlen) {
+        m++;
+    }
+    for (uint16_t k = 0; k < fftlen; k++) {
+        uint16_t ki = k, kr = 0;
+        for (uint16_t i = 1; i <= m; i++) {
+            kr = (kr << 1) | (ki & 1);
+            ki >>= 1;
+        }
+        if (kr > k) {
+            std::swap(buf[k], buf[kr]);
+        }
+    }
+    for (uint16_t istep = 2; istep <= fftlen; istep <<= 1) {
+        const uint16_t is2 = istep / 2;
+        const uint16_t astep = fftlen / istep;
+        for (uint16_t km = 0; km < is2; km++) {
+            const uint16_t a = km * astep;
+            const std::complex<float> w(sinf(M_2PI * (a + (fftlen / 4)) / fftlen), sinf(M_2PI * a / fftlen));
+            for (uint16_t ki = 0; ki <= (fftlen - istep); ki += istep) {
+                const uint16_t i = km + ki;
+                const uint16_t j = is2 + i;
+                const std::complex<float> t = w * buf[j];
+                const std::complex<float> q = buf[i];
+                buf[j] = q - t;
+                buf[i] = q + t;
+            }
+        }
+    }
+}
+
+static void BM_ComplexFFT(benchmark::State& state)
+{
+    const uint16_t window_size = state.range_x();
+    static std::complex<float> buf[BENCH_FFT_MAX_WINDOW];
+    fill_samples(window_size);
+    while (state.KeepRunning()) {
+        for (uint16_t i = 0; i < window_size; i++) {
+            buf[i] = std::complex<float>(samples[i], 0);
+        }
+        complex_fft(buf, window_size);
+        for (uint16_t i = 0; i < window_size / 2; i++) {
+            freq_bins[i] = std::norm(buf[i]);
+        }
+        gbenchmark_escape(freq_bins);
+    }
+    state.SetItemsProcessed(state.iterations() * window_size);
+}
+
+static void BM_RealFFT(benchmark::State& state)
+{
+    const uint16_t window_size = state.range_x();
+    RealFFT rfft;
+    rfft.init(window_size);
+    fill_samples(window_size);
+    while (state.KeepRunning()) {
+        rfft.transform(samples, rfft_data);
+        RealFFT::magnitude_squared(rfft_data, freq_bins, window_size / 2);
+        gbenchmark_escape(freq_bins);
+    }
+    state.SetItemsProcessed(state.iterations() * window_size);
+}
+
+// all three gyro axes, one after the other
+static void BM_RealFFTAxes(benchmark::State& state)
+{
+    const uint16_t window_size = state.range_x();
+    RealFFT rfft[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        rfft[i].init(window_size);
+    }
+    fill_samples(window_size);
+    while (state.KeepRunning()) {
+        for (uint8_t i = 0; i < 3; i++) {
+            rfft[i].transform(samples, rfft_data);
+            RealFFT::magnitude_squared(rfft_data, freq_bins, window_size / 2);
+            gbenchmark_escape(freq_bins);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * window_size * 3);
+}
+
+// all three gyro axes interleaved through the FFT
+static void BM_RealFFTBatch(benchmark::State& state)
+{
+    const uint16_t window_size = state.range_x();
+    RealFFT rfft[3];
+    static float batch_rfft_data[3][BENCH_FFT_MAX_WINDOW + 2];
+    RealFFT* ffts[3];
+    const float* in[3];
+    float* out[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        rfft[i].init(window_size);
+        ffts[i] = &rfft[i];
+        in[i] = samples;
+        out[i] = batch_rfft_data[i];
+    }
+    fill_samples(window_size);
+    while (state.KeepRunning()) {
+        RealFFT::transform_batch(ffts, in, out, 3);
+        for (uint8_t i = 0; i < 3; i++) {
+            RealFFT::magnitude_squared(out[i], freq_bins, window_size / 2);
+            gbenchmark_escape(freq_bins);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * window_size * 3);
+}
+
+BENCHMARK(BM_ComplexFFT)->Arg(32)->Arg(64)->Arg(128)->Arg(256)->Arg(512)->Arg(1024);
+BENCHMARK(BM_RealFFT)->Arg(32)->Arg(64)->Arg(128)->Arg(256)->Arg(512)->Arg(1024);
+BENCHMARK(BM_RealFFTAxes)->Arg(32)->Arg(64)->Arg(128)->Arg(256)->Arg(512)->Arg(1024);
+BENCHMARK(BM_RealFFTBatch)->Arg(32)->Arg(64)->Arg(128)->Arg(256)->Arg(512)->Arg(1024);
+
+BENCHMARK_MAIN();
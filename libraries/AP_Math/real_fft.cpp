@@ -0,0 +1,302 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  FFT of real input using a half length complex FFT
+
+  With z[n] = x[2n] + i*x[2n+1] and Z = FFT(z) of length M = N/2 the
+  real FFT of x is
+
+    X[k] = Xe[k] + exp(-2*pi*i*k/N) * Xo[k]
+    Xe[k] = (Z[k] + conj(Z[M-k])) / 2
+    Xo[k] = (Z[k] - conj(Z[M-k])) / 2i
+
+  and X[M-k] = conj(Xe[k] - exp(-2*pi*i*k/N) * Xo[k]), so each pass of
+  the split loop produces two bins.
+
+  The complex FFT is a decimation in time radix-2 FFT on separate real
+  and imaginary arrays, so that four butterflies of a stage can be
+  done at once with contiguous loads. The first two stages have no
+  multiplications and are done together as radix-4 butterflies.
+  Batches of windows share the twiddle factors of the first FFT
+ */
+
+#include "real_fft.h"
+
+#if AP_MATH_REAL_FFT_ENABLED
+
+#include "AP_Math.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define REAL_FFT_NEON 1
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define REAL_FFT_SSE 1
+#endif
+
+RealFFT::~RealFFT()
+{
+    delete[] _re;
+    delete[] _bitrev;
+}
+
+// prepare for transforms of length real samples. length must be a
+// power of 2 of at least 4. Returns false if out of memory
+bool RealFFT::init(uint16_t length)
+{
+    delete[] _re;
+    delete[] _bitrev;
+    _re = nullptr;
+    _bitrev = nullptr;
+    _length = 0;
+
+    if (length < 4 || (length & (length - 1)) != 0) {
+        return false;
+    }
+
+    const uint16_t half = length / 2;
+    const uint16_t split_count = half / 2 + 1;
+
+    // packed data, butterfly twiddles and split twiddles in one allocation
+    float *block = new float[4 * half + 2 * split_count];
+    _bitrev = new uint16_t[half];
+    if (block == nullptr || _bitrev == nullptr) {
+        delete[] block;
+        delete[] _bitrev;
+        _bitrev = nullptr;
+        return false;
+    }
+    _re = block;
+    _im = &block[half];
+    _twiddle_re = &block[2 * half];
+    _twiddle_im = &block[3 * half];
+    _split_re = &block[4 * half];
+    _split_im = &block[4 * half + split_count];
+
+    uint8_t bits = 0;
+    while ((1U << bits) < half) {
+        bits++;
+    }
+    for (uint16_t n = 0; n < half; n++) {
+        uint16_t rev = 0;
+        for (uint8_t b = 0; b < bits; b++) {
+            if (n & (1U << b)) {
+                rev |= 1U << (bits - 1 - b);
+            }
+        }
+        _bitrev[n] = rev;
+    }
+
+    // the stage joining pairs of h point FFTs uses exp(-pi*i*j/h) for
+    // j < h, stored from index h-1
+    for (uint16_t h = 1; h < half; h <<= 1) {
+        for (uint16_t j = 0; j < h; j++) {
+            const float angle = M_PI * j / h;
+            _twiddle_re[h - 1 + j] = cosf(angle);
+            _twiddle_im[h - 1 + j] = -sinf(angle);
+        }
+    }
+
+    for (uint16_t k = 0; k < split_count; k++) {
+        const float angle = M_2PI * k / length;
+        _split_re[k] = cosf(angle);
+        _split_im[k] = -sinf(angle);
+    }
+
+    _length = length;
+    _half = half;
+    return true;
+}
+
+// forward FFT of length real samples. out holds length/2+1
+// interleaved real, imaginary pairs, with bins 0 and length/2 real
+void RealFFT::transform(const float *in, float *out)
+{
+    RealFFT *self = this;
+    transform_batch(&self, &in, &out, 1);
+}
+
+// forward FFT of count windows of the same length
+void RealFFT::transform_batch(RealFFT* const ffts[], const float* const in[], float* const out[], uint8_t count)
+{
+    for (uint8_t c = 0; c < count; c++) {
+        ffts[c]->pack(in[c]);
+    }
+
+    butterflies(ffts, count);
+
+    for (uint8_t c = 0; c < count; c++) {
+        ffts[c]->split(out[c]);
+    }
+}
+
+// pack even and odd samples as complex values in bit reversed order
+void RealFFT::pack(const float *in)
+{
+    for (uint16_t n = 0; n < _half; n++) {
+        const uint16_t r = _bitrev[n];
+        _re[r] = in[2 * n];
+        _im[r] = in[2 * n + 1];
+    }
+}
+
+// N/2 point complex FFTs of _re and _im of count ffts, in bit reversed order
+void RealFFT::butterflies(RealFFT* const ffts[], uint8_t count)
+{
+    const uint16_t half = ffts[0]->_half;
+    uint16_t h;
+    if (half >= 4) {
+        // first two stages, twiddles are 1 and -i
+        for (uint8_t c = 0; c < count; c++) {
+            float *re = ffts[c]->_re;
+            float *im = ffts[c]->_im;
+            for (uint16_t n = 0; n < half; n += 4) {
+                const float a0r = re[n] + re[n + 1], a0i = im[n] + im[n + 1];
+                const float a1r = re[n] - re[n + 1], a1i = im[n] - im[n + 1];
+                const float a2r = re[n + 2] + re[n + 3], a2i = im[n + 2] + im[n + 3];
+                const float a3r = re[n + 2] - re[n + 3], a3i = im[n + 2] - im[n + 3];
+                re[n] = a0r + a2r;
+                im[n] = a0i + a2i;
+                re[n + 2] = a0r - a2r;
+                im[n + 2] = a0i - a2i;
+                // -i * a3
+                re[n + 1] = a1r + a3i;
+                im[n + 1] = a1i - a3r;
+                re[n + 3] = a1r - a3i;
+                im[n + 3] = a1i + a3r;
+            }
+        }
+        h = 4;
+    } else {
+        // two point FFT
+        for (uint8_t c = 0; c < count; c++) {
+            float *re = ffts[c]->_re;
+            float *im = ffts[c]->_im;
+            const float r = re[1], i = im[1];
+            re[1] = re[0] - r;
+            im[1] = im[0] - i;
+            re[0] += r;
+            im[0] += i;
+        }
+        h = 2;
+    }
+
+    // remaining stages have a multiple of four butterflies per group
+    for (; h < half; h <<= 1) {
+        const float *wr = &ffts[0]->_twiddle_re[h - 1];
+        const float *wi = &ffts[0]->_twiddle_im[h - 1];
+        for (uint16_t start = 0; start < half; start += 2 * h) {
+            for (uint16_t j = 0; j < h; j += 4) {
+#if REAL_FFT_NEON
+                const float32x4_t vwr = vld1q_f32(&wr[j]);
+                const float32x4_t vwi = vld1q_f32(&wi[j]);
+#elif REAL_FFT_SSE
+                const __m128 vwr = _mm_loadu_ps(&wr[j]);
+                const __m128 vwi = _mm_loadu_ps(&wi[j]);
+#endif
+                for (uint8_t c = 0; c < count; c++) {
+                    float *ar = &ffts[c]->_re[start + j];
+                    float *ai = &ffts[c]->_im[start + j];
+                    float *br = &ffts[c]->_re[start + h + j];
+                    float *bi = &ffts[c]->_im[start + h + j];
+#if REAL_FFT_NEON
+                    const float32x4_t vbr = vld1q_f32(br);
+                    const float32x4_t vbi = vld1q_f32(bi);
+                    const float32x4_t var = vld1q_f32(ar);
+                    const float32x4_t vai = vld1q_f32(ai);
+                    const float32x4_t tr = vmlsq_f32(vmulq_f32(vwr, vbr), vwi, vbi);
+                    const float32x4_t ti = vmlaq_f32(vmulq_f32(vwr, vbi), vwi, vbr);
+                    vst1q_f32(br, vsubq_f32(var, tr));
+                    vst1q_f32(bi, vsubq_f32(vai, ti));
+                    vst1q_f32(ar, vaddq_f32(var, tr));
+                    vst1q_f32(ai, vaddq_f32(vai, ti));
+#elif REAL_FFT_SSE
+                    const __m128 vbr = _mm_loadu_ps(br);
+                    const __m128 vbi = _mm_loadu_ps(bi);
+                    const __m128 var = _mm_loadu_ps(ar);
+                    const __m128 vai = _mm_loadu_ps(ai);
+                    const __m128 tr = _mm_sub_ps(_mm_mul_ps(vwr, vbr), _mm_mul_ps(vwi, vbi));
+                    const __m128 ti = _mm_add_ps(_mm_mul_ps(vwr, vbi), _mm_mul_ps(vwi, vbr));
+                    _mm_storeu_ps(br, _mm_sub_ps(var, tr));
+                    _mm_storeu_ps(bi, _mm_sub_ps(vai, ti));
+                    _mm_storeu_ps(ar, _mm_add_ps(var, tr));
+                    _mm_storeu_ps(ai, _mm_add_ps(vai, ti));
+#else
+                    for (uint8_t l = 0; l < 4; l++) {
+                        const float tr = wr[j + l] * br[l] - wi[j + l] * bi[l];
+                        const float ti = wr[j + l] * bi[l] + wi[j + l] * br[l];
+                        br[l] = ar[l] - tr;
+                        bi[l] = ai[l] - ti;
+                        ar[l] += tr;
+                        ai[l] += ti;
+                    }
+#endif
+                }
+            }
+        }
+    }
+}
+
+// combine the half length FFT into the real FFT bins
+void RealFFT::split(float *out) const
+{
+    // DC and nyquist are real only
+    out[0] = _re[0] + _im[0];
+    out[1] = 0.0f;
+    out[2 * _half] = _re[0] - _im[0];
+    out[2 * _half + 1] = 0.0f;
+
+    for (uint16_t k = 1; k <= _half / 2; k++) {
+        const uint16_t m = _half - k;
+        const float er = 0.5f * (_re[k] + _re[m]);
+        const float ei = 0.5f * (_im[k] - _im[m]);
+        const float or_ = 0.5f * (_im[k] + _im[m]);
+        const float oi = -0.5f * (_re[k] - _re[m]);
+        const float tr = _split_re[k] * or_ - _split_im[k] * oi;
+        const float ti = _split_re[k] * oi + _split_im[k] * or_;
+        out[2 * k] = er + tr;
+        out[2 * k + 1] = ei + ti;
+        out[2 * m] = er - tr;
+        out[2 * m + 1] = ti - ei;
+    }
+}
+
+// squared magnitude of count interleaved complex values
+void RealFFT::magnitude_squared(const float *in, float *out, uint16_t count)
+{
+    uint16_t i = 0;
+#if REAL_FFT_NEON
+    for (; i + 4 <= count; i += 4) {
+        const float32x4x2_t v = vld2q_f32(&in[2 * i]);
+        vst1q_f32(&out[i], vmlaq_f32(vmulq_f32(v.val[0], v.val[0]), v.val[1], v.val[1]));
+    }
+#elif REAL_FFT_SSE
+    for (; i + 4 <= count; i += 4) {
+        const __m128 a = _mm_loadu_ps(&in[2 * i]);
+        const __m128 b = _mm_loadu_ps(&in[2 * i + 4]);
+        const __m128 a2 = _mm_mul_ps(a, a);
+        const __m128 b2 = _mm_mul_ps(b, b);
+        // de-interleave the squared real and imaginary parts
+        const __m128 re2 = _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 im2 = _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(&out[i], _mm_add_ps(re2, im2));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = sq(in[2 * i], in[2 * i + 1]);
+    }
+}
+
+#endif // AP_MATH_REAL_FFT_ENABLED
@@ -0,0 +1,86 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <AP_HAL/AP_HAL_Boards.h>
+
+#ifndef AP_MATH_REAL_FFT_ENABLED
+#define AP_MATH_REAL_FFT_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX)
+#endif
+
+#if AP_MATH_REAL_FFT_ENABLED
+
+/*
+  FFT of real input, used by the SITL and Linux DSP backends in place
+  of CMSIS arm_rfft_fast_f32().
+
+  The N real samples are packed into N/2 complex samples (even samples
+  real, odd samples imaginary), transformed with a N/2 point complex
+  FFT and split into the N/2+1 bins of the real FFT. All twiddle
+  factors and the bit reversal table are calculated in init(), and the
+  butterflies use NEON or SSE where available
+ */
+class RealFFT {
+public:
+    RealFFT() {}
+    ~RealFFT();
+
+    /* Do not allow copies */
+    RealFFT(const RealFFT &other) = delete;
+    RealFFT &operator=(const RealFFT&) = delete;
+
+    // prepare for transforms of length real samples. length must be a
+    // power of 2 of at least 4. Returns false if out of memory
+    bool init(uint16_t length);
+
+    // number of real samples per transform, zero if not initialised
+    uint16_t length() const { return _length; }
+
+    // forward FFT of length real samples. out holds length/2+1
+    // interleaved real, imaginary pairs, with bins 0 and length/2 real
+    void transform(const float *in, float *out);
+
+    // forward FFT of count windows, such as the three gyro axes. The
+    // windows are interleaved through each butterfly stage so that
+    // every twiddle factor is loaded once for all of them. All of the
+    // ffts must have the same length
+    static void transform_batch(RealFFT* const ffts[], const float* const in[], float* const out[], uint8_t count);
+
+    // squared magnitude of count interleaved complex values
+    static void magnitude_squared(const float *in, float *out, uint16_t count);
+
+private:
+    // pack even and odd samples as complex values in bit reversed order
+    void pack(const float *in);
+    // N/2 point complex FFTs of _re and _im of count ffts, in bit reversed order
+    static void butterflies(RealFFT* const ffts[], uint8_t count);
+    // combine the half length FFT into the real FFT bins
+    void split(float *out) const;
+
+    uint16_t _length = 0;   // real samples per transform
+    uint16_t _half;         // complex points in the packed FFT
+
+    // the float arrays share one allocation, starting at _re
+    float *_re = nullptr;   // packed FFT real parts
+    float *_im;             // packed FFT imaginary parts
+    float *_twiddle_re;     // butterfly twiddles, _half-1 entries with each stage contiguous
+    float *_twiddle_im;
+    float *_split_re;       // split twiddles exp(-2*pi*i*k/N) for k <= N/4
+    float *_split_im;
+    uint16_t *_bitrev = nullptr; // bit reversed index of each packed sample
+};
+
+#endif // AP_MATH_REAL_FFT_ENABLED
@@ -60,6 +60,10 @@ void AP_Mission::init()
         clear();
     }
 
+#if AP_MISSION_CACHE_ENABLED
+    cache_reserve(_cmd_total);
+#endif
+
     _last_change_time_ms = AP_HAL::millis();
 }
 
@@ -211,6 +215,8 @@ void AP_Mission::reset()
 ///     returns true if mission was running so it could not be cleared
 bool AP_Mission::clear()
 {
+    WITH_SEMAPHORE(_rsem);
+
     // do not allow clearing the mission while it is running
     if (_flags.state == MISSION_RUNNING) {
         return false;
@@ -218,6 +224,9 @@ bool AP_Mission::clear()
 
     // remove all commands
     _cmd_total.set_and_save(0);
+#if AP_MISSION_CACHE_ENABLED
+    _summary_valid = false;
+#endif
 
     // clear index to commands
     _nav_cmd.index = AP_MISSION_CMD_INDEX_NONE;
@@ -233,11 +242,34 @@ bool AP_Mission::clear()
 /// trucate - truncate any mission items beyond index
 void AP_Mission::truncate(uint16_t index)
 {
+    WITH_SEMAPHORE(_rsem);
+
     if ((unsigned)_cmd_total > index) {
         _cmd_total.set_and_save(index);
+#if AP_MISSION_CACHE_ENABLED
+        _summary_valid = false;
+#endif
     }
 }
 
+/// set_num_commands - sets the number of commands once they have been written with write_cmd_to_storage
+bool AP_Mission::set_num_commands(uint16_t count)
+{
+    WITH_SEMAPHORE(_rsem);
+
+    if (count > num_commands_max()) {
+        return false;
+    }
+    if ((unsigned)_cmd_total != count) {
+        _cmd_total.set_and_save(count);
+#if AP_MISSION_CACHE_ENABLED
+        _summary_valid = false;
+#endif
+    }
+    _last_change_time_ms = AP_HAL::millis();
+    return true;
+}
+
 /// update - ensures the command queues are loaded with the next command and calls main programs command_init and command_verify functions to progress the mission
 ///     should be called at 10hz or higher
 void AP_Mission::update()
@@ -354,6 +386,8 @@ bool AP_Mission::start_command(const Mission_Command& cmd)
 ///     cmd.index is updated with it's new position in the mission
 bool AP_Mission::add_cmd(Mission_Command& cmd)
 {
+    WITH_SEMAPHORE(_rsem);
+
     // attempt to write the command to storage
     bool ret = write_cmd_to_storage(_cmd_total, cmd);
 
@@ -362,6 +396,9 @@ bool AP_Mission::add_cmd(Mission_Command& cmd)
         cmd.index = _cmd_total;
         // increment total number of commands
         _cmd_total.set_and_save(_cmd_total + 1);
+#if AP_MISSION_CACHE_ENABLED
+        _summary_valid = false;
+#endif
     }
 
     return ret;
@@ -661,6 +698,13 @@ bool AP_Mission::read_cmd_from_storage(uint16_t index, Mission_Command& cmd) con
         return false;
     }
 
+#if AP_MISSION_CACHE_ENABLED
+    if (index < _cache_size && _cache[index].index == index) {
+        cmd = _cache[index];
+        return true;
+    }
+#endif
+
     // ensure all bytes of cmd are zeroed
     cmd = {};
 
@@ -711,6 +755,12 @@ bool AP_Mission::read_cmd_from_storage(uint16_t index, Mission_Command& cmd) con
     // set command's index to it's position in eeprom
     cmd.index = index;
 
+#if AP_MISSION_CACHE_ENABLED
+    if (index < _cache_size) {
+        _cache[index] = cmd;
+    }
+#endif
+
     // return success
     return true;
 }
@@ -786,6 +836,17 @@ bool AP_Mission::write_cmd_to_storage(uint16_t index, const Mission_Command& cmd
         _storage.write_block(pos_in_storage+5, packed.bytes, 10);
     }
 
+#if AP_MISSION_CACHE_ENABLED
+    // the command is decoded from storage again on its next read
+    if (index >= _cache_size) {
+        cache_reserve(index + 1);
+    }
+    if (index < _cache_size) {
+        _cache[index].index = AP_MISSION_CMD_INDEX_NONE;
+    }
+    _summary_valid = false;
+#endif
+
     // remember when the mission last changed
     _last_change_time_ms = AP_HAL::millis();
 
@@ -1986,9 +2047,34 @@ uint16_t AP_Mission::get_landing_sequence_start() const
         return 0;
     }
 
+    return get_landing_sequence_start(current_loc);
+}
+
+// find the DO_LAND_START nearest to current_loc and return its index,
+// or 0 if there isn't one
+uint16_t AP_Mission::get_landing_sequence_start(const Location &current_loc) const
+{
     uint16_t landing_start_index = 0;
     float min_distance = -1;
 
+    WITH_SEMAPHORE(_rsem);
+
+#if AP_MISSION_CACHE_ENABLED
+    // only visit the landing start commands
+    if (update_summary()) {
+        for (uint16_t i = (num_commands() > 1) ? _summary[1].next_land_start : AP_MISSION_CMD_INDEX_NONE;
+             i < num_commands();
+             i = (i + 1 < num_commands()) ? _summary[i+1].next_land_start : AP_MISSION_CMD_INDEX_NONE) {
+            const float tmp_distance = _cache[i].content.location.get_distance(current_loc);
+            if (min_distance < 0 || tmp_distance < min_distance) {
+                min_distance = tmp_distance;
+                landing_start_index = i;
+            }
+        }
+        return landing_start_index;
+    }
+#endif
+
     // Go through mission looking for nearest landing start command
     for (uint16_t i = 1; i < num_commands(); i++) {
         Mission_Command tmp;
@@ -2136,6 +2222,18 @@ bool AP_Mission::is_best_land_sequence(void)
 
 // Approximate the distance travelled to get to a landing.  DO_JUMP commands are observed in look forward.
 bool AP_Mission::distance_to_landing(uint16_t index, float &tot_distance, Location prev_loc)
+{
+#if AP_MISSION_CACHE_ENABLED
+    if (distance_to_landing_from_summary(index, tot_distance, prev_loc)) {
+        return true;
+    }
+#endif
+    return distance_to_landing_walk(index, tot_distance, prev_loc);
+}
+
+// approximate the distance travelled to get to a landing by walking
+// through the mission, following DO_JUMP commands
+bool AP_Mission::distance_to_landing_walk(uint16_t index, float &tot_distance, Location prev_loc)
 {
     Mission_Command temp_cmd;
     tot_distance = 0.0f;
@@ -2157,7 +2255,7 @@ bool AP_Mission::distance_to_landing(uint16_t index, float &tot_distance, Locati
                 ret = false;
                 goto reset_do_jump_tracking;
             }
-            if (temp_cmd.id == MAV_CMD_NAV_WAYPOINT || temp_cmd.id == MAV_CMD_NAV_SPLINE_WAYPOINT || is_landing_type_cmd(temp_cmd.id)) {
+            if (is_landing_leg_cmd(temp_cmd.id)) {
                 break;
             } else if (is_nav_cmd(temp_cmd) || temp_cmd.id == MAV_CMD_CONDITION_DELAY) {
                 // if we receive a nav command that we dont handle then give up as cant measure the distance e.g. MAV_CMD_NAV_LOITER_UNLIM
@@ -2206,6 +2304,140 @@ bool AP_Mission::is_landing_type_cmd(uint16_t id) const
     }
 }
 
+// check if command is a waypoint or landing, which distance_to_landing measures between
+bool AP_Mission::is_landing_leg_cmd(uint16_t id) const
+{
+    return id == MAV_CMD_NAV_WAYPOINT || id == MAV_CMD_NAV_SPLINE_WAYPOINT || is_landing_type_cmd(id);
+}
+
+#if AP_MISSION_CACHE_ENABLED
+// grow the cache to hold count commands, returns false if it can't
+bool AP_Mission::cache_reserve(uint16_t count)
+{
+    WITH_SEMAPHORE(_rsem);
+
+    if (count <= _cache_size) {
+        return true;
+    }
+    const uint16_t size = MIN(((count + AP_MISSION_CACHE_CHUNK - 1) / AP_MISSION_CACHE_CHUNK) * AP_MISSION_CACHE_CHUNK,
+                              MAX(count, num_commands_max()));
+    Mission_Command *cache = new Mission_Command[size];
+    Command_Summary *summary = new Command_Summary[size];
+    if (cache == nullptr || summary == nullptr) {
+        delete[] cache;
+        delete[] summary;
+        return false;
+    }
+    for (uint16_t i = 0; i < size; i++) {
+        if (i < _cache_size) {
+            cache[i] = _cache[i];
+        } else {
+            cache[i].index = AP_MISSION_CMD_INDEX_NONE;
+        }
+    }
+    delete[] _cache;
+    delete[] _summary;
+    _cache = cache;
+    _summary = summary;
+    _cache_size = size;
+    _summary_valid = false;
+    return true;
+}
+
+// build the summary if the mission has changed, returns false if the
+// mission doesn't fit in the cache
+bool AP_Mission::update_summary() const
+{
+    WITH_SEMAPHORE(_rsem);
+
+    // MIS_TOTAL can be set directly, so check the summary is for the
+    // current number of commands
+    const uint16_t total = num_commands();
+    if (_summary_valid && _summary_total == total) {
+        return true;
+    }
+    if (total == 0 || total > _cache_size) {
+        return false;
+    }
+
+    // forward through the mission adding up the distance between the
+    // waypoints, as distance_to_landing does
+    Mission_Command cmd;
+    Location prev_loc;
+    bool have_prev_loc = false;
+    float distance = 0;
+    uint16_t legs = 0;
+    for (uint16_t i = 1; i < total; i++) {
+        if (!read_cmd_from_storage(i, cmd)) {
+            return false;
+        }
+        if (is_landing_leg_cmd(cmd.id)) {
+            legs++;
+            if (!(cmd.content.location.lat == 0 && cmd.content.location.lng == 0)) {
+                if (have_prev_loc) {
+                    distance += prev_loc.get_distance(cmd.content.location);
+                }
+                prev_loc = cmd.content.location;
+                have_prev_loc = true;
+            }
+        }
+        _summary[i].distance = distance;
+        _summary[i].legs = legs;
+    }
+
+    // back through the mission finding the commands a walk stops at
+    uint16_t next_stop = total;
+    uint16_t next_land_start = AP_MISSION_CMD_INDEX_NONE;
+    for (uint16_t i = total - 1; i > 0; i--) {
+        cmd = _cache[i];
+        if (cmd.id == MAV_CMD_DO_JUMP || is_landing_type_cmd(cmd.id) || cmd.id == MAV_CMD_CONDITION_DELAY ||
+            (is_nav_cmd(cmd) && !is_landing_leg_cmd(cmd.id))) {
+            next_stop = i;
+        }
+        if (cmd.id == MAV_CMD_DO_LAND_START) {
+            next_land_start = i;
+        }
+        _summary[i].next_stop = next_stop;
+        _summary[i].next_land_start = next_land_start;
+    }
+    _summary[0] = {};
+
+    _summary_total = total;
+    _summary_valid = true;
+    return true;
+}
+
+// distance to a landing from the summary, returns false if there is a
+// jump or a command the distance can't be measured past before it
+bool AP_Mission::distance_to_landing_from_summary(uint16_t index, float &tot_distance, const Location &prev_loc) const
+{
+    WITH_SEMAPHORE(_rsem);
+
+    if (index == 0 || index >= num_commands() || !update_summary()) {
+        return false;
+    }
+    const uint16_t stop = _summary[index].next_stop;
+    if (stop >= num_commands() || !is_landing_type_cmd(_cache[stop].id)) {
+        return false;
+    }
+    // distance_to_landing gives up after 255 legs
+    if (_summary[stop].legs - _summary[index-1].legs > 255) {
+        return false;
+    }
+
+    // from here to the first waypoint, then along the mission
+    tot_distance = 0.0f;
+    for (uint16_t i = index; i <= stop; i++) {
+        const Mission_Command &cmd = _cache[i];
+        if (is_landing_leg_cmd(cmd.id) && !(cmd.content.location.lat == 0 && cmd.content.location.lng == 0)) {
+            tot_distance = prev_loc.get_distance(cmd.content.location) + (_summary[stop].distance - _summary[i].distance);
+            break;
+        }
+    }
+    return true;
+}
+#endif // AP_MISSION_CACHE_ENABLED
+
 const char *AP_Mission::Mission_Command::type() const
 {
     switch (id) {
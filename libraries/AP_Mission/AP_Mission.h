@@ -44,6 +44,13 @@
 #define AP_MISSION_MAX_WP_HISTORY           7       // The maximum number of previous wp commands that will be stored from the active missions history
 #define LAST_WP_PASSED (AP_MISSION_MAX_WP_HISTORY-2)
 
+// keep decoded commands in RAM on boards with memory to spare, so walks
+// through the mission don't decode each command from storage again
+#ifndef AP_MISSION_CACHE_ENABLED
+#define AP_MISSION_CACHE_ENABLED (HAL_MEM_CLASS >= HAL_MEM_CLASS_500)
+#endif
+#define AP_MISSION_CACHE_CHUNK              64      // number of commands the cache grows by
+
 /// @class    AP_Mission
 /// @brief    Object managing Mission
 class AP_Mission
@@ -404,6 +411,11 @@ public:
     /// truncate - truncate any mission items beyond given index
     void truncate(uint16_t index);
 
+    /// set_num_commands - sets the number of commands once they have been written with write_cmd_to_storage,
+    ///     so a whole mission is loaded with a single parameter save
+    ///     returns false if storage can't hold that many commands
+    bool set_num_commands(uint16_t count);
+
     /// update - ensures the command queues are loaded with the next command and calls main programs command_init and command_verify functions to progress the mission
     ///     should be called at 10hz or higher
     void update();
@@ -538,6 +550,7 @@ public:
     // return its index.  Returns 0 if no appropriate DO_LAND_START point can
     // be found.
     uint16_t get_landing_sequence_start() const;
+    uint16_t get_landing_sequence_start(const Location &current_loc) const;
 
     // find the nearest landing sequence starting point (DO_LAND_START) and
     // switch to that mission item.  Returns false if no DO_LAND_START
@@ -596,6 +609,23 @@ public:
     bool get_item(uint16_t index, mavlink_mission_item_int_t& result) const ;
     bool set_item(uint16_t index, mavlink_mission_item_int_t& source) ;
 
+protected:
+    // init_jump_tracking - initialise jump_tracking variables
+    void init_jump_tracking();
+
+    // approximate the distance travelled to get to a landing.  DO_JUMP commands are observed in look forward.
+    bool distance_to_landing(uint16_t index, float &tot_distance,Location current_loc);
+    bool distance_to_landing_walk(uint16_t index, float &tot_distance, Location prev_loc);
+
+#if AP_MISSION_CACHE_ENABLED
+    // distance to a landing from the summary, returns false if there is
+    // a jump or a command the distance can't be measured past before it
+    bool distance_to_landing_from_summary(uint16_t index, float &tot_distance, const Location &prev_loc) const;
+#endif
+
+    // parameters
+    AP_Int16                _cmd_total;  // total number of commands in the mission
+
 private:
     static AP_Mission *_singleton;
 
@@ -652,8 +682,6 @@ private:
     ///
     /// jump handling methods
     ///
-    // init_jump_tracking - initialise jump_tracking variables
-    void init_jump_tracking();
 
     /// get_jump_times_run - returns number of times the jump command has been run
     ///     return is signed to be consistent with do-jump cmd's repeat count which can be -1 (to signify to repeat forever)
@@ -669,8 +697,8 @@ private:
     // check if command is a landing type command.  Asside the obvious, MAV_CMD_DO_PARACHUTE is considered a type of landing
     bool is_landing_type_cmd(uint16_t id) const;
 
-    // approximate the distance travelled to get to a landing.  DO_JUMP commands are observed in look forward.
-    bool distance_to_landing(uint16_t index, float &tot_distance,Location current_loc);
+    // check if command is a waypoint or landing, which distance_to_landing measures between
+    bool is_landing_leg_cmd(uint16_t id) const;
 
     // calculate the location of a resume cmd wp
     bool calc_rewind_pos(Mission_Command& rewind_cmd);
@@ -682,7 +710,6 @@ private:
     static MAV_MISSION_RESULT sanity_check_params(const mavlink_mission_item_int_t& packet);
 
     // parameters
-    AP_Int16                _cmd_total;  // total number of commands in the mission
     AP_Int8                 _restart;   // controls mission starting point when entering Auto mode (either restart from beginning of mission or resume from last command run)
     AP_Int16                _options;    // bitmask options for missions, currently for mission clearing on reboot but can be expanded as required
 
@@ -717,6 +744,35 @@ private:
     // const functions
     static HAL_Semaphore _rsem;
 
+#if AP_MISSION_CACHE_ENABLED
+    // decoded commands, an entry is valid when its index matches its
+    // position. Commands are decoded on their first read and invalidated
+    // when written
+    Mission_Command *_cache;
+
+    // the mission up to each command, for walking it without reading
+    // each command in turn
+    struct Command_Summary {
+        float distance;             // distance along the mission to the last waypoint at or before this command, not following jumps
+        uint16_t legs;              // number of waypoints at or before this command
+        uint16_t next_stop;         // first jump, landing or command the distance can't be measured past, at or after this command
+        uint16_t next_land_start;   // first DO_LAND_START at or after this command
+    };
+    Command_Summary *_summary;
+    mutable bool _summary_valid;
+    mutable uint16_t _summary_total;    // number of commands the summary was built for
+
+    // number of commands _cache and _summary can hold
+    uint16_t _cache_size;
+
+    // grow the cache to hold count commands, returns false if it can't
+    bool cache_reserve(uint16_t count);
+
+    // build the summary if the mission has changed, returns false if
+    // the mission doesn't fit in the cache
+    bool update_summary() const;
+#endif
+
     // mission items common to all vehicles:
     bool start_command_do_aux_function(const AP_Mission::Mission_Command& cmd);
     bool start_command_do_gripper(const AP_Mission::Mission_Command& cmd);
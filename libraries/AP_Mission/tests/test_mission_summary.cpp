@@ -0,0 +1,353 @@
+#include <AP_gtest.h>
+
+#include <AP_Mission/AP_Mission.h>
+#include <GCS_MAVLink/GCS_Dummy.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#if AP_MISSION_CACHE_ENABLED
+
+static bool start_cmd(const AP_Mission::Mission_Command &) { return true; }
+static bool verify_cmd(const AP_Mission::Mission_Command &) { return true; }
+static void mission_complete() {}
+
+// home and the start of every walk
+static const int32_t home_lat = -353632620;
+static const int32_t home_lng = 1491652370;
+
+// reaches the parts of AP_Mission the summary is used by
+class AP_Mission_Test : public AP_Mission
+{
+public:
+    AP_Mission_Test() :
+        AP_Mission(FUNCTOR_BIND(&start_cmd, bool, const AP_Mission::Mission_Command &),
+                   FUNCTOR_BIND(&verify_cmd, bool, const AP_Mission::Mission_Command &),
+                   FUNCTOR_BIND(&mission_complete, void))
+    {}
+
+    // replace the mission with home followed by cmds
+    void load(const Mission_Command *cmds, uint16_t count)
+    {
+        Mission_Command home {};
+        home.id = MAV_CMD_NAV_WAYPOINT;
+        home.content.location = Location(home_lat, home_lng, 0, Location::AltFrame::ABSOLUTE);
+        ASSERT_TRUE(write_cmd_to_storage(0, home));
+        for (uint16_t i = 0; i < count; i++) {
+            ASSERT_TRUE(write_cmd_to_storage(i+1, cmds[i]));
+        }
+        ASSERT_TRUE(set_num_commands(count + 1));
+        init_jump_tracking();
+    }
+
+    // set MIS_TOTAL directly, as a parameter set does
+    void set_total(uint16_t total)
+    {
+        _cmd_total.set(total);
+    }
+
+    // check distance_to_landing() agrees with the original walk for
+    // every starting command
+    void check_all(const Location &loc)
+    {
+        for (uint16_t index = 1; index < num_commands(); index++) {
+            float walk_distance = -1;
+            const bool walk_ok = distance_to_landing_walk(index, walk_distance, loc);
+            float distance = -1;
+            const bool ok = distance_to_landing(index, distance, loc);
+            EXPECT_EQ(walk_ok, ok) << "index " << index;
+            if (walk_ok && ok) {
+                EXPECT_NEAR(walk_distance, distance, 0.01f + 1e-5f * walk_distance) << "index " << index;
+            }
+        }
+    }
+
+    // true if the summary can answer for index
+    bool from_summary(uint16_t index, const Location &loc)
+    {
+        float distance;
+        return distance_to_landing_from_summary(index, distance, loc);
+    }
+
+    // the nearest DO_LAND_START found by reading every command
+    uint16_t landing_sequence_start_scan(const Location &loc) const
+    {
+        uint16_t index = 0;
+        float min_distance = -1;
+        for (uint16_t i = 1; i < num_commands(); i++) {
+            Mission_Command cmd;
+            if (!read_cmd_from_storage(i, cmd) || cmd.id != MAV_CMD_DO_LAND_START) {
+                continue;
+            }
+            const float distance = cmd.content.location.get_distance(loc);
+            if (min_distance < 0 || distance < min_distance) {
+                min_distance = distance;
+                index = i;
+            }
+        }
+        return index;
+    }
+};
+
+static AP_Mission_Test mission;
+
+static AP_Mission::Mission_Command waypoint(int32_t north_m, int32_t east_m)
+{
+    AP_Mission::Mission_Command cmd {};
+    cmd.id = MAV_CMD_NAV_WAYPOINT;
+    cmd.content.location = Location(home_lat, home_lng, 5000, Location::AltFrame::ABOVE_HOME);
+    cmd.content.location.offset(north_m, east_m);
+    return cmd;
+}
+
+static AP_Mission::Mission_Command land(int32_t north_m, int32_t east_m)
+{
+    AP_Mission::Mission_Command cmd = waypoint(north_m, east_m);
+    cmd.id = MAV_CMD_NAV_LAND;
+    return cmd;
+}
+
+// a landing at 0,0 lands where the vehicle is
+static AP_Mission::Mission_Command land_here()
+{
+    AP_Mission::Mission_Command cmd {};
+    cmd.id = MAV_CMD_NAV_LAND;
+    return cmd;
+}
+
+static AP_Mission::Mission_Command do_cmd(uint16_t id)
+{
+    AP_Mission::Mission_Command cmd {};
+    cmd.id = id;
+    return cmd;
+}
+
+static AP_Mission::Mission_Command jump(uint16_t target, int16_t num_times)
+{
+    AP_Mission::Mission_Command cmd {};
+    cmd.id = MAV_CMD_DO_JUMP;
+    cmd.content.jump.target = target;
+    cmd.content.jump.num_times = num_times;
+    return cmd;
+}
+
+static AP_Mission::Mission_Command delay(float seconds)
+{
+    AP_Mission::Mission_Command cmd {};
+    cmd.id = MAV_CMD_CONDITION_DELAY;
+    cmd.content.delay.seconds = seconds;
+    return cmd;
+}
+
+static AP_Mission::Mission_Command loiter_unlim(int32_t north_m, int32_t east_m)
+{
+    AP_Mission::Mission_Command cmd = waypoint(north_m, east_m);
+    cmd.id = MAV_CMD_NAV_LOITER_UNLIM;
+    return cmd;
+}
+
+static AP_Mission::Mission_Command land_start(int32_t north_m, int32_t east_m)
+{
+    AP_Mission::Mission_Command cmd = waypoint(north_m, east_m);
+    cmd.id = MAV_CMD_DO_LAND_START;
+    return cmd;
+}
+
+static Location start_loc()
+{
+    Location loc(home_lat, home_lng, 5000, Location::AltFrame::ABOVE_HOME);
+    loc.offset(-30, 40);
+    return loc;
+}
+
+TEST(AP_Mission, summary_straight)
+{
+    const AP_Mission::Mission_Command cmds[] {
+        waypoint(100, 0),
+        do_cmd(MAV_CMD_DO_CHANGE_SPEED),
+        waypoint(100, 200),
+        waypoint(-50, 300),
+        do_cmd(MAV_CMD_DO_LAND_START),
+        waypoint(0, 100),
+        land(0, 0),
+    };
+    mission.load(cmds, ARRAY_SIZE(cmds));
+    mission.check_all(start_loc());
+    // the summary answers without a walk
+    for (uint16_t i = 1; i < mission.num_commands(); i++) {
+        EXPECT_TRUE(mission.from_summary(i, start_loc())) << "index " << i;
+    }
+}
+
+TEST(AP_Mission, summary_jumps)
+{
+    const AP_Mission::Mission_Command cmds[] {
+        waypoint(100, 0),
+        waypoint(100, 200),
+        jump(1, 2),
+        waypoint(-50, 300),
+        jump(4, -1),
+        waypoint(0, 100),
+        land(0, 0),
+    };
+    mission.load(cmds, ARRAY_SIZE(cmds));
+    mission.check_all(start_loc());
+    // a walk from before a jump has to follow it
+    EXPECT_FALSE(mission.from_summary(1, start_loc()));
+    EXPECT_TRUE(mission.from_summary(6, start_loc()));
+}
+
+TEST(AP_Mission, summary_condition_delay)
+{
+    const AP_Mission::Mission_Command cmds[] {
+        waypoint(100, 0),
+        delay(5),
+        waypoint(100, 200),
+        land(0, 0),
+    };
+    mission.load(cmds, ARRAY_SIZE(cmds));
+    mission.check_all(start_loc());
+}
+
+TEST(AP_Mission, summary_loiter_unlim)
+{
+    const AP_Mission::Mission_Command cmds[] {
+        waypoint(100, 0),
+        loiter_unlim(100, 200),
+        waypoint(-50, 300),
+        land(0, 0),
+        waypoint(500, 500),
+    };
+    mission.load(cmds, ARRAY_SIZE(cmds));
+    mission.check_all(start_loc());
+}
+
+TEST(AP_Mission, summary_land_at_zero)
+{
+    AP_Mission::Mission_Command zero_wp = waypoint(0, 0);
+    zero_wp.content.location.lat = 0;
+    zero_wp.content.location.lng = 0;
+    const AP_Mission::Mission_Command cmds[] {
+        waypoint(100, 0),
+        zero_wp,
+        waypoint(100, 200),
+        land_here(),
+        do_cmd(MAV_CMD_DO_LAND_START),
+        land_here(),
+        waypoint(-50, 300),
+        zero_wp,
+        land_here(),
+    };
+    mission.load(cmds, ARRAY_SIZE(cmds));
+    mission.check_all(start_loc());
+}
+
+TEST(AP_Mission, summary_no_landing)
+{
+    const AP_Mission::Mission_Command cmds[] {
+        waypoint(100, 0),
+        waypoint(100, 200),
+        do_cmd(MAV_CMD_DO_CHANGE_SPEED),
+    };
+    mission.load(cmds, ARRAY_SIZE(cmds));
+    mission.check_all(start_loc());
+}
+
+TEST(AP_Mission, summary_landing_sequence_start)
+{
+    const AP_Mission::Mission_Command cmds[] {
+        waypoint(100, 0),
+        land_start(500, 0),
+        land(600, 0),
+        waypoint(100, 200),
+        land_start(-20, 30),
+        land(0, 0),
+        land_start(-400, -400),
+        land(-500, -500),
+    };
+    mission.load(cmds, ARRAY_SIZE(cmds));
+    const Location locs[] { start_loc(), cmds[1].content.location, cmds[7].content.location };
+    for (const Location &loc : locs) {
+        EXPECT_EQ(mission.landing_sequence_start_scan(loc), mission.get_landing_sequence_start(loc));
+    }
+    EXPECT_EQ(5, mission.get_landing_sequence_start(start_loc()));
+    EXPECT_EQ(2, mission.get_landing_sequence_start(cmds[1].content.location));
+    EXPECT_EQ(7, mission.get_landing_sequence_start(cmds[7].content.location));
+
+    // no DO_LAND_START
+    const AP_Mission::Mission_Command no_land_start[] {
+        waypoint(100, 0),
+        land(0, 0),
+    };
+    mission.load(no_land_start, ARRAY_SIZE(no_land_start));
+    EXPECT_EQ(0, mission.get_landing_sequence_start(start_loc()));
+}
+
+TEST(AP_Mission, cache_rewrite)
+{
+    const AP_Mission::Mission_Command cmds[] {
+        waypoint(100, 0),
+        waypoint(100, 200),
+        land(0, 0),
+    };
+    mission.load(cmds, ARRAY_SIZE(cmds));
+
+    // decode the command into the cache, then write over it
+    AP_Mission::Mission_Command cmd;
+    ASSERT_TRUE(mission.read_cmd_from_storage(2, cmd));
+    EXPECT_EQ(MAV_CMD_NAV_WAYPOINT, cmd.id);
+    EXPECT_EQ(cmds[1].content.location.lat, cmd.content.location.lat);
+
+    const AP_Mission::Mission_Command rewrite = land_start(-300, 50);
+    ASSERT_TRUE(mission.write_cmd_to_storage(2, rewrite));
+    ASSERT_TRUE(mission.read_cmd_from_storage(2, cmd));
+    EXPECT_EQ(MAV_CMD_DO_LAND_START, cmd.id);
+    EXPECT_EQ(rewrite.content.location.lat, cmd.content.location.lat);
+    EXPECT_EQ(rewrite.content.location.lng, cmd.content.location.lng);
+
+    // the summary sees the rewritten command
+    EXPECT_EQ(2, mission.get_landing_sequence_start(start_loc()));
+    mission.check_all(start_loc());
+}
+
+TEST(AP_Mission, summary_shrink_grow)
+{
+    const AP_Mission::Mission_Command cmds[] {
+        waypoint(100, 0),
+        land_start(300, 0),
+        land(400, 0),
+        waypoint(100, 200),
+        land_start(-20, 30),
+        land(0, 0),
+    };
+    mission.load(cmds, ARRAY_SIZE(cmds));
+    const uint16_t total = mission.num_commands();
+    EXPECT_EQ(5, mission.get_landing_sequence_start(start_loc()));
+
+    // shrink past the nearest DO_LAND_START
+    mission.set_total(4);
+    EXPECT_EQ(mission.landing_sequence_start_scan(start_loc()), mission.get_landing_sequence_start(start_loc()));
+    EXPECT_EQ(2, mission.get_landing_sequence_start(start_loc()));
+    mission.check_all(start_loc());
+
+    // grow back over the commands still in storage
+    mission.set_total(total);
+    EXPECT_EQ(mission.landing_sequence_start_scan(start_loc()), mission.get_landing_sequence_start(start_loc()));
+    EXPECT_EQ(5, mission.get_landing_sequence_start(start_loc()));
+    mission.check_all(start_loc());
+
+    // and through set_num_commands()
+    ASSERT_TRUE(mission.set_num_commands(4));
+    EXPECT_EQ(2, mission.get_landing_sequence_start(start_loc()));
+    ASSERT_TRUE(mission.set_num_commands(total));
+    EXPECT_EQ(5, mission.get_landing_sequence_start(start_loc()));
+    mission.check_all(start_loc());
+}
+
+#endif // AP_MISSION_CACHE_ENABLED
+
+const AP_Param::GroupInfo GCS_MAVLINK_Parameters::var_info[] = {
+    AP_GROUPEND
+};
+GCS_Dummy _gcs;
+
+AP_GTEST_MAIN()
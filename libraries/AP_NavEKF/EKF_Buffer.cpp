@@ -10,7 +10,8 @@
 
 // constructor
 ekf_ring_buffer::ekf_ring_buffer(uint8_t _elsize) :
-    elsize(_elsize)
+    elsize(_elsize),
+    buffer(nullptr)
 {}
 
 bool ekf_ring_buffer::init(uint8_t size)
@@ -25,6 +26,7 @@ bool ekf_ring_buffer::init(uint8_t size)
     _size = size;
     _head = 0;
     _tail = 0;
+    _search_start = 0;
     _new_data = false;
     return true;
 }
@@ -47,56 +49,97 @@ uint32_t &ekf_ring_buffer::time_ms(uint8_t idx)
 }
 
 /*
-  Search through a ring buffer and return the newest data that is
-  older than the time specified by sample_time_ms Zeros old data
-  so it cannot not be used again Returns false if no data can be
-  found that is less than 100msec old
+  return true if the data at idx can't be returned for this or any
+  later sample time, as it has been used or is more than 100msec old
+ */
+bool ekf_ring_buffer::is_expired(uint8_t idx, uint32_t sample_time)
+{
+    const uint32_t t = time_ms(idx);
+    return t == 0 || (t <= sample_time && (sample_time - t) >= 100);
+}
+
+/*
+  find the newest data that is older than the time specified by
+  sample_time and less than 100msec old.
+
+  The data from the tail to the head is in time order and the fusion
+  time horizon doesn't go backwards, so the search starts after any
+  expired data found by the last search instead of at the tail. The
+  tail itself is unchanged, so that the result is the same as a full
+  search, including when pushes wrap around onto the tail
 */
-bool ekf_ring_buffer::recall(void *element,uint32_t sample_time)
+bool ekf_ring_buffer::find(uint32_t sample_time, uint8_t &bestIndex)
 {
     if (!_new_data) {
         return false;
     }
+
+    if (_head == _tail) {
+        // if head is equal to tail just check if the data is unused and within time horizon window
+        if (time_ms(_tail) <= sample_time && !is_expired(_tail, sample_time)) {
+            bestIndex = _tail;
+            return true;
+        }
+        return false;
+    }
+
+    // skip expired data, which is never returned, keeping the search behind the head
+    for (uint8_t next = next_index(_search_start); next != _head && is_expired(_search_start, sample_time); next = next_index(next)) {
+        _search_start = next;
+    }
+
     bool success = false;
-    uint8_t tail = _tail, bestIndex;
-
-    if (_head == tail) {
-        if (time_ms(tail) != 0 && time_ms(tail) <= sample_time) {
-            // if head is equal to tail just check if the data is unused and within time horizon window
-            if (((sample_time - time_ms(tail)) < 100)) {
-                bestIndex = tail;
-                success = true;
-                _new_data = false;
-            }
+    for (uint8_t idx = _search_start; idx != _head; idx = next_index(idx)) {
+        if (time_ms(idx) > sample_time) {
+            break;
         }
-    } else {
-        while(_head != tail) {
-            // find a measurement older than the fusion time horizon that we haven't checked before
-            if (time_ms(tail) != 0 && time_ms(tail) <= sample_time) {
-                // Find the most recent non-stale measurement that meets the time horizon criteria
-                if (((sample_time - time_ms(tail)) < 100)) {
-                    bestIndex = tail;
-                    success = true;
-                }
-            } else if (time_ms(tail) > sample_time){
-                break;
-            }
-            tail = (tail+1) % _size;
+        // Find the most recent non-stale measurement that meets the time horizon criteria
+        if (!is_expired(idx, sample_time)) {
+            bestIndex = idx;
+            success = true;
         }
     }
+    return success;
+}
 
-    if (!success) {
+/*
+  Search through a ring buffer and return the newest data that is
+  older than the time specified by sample_time_ms Zeros old data
+  so it cannot not be used again Returns false if no data can be
+  found that is less than 100msec old
+*/
+bool ekf_ring_buffer::recall(void *element,uint32_t sample_time)
+{
+    uint8_t bestIndex;
+    if (!find(sample_time, bestIndex)) {
         return false;
     }
 
     memcpy(element, get_offset(bestIndex), elsize);
-    _tail = (bestIndex+1) % _size;
+    if (bestIndex == _head) {
+        _new_data = false;
+    }
+    _tail = next_index(bestIndex);
+    _search_start = _tail;
     // make time zero to stop using it again,
     // resolves corner case of reusing the element when head == tail
     time_ms(bestIndex) = 0;
     return true;
 }
 
+/*
+  return the data that recall() would return without using it, or
+  nullptr if there is none
+*/
+const void *ekf_ring_buffer::peek(uint32_t sample_time)
+{
+    uint8_t bestIndex;
+    if (!find(sample_time, bestIndex)) {
+        return nullptr;
+    }
+    return get_offset(bestIndex);
+}
+
 /*
  * Writes data and timestamp to a Ring buffer and advances indices that
  * define the location of the newest and oldest data
@@ -107,10 +150,14 @@ void ekf_ring_buffer::push(const void *element)
         return;
     }
     // Advance head to next available index
-    _head = (_head+1) % _size;
+    _head = next_index(_head);
     // New data is written at the head
     memcpy(get_offset(_head), element, elsize);
     _new_data = true;
+    if (_head == _tail) {
+        // the buffer has wrapped around, so only the new data is searched
+        _search_start = _tail;
+    }
 }
 
 
@@ -119,6 +166,7 @@ void ekf_ring_buffer::reset()
 {
     _head = 0;
     _tail = 0;
+    _search_start = 0;
     _new_data = false;
     memset((void *)buffer,0,_size*uint32_t(elsize));
 }
@@ -30,6 +30,12 @@ public:
     */
     bool recall(void *element, uint32_t sample_time);
 
+    /*
+     * Returns the data that recall() would return, without using it, or nullptr if
+     * there is none. The data is valid until the next call to push() or reset()
+    */
+    const void *peek(uint32_t sample_time);
+
     /*
      * Writes data and timestamp to a Ring buffer and advances indices that
      * define the location of the newest and oldest data
@@ -43,9 +49,17 @@ private:
     const uint8_t elsize;
     void *buffer;
     uint8_t _size, _head, _tail, _new_data;
+    // start of the search for recall(), after any expired data at the tail
+    uint8_t _search_start;
 
     uint32_t &time_ms(uint8_t idx);
     void *get_offset(uint8_t idx) const;
+    bool is_expired(uint8_t idx, uint32_t sample_time);
+    bool find(uint32_t sample_time, uint8_t &bestIndex);
+
+    uint8_t next_index(uint8_t idx) const {
+        return (idx+1 == _size) ? 0 : idx+1;
+    }
 };
 
 /*
@@ -71,6 +85,10 @@ public:
         return ekf_ring_buffer::recall(&element, sample_time);
     }
 
+    const element_type *peek(uint32_t sample_time) {
+        return (const element_type *)ekf_ring_buffer::peek(sample_time);
+    }
+
     void push(element_type element) {
         return ekf_ring_buffer::push(&element);
     }
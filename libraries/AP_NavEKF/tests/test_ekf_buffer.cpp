@@ -0,0 +1,258 @@
+#include <AP_gtest.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AP_NavEKF/EKF_Buffer.h>
+#include <string.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+struct test_elements : EKF_obs_element_t {
+    uint32_t seq;
+    uint32_t source_ms;
+};
+
+/*
+  the ekf_ring_buffer recall() from before it kept track of expired
+  data, searching from the tail on every call
+ */
+class reference_ring_buffer
+{
+public:
+    reference_ring_buffer(uint8_t size) :
+        _size(size)
+    {
+        buffer = new test_elements[size] {};
+    }
+    ~reference_ring_buffer() {
+        delete[] buffer;
+    }
+
+    bool recall(test_elements &element, uint32_t sample_time)
+    {
+        if (!_new_data) {
+            return false;
+        }
+        bool success = false;
+        uint8_t tail = _tail, bestIndex = 0;
+
+        if (_head == tail) {
+            if (buffer[tail].time_ms != 0 && buffer[tail].time_ms <= sample_time) {
+                if (((sample_time - buffer[tail].time_ms) < 100)) {
+                    bestIndex = tail;
+                    success = true;
+                    _new_data = false;
+                }
+            }
+        } else {
+            while (_head != tail) {
+                if (buffer[tail].time_ms != 0 && buffer[tail].time_ms <= sample_time) {
+                    if (((sample_time - buffer[tail].time_ms) < 100)) {
+                        bestIndex = tail;
+                        success = true;
+                    }
+                } else if (buffer[tail].time_ms > sample_time) {
+                    break;
+                }
+                tail = (tail+1) % _size;
+            }
+        }
+
+        if (!success) {
+            return false;
+        }
+
+        element = buffer[bestIndex];
+        _tail = (bestIndex+1) % _size;
+        buffer[bestIndex].time_ms = 0;
+        return true;
+    }
+
+    void push(const test_elements &element)
+    {
+        _head = (_head+1) % _size;
+        buffer[_head] = element;
+        _new_data = true;
+    }
+
+    void reset()
+    {
+        _head = 0;
+        _tail = 0;
+        _new_data = false;
+        memset((void *)buffer, 0, _size*sizeof(test_elements));
+    }
+
+private:
+    test_elements *buffer;
+    uint8_t _size, _head = 0, _tail = 0;
+    bool _new_data = false;
+};
+
+static uint32_t test_seed = 1;
+
+static uint32_t test_random(uint32_t max)
+{
+    test_seed = test_seed * 1664525U + 1013904223U;
+    return (test_seed >> 8) % (max + 1);
+}
+
+/*
+  a sensor as the EKF sees it: samples arrive at an interval with
+  jitter and a delay, and are stamped no older than the fusion time
+  horizon. The EKF recalls data for every prediction, except when
+  fusion of the sensor is paused
+ */
+struct test_sensor {
+    const char *name;
+    uint16_t interval_ms;
+    uint16_t jitter_ms;
+    uint16_t delay_ms;
+    uint8_t buffer_length;
+    // probability in percent of dropping a sample, and of pausing
+    // recall for up to pause_max_ms
+    uint8_t dropout_pct;
+    uint8_t pause_pct;
+    uint16_t pause_max_ms;
+};
+
+struct test_counts {
+    uint32_t pushes;
+    uint32_t recalls;
+    uint32_t peeks;
+};
+
+/*
+  replay a sensor timeline through EKF_obs_buffer_t and the reference
+  buffer and check that every recall returns the same data
+ */
+static test_counts replay_timeline(const test_sensor &sensor, uint32_t duration_ms)
+{
+    EKF_obs_buffer_t<test_elements> buffer;
+    reference_ring_buffer reference{sensor.buffer_length};
+    EXPECT_TRUE(buffer.init(sensor.buffer_length));
+
+    // EKF prediction interval and worst case delay to the fusion time horizon
+    const uint32_t ekf_dt_ms = 12;
+    const uint32_t ekf_delay_ms = 220;
+
+    test_counts counts {};
+    uint32_t seq = 0;
+    uint32_t horizon_ms = 0;
+    uint32_t next_sample_ms = 1000;
+    uint32_t paused_until_ms = 0;
+
+    for (uint32_t now_ms = 1000; now_ms < duration_ms; now_ms += ekf_dt_ms) {
+        // the time horizon follows the IMU buffer with jitter, and
+        // occasionally jumps forward as if samples were lost
+        uint32_t new_horizon_ms = now_ms - ekf_delay_ms + test_random(4);
+        if (test_random(500) == 0) {
+            new_horizon_ms += 100 + test_random(200);
+        }
+        horizon_ms = MAX(horizon_ms, new_horizon_ms);
+
+        while (next_sample_ms <= now_ms) {
+            if (test_random(99) >= sensor.dropout_pct) {
+                test_elements sample {};
+                sample.time_ms = MAX(next_sample_ms - sensor.delay_ms, horizon_ms);
+                sample.seq = ++seq;
+                sample.source_ms = next_sample_ms;
+                buffer.push(sample);
+                reference.push(sample);
+                counts.pushes++;
+            }
+            next_sample_ms += sensor.interval_ms + test_random(sensor.jitter_ms);
+        }
+
+        if (test_random(2999) == 0) {
+            // as the EKF does on a core reset
+            buffer.reset();
+            reference.reset();
+        }
+
+        if (now_ms < paused_until_ms) {
+            continue;
+        }
+        if (test_random(99) < sensor.pause_pct) {
+            paused_until_ms = now_ms + test_random(sensor.pause_max_ms);
+        }
+
+        // peek doesn't change what is recalled
+        const test_elements *peeked = nullptr;
+        if (test_random(1) == 0) {
+            peeked = buffer.peek(horizon_ms);
+            counts.peeks++;
+        }
+
+        test_elements expected {}, actual {};
+        const bool expected_ok = reference.recall(expected, horizon_ms);
+        if (peeked != nullptr) {
+            EXPECT_TRUE(expected_ok) << sensor.name << " peek at " << now_ms;
+            EXPECT_EQ(expected.seq, peeked->seq) << sensor.name << " peek at " << now_ms;
+            EXPECT_EQ(expected.source_ms, peeked->source_ms) << sensor.name << " peek at " << now_ms;
+        }
+        const bool actual_ok = buffer.recall(actual, horizon_ms);
+        EXPECT_EQ(expected_ok, actual_ok) << sensor.name << " recall at " << now_ms;
+        if (expected_ok && actual_ok) {
+            EXPECT_EQ(expected.time_ms, actual.time_ms) << sensor.name << " recall at " << now_ms;
+            EXPECT_EQ(expected.seq, actual.seq) << sensor.name << " recall at " << now_ms;
+            EXPECT_EQ(expected.source_ms, actual.source_ms) << sensor.name << " recall at " << now_ms;
+            counts.recalls++;
+        }
+    }
+    return counts;
+}
+
+TEST(EKFBufferTest, RecallMatchesReference)
+{
+    const test_sensor sensors[] {
+        // name, interval, jitter, delay, buffer length, dropout, pause, pause max
+        { "gps", 200, 20, 220, 7, 2, 1, 400 },
+        { "baro", 50, 5, 10, 7, 1, 0, 0 },
+        { "mag", 50, 3, 10, 7, 0, 2, 1000 },
+        { "range", 50, 10, 5, 7, 20, 1, 300 },
+        { "flow", 20, 2, 10, 17, 5, 1, 200 },
+        { "airspeed", 100, 10, 240, 7, 1, 1, 2000 },
+    };
+
+    for (const auto &sensor : sensors) {
+        test_seed = 1;
+        const test_counts counts = replay_timeline(sensor, 600000);
+        // the timeline must exercise the buffer
+        EXPECT_GT(counts.recalls, counts.pushes / 4) << sensor.name;
+        EXPECT_GT(counts.peeks, 0U) << sensor.name;
+    }
+}
+
+TEST(EKFBufferTest, PeekDoesNotRemove)
+{
+    EKF_obs_buffer_t<test_elements> buffer;
+    ASSERT_TRUE(buffer.init(4));
+
+    test_elements sample {};
+    sample.time_ms = 1000;
+    sample.seq = 1;
+    buffer.push(sample);
+    sample.time_ms = 1050;
+    sample.seq = 2;
+    buffer.push(sample);
+
+    // data newer than the sample time is not returned
+    EXPECT_EQ(nullptr, buffer.peek(999));
+
+    const test_elements *peeked = buffer.peek(1060);
+    ASSERT_NE(nullptr, peeked);
+    EXPECT_EQ(1U, peeked->seq);
+    peeked = buffer.peek(1060);
+    ASSERT_NE(nullptr, peeked);
+    EXPECT_EQ(1U, peeked->seq);
+
+    test_elements recalled {};
+    EXPECT_TRUE(buffer.recall(recalled, 1060));
+    EXPECT_EQ(1U, recalled.seq);
+    EXPECT_TRUE(buffer.recall(recalled, 1060));
+    EXPECT_EQ(2U, recalled.seq);
+    EXPECT_EQ(nullptr, buffer.peek(1060));
+    EXPECT_FALSE(buffer.recall(recalled, 1060));
+}
+
+AP_GTEST_MAIN()
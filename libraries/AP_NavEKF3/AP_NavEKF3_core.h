@@ -400,7 +400,7 @@ public:
 
     void Log_Write(uint64_t time_us);
 
-private:
+protected:
     EKFGSF_yaw *yawEstimator;
     AP_DAL &dal;
 
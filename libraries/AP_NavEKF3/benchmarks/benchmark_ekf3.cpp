@@ -0,0 +1,105 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_NavEKF3/AP_NavEKF3.h>
+#include <AP_NavEKF3/AP_NavEKF3_core.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+/*
+  cost of the EKF3 prediction step for one IMU sample: the strapdown
+  equations and the covariance prediction. These run for every IMU
+  sample in every core, so the time per sample multiplied by the
+  number of cores and the EKF rate is the fixed load of the EKF before
+  any measurements are fused.
+
+  The first argument is the state index limit that the inhibited states
+  give (9, 12, 15, 21 or 23), the second is non-zero to inhibit the
+  magnetic field states while the wind states are active
+ */
+class NavEKF3_core_Benchmark : public NavEKF3_core {
+public:
+    NavEKF3_core_Benchmark(NavEKF3 *frontend, uint8_t state_index_lim, bool inhibit_mag) :
+        NavEKF3_core(frontend)
+    {
+        InitialiseVariables();
+        dtEkfAvg = EKF_TARGET_DT;
+        stateStruct.quat.from_euler(radians(5), radians(-10), radians(30));
+        stateStruct.quat.inverse().rotation_matrix(prevTnb);
+        stateStruct.velocity = Vector3f(3, -1, 0.5f);
+        onGround = false;
+        PV_AidingMode = AID_ABSOLUTE;
+
+        inhibitWindStates = state_index_lim < 22;
+        inhibitMagStates = state_index_lim < 16 || inhibit_mag;
+        lastInhibitMagStates = inhibitMagStates;
+        inhibitDelVelBiasStates = state_index_lim < 13;
+        inhibitDelAngBiasStates = state_index_lim < 10;
+        stateIndexLim = state_index_lim;
+
+        imuDataDelayed.delAng = Vector3f(0.002f, -0.001f, 0.003f);
+        imuDataDelayed.delVel = Vector3f(0.01f, 0.02f, -GRAVITY_MSS * EKF_TARGET_DT);
+        imuDataDelayed.delAngDT = EKF_TARGET_DT;
+        imuDataDelayed.delVelDT = EKF_TARGET_DT;
+        delAngCorrected = imuDataDelayed.delAng;
+        delVelCorrected = imuDataDelayed.delVel;
+
+        CovarianceInit();
+        memcpy(&initial_P, &P, sizeof(initial_P));
+        initial_state = stateStruct;
+        initial_prevTnb = prevTnb;
+    }
+
+    // prediction for one IMU sample, as in NavEKF3_core::UpdateFilter()
+    void predict()
+    {
+        UpdateStrapdownEquationsNED();
+        CovariancePrediction(nullptr);
+    }
+
+    // restart from the initial states, so that long runs don't
+    // measure a diverged filter
+    void restart()
+    {
+        memcpy(&P, &initial_P, sizeof(initial_P));
+        stateStruct = initial_state;
+        prevTnb = initial_prevTnb;
+    }
+
+    const Matrix24 &covariance() const { return P; }
+
+private:
+    Matrix24 initial_P;
+    state_elements initial_state;
+    Matrix3f initial_prevTnb;
+};
+
+static void BM_EKF3PredictionPerIMUSample(benchmark::State& state)
+{
+    NavEKF3 *frontend = new NavEKF3();
+    NavEKF3_core_Benchmark *bench = new NavEKF3_core_Benchmark(frontend, state.range_x(), state.range_y() != 0);
+    uint16_t samples = 0;
+
+    while (state.KeepRunning()) {
+        bench->predict();
+        gbenchmark_escape((void *)&bench->covariance());
+        if (++samples == 1000) {
+            state.PauseTiming();
+            bench->restart();
+            samples = 0;
+            state.ResumeTiming();
+        }
+    }
+
+    delete bench;
+    delete frontend;
+}
+
+BENCHMARK(BM_EKF3PredictionPerIMUSample)
+    ->ArgPair(9, 0)
+    ->ArgPair(12, 0)
+    ->ArgPair(15, 0)
+    ->ArgPair(21, 0)
+    ->ArgPair(23, 0)
+    ->ArgPair(23, 1);
+
+BENCHMARK_MAIN();
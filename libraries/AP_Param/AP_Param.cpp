@@ -24,6 +24,7 @@
 #include "AP_Param.h"
 
 #include <cmath>
+#include <stdlib.h>
 #include <string.h>
 
 #include <AP_Common/AP_Common.h>
@@ -84,6 +85,17 @@ HAL_Semaphore AP_Param::_count_sem;
 // storage and naming information about all types that can be saved
 const AP_Param::Info *AP_Param::_var_info;
 
+#if AP_PARAM_NAME_INDEX_ENABLED
+// sorted index for by-name lookups
+struct AP_Param::name_index_entry *AP_Param::_name_index;
+uint16_t *AP_Param::_name_index_order;
+uint16_t AP_Param::_name_index_count;
+uint16_t AP_Param::_name_index_size;
+uint16_t AP_Param::_name_index_marker;
+bool AP_Param::_name_index_valid;
+HAL_Semaphore AP_Param::_name_index_sem;
+#endif
+
 struct AP_Param::param_override *AP_Param::param_overrides = nullptr;
 uint16_t AP_Param::num_param_overrides = 0;
 uint16_t AP_Param::num_read_only = 0;
@@ -874,6 +886,33 @@ AP_Param::find_group(const char *name, uint16_t vindex, ptrdiff_t group_offset,
 //
 AP_Param *
 AP_Param::find(const char *name, enum ap_var_type *ptype, uint16_t *flags)
+{
+#if AP_PARAM_NAME_INDEX_ENABLED
+    ParamToken token {};
+    AP_Param *ap = nullptr;
+    if (find_in_name_index(name, ptype, &token, ap) && ap != nullptr) {
+        if (flags != nullptr) {
+            uint32_t group_element = 0;
+            const struct GroupInfo *ginfo;
+            struct GroupNesting group_nesting {};
+            uint8_t idx;
+            ap->find_var_info(&group_element, ginfo, group_nesting, &idx);
+            if (ginfo != nullptr) {
+                *flags = ginfo->flags;
+            }
+        }
+        return ap;
+    }
+    // the index only holds visible scalar parameters, so fall back
+    // to a tree walk for vectors and disabled subtrees
+#endif
+    return find_linear(name, ptype, flags);
+}
+
+// Find a variable by name, walking the var_info tree
+//
+AP_Param *
+AP_Param::find_linear(const char *name, enum ap_var_type *ptype, uint16_t *flags)
 {
     for (uint16_t i=0; i<_num_vars; i++) {
         uint8_t type = _var_info[i].type;
@@ -915,12 +954,18 @@ AP_Param::find(const char *name, enum ap_var_type *ptype, uint16_t *flags)
     return nullptr;
 }
 
-// Find a variable by index. Note that this is quite slow.
+// Find a variable by index. Note that this is quite slow without the
+// name index.
 //
 AP_Param *
 AP_Param::find_by_index(uint16_t idx, enum ap_var_type *ptype, ParamToken *token)
 {
     AP_Param *ap;
+#if AP_PARAM_NAME_INDEX_ENABLED
+    if (find_in_name_index_by_order(idx, ptype, token, ap)) {
+        return ap;
+    }
+#endif
     uint16_t count=0;
     for (ap=AP_Param::first(token, ptype);
          ap && count < idx;
@@ -934,6 +979,13 @@ AP_Param::find_by_index(uint16_t idx, enum ap_var_type *ptype, ParamToken *token
 AP_Param* AP_Param::find_by_name(const char* name, enum ap_var_type *ptype, ParamToken *token)
 {
     AP_Param *ap;
+#if AP_PARAM_NAME_INDEX_ENABLED
+    if (find_in_name_index(name, ptype, token, ap)) {
+        // the index holds exactly the set of parameters visited by
+        // next_scalar(), so a miss here is authoritative
+        return ap;
+    }
+#endif
     uint16_t count = 0;
     for (ap = AP_Param::first(token, ptype);
          ap && *ptype != AP_PARAM_GROUP && *ptype != AP_PARAM_NONE;
@@ -1782,6 +1834,22 @@ AP_Param *AP_Param::next_scalar(ParamToken *token, enum ap_var_type *ptype)
 }
 
 
+/// Returns the scalar variable at position idx, continuing from token
+AP_Param *AP_Param::next_scalar_indexed(ParamToken *token, enum ap_var_type *ptype, uint16_t idx)
+{
+#if AP_PARAM_NAME_INDEX_ENABLED
+    AP_Param *ap;
+    enum ap_var_type type;
+    if (find_in_name_index_by_order(idx, &type, token, ap)) {
+        if (ap != nullptr && ptype != nullptr) {
+            *ptype = type;
+        }
+        return ap;
+    }
+#endif
+    return next_scalar(token, ptype);
+}
+
 /// cast a variable to a float given its type
 float AP_Param::cast_to_float(enum ap_var_type type) const
 {
@@ -2436,6 +2504,182 @@ void AP_Param::invalidate_count(void)
     _count_marker++;
 }
 
+#if AP_PARAM_NAME_INDEX_ENABLED
+/*
+  case-insensitive 32 bit FNV-1a hash of a parameter name
+ */
+uint32_t AP_Param::name_hash(const char *name)
+{
+    uint32_t hash = 2166136261U;
+    for (uint8_t i=0; i<AP_MAX_NAME_SIZE && name[i] != 0; i++) {
+        uint8_t c = name[i];
+        if (c >= 'a' && c <= 'z') {
+            c -= 'a' - 'A';
+        }
+        hash = (hash ^ c) * 16777619U;
+    }
+    return hash;
+}
+
+static int name_index_compare(const void *v1, const void *v2)
+{
+    const uint32_t h1 = *(const uint32_t *)v1;
+    const uint32_t h2 = *(const uint32_t *)v2;
+    if (h1 < h2) {
+        return -1;
+    }
+    if (h1 > h2) {
+        return 1;
+    }
+    return 0;
+}
+
+/*
+  build the sorted name index. Must be called with _name_index_sem
+  held. Returns false if the index could not be allocated
+ */
+bool AP_Param::build_name_index(void)
+{
+    if (!initialised()) {
+        return false;
+    }
+
+    // take the marker before counting so a concurrent change to the
+    // tree causes a rebuild on the next lookup
+    const uint16_t marker = _count_marker;
+    const uint16_t count = count_parameters();
+
+    if (count > _name_index_size) {
+        delete[] _name_index;
+        delete[] _name_index_order;
+        _name_index_size = 0;
+        _name_index_count = 0;
+        _name_index_valid = false;
+        // allow some headroom for backends enabled later
+        const uint16_t new_size = count + count/8;
+        _name_index = new name_index_entry[new_size];
+        _name_index_order = new uint16_t[new_size];
+        if (_name_index == nullptr || _name_index_order == nullptr) {
+            delete[] _name_index;
+            delete[] _name_index_order;
+            _name_index = nullptr;
+            _name_index_order = nullptr;
+            return false;
+        }
+        _name_index_size = new_size;
+    }
+
+    ParamToken token {};
+    enum ap_var_type type;
+    uint16_t n = 0;
+    for (AP_Param *ap = first(&token, &type);
+         ap != nullptr;
+         ap = next_scalar(&token, &type)) {
+        if (type == AP_PARAM_GROUP || type == AP_PARAM_NONE) {
+            break;
+        }
+        if (n == _name_index_size) {
+            // the tree grew while we were counting; an incomplete
+            // index can't be used, so retry on the next lookup
+            _name_index_valid = false;
+            return false;
+        }
+        char name[AP_MAX_NAME_SIZE+1];
+        ap->copy_name_token(token, name, sizeof(name));
+        name_index_entry &e = _name_index[n];
+        e.hash = name_hash(name);
+        e.token = token;
+        e.ap = ap;
+        e.type = type;
+        e.order = n++;
+    }
+
+    // hash is the first member of name_index_entry
+    qsort(_name_index, n, sizeof(_name_index[0]), name_index_compare);
+
+    for (uint16_t i=0; i<n; i++) {
+        _name_index_order[_name_index[i].order] = i;
+    }
+
+    _name_index_count = n;
+    _name_index_marker = marker;
+    _name_index_valid = true;
+    return true;
+}
+
+/*
+  find a scalar parameter using the name index. Returns false if the
+  index is unavailable, in which case the caller must fall back to a
+  tree walk. On success ap is set to the parameter, or nullptr if the
+  name is not a visible scalar parameter
+ */
+bool AP_Param::find_in_name_index(const char *name, enum ap_var_type *ptype, ParamToken *token, AP_Param *&ap)
+{
+    WITH_SEMAPHORE(_name_index_sem);
+
+    if (!_name_index_valid || _name_index_marker != _count_marker) {
+        if (!build_name_index()) {
+            return false;
+        }
+    }
+
+    const uint32_t hash = name_hash(name);
+
+    // binary search for the first entry with a matching hash
+    uint16_t lo = 0;
+    uint16_t hi = _name_index_count;
+    while (lo < hi) {
+        const uint16_t mid = (lo + hi) / 2;
+        if (_name_index[mid].hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    // confirm the name, as hashes may collide
+    ap = nullptr;
+    for (uint16_t i=lo; i<_name_index_count && _name_index[i].hash == hash; i++) {
+        const name_index_entry &e = _name_index[i];
+        char buf[AP_MAX_NAME_SIZE+1];
+        e.ap->copy_name_token(e.token, buf, sizeof(buf));
+        if (strncasecmp(name, buf, AP_MAX_NAME_SIZE) == 0) {
+            ap = e.ap;
+            *ptype = (enum ap_var_type)e.type;
+            if (token != nullptr) {
+                *token = e.token;
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+/*
+  find a parameter by its position in first()/next_scalar() order
+  using the name index. Returns false if the index is unavailable
+ */
+bool AP_Param::find_in_name_index_by_order(uint16_t idx, enum ap_var_type *ptype, ParamToken *token, AP_Param *&ap)
+{
+    WITH_SEMAPHORE(_name_index_sem);
+
+    if (!_name_index_valid || _name_index_marker != _count_marker) {
+        if (!build_name_index()) {
+            return false;
+        }
+    }
+
+    ap = nullptr;
+    if (idx < _name_index_count) {
+        const name_index_entry &e = _name_index[_name_index_order[idx]];
+        ap = e.ap;
+        *ptype = (enum ap_var_type)e.type;
+        *token = e.token;
+    }
+    return true;
+}
+#endif // AP_PARAM_NAME_INDEX_ENABLED
+
 /*
   set a default value by name
  */
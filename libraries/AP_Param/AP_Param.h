@@ -46,6 +46,15 @@
 #endif
 #endif
 
+/*
+  enable a sorted name index for by-name lookups. This costs about 20
+  bytes of heap per parameter, so is only enabled on boards with
+  plenty of memory
+ */
+#ifndef AP_PARAM_NAME_INDEX_ENABLED
+#define AP_PARAM_NAME_INDEX_ENABLED (HAL_MEM_CLASS >= HAL_MEM_CLASS_500)
+#endif
+
 /*
   flags for variables in var_info and group tables
  */
@@ -269,6 +278,11 @@ public:
     ///
     static AP_Param * find(const char *name, enum ap_var_type *ptype, uint16_t *flags = nullptr);
 
+    /// Find a variable by name by walking the var_info tree, without
+    /// using the name index. This is the slow path used by find()
+    /// when the index is not available
+    static AP_Param * find_linear(const char *name, enum ap_var_type *ptype, uint16_t *flags = nullptr);
+
     /// set a default value by name
     ///
     /// @param  name            The full name of the variable to be found.
@@ -310,6 +324,8 @@ public:
 
     /// Find a variable by index.
     ///
+    /// This uses the name index when available, otherwise it walks
+    /// the var_info tree and is quite slow.
     ///
     /// @param  idx             The index of the variable
     /// @return                 A pointer to the variable, or nullptr if
@@ -467,6 +483,12 @@ public:
     /// as needed
     static AP_Param *       next_scalar(ParamToken *token, enum ap_var_type *ptype);
 
+    /// Returns the scalar variable at position idx in next_scalar()
+    /// order, where token holds the variable at position idx-1. This
+    /// uses the name index when it is available, giving a cursor that
+    /// doesn't need to re-walk the group tree on each call
+    static AP_Param *       next_scalar_indexed(ParamToken *token, enum ap_var_type *ptype, uint16_t idx);
+
     /// get the size of a type in bytes
     static uint8_t				type_size(enum ap_var_type type);
 
@@ -697,6 +719,32 @@ private:
     static HAL_Semaphore        _count_sem;
     static const struct Info *  _var_info;
 
+#if AP_PARAM_NAME_INDEX_ENABLED
+    /*
+      sorted index of scalar parameters by name hash, rebuilt lazily
+      when the parameter tree changes (tracked via _count_marker)
+     */
+    struct name_index_entry {
+        uint32_t hash;
+        ParamToken token;
+        AP_Param *ap;
+        uint8_t type;       // ap_var_type
+        uint16_t order;     // position in first()/next_scalar() order
+    };
+    static struct name_index_entry *_name_index;
+    static uint16_t *           _name_index_order;
+    static uint16_t             _name_index_count;
+    static uint16_t             _name_index_size;
+    static uint16_t             _name_index_marker;
+    static bool                 _name_index_valid;
+    static HAL_Semaphore        _name_index_sem;
+
+    static uint32_t             name_hash(const char *name);
+    static bool                 build_name_index(void);
+    static bool                 find_in_name_index(const char *name, enum ap_var_type *ptype, ParamToken *token, AP_Param *&ap);
+    static bool                 find_in_name_index_by_order(uint16_t idx, enum ap_var_type *ptype, ParamToken *token, AP_Param *&ap);
+#endif
+
     /*
       list of overridden values from load_defaults_file()
     */
@@ -0,0 +1,120 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Param/AP_Param.h>
+#include <GCS_MAVLink/GCS_Dummy.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+/*
+  synthetic parameter tree roughly the size of a Copter build: 32
+  groups of 32 parameters plus a top level scalar
+ */
+#define NUM_BENCH_GROUPS 32
+#define NUM_BENCH_PARAMS 32
+
+class BenchGroup {
+public:
+    static const struct AP_Param::GroupInfo var_info[];
+    AP_Float p[NUM_BENCH_PARAMS];
+};
+
+#define BENCH_PARAM(i) AP_GROUPINFO("P" #i, i, BenchGroup, p[i], 0)
+
+const AP_Param::GroupInfo BenchGroup::var_info[] = {
+    BENCH_PARAM(0),  BENCH_PARAM(1),  BENCH_PARAM(2),  BENCH_PARAM(3),
+    BENCH_PARAM(4),  BENCH_PARAM(5),  BENCH_PARAM(6),  BENCH_PARAM(7),
+    BENCH_PARAM(8),  BENCH_PARAM(9),  BENCH_PARAM(10), BENCH_PARAM(11),
+    BENCH_PARAM(12), BENCH_PARAM(13), BENCH_PARAM(14), BENCH_PARAM(15),
+    BENCH_PARAM(16), BENCH_PARAM(17), BENCH_PARAM(18), BENCH_PARAM(19),
+    BENCH_PARAM(20), BENCH_PARAM(21), BENCH_PARAM(22), BENCH_PARAM(23),
+    BENCH_PARAM(24), BENCH_PARAM(25), BENCH_PARAM(26), BENCH_PARAM(27),
+    BENCH_PARAM(28), BENCH_PARAM(29), BENCH_PARAM(30), BENCH_PARAM(31),
+    AP_GROUPEND
+};
+
+static AP_Int16 format_version;
+static BenchGroup groups[NUM_BENCH_GROUPS];
+
+#define BENCH_GROUP(i) { AP_PARAM_GROUP, "G" #i "_", i+1, (const void *)&groups[i], {group_info : BenchGroup::var_info} }
+
+static const struct AP_Param::Info var_info[] = {
+    { AP_PARAM_INT16, "FORMAT_VERSION", 0, (const void *)&format_version, {def_value : 0} },
+    BENCH_GROUP(0),  BENCH_GROUP(1),  BENCH_GROUP(2),  BENCH_GROUP(3),
+    BENCH_GROUP(4),  BENCH_GROUP(5),  BENCH_GROUP(6),  BENCH_GROUP(7),
+    BENCH_GROUP(8),  BENCH_GROUP(9),  BENCH_GROUP(10), BENCH_GROUP(11),
+    BENCH_GROUP(12), BENCH_GROUP(13), BENCH_GROUP(14), BENCH_GROUP(15),
+    BENCH_GROUP(16), BENCH_GROUP(17), BENCH_GROUP(18), BENCH_GROUP(19),
+    BENCH_GROUP(20), BENCH_GROUP(21), BENCH_GROUP(22), BENCH_GROUP(23),
+    BENCH_GROUP(24), BENCH_GROUP(25), BENCH_GROUP(26), BENCH_GROUP(27),
+    BENCH_GROUP(28), BENCH_GROUP(29), BENCH_GROUP(30), BENCH_GROUP(31),
+    AP_VAREND
+};
+
+static AP_Param param_loader{var_info};
+
+// look up the last parameter in the tree, the worst case for a walk
+static const char *lookup_name = "G31_P31";
+
+static void BM_ParamFindLinear(benchmark::State& state)
+{
+    enum ap_var_type ptype;
+    while (state.KeepRunning()) {
+        AP_Param *ap = AP_Param::find_linear(lookup_name, &ptype);
+        gbenchmark_escape(ap);
+    }
+}
+
+static void BM_ParamFind(benchmark::State& state)
+{
+    enum ap_var_type ptype;
+    while (state.KeepRunning()) {
+        AP_Param *ap = AP_Param::find(lookup_name, &ptype);
+        gbenchmark_escape(ap);
+    }
+}
+
+static void BM_ParamFindByName(benchmark::State& state)
+{
+    enum ap_var_type ptype;
+    AP_Param::ParamToken token;
+    while (state.KeepRunning()) {
+        AP_Param *ap = AP_Param::find_by_name(lookup_name, &ptype, &token);
+        gbenchmark_escape(ap);
+    }
+}
+
+static void BM_ParamFindByIndex(benchmark::State& state)
+{
+    enum ap_var_type ptype;
+    AP_Param::ParamToken token;
+    const uint16_t idx = AP_Param::count_parameters() - 1;
+    while (state.KeepRunning()) {
+        AP_Param *ap = AP_Param::find_by_index(idx, &ptype, &token);
+        gbenchmark_escape(ap);
+    }
+}
+
+// cost of rebuilding the index after the tree changes
+static void BM_ParamFindAfterInvalidate(benchmark::State& state)
+{
+    enum ap_var_type ptype;
+    while (state.KeepRunning()) {
+        AP_Param::invalidate_count();
+        AP_Param *ap = AP_Param::find(lookup_name, &ptype);
+        gbenchmark_escape(ap);
+    }
+}
+
+BENCHMARK(BM_ParamFindLinear);
+BENCHMARK(BM_ParamFind);
+BENCHMARK(BM_ParamFindByName);
+BENCHMARK(BM_ParamFindByIndex);
+BENCHMARK(BM_ParamFindAfterInvalidate);
+
+const AP_Param::GroupInfo GCS_MAVLINK_Parameters::var_info[] = {
+    AP_GROUPEND
+};
+GCS_Dummy _gcs;
+
+BENCHMARK_MAIN();
@@ -115,10 +115,30 @@ void AP_Scheduler::init(const AP_Scheduler::Task *tasks, uint8_t num_tasks, uint
     _tasks = tasks;
     _num_unshared_tasks = num_tasks;
 
+    if (_num_tasks >= no_task) {
+        AP_HAL::panic("Too many scheduler tasks");
+    }
+
     _last_run = new uint16_t[_num_tasks];
     memset(_last_run, 0, sizeof(_last_run[0]) * _num_tasks);
     _tick_counter = 0;
 
+    // work out task intervals once, and place every task in the wheel
+    _interval_ticks = new uint16_t[_num_tasks];
+    _wheel_next = new uint8_t[_num_tasks];
+    memset(_wheel_head, no_task, sizeof(_wheel_head));
+    _due_tasks.clearall();
+    for (uint8_t i=0; i<_num_tasks; i++) {
+        const AP_Scheduler::Task& task = get_task(i);
+        // we allow 0 to mean loop rate
+        uint32_t interval_ticks = (is_zero(task.rate_hz) ? 1 : _loop_rate_hz / task.rate_hz);
+        if (interval_ticks < 1) {
+            interval_ticks = 1;
+        }
+        _interval_ticks[i] = MIN(interval_ticks, uint32_t(UINT16_MAX));
+        wheel_insert(i);
+    }
+
     // setup initial performance counters
     perf_info.set_loop_rate(get_loop_rate_hz());
     perf_info.reset();
@@ -134,6 +154,33 @@ void AP_Scheduler::init(const AP_Scheduler::Task *tasks, uint8_t num_tasks, uint
 void AP_Scheduler::tick(void)
 {
     _tick_counter++;
+
+    if (_wheel_next == nullptr) {
+        // not initialised yet
+        return;
+    }
+
+    // move tasks in this tick's slot which are now due into the due
+    // set. Tasks with an interval longer than the wheel stay in the
+    // slot until their due tick comes around
+    uint8_t *prev = &_wheel_head[_tick_counter & (wheel_slots-1)];
+    while (*prev != no_task) {
+        const uint8_t i = *prev;
+        if (uint16_t(_tick_counter - _last_run[i]) >= _interval_ticks[i]) {
+            *prev = _wheel_next[i];
+            _due_tasks.set(i);
+        } else {
+            prev = &_wheel_next[i];
+        }
+    }
+}
+
+// add a task to the wheel slot for its next due tick
+void AP_Scheduler::wheel_insert(uint8_t task_index)
+{
+    const uint8_t slot = (_last_run[task_index] + _interval_ticks[task_index]) & (wheel_slots-1);
+    _wheel_next[task_index] = _wheel_head[slot];
+    _wheel_head[slot] = task_index;
 }
 
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
@@ -169,19 +216,18 @@ void AP_Scheduler::run(uint32_t time_available)
         }
     }
     
-    for (uint8_t i=0; i<_num_tasks; i++) {
-        const AP_Scheduler::Task& task = (i < _num_unshared_tasks) ? _tasks[i] : _common_tasks[i - _num_unshared_tasks];
+    // only look at tasks which are due, in table order so that
+    // earlier tasks keep priority
+    Bitmask<256> due;
+    due = _due_tasks;
+    for (int16_t next = due.first_set(); next != -1; next = due.first_set()) {
+        const uint8_t i = next;
+        due.clear(i);
+        const AP_Scheduler::Task& task = get_task(i);
+
+        const uint32_t dt = uint16_t(_tick_counter - _last_run[i]);
+        const uint32_t interval_ticks = _interval_ticks[i];
 
-        uint32_t dt = _tick_counter - _last_run[i];
-        // we allow 0 to mean loop rate
-        uint32_t interval_ticks = (is_zero(task.rate_hz) ? 1 : _loop_rate_hz / task.rate_hz);
-        if (interval_ticks < 1) {
-            interval_ticks = 1;
-        }
-        if (dt < interval_ticks) {
-            // this task is not yet scheduled to run again
-            continue;
-        }
         // this task is due to run. Do we have enough time to run it?
         _task_time_allowed = task.max_time_micros;
 
@@ -219,13 +265,13 @@ void AP_Scheduler::run(uint32_t time_available)
         // record the tick counter when we ran. This drives
         // when we next run the event
         _last_run[i] = _tick_counter;
+        _due_tasks.clear(i);
+        wheel_insert(i);
 
         // work out how long the event actually took
         now = AP_HAL::micros();
         uint32_t time_taken = now - _task_time_started;
-        bool overrun = false;
         if (time_taken > _task_time_allowed) {
-            overrun = true;
             // the event overran!
             debug(3, "Scheduler overrun task[%u-%s] (%u/%u)\n",
                   (unsigned)i,
@@ -234,7 +280,7 @@ void AP_Scheduler::run(uint32_t time_available)
                   (unsigned)_task_time_allowed);
         }
 
-        perf_info.update_task_info(i, time_taken, overrun);
+        perf_info.update_task_info(i, time_taken, _task_time_allowed);
 
         if (time_taken >= time_available) {
             time_available = 0;
@@ -335,7 +381,7 @@ void AP_Scheduler::loop()
     // add in extra loop time determined by not achieving scheduler tasks
     time_available += extra_loop_us;
     // update the task info for the fast loop
-    perf_info.update_task_info(_num_tasks, loop_tick_us, loop_tick_us > loop_us);
+    perf_info.update_task_info(_num_tasks, loop_tick_us, loop_us);
 
     // run the tasks
     run(time_available);
@@ -376,6 +422,9 @@ void AP_Scheduler::update_logging()
     if (_log_performance_bit != (uint32_t)-1 &&
         AP::logger().should_log(_log_performance_bit)) {
         Log_Write_Performance();
+        if (perf_info.has_task_info()) {
+            Log_Write_Task_Histograms();
+        }
     }
     perf_info.set_loop_rate(get_loop_rate_hz());
     perf_info.reset();
@@ -410,11 +459,30 @@ void AP_Scheduler::Log_Write_Performance()
     AP::logger().WriteCriticalBlock(&pkt, sizeof(pkt));
 }
 
+// Write per-task run time and overrun histograms
+void AP_Scheduler::Log_Write_Task_Histograms()
+{
+    const uint64_t now_us = AP_HAL::micros64();
+    for (uint8_t i = 0; i < _num_tasks + 1; i++) {
+        const AP::PerfInfo::TaskInfo* ti = perf_info.get_task_info(i);
+        if (ti == nullptr || ti->tick_count == 0) {
+            continue;
+        }
+        AP::logger().Write("TSKH", "TimeUS,Id,T16,T32,T64,T128,T256,T512,T1K,TL,O1,O2,O4,O8",
+                           "s#------------", "F-------------", "QBHHHHHHHHHHHH",
+                           now_us,
+                           i,
+                           ti->time_hist[0], ti->time_hist[1], ti->time_hist[2], ti->time_hist[3],
+                           ti->time_hist[4], ti->time_hist[5], ti->time_hist[6], ti->time_hist[7],
+                           ti->overrun_hist[0], ti->overrun_hist[1], ti->overrun_hist[2], ti->overrun_hist[3]);
+    }
+}
+
 // display task statistics as text buffer for @SYS/tasks.txt
 void AP_Scheduler::task_info(ExpandingString &str)
 {
     // a header to allow for machine parsers to determine format
-    str.printf("TasksV1\n");
+    str.printf("TasksV2\n");
 
     // dynamically enable statistics collection
     if (!(_options & uint8_t(Options::RECORD_TASK_INFO))) {
@@ -447,13 +515,19 @@ void AP_Scheduler::task_info(ExpandingString &str)
         }
 
 #if HAL_MINIMIZE_FEATURES
-        const char* fmt = "%-16.16s MIN=%3u MAX=%3u AVG=%3u OVR=%3u SLP=%3u, TOT=%4.1f%%\n";
+        const char* fmt = "%-16.16s MIN=%3u MAX=%3u AVG=%3u OVR=%3u SLP=%3u, TOT=%4.1f%%";
 #else
-        const char* fmt = "%-32.32s MIN=%3u MAX=%3u AVG=%3u OVR=%3u SLP=%3u, TOT=%4.1f%%\n";
+        const char* fmt = "%-32.32s MIN=%3u MAX=%3u AVG=%3u OVR=%3u SLP=%3u, TOT=%4.1f%%";
 #endif
         str.printf(fmt, task_name,
                    unsigned(MIN(ti->min_time_us, 999)), unsigned(MIN(ti->max_time_us, 999)), unsigned(avg),
                    unsigned(MIN(ti->overrun_count, 999)), unsigned(MIN(ti->slip_count, 999)), pct);
+        // log2 run time histogram from <16us to >=1024us, then overrun
+        // histogram from 1x to >=8x the allowed time
+        str.printf(" T=%u,%u,%u,%u,%u,%u,%u,%u O=%u,%u,%u,%u\n",
+                   unsigned(ti->time_hist[0]), unsigned(ti->time_hist[1]), unsigned(ti->time_hist[2]), unsigned(ti->time_hist[3]),
+                   unsigned(ti->time_hist[4]), unsigned(ti->time_hist[5]), unsigned(ti->time_hist[6]), unsigned(ti->time_hist[7]),
+                   unsigned(ti->overrun_hist[0]), unsigned(ti->overrun_hist[1]), unsigned(ti->overrun_hist[2]), unsigned(ti->overrun_hist[3]));
     }
 }
 
@@ -24,6 +24,7 @@
 #include <AP_HAL/Util.h>
 #include <AP_HAL/AP_HAL.h>
 #include <AP_Math/AP_Math.h>
+#include <AP_Common/Bitmask.h>
 #include "PerfInfo.h"       // loop perf monitoring
 
 #if HAL_MINIMIZE_FEATURES
@@ -96,6 +97,9 @@ public:
     // write out PERF message to logger
     void Log_Write_Performance();
 
+    // write out per-task TSKH histogram messages to logger
+    void Log_Write_Task_Histograms();
+
     // call when one tick has passed
     void tick(void);
 
@@ -204,6 +208,32 @@ private:
     // tick counter at the time we last ran each task
     uint16_t *_last_run;
 
+    // number of ticks between runs of each task
+    uint16_t *_interval_ticks;
+
+    /*
+      timing wheel of tasks waiting to become due. Each task which is
+      not due sits in the slot for its next due tick, and tick() moves
+      the tasks in the current slot into _due_tasks. This avoids
+      scanning the whole task table every loop. The number of slots
+      must be a power of two so slots line up when _tick_counter wraps
+     */
+    static const uint8_t wheel_slots = 64;
+    static const uint8_t no_task = 0xFF;
+    uint8_t _wheel_head[wheel_slots];
+    uint8_t *_wheel_next;
+
+    // tasks which are due to run, in table (priority) order
+    Bitmask<256> _due_tasks;
+
+    // add a task to the wheel slot for its next due tick
+    void wheel_insert(uint8_t task_index);
+
+    // return a task from the vehicle or common task tables
+    const Task &get_task(uint8_t i) const {
+        return (i < _num_unshared_tasks) ? _tasks[i] : _common_tasks[i - _num_unshared_tasks];
+    }
+
     // number of microseconds allowed for the current task
     uint32_t _task_time_allowed;
 
@@ -53,7 +53,7 @@ void AP::PerfInfo::free_task_info()
 }
 
 // called after each run of a task to update its statistics based on measurements taken by the scheduler
-void AP::PerfInfo::update_task_info(uint8_t task_index, uint16_t task_time_us, bool overrun)
+void AP::PerfInfo::update_task_info(uint8_t task_index, uint16_t task_time_us, uint32_t allowed_time_us)
 {
     if (_task_info == nullptr) {
         return;
@@ -72,8 +72,27 @@ void AP::PerfInfo::update_task_info(uint8_t task_index, uint16_t task_time_us, b
     }
     ti.elapsed_time_us += task_time_us;
     ti.tick_count++;
-    if (overrun) {
+
+    // log2 histogram of run time
+    uint8_t bin = 0;
+    for (uint32_t t = task_time_us >> 4; t != 0 && bin < TASK_TIME_HIST_BINS-1; t >>= 1) {
+        bin++;
+    }
+    if (ti.time_hist[bin] < UINT16_MAX) {
+        ti.time_hist[bin]++;
+    }
+
+    if (task_time_us > allowed_time_us) {
         ti.overrun_count++;
+        // log2 histogram of how far over its allowed time the task went
+        uint8_t obin = 0;
+        uint32_t ratio = allowed_time_us > 0 ? task_time_us / allowed_time_us : UINT32_MAX;
+        for (; ratio > 1 && obin < TASK_OVERRUN_HIST_BINS-1; ratio >>= 1) {
+            obin++;
+        }
+        if (ti.overrun_hist[obin] < UINT16_MAX) {
+            ti.overrun_hist[obin]++;
+        }
     }
 }
 
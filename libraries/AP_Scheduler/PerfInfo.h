@@ -8,6 +8,13 @@ class PerfInfo {
 public:
     PerfInfo() {}
 
+    // number of log2 buckets in the per-task run time histogram. The
+    // first bucket is under 16us, the last is 1024us or more
+    static const uint8_t TASK_TIME_HIST_BINS = 8;
+    // number of log2 buckets in the per-task overrun histogram, by
+    // multiple of the allowed time: 1x, 2x, 4x and 8x or more
+    static const uint8_t TASK_OVERRUN_HIST_BINS = 4;
+
     // per-task timing information
     struct TaskInfo {
         uint16_t min_time_us;
@@ -16,6 +23,8 @@ public:
         uint32_t tick_count;
         uint16_t slip_count;
         uint16_t overrun_count;
+        uint16_t time_hist[TASK_TIME_HIST_BINS];
+        uint16_t overrun_hist[TASK_OVERRUN_HIST_BINS];
     };
 
     /* Do not allow copies */
@@ -46,11 +55,11 @@ public:
         return (_task_info && task_index <= _num_tasks) ? &_task_info[task_index] : nullptr;
     }
     // called after each run of a task to update its statistics based on measurements taken by the scheduler
-    void update_task_info(uint8_t task_index, uint16_t task_time_us, bool overrun);
+    void update_task_info(uint8_t task_index, uint16_t task_time_us, uint32_t allowed_time_us);
     // record that a task slipped
     void task_slipped(uint8_t task_index) {
         if (_task_info && task_index <= _num_tasks) {
-            _task_info[task_index].overrun_count++;
+            _task_info[task_index].slip_count++;
         }
     }
 
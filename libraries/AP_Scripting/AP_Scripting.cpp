@@ -16,6 +16,7 @@
 #include <AP_Scripting/AP_Scripting.h>
 #include <AP_HAL/AP_HAL.h>
 #include <GCS_MAVLink/GCS.h>
+#include <AP_Common/ExpandingString.h>
 
 #include "lua_scripts.h"
 
@@ -109,6 +110,16 @@ const AP_Param::GroupInfo AP_Scripting::var_info[] = {
     // @User: Advanced
     AP_GROUPINFO("DIR_DISABLE", 9, AP_Scripting, _dir_disable, 0),
 
+#if AP_SCRIPTING_MULTI_VM_ENABLED
+    // @Param: THREADS
+    // @DisplayName: Scripting threads
+    // @Description: With 0 all scripts share one VM on the scripting thread. Otherwise each script is run in its own VM, with a heap of SCR_HEAP_SIZE, and the VMs are spread over this many threads. Calls scripts make into the vehicle are serialised between the threads. The REPL runs in the VM of the first script
+    // @Range: 0 8
+    // @RebootRequired: True
+    // @User: Advanced
+    AP_GROUPINFO("THREADS", 10, AP_Scripting, _threads, 0),
+#endif // AP_SCRIPTING_MULTI_VM_ENABLED
+
     AP_GROUPEND
 };
 
@@ -193,6 +204,14 @@ void AP_Scripting::repl_stop(void) {
 }
 
 void AP_Scripting::thread(void) {
+#if AP_SCRIPTING_MULTI_VM_ENABLED
+    if (_threads > 0 && run_vms()) {
+        // only reachable if the lua backend has died for any reason
+        gcs().send_text(MAV_SEVERITY_CRITICAL, "Scripting has stopped");
+        return;
+    }
+#endif // AP_SCRIPTING_MULTI_VM_ENABLED
+
     lua_scripts *lua = new lua_scripts(_script_vm_exec_count, _script_heap_size, _debug_level, terminal);
     if (lua == nullptr || !lua->heap_allocated()) {
         gcs().send_text(MAV_SEVERITY_CRITICAL, "Unable to allocate scripting memory");
@@ -200,12 +219,97 @@ void AP_Scripting::thread(void) {
         _init_failed = true;
         return;
     }
+    _lua.store(lua, std::memory_order_release);
     lua->run();
 
     // only reachable if the lua backend has died for any reason
     gcs().send_text(MAV_SEVERITY_CRITICAL, "Scripting has stopped");
 }
 
+#if AP_SCRIPTING_MULTI_VM_ENABLED
+bool AP_Scripting::run_vms(void) {
+    char *names[AP_SCRIPTING_MAX_VMS];
+    uint8_t count = lua_scripts::find_scripts(names, ARRAY_SIZE(names));
+    if (count == 0) {
+        // leave the shared VM to report there is nothing to run
+        return false;
+    }
+
+    lua_scripts **vms = new lua_scripts*[count];
+    if (vms == nullptr) {
+        for (uint8_t i=0; i<count; i++) {
+            free(names[i]);
+        }
+        return false;
+    }
+    uint8_t num_vms = 0;
+    for (uint8_t i=0; i<count; i++) {
+        lua_scripts *vm = new lua_scripts(_script_vm_exec_count, _script_heap_size, _debug_level, terminal, names[i], num_vms == 0);
+        if (vm == nullptr || !vm->heap_allocated()) {
+            gcs().send_text(MAV_SEVERITY_CRITICAL, "Unable to allocate scripting memory for %s", names[i]);
+            delete vm;
+            free(names[i]);
+            continue;
+        }
+        // the VM keeps its script name
+        names[num_vms] = names[i];
+        vms[num_vms++] = vm;
+    }
+    if (num_vms == 0) {
+        delete[] vms;
+        return false;
+    }
+
+    // give each thread an even share of the VMs
+    const uint8_t num_workers = MIN(MIN(uint8_t(_threads.get()), num_vms), AP_SCRIPTING_MAX_THREADS);
+    vm_worker *workers = new vm_worker[num_workers];
+    if (workers == nullptr) {
+        for (uint8_t i=0; i<num_vms; i++) {
+            delete vms[i];
+            free(names[i]);
+        }
+        delete[] vms;
+        return false;
+    }
+    for (uint8_t i=0; i<num_workers; i++) {
+        const uint8_t start = (i * num_vms) / num_workers;
+        workers[i].vms = &vms[start];
+        workers[i].count = (((i + 1) * num_vms) / num_workers) - start;
+        workers[i].index = i;
+    }
+
+    // publish the VMs for profile_info(), which may run on another
+    // thread. The array must be visible before the count is
+    _vms = vms;
+    _num_vms.store(num_vms, std::memory_order_release);
+
+    // this thread runs the first share. Threads are started last first,
+    // so if one can't be created its share goes to the worker before
+    // it, whose VMs are next to its own and which hasn't started yet
+    lua_scripts::lock_bindings = num_workers > 1;
+    uint8_t num_started = 0;
+    for (uint8_t i=num_workers-1; i>0; i--) {
+        if (hal.scheduler->thread_create(FUNCTOR_BIND(&workers[i], &AP_Scripting::vm_worker::run, void),
+                                         "Scripting", SCRIPTING_STACK_SIZE, AP_HAL::Scheduler::PRIORITY_SCRIPTING, 0)) {
+            num_started++;
+        } else {
+            gcs().send_text(MAV_SEVERITY_CRITICAL, "Could not create scripting thread %u", (unsigned)i);
+            workers[i-1].count += workers[i].count;
+        }
+    }
+    if (num_started == 0) {
+        // no other thread runs scripts, so bindings don't need locking
+        lua_scripts::lock_bindings = false;
+    }
+    workers[0].run();
+    return true;
+}
+
+void AP_Scripting::vm_worker::run(void) {
+    lua_scripts::run_group(vms, count, index);
+}
+#endif // AP_SCRIPTING_MULTI_VM_ENABLED
+
 void AP_Scripting::handle_mission_command(const AP_Mission::Mission_Command& cmd_in)
 {
     if (!_enable) {
@@ -230,6 +334,26 @@ void AP_Scripting::handle_mission_command(const AP_Mission::Mission_Command& cmd
     mission_data->push(cmd);
 }
 
+void AP_Scripting::profile_info(ExpandingString &str)
+{
+    // a header to allow for machine parsers to determine format
+    str.printf("ScriptsV1\n");
+
+    lua_scripts *lua = _lua.load(std::memory_order_acquire);
+    if (lua != nullptr) {
+        lua->profile_info(str);
+    }
+#if AP_SCRIPTING_MULTI_VM_ENABLED
+    const uint8_t num_vms = _num_vms.load(std::memory_order_acquire);
+    for (uint8_t i=0; i<num_vms; i++) {
+        _vms[i]->profile_info(str);
+    }
+#endif // AP_SCRIPTING_MULTI_VM_ENABLED
+
+    str.printf("\nBindings\n");
+    lua_scripts::binding_info(str);
+}
+
 AP_Scripting *AP_Scripting::_singleton = nullptr;
 
 namespace AP {
@@ -21,11 +21,30 @@
 #include <GCS_MAVLink/GCS.h>
 #include <AP_Filesystem/AP_Filesystem.h>
 #include <AP_HAL/I2CDevice.h>
+#include <atomic>
+
+class lua_scripts;
+class ExpandingString;
 
 #ifndef SCRIPTING_MAX_NUM_I2C_DEVICE
   #define SCRIPTING_MAX_NUM_I2C_DEVICE 4
 #endif
 
+// allow each script to run in its own VM, spread over a pool of
+// threads, see SCR_THREADS
+#ifndef AP_SCRIPTING_MULTI_VM_ENABLED
+  #define AP_SCRIPTING_MULTI_VM_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX)
+#endif // AP_SCRIPTING_MULTI_VM_ENABLED
+
+#if AP_SCRIPTING_MULTI_VM_ENABLED
+  #ifndef AP_SCRIPTING_MAX_THREADS
+    #define AP_SCRIPTING_MAX_THREADS 8
+  #endif
+  #ifndef AP_SCRIPTING_MAX_VMS
+    #define AP_SCRIPTING_MAX_VMS 32
+  #endif
+#endif // AP_SCRIPTING_MULTI_VM_ENABLED
+
 class AP_Scripting
 {
 public:
@@ -48,6 +67,9 @@ public:
 
     void handle_mission_command(const AP_Mission::Mission_Command& cmd);
 
+    // profile of the running scripts, for @SYS/scripts.txt
+    void profile_info(ExpandingString &str);
+
    // User parameters for inputs into scripts 
    AP_Float _user[4]; 
 
@@ -78,6 +100,17 @@ public:
     };
     ObjectBuffer<struct scripting_mission_cmd> * mission_data;
 
+protected:
+
+    AP_Int8 _enable;
+    AP_Int32 _script_vm_exec_count;
+    AP_Int32 _script_heap_size;
+    AP_Int8 _debug_level;
+    AP_Int16 _dir_disable;
+#if AP_SCRIPTING_MULTI_VM_ENABLED
+    AP_Int8 _threads;
+#endif
+
 private:
 
     bool repl_start(void);
@@ -87,14 +120,31 @@ private:
 
     void thread(void); // main script execution thread
 
-    AP_Int8 _enable;
-    AP_Int32 _script_vm_exec_count;
-    AP_Int32 _script_heap_size;
-    AP_Int8 _debug_level;
-    AP_Int16 _dir_disable;
-
     bool _init_failed;  // true if memory allocation failed
 
+    // the shared VM, set by the scripting thread once it has been
+    // created and read by profile_info() from other threads
+    std::atomic<lua_scripts *> _lua;
+
+#if AP_SCRIPTING_MULTI_VM_ENABLED
+    // run each script in its own VM, returns false if they couldn't be
+    // started
+    bool run_vms(void);
+
+    // a thread running some of the VMs
+    struct vm_worker {
+        lua_scripts **vms;
+        uint8_t count;
+        uint8_t index;
+        void run(void);
+    };
+
+    // _vms is set before _num_vms is, so a reader which loads
+    // _num_vms first sees the VMs it counts
+    lua_scripts **_vms;
+    std::atomic<uint8_t> _num_vms;
+#endif // AP_SCRIPTING_MULTI_VM_ENABLED
+
     static AP_Scripting *_singleton;
 
 };
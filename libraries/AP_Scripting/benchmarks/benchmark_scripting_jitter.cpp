@@ -0,0 +1,219 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Scripting/AP_Scripting.h>
+#include <GCS_MAVLink/GCS_Dummy.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#if defined(ENABLE_SCRIPTING) && AP_SCRIPTING_MULTI_VM_ENABLED
+
+#include <AP_Scripting/lua_scripts.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/*
+  measure how late scripts start against when they were due, for a
+  number of scripts run in one shared VM or each in its own VM spread
+  over a number of threads, as SCR_THREADS does. Each script runs
+  about 0.3ms of lua and three binding calls every 10ms. Lateness is
+  measured by the scheduling profile of each script, the first run of
+  each script isn't counted
+ */
+
+// the scripting parameters the benchmark sets
+class AP_Scripting_Benchmark : public AP_Scripting {
+public:
+    void set_enable(bool enable) { _enable.set(enable); }
+    void set_dir_disable(uint16_t dirs) { _dir_disable.set(dirs); }
+};
+
+// a VM whose scheduling profile can be read back once it has stopped
+class lua_scripts_Benchmark : public lua_scripts {
+public:
+    using lua_scripts::lua_scripts;
+
+    void add_lateness(uint64_t &late_us, uint32_t &max_us, uint32_t &runs) const;
+
+private:
+    static void add_lateness(const lua_profile::script_stats &stats, uint64_t &late_us, uint32_t &max_us, uint32_t &runs);
+};
+
+class AP_Scripting_JitterBenchmark {
+public:
+    AP_Scripting_JitterBenchmark();
+
+    // run num_scripts scripts, in a shared VM if threads is 0
+    void start(uint8_t num_scripts, uint8_t threads);
+    void stop(void);
+
+    // average and most lateness of the scripts in us, and the runs
+    // the average is over
+    void lateness(float &avg_us, uint32_t &max_us, uint32_t &runs) const;
+
+private:
+    AP_Int32 vm_steps;
+    AP_Int32 heap_size;
+    AP_Int8 debug_level;
+    AP_Scripting::terminal_s terminal {};
+
+    lua_scripts **vms;
+    char *names[AP_SCRIPTING_MAX_VMS];
+    uint8_t num_vms;
+    std::vector<std::thread> workers;
+
+    void make_scripts(uint8_t num_scripts);
+};
+
+static AP_Scripting_Benchmark scripting;
+
+AP_Scripting_JitterBenchmark::AP_Scripting_JitterBenchmark()
+{
+    vm_steps.set(100000);
+    heap_size.set(64 * 1024);
+
+    // run in a directory of our own, as the scripts are found in
+    // SCRIPTING_DIRECTORY
+    char dir[] = "/tmp/scrjitterXXXXXX";
+    if (mkdtemp(dir) == nullptr || chdir(dir) != 0) {
+        AP_HAL::panic("failed to make benchmark directory");
+    }
+    scripting.set_dir_disable(uint16_t(AP_Scripting::SCR_DIR::ROMFS));
+}
+
+void AP_Scripting_JitterBenchmark::make_scripts(uint8_t num_scripts)
+{
+    if (system("rm -rf " SCRIPTING_DIRECTORY " && mkdir -p " SCRIPTING_DIRECTORY) != 0) {
+        AP_HAL::panic("failed to make scripts directory");
+    }
+    for (uint8_t i=0; i<num_scripts; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), SCRIPTING_DIRECTORY "/s%02u.lua", (unsigned)i);
+        FILE *f = fopen(path, "w");
+        if (f == nullptr) {
+            AP_HAL::panic("failed to write %s", path);
+        }
+        fprintf(f,
+                "function update()\n"
+                "  local t = {}\n"
+                "  for i=1,1000 do t[i%%16+1] = i*i end\n"
+                "  millis() millis() millis()\n"
+                "  return update, 10\n"
+                "end\n"
+                "return update, 10\n");
+        fclose(f);
+    }
+}
+
+void AP_Scripting_JitterBenchmark::start(uint8_t num_scripts, uint8_t threads)
+{
+    make_scripts(num_scripts);
+    scripting.set_enable(true);
+
+    if (threads == 0) {
+        num_vms = 1;
+        vms = new lua_scripts*[1];
+        vms[0] = new lua_scripts_Benchmark(vm_steps, heap_size, debug_level, terminal);
+        lua_scripts::lock_bindings = false;
+        workers.emplace_back([this]() { vms[0]->run(); });
+        return;
+    }
+
+    num_vms = lua_scripts::find_scripts(names, ARRAY_SIZE(names));
+    vms = new lua_scripts*[num_vms];
+    for (uint8_t i=0; i<num_vms; i++) {
+        vms[i] = new lua_scripts_Benchmark(vm_steps, heap_size, debug_level, terminal, names[i], i == 0);
+    }
+    const uint8_t num_workers = MIN(threads, num_vms);
+    lua_scripts::lock_bindings = num_workers > 1;
+    for (uint8_t i=0; i<num_workers; i++) {
+        const uint8_t first = (i * num_vms) / num_workers;
+        const uint8_t count = (((i + 1) * num_vms) / num_workers) - first;
+        workers.emplace_back([this, first, count, i]() { lua_scripts::run_group(&vms[first], count, i); });
+    }
+}
+
+void AP_Scripting_JitterBenchmark::stop(void)
+{
+    scripting.set_enable(false);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+// the first run of a script is late by however long loading took, so
+// isn't counted
+void lua_scripts_Benchmark::add_lateness(const lua_profile::script_stats &stats, uint64_t &late_us, uint32_t &max_us, uint32_t &runs)
+{
+    late_us += stats.late_us;
+    runs += MAX(stats.runs, 1U) - 1;
+    max_us = MAX(max_us, stats.late_us_max);
+}
+
+void lua_scripts_Benchmark::add_lateness(uint64_t &late_us, uint32_t &max_us, uint32_t &runs) const
+{
+    // the script which last ran is out of the list until it is
+    // rescheduled
+    if (running != nullptr) {
+        add_lateness(running->stats, late_us, max_us, runs);
+    }
+    for (const script_info *script = scripts; script != nullptr; script = script->next) {
+        if (script != running) {
+            add_lateness(script->stats, late_us, max_us, runs);
+        }
+    }
+}
+
+void AP_Scripting_JitterBenchmark::lateness(float &avg_us, uint32_t &max_us, uint32_t &runs) const
+{
+    uint64_t late_us = 0;
+    max_us = 0;
+    runs = 0;
+    for (uint8_t i=0; i<num_vms; i++) {
+        // all the VMs were created as lua_scripts_Benchmark
+        static_cast<const lua_scripts_Benchmark *>(vms[i])->add_lateness(late_us, max_us, runs);
+    }
+    avg_us = runs > 0 ? float(late_us) / runs : 0;
+}
+
+static void BM_ScriptingJitter(benchmark::State& state)
+{
+    AP_Scripting_JitterBenchmark bench;
+    bench.start(state.range_x(), state.range_y());
+    while (state.KeepRunning()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    bench.stop();
+
+    float avg_us;
+    uint32_t max_us;
+    uint32_t runs;
+    bench.lateness(avg_us, max_us, runs);
+    char label[64];
+    snprintf(label, sizeof(label), "late avg %.0fus max %uus over %u runs",
+             (double)avg_us, (unsigned)max_us, (unsigned)runs);
+    state.SetLabel(label);
+}
+
+// arguments are the number of scripts and the number of threads, 0
+// threads is the shared VM
+BENCHMARK(BM_ScriptingJitter)
+    ->ArgPair(1, 0)->ArgPair(1, 1)->ArgPair(1, 4)
+    ->ArgPair(4, 0)->ArgPair(4, 1)->ArgPair(4, 4)
+    ->ArgPair(16, 0)->ArgPair(16, 1)->ArgPair(16, 4)
+    ->UseRealTime();
+
+#endif // ENABLE_SCRIPTING && AP_SCRIPTING_MULTI_VM_ENABLED
+
+const AP_Param::GroupInfo GCS_MAVLINK_Parameters::var_info[] = {
+    AP_GROUPEND
+};
+GCS_Dummy _gcs;
+
+BENCHMARK_MAIN();
@@ -1438,6 +1438,7 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
   const char *access_name = data->alias ? data->alias : data->name;
   // bind ud early if it's a singleton, so that we can use it in the range checks
   fprintf(source, "static int %s_%s(lua_State *L) {\n", data->sanatized_name, method->sanatized_name);
+  fprintf(source, "    SCRIPTING_BINDING_ENTRY(L, \"%s:%s\");\n", access_name, method->alias ? method->alias : method->name);
   // emit comments on expected arg/type
   struct argument *arg = method->arguments;
 
@@ -1645,8 +1646,10 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
         // we need to emit out nullable arguments, iterate the args again, creating and copying objects, while keeping a new count
         arg = method->arguments;
         return_count = emit_references(arg,"        ");
+        fprintf(source, "        SCRIPTING_BINDING_EXIT(L);\n");
         fprintf(source, "        return %d;\n", return_count);
         fprintf(source, "    } else {\n");
+        fprintf(source, "        SCRIPTING_BINDING_EXIT(L);\n");
         fprintf(source, "        return 0;\n");
         fprintf(source, "    }\n");
       } else {
@@ -1678,6 +1681,7 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
       break;
     case TYPE_AP_OBJECT:
       fprintf(source, "    if (data == NULL) {\n");
+      fprintf(source, "        SCRIPTING_BINDING_EXIT(L);\n");
       fprintf(source, "        return 0;\n");
       fprintf(source, "    }\n");
       fprintf(source, "    new_%s(L);\n", method->return_type.data.ud.sanatized_name);
@@ -1691,6 +1695,7 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
   }
 
   if ((method->return_type.type != TYPE_BOOLEAN) || ((method->flags & TYPE_FLAGS_NULLABLE) == 0)) {
+      fprintf(source, "    SCRIPTING_BINDING_EXIT(L);\n");
       fprintf(source, "    return %d;\n", return_count);
   }
 
@@ -2090,6 +2095,7 @@ int main(int argc, char **argv) {
 
   fprintf(source, "#include \"lua_generated_bindings.h\"\n");
   fprintf(source, "#include <AP_Scripting/lua_boxed_numerics.h>\n");
+  fprintf(source, "#include <AP_Scripting/lua_scripts.h>\n");
 
   trace(TRACE_GENERAL, "Starting emission");
 
@@ -6,6 +6,7 @@
 #include "lua_bindings.h"
 
 #include "lua_boxed_numerics.h"
+#include "lua_scripts.h"
 #include <AP_Scripting/lua_generated_bindings.h>
 
 #include <AP_Scripting/AP_Scripting.h>
@@ -29,31 +30,37 @@ int check_arguments(lua_State *L, int expected_arguments, const char *fn_name) {
 
 // millis
 static int lua_millis(lua_State *L) {
+    SCRIPTING_BINDING_ENTRY(L, "millis");
     check_arguments(L, 0, "millis");
 
     new_uint32_t(L);
     *check_uint32_t(L, -1) = AP_HAL::millis();
 
+    SCRIPTING_BINDING_EXIT(L);
     return 1;
 }
 
 // micros
 static int lua_micros(lua_State *L) {
+    SCRIPTING_BINDING_ENTRY(L, "micros");
     check_arguments(L, 0, "micros");
 
     new_uint32_t(L);
     *check_uint32_t(L, -1) = AP_HAL::micros();
 
+    SCRIPTING_BINDING_EXIT(L);
     return 1;
 }
 
 static int lua_mission_receive(lua_State *L) {
+    SCRIPTING_BINDING_ENTRY(L, "mission_receive");
     check_arguments(L, 0, "mission_receive");
 
     ObjectBuffer<struct AP_Scripting::scripting_mission_cmd> *input = AP::scripting()->mission_data;
 
     if (input == nullptr) {
         // no mission items ever received
+        SCRIPTING_BINDING_EXIT(L);
         return 0;
     }
 
@@ -61,6 +68,7 @@ static int lua_mission_receive(lua_State *L) {
 
     if (!input->pop(cmd)) {
         // no new item
+        SCRIPTING_BINDING_EXIT(L);
         return 0;
     }
 
@@ -72,6 +80,7 @@ static int lua_mission_receive(lua_State *L) {
     lua_pushnumber(L, cmd.content_p2);
     lua_pushnumber(L, cmd.content_p3);
 
+    SCRIPTING_BINDING_EXIT(L);
     return 5;
 }
 
@@ -84,6 +93,7 @@ static const luaL_Reg global_functions[] =
 };
 
 static int AP_Logger_Write(lua_State *L) {
+    SCRIPTING_BINDING_ENTRY(L, "logger:write");
     AP_Logger * AP_logger = AP_Logger::get_singleton();
     if (AP_logger == nullptr) {
         return luaL_argerror(L, 1, "logger not supported on this firmware");
@@ -273,6 +283,7 @@ static int AP_Logger_Write(lua_State *L) {
     luaL_pushresult(&buffer);
     AP_logger->WriteBlock(buffer.b,msg_len);
 
+    SCRIPTING_BINDING_EXIT(L);
     return 0;
 }
 
@@ -282,6 +293,7 @@ const luaL_Reg AP_Logger_functions[] = {
 };
 
 static int lua_get_i2c_device(lua_State *L) {
+    SCRIPTING_BINDING_ENTRY(L, "i2c:get_device");
 
     const int args = lua_gettop(L);
     if (args < 2) {
@@ -332,6 +344,7 @@ static int lua_get_i2c_device(lua_State *L) {
 
     AP::scripting()->num_i2c_devices++;
 
+    SCRIPTING_BINDING_EXIT(L);
     return 1;
 }
 
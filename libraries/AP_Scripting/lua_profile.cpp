@@ -0,0 +1,101 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lua_profile.h"
+
+#include <AP_Common/ExpandingString.h>
+#include <AP_Logger/AP_Logger.h>
+
+lua_profile::binding_stats lua_profile::bindings[AP_SCRIPTING_PROFILE_NUM_BINDINGS];
+
+void lua_profile::binding_call(const char *name, uint32_t us)
+{
+    // find the binding, or the entry with the least time to replace
+    uint8_t idx = 0;
+    for (uint8_t i=0; i<AP_SCRIPTING_PROFILE_NUM_BINDINGS; i++) {
+        if (bindings[i].name == name) {
+            idx = i;
+            break;
+        }
+        if (bindings[i].total_us < bindings[idx].total_us) {
+            idx = i;
+        }
+    }
+
+    binding_stats &b = bindings[idx];
+    if (b.name != name) {
+        b.name = name;
+        b.calls = 0;
+        b.logged_calls = 0;
+        b.max_us = 0;
+        b.total_us = 0;
+    }
+    b.calls++;
+    b.max_us = MAX(b.max_us, us);
+    b.total_us += us;
+}
+
+void lua_profile::log_bindings(void)
+{
+#if HAL_LOGGING_ENABLED
+    const uint64_t now_us = AP_HAL::micros64();
+    for (binding_stats &b : bindings) {
+        if (b.name == nullptr || b.calls == b.logged_calls) {
+            continue;
+        }
+        b.logged_calls = b.calls;
+// @LoggerMessage: SCRB
+// @Description: Scripting binding profile, for the bindings with the most time
+// @Field: TimeUS: Time since system startup
+// @Field: Name: binding name
+// @Field: Calls: number of calls
+// @Field: TotUS: total time spent in the binding
+// @Field: MaxUS: longest call of the binding
+        AP::logger().Write("SCRB", "TimeUS,Name,Calls,TotUS,MaxUS", "s--ss", "F--FF", "QZIQI",
+                           now_us,
+                           b.name,
+                           b.calls,
+                           b.total_us,
+                           b.max_us);
+    }
+#endif
+}
+
+void lua_profile::binding_info(ExpandingString &str)
+{
+    // sort a copy, hottest first
+    binding_stats sorted[AP_SCRIPTING_PROFILE_NUM_BINDINGS];
+    uint8_t count = 0;
+    for (const binding_stats &b : bindings) {
+        if (b.name == nullptr) {
+            continue;
+        }
+        uint8_t i = count++;
+        for (; i > 0 && sorted[i-1].total_us < b.total_us; i--) {
+            sorted[i] = sorted[i-1];
+        }
+        sorted[i] = b;
+    }
+
+    for (uint8_t i=0; i<count; i++) {
+        const binding_stats &b = sorted[i];
+        str.printf("%-40.40s CALLS=%8u TOT=%8ums AVG=%5uus MAX=%5uus\n",
+                   b.name,
+                   (unsigned)b.calls,
+                   (unsigned)(b.total_us / 1000U),
+                   (unsigned)(b.calls > 0 ? b.total_us / b.calls : 0),
+                   (unsigned)b.max_us);
+    }
+}
@@ -0,0 +1,76 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  profiling of scripts and of the bindings they call
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL.h>
+
+// time the calls scripts make to bindings. This adds a little to
+// every binding call, so is only on by default on boards with plenty
+// of memory and CPU
+#ifndef AP_SCRIPTING_PROFILE_BINDINGS_ENABLED
+  #define AP_SCRIPTING_PROFILE_BINDINGS_ENABLED (HAL_MEM_CLASS >= HAL_MEM_CLASS_500)
+#endif // AP_SCRIPTING_PROFILE_BINDINGS_ENABLED
+
+// number of bindings the binding profiler keeps. Once more bindings
+// than this have been called the one with the least time is replaced
+#ifndef AP_SCRIPTING_PROFILE_NUM_BINDINGS
+  #define AP_SCRIPTING_PROFILE_NUM_BINDINGS 16
+#endif // AP_SCRIPTING_PROFILE_NUM_BINDINGS
+
+class ExpandingString;
+
+class lua_profile {
+public:
+    // accounting for one script, totals since it was loaded
+    struct script_stats {
+        uint32_t runs;
+        uint64_t run_us;
+        uint32_t run_us_max;
+        uint64_t vm_steps;
+        uint32_t vm_steps_max;
+        uint64_t alloc_bytes;
+        uint64_t free_bytes;
+        uint64_t gc_us;
+        uint64_t binding_us;
+        uint64_t late_us;
+        uint32_t late_us_max;
+    };
+
+    // a call of the binding name took us microseconds. name must be a
+    // string literal, bindings are told apart by its address
+    static void binding_call(const char *name, uint32_t us);
+
+    // log the bindings which have been called since they were last logged
+    static void log_bindings(void);
+
+    // print the binding table, hottest first. The binding table is
+    // shared by all VMs, so all three are called with
+    // lua_scripts::binding_sem held
+    static void binding_info(ExpandingString &str);
+
+private:
+    struct binding_stats {
+        const char *name;
+        uint32_t calls;
+        uint32_t logged_calls;
+        uint32_t max_us;
+        uint64_t total_us;
+    };
+
+    static binding_stats bindings[AP_SCRIPTING_PROFILE_NUM_BINDINGS];
+};
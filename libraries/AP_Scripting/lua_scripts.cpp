@@ -19,21 +19,39 @@
 #include "AP_Scripting.h"
 
 #include <AP_Scripting/lua_generated_bindings.h>
+#include <AP_Logger/AP_Logger.h>
+#include <AP_Math/crc.h>
+#include <AP_Common/ExpandingString.h>
+#include <AP_Common/AP_FWVersion.h>
+
+extern "C" {
+#include "lua/src/lstate.h"
+}
+
+#if AP_SCRIPTING_BYTECODE_CACHE
+#define SCRIPT_CACHE_MAGIC 0x43415041 // "APAC"
+#define SCRIPT_CACHE_NAME_MAX 128
+#endif
 
 extern const AP_HAL::HAL& hal;
 
-bool lua_scripts::overtime;
-jmp_buf lua_scripts::panic_jmp;
+HAL_Semaphore lua_scripts::binding_sem;
+#if AP_SCRIPTING_MULTI_VM_ENABLED
+bool lua_scripts::lock_bindings;
+#endif // AP_SCRIPTING_MULTI_VM_ENABLED
 
-lua_scripts::lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, const AP_Int8 &debug_level, struct AP_Scripting::terminal_s &_terminal)
-    : _vm_steps(vm_steps),
+lua_scripts::lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, const AP_Int8 &debug_level, struct AP_Scripting::terminal_s &_terminal,
+                         const char *filename, bool repl)
+    : _filename(filename),
+      _repl(repl),
+      _vm_steps(vm_steps),
       _debug_level(debug_level),
      terminal(_terminal) {
     _heap = hal.util->allocate_heap_memory(heap_size);
 }
 
 void lua_scripts::hook(lua_State *L, lua_Debug *ar) {
-    lua_scripts::overtime = true;
+    get_vm(L)->overtime = true;
 
     // we need to aggressively bail out as we are over time
     // so we will aggressively trap errors until we clear out
@@ -46,33 +64,427 @@ int lua_scripts::atpanic(lua_State *L) {
     gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Panic: %s", lua_tostring(L, -1));
     hal.console->printf("Lua: Panic: %s\n", lua_tostring(L, -1));
     printf("Lua: Panic: %s\n", lua_tostring(L, -1));
-    longjmp(panic_jmp, 1);
+    longjmp(get_vm(L)->panic_jmp, 1);
     return 0;
 }
 
-lua_scripts::script_info *lua_scripts::load_script(lua_State *L, char *filename) {
-    if (int error = luaL_loadfile(L, filename)) {
-        switch (error) {
-            case LUA_ERRSYNTAX:
-                gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Syntax error in %s", filename);
-                gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Error: %s", lua_tostring(L, -1));
-                lua_pop(L, lua_gettop(L));
-                return nullptr;
-            case LUA_ERRMEM:
-                gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Insufficent memory loading %s", filename);
-                lua_pop(L, lua_gettop(L));
-                return nullptr;
-            case LUA_ERRFILE:
-                gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Unable to load the file: %s", lua_tostring(L, -1));
-                hal.console->printf("Lua: File error: %s\n", lua_tostring(L, -1));
-                lua_pop(L, lua_gettop(L));
-                return nullptr;
-            default:
-                gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Unknown error (%d) loading %s", error, filename);
-                lua_pop(L, lua_gettop(L));
-                return nullptr;
+#if AP_SCRIPTING_BYTECODE_CACHE
+bool lua_scripts::cache_key(const char *filename, struct cache_header &key) {
+    struct stat st;
+    if (AP::FS().stat(filename, &st) != 0) {
+        return false;
+    }
+    const int fd = AP::FS().open(filename, O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    uint8_t buf[128];
+    uint32_t crc = 0;
+    uint32_t length = 0;
+    int32_t n;
+    while ((n = AP::FS().read(fd, buf, sizeof(buf))) > 0) {
+        crc = crc_crc32(crc, buf, n);
+        length += n;
+    }
+    AP::FS().close(fd);
+    if (n < 0 || length != (uint32_t)st.st_size) {
+        return false;
+    }
+    memset(&key, 0, sizeof(key));
+    key.magic = SCRIPT_CACHE_MAGIC;
+    key.lua_version = LUA_VERSION_NUM;
+    key.header_size = sizeof(key);
+    // the bytecode format and the bindings it calls can change between
+    // builds without LUA_VERSION_NUM changing
+    const char *fw_hash = AP::fwversion().fw_hash_str;
+    if (fw_hash != nullptr) {
+        strncpy_noterm(key.fw_hash, fw_hash, sizeof(key.fw_hash));
+    }
+    key.source_size = length;
+    key.source_mtime = st.st_mtime;
+    key.source_crc = crc;
+    return true;
+}
+
+namespace {
+struct cache_reader {
+    int fd;
+    uint32_t remaining;
+    char buf[128];
+};
+
+struct cache_writer {
+    int fd;
+    uint32_t length;
+    uint32_t crc;
+};
+}
+
+static const char *read_cache(lua_State *L, void *data, size_t *size) {
+    (void)L;
+    cache_reader *reader = (cache_reader *)data;
+    const int32_t n = AP::FS().read(reader->fd, reader->buf, MIN(reader->remaining, sizeof(reader->buf)));
+    if (n <= 0) {
+        *size = 0;
+        return nullptr;
+    }
+    reader->remaining -= n;
+    *size = n;
+    return reader->buf;
+}
+
+static int write_cache_data(lua_State *L, const void *p, size_t sz, void *data) {
+    (void)L;
+    cache_writer *writer = (cache_writer *)data;
+    if (AP::FS().write(writer->fd, p, sz) != (int32_t)sz) {
+        return 1;
+    }
+    writer->crc = crc_crc32(writer->crc, (const uint8_t *)p, sz);
+    writer->length += sz;
+    return 0;
+}
+
+bool lua_scripts::load_cached(lua_State *L, const char *cache_name, const struct cache_header &key) {
+    const int fd = AP::FS().open(cache_name, O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct cache_header header;
+    cache_reader reader;
+    reader.fd = fd;
+    if (AP::FS().read(fd, &header, sizeof(header)) != sizeof(header) ||
+        memcmp(&header, &key, offsetof(cache_header, code_length)) != 0) {
+        AP::FS().close(fd);
+        return false;
+    }
+
+    // check the bytecode before handing it to lua, which doesn't
+    // validate binary chunks
+    uint32_t crc = 0;
+    uint32_t length = 0;
+    int32_t n;
+    while ((n = AP::FS().read(fd, reader.buf, sizeof(reader.buf))) > 0) {
+        crc = crc_crc32(crc, (const uint8_t *)reader.buf, n);
+        length += n;
+    }
+    if (n < 0 || length != header.code_length || crc != header.code_crc ||
+        AP::FS().lseek(fd, sizeof(header), SEEK_SET) != sizeof(header)) {
+        AP::FS().close(fd);
+        return false;
+    }
+
+    reader.remaining = header.code_length;
+    const int error = lua_load(L, read_cache, &reader, cache_name, "b");
+    AP::FS().close(fd);
+    if (error != LUA_OK) {
+        lua_pop(L, 1);
+        return false;
+    }
+    return true;
+}
+
+void lua_scripts::write_cache(lua_State *L, const char *cache_name, struct cache_header &key) {
+    const int fd = AP::FS().open(cache_name, O_WRONLY|O_CREAT|O_TRUNC);
+    if (fd == -1) {
+        return;
+    }
+    // the header is written last, so an interrupted write leaves a
+    // cache which won't be used
+    struct cache_header header {};
+    cache_writer writer { fd, 0, 0 };
+    bool ok = AP::FS().write(fd, &header, sizeof(header)) == sizeof(header) &&
+              lua_dump(L, write_cache_data, &writer, 0) == 0;
+    if (ok) {
+        key.code_length = writer.length;
+        key.code_crc = writer.crc;
+        ok = AP::FS().lseek(fd, 0, SEEK_SET) == 0 &&
+             AP::FS().write(fd, &key, sizeof(key)) == sizeof(key);
+    }
+    AP::FS().close(fd);
+    if (!ok) {
+        AP::FS().unlink(cache_name);
+    }
+}
+
+bool lua_scripts::is_stale_cache(const char *dirname, const char *name) {
+    const size_t length = strlen(name);
+    if (length < 6 || strcmp(&name[length-5], ".luac") != 0) {
+        return false;
+    }
+    char script_name[SCRIPT_CACHE_NAME_MAX];
+    const int n = snprintf(script_name, sizeof(script_name), "%s/%s", dirname, name);
+    if (n <= 0 || n >= (int)sizeof(script_name)) {
+        return false;
+    }
+    // foo.luac belongs to foo.lua
+    script_name[n-1] = 0;
+    struct stat st;
+    return AP::FS().stat(script_name, &st) != 0;
+}
+
+void lua_scripts::remove_stale_caches(const char *dirname) {
+    auto *d = AP::FS().opendir(dirname);
+    if (d == nullptr) {
+        return;
+    }
+    // collect the names first, removing entries while reading the
+    // directory can skip or repeat entries on some filesystems
+    struct stale_cache {
+        stale_cache *next;
+        char *name;
+    } *stale = nullptr;
+    for (struct dirent *de=AP::FS().readdir(d); de; de=AP::FS().readdir(d)) {
+        if (!is_stale_cache(dirname, de->d_name)) {
+            continue;
+        }
+        stale_cache *entry = (stale_cache *)calloc(1, sizeof(stale_cache));
+        if (entry == nullptr) {
+            break;
+        }
+        if (asprintf(&entry->name, "%s/%s", dirname, de->d_name) <= 0) {
+            free(entry);
+            break;
+        }
+        entry->next = stale;
+        stale = entry;
+    }
+    AP::FS().closedir(d);
+
+    while (stale != nullptr) {
+        stale_cache *next = stale->next;
+        AP::FS().unlink(stale->name);
+        free(stale->name);
+        free(stale);
+        stale = next;
+    }
+}
+#endif // AP_SCRIPTING_BYTECODE_CACHE
+
+// the file name of a script without its directory
+static const char *script_name(const char *filename) {
+    const char *name = strrchr(filename, '/');
+    return (name == nullptr) ? filename : name + 1;
+}
+
+void lua_scripts::log_load(const char *filename, bool cached, uint32_t load_us, int32_t mem, uint32_t peak_mem) {
+    const char *name = script_name(filename);
+
+    if (_debug_level > 0) {
+        gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: Loaded %s%s in %u us, mem %d peak %u",
+                        name, cached ? " (cached)" : "",
+                        (unsigned int)load_us, (int)mem, (unsigned int)peak_mem);
+    }
+
+#if HAL_LOGGING_ENABLED
+// @LoggerMessage: SCRL
+// @Description: Scripting script load
+// @Field: TimeUS: Time since system startup
+// @Field: Name: script file name
+// @Field: Cache: 1 if the script was loaded from its precompiled bytecode cache
+// @Field: LoadUS: time taken to load the script
+// @Field: Mem: change in scripting heap used from loading the script
+// @Field: Peak: most scripting heap used while loading the script
+    AP::logger().Write("SCRL", "TimeUS,Name,Cache,LoadUS,Mem,Peak", "s--sbb", "F--F--", "QNBIiI",
+                       AP_HAL::micros64(),
+                       name,
+                       (uint8_t)cached,
+                       load_us,
+                       mem,
+                       peak_mem);
+#endif
+}
+
+void lua_scripts::log_profile(void) {
+#if HAL_LOGGING_ENABLED
+    const uint64_t now_us = AP_HAL::micros64();
+    for (const script_info *script = scripts; script != nullptr; script = script->next) {
+        const lua_profile::script_stats &stats = script->stats;
+// @LoggerMessage: SCRP
+// @Description: Scripting script profile, totals since the script was loaded
+// @Field: TimeUS: Time since system startup
+// @Field: Name: script file name
+// @Field: Runs: number of times the script has run
+// @Field: RunUS: total run time
+// @Field: MaxUS: longest run
+// @Field: Insn: total VM instructions executed
+// @Field: MaxInsn: most VM instructions executed in one run
+// @Field: Alloc: total bytes allocated
+// @Field: Free: total bytes freed
+// @Field: GCUS: total time collecting garbage after the script ran
+// @Field: BindUS: total time in binding calls
+        AP::logger().Write("SCRP", "TimeUS,Name,Runs,RunUS,MaxUS,Insn,MaxInsn,Alloc,Free,GCUS,BindUS",
+                           "s--ss--bbss", "F--FF----FF", "QNIQIQIQQQQ",
+                           now_us,
+                           script_name(script->name),
+                           stats.runs,
+                           stats.run_us,
+                           stats.run_us_max,
+                           stats.vm_steps,
+                           stats.vm_steps_max,
+                           stats.alloc_bytes,
+                           stats.free_bytes,
+                           stats.gc_us,
+                           stats.binding_us);
+// @LoggerMessage: SCRJ
+// @Description: Scripting scheduling jitter, how late scripts start after they are due
+// @Field: TimeUS: Time since system startup
+// @Field: Name: script file name
+// @Field: Thr: scripting thread running the script
+// @Field: Late: average time the script started after it was due
+// @Field: MaxLate: most a run has started after it was due
+        AP::logger().Write("SCRJ", "TimeUS,Name,Thr,Late,MaxLate", "s--ss", "F--FF", "QNBII",
+                           now_us,
+                           script_name(script->name),
+                           _thread,
+                           (uint32_t)(stats.late_us / MAX(stats.runs, 1U)),
+                           stats.late_us_max);
+    }
+
+    // one VM logs the bindings for all of them
+    if (_repl) {
+        WITH_SEMAPHORE(binding_sem);
+        lua_profile::log_bindings();
+    }
+#endif
+}
+
+static void print_profile(ExpandingString &str, const char *filename, uint8_t thread, const lua_profile::script_stats &stats) {
+    const uint32_t runs = MAX(stats.runs, 1U);
+    str.printf("%-24.24s THR=%u RUNS=%6u AVG=%5uus MAX=%5uus INSN=%7u MAXINSN=%7u ALLOC=%7uKB FREE=%7uKB GC=%6ums BIND=%6ums LATE=%5uus MAXLATE=%6uus\n",
+               script_name(filename),
+               (unsigned)thread,
+               (unsigned)stats.runs,
+               (unsigned)(stats.run_us / runs),
+               (unsigned)stats.run_us_max,
+               (unsigned)(stats.vm_steps / runs),
+               (unsigned)stats.vm_steps_max,
+               (unsigned)(stats.alloc_bytes / 1024U),
+               (unsigned)(stats.free_bytes / 1024U),
+               (unsigned)(stats.gc_us / 1000U),
+               (unsigned)(stats.binding_us / 1000U),
+               (unsigned)(stats.late_us / runs),
+               (unsigned)stats.late_us_max);
+}
+
+void lua_scripts::profile_info(ExpandingString &str) {
+    WITH_SEMAPHORE(_scripts_sem);
+    // the running script is out of the list until it is rescheduled
+    if (running != nullptr) {
+        print_profile(str, running->name, _thread, running->stats);
+    }
+    for (const script_info *script = scripts; script != nullptr; script = script->next) {
+        if (script != running) {
+            print_profile(str, script->name, _thread, script->stats);
         }
     }
+}
+
+void lua_scripts::binding_info(ExpandingString &str) {
+    WITH_SEMAPHORE(binding_sem);
+    lua_profile::binding_info(str);
+}
+
+uint32_t lua_scripts::binding_entry(lua_State *L)
+{
+#if AP_SCRIPTING_MULTI_VM_ENABLED
+    if (lock_bindings) {
+        binding_sem.take_blocking();
+        get_vm(L)->binding_sem_count++;
+    }
+#else
+    (void)L;
+#endif
+#if AP_SCRIPTING_PROFILE_BINDINGS_ENABLED
+    return AP_HAL::micros();
+#else
+    return 0;
+#endif
+}
+
+void lua_scripts::binding_exit(lua_State *L, const char *name, uint32_t start_us)
+{
+    lua_scripts *vm = get_vm(L);
+#if AP_SCRIPTING_PROFILE_BINDINGS_ENABLED
+    const uint32_t us = AP_HAL::micros() - start_us;
+    if (vm->running != nullptr) {
+        vm->running->stats.binding_us += us;
+    }
+    {
+        // already held if lock_bindings is set, the semaphore is recursive
+        WITH_SEMAPHORE(binding_sem);
+        lua_profile::binding_call(name, us);
+    }
+#else
+    (void)name;
+    (void)start_us;
+#endif
+#if AP_SCRIPTING_MULTI_VM_ENABLED
+    if (lock_bindings) {
+        vm->binding_sem_count--;
+        binding_sem.give();
+    }
+#else
+    (void)vm;
+#endif
+}
+
+void lua_scripts::release_bindings(void) {
+#if AP_SCRIPTING_MULTI_VM_ENABLED
+    for (; binding_sem_count > 0; binding_sem_count--) {
+        binding_sem.give();
+    }
+#endif
+}
+
+lua_scripts::script_info *lua_scripts::load_script(lua_State *L, char *filename, bool use_cache) {
+    const uint32_t start_us = AP_HAL::micros();
+    const uint32_t start_mem = heap_used;
+    heap_peak = heap_used;
+    bool cached = false;
+
+#if AP_SCRIPTING_BYTECODE_CACHE
+    char cache_name[SCRIPT_CACHE_NAME_MAX];
+    struct cache_header key;
+    if (use_cache) {
+        const int n = snprintf(cache_name, sizeof(cache_name), "%sc", filename);
+        use_cache = n > 0 && n < (int)sizeof(cache_name) && cache_key(filename, key);
+    }
+    if (use_cache) {
+        cached = load_cached(L, cache_name, key);
+    }
+#else
+    (void)use_cache;
+#endif // AP_SCRIPTING_BYTECODE_CACHE
+
+    if (!cached) {
+        if (int error = luaL_loadfile(L, filename)) {
+            switch (error) {
+                case LUA_ERRSYNTAX:
+                    gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Syntax error in %s", filename);
+                    gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Error: %s", lua_tostring(L, -1));
+                    lua_pop(L, lua_gettop(L));
+                    return nullptr;
+                case LUA_ERRMEM:
+                    gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Insufficent memory loading %s", filename);
+                    lua_pop(L, lua_gettop(L));
+                    return nullptr;
+                case LUA_ERRFILE:
+                    gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Unable to load the file: %s", lua_tostring(L, -1));
+                    hal.console->printf("Lua: File error: %s\n", lua_tostring(L, -1));
+                    lua_pop(L, lua_gettop(L));
+                    return nullptr;
+                default:
+                    gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Unknown error (%d) loading %s", error, filename);
+                    lua_pop(L, lua_gettop(L));
+                    return nullptr;
+            }
+        }
+#if AP_SCRIPTING_BYTECODE_CACHE
+        if (use_cache) {
+            write_cache(L, cache_name, key);
+        }
+#endif // AP_SCRIPTING_BYTECODE_CACHE
+    }
 
     script_info *new_script = (script_info *)hal.util->heap_realloc(_heap, nullptr, sizeof(script_info));
     if (new_script == nullptr) {
@@ -84,6 +496,7 @@ lua_scripts::script_info *lua_scripts::load_script(lua_State *L, char *filename)
 
     new_script->name = filename;
     new_script->next = nullptr;
+    memset(&new_script->stats, 0, sizeof(new_script->stats));
 
     create_sandbox(L);
     lua_setupvalue(L, -2, 1);
@@ -91,6 +504,8 @@ lua_scripts::script_info *lua_scripts::load_script(lua_State *L, char *filename)
     new_script->lua_ref = luaL_ref(L, LUA_REGISTRYINDEX);   // cache the reference
     new_script->next_run_ms = AP_HAL::millis64() - 1; // force the script to be stale
 
+    log_load(filename, cached, AP_HAL::micros() - start_us, (int32_t)(heap_used - start_mem), heap_peak - start_mem);
+
     return new_script;
 }
 
@@ -122,22 +537,22 @@ void lua_scripts::load_all_scripts_in_dir(lua_State *L, const char *dirname) {
         return;
     }
 
+    // scripts in ROMFS can't have a cache alongside them
+    const bool use_cache = strncmp(dirname, "@ROMFS", 6) != 0;
+#if AP_SCRIPTING_BYTECODE_CACHE
+    if (use_cache) {
+        remove_stale_caches(dirname);
+    }
+#endif
+
     auto *d = AP::FS().opendir(dirname);
     if (d == nullptr) {
         gcs().send_text(MAV_SEVERITY_INFO, "Lua: open directory (%s) failed", dirname);
         return;
     }
 
-    // load anything that ends in .lua
     for (struct dirent *de=AP::FS().readdir(d); de; de=AP::FS().readdir(d)) {
-        uint8_t length = strlen(de->d_name);
-        if (length < 5) {
-            // not long enough
-            continue;
-        }
-
-        if (strncmp(&de->d_name[length-4], ".lua", 4)) {
-            // doesn't end in .lua
+        if (!is_script(de->d_name)) {
             continue;
         }
 
@@ -150,16 +565,76 @@ void lua_scripts::load_all_scripts_in_dir(lua_State *L, const char *dirname) {
         snprintf(filename, size, "%s/%s", dirname, de->d_name);
 
         // we have something that looks like a lua file, attempt to load it
-        script_info * script = load_script(L, filename);
-        if (script == nullptr) {
-            hal.util->heap_realloc(_heap, filename, 0);
+        load_file(L, filename, use_cache);
+    }
+    AP::FS().closedir(d);
+}
+
+void lua_scripts::load_file(lua_State *L, char *filename, bool use_cache) {
+    script_info * script = load_script(L, filename, use_cache);
+    if (script == nullptr) {
+        hal.util->heap_realloc(_heap, filename, 0);
+        return;
+    }
+    reschedule_script(script);
+}
+
+bool lua_scripts::is_script(const char *name) {
+    // load anything that ends in .lua
+    uint8_t length = strlen(name);
+    if (length < 5) {
+        // not long enough
+        return false;
+    }
+
+    // doesn't end in .lua
+    return strncmp(&name[length-4], ".lua", 4) == 0;
+}
+
+#if AP_SCRIPTING_MULTI_VM_ENABLED
+uint8_t lua_scripts::find_scripts(char *names[], uint8_t max) {
+    const uint16_t dir_disable = AP_Scripting::get_singleton()->get_disabled_dir();
+    const struct {
+        AP_Scripting::SCR_DIR dir;
+        const char *name;
+    } dirs[] {
+        { AP_Scripting::SCR_DIR::SCRIPTS, SCRIPTING_DIRECTORY },
+        { AP_Scripting::SCR_DIR::ROMFS, "@ROMFS/scripts" },
+    };
+
+    uint8_t count = 0;
+    for (const auto &dir : dirs) {
+        if ((dir_disable & uint16_t(dir.dir)) != 0) {
             continue;
         }
-        reschedule_script(script);
-
+#if AP_SCRIPTING_BYTECODE_CACHE
+        if (dir.dir != AP_Scripting::SCR_DIR::ROMFS) {
+            remove_stale_caches(dir.name);
+        }
+#endif
+        auto *d = AP::FS().opendir(dir.name);
+        if (d == nullptr) {
+            gcs().send_text(MAV_SEVERITY_INFO, "Lua: open directory (%s) failed", dir.name);
+            continue;
+        }
+        for (struct dirent *de=AP::FS().readdir(d); de; de=AP::FS().readdir(d)) {
+            if (!is_script(de->d_name)) {
+                continue;
+            }
+            if (count == max) {
+                gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Too many scripts, %s not loaded", de->d_name);
+                continue;
+            }
+            char *filename = nullptr;
+            if (asprintf(&filename, "%s/%s", dir.name, de->d_name) > 0) {
+                names[count++] = filename;
+            }
+        }
+        AP::FS().closedir(d);
     }
-    AP::FS().closedir(d);
+    return count;
 }
+#endif // AP_SCRIPTING_MULTI_VM_ENABLED
 
 void lua_scripts::reset_loop_overtime(lua_State *L) {
     overtime = false;
@@ -178,8 +653,24 @@ void lua_scripts::run_next_script(lua_State *L) {
 
     uint64_t start_time_ms = AP_HAL::millis64();
     // strip the selected script out of the list
-    script_info *script = scripts;
-    scripts = script->next;
+    script_info *script;
+    {
+        WITH_SEMAPHORE(_scripts_sem);
+        script = scripts;
+        scripts = script->next;
+        running = script;
+    }
+
+    // how late the script is starting. The first run waits for the
+    // other scripts to load, so isn't counted
+    lua_profile::script_stats &stats = script->stats;
+    if (stats.runs > 0) {
+        const uint64_t due_us = script->next_run_ms * 1000U;
+        const uint64_t now_us = AP_HAL::micros64();
+        const uint32_t late_us = now_us > due_us ? now_us - due_us : 0;
+        stats.late_us += late_us;
+        stats.late_us_max = MAX(stats.late_us_max, late_us);
+    }
 
     // reset the hook to clear the counter
     reset_loop_overtime(L);
@@ -190,7 +681,19 @@ void lua_scripts::run_next_script(lua_State *L) {
     // pop the function to the top of the stack
     lua_rawgeti(L, LUA_REGISTRYINDEX, script->lua_ref);
 
-    if(lua_pcall(L, 0, LUA_MULTRET, 0)) {
+    const uint32_t start_us = AP_HAL::micros();
+    const int error = lua_pcall(L, 0, LUA_MULTRET, 0);
+
+    // the instruction count hook counts down from the VM step limit
+    const uint32_t run_us = AP_HAL::micros() - start_us;
+    const uint32_t vm_steps = overtime ? lua_gethookcount(L) : lua_gethookcount(L) - L->hookcount;
+    stats.runs++;
+    stats.run_us += run_us;
+    stats.run_us_max = MAX(stats.run_us_max, run_us);
+    stats.vm_steps += vm_steps;
+    stats.vm_steps_max = MAX(stats.vm_steps_max, vm_steps);
+
+    if (error) {
         if (overtime) {
             // script has consumed an excessive amount of CPU time
             gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: %s exceeded time limit", script->name);
@@ -251,6 +754,17 @@ void lua_scripts::remove_script(lua_State *L, script_info *script) {
         return;
     }
 
+    if (L != nullptr) {
+        // state could be null if we are force killing all scripts
+        luaL_unref(L, LUA_REGISTRYINDEX, script->lua_ref);
+    }
+
+    WITH_SEMAPHORE(_scripts_sem);
+
+    if (running == script) {
+        running = nullptr;
+    }
+
     // ensure that the script isn't in the loaded list for any reason
     if (scripts == nullptr) {
         // nothing to do, already not in the list
@@ -265,10 +779,6 @@ void lua_scripts::remove_script(lua_State *L, script_info *script) {
         }
     }
 
-    if (L != nullptr) {
-        // state could be null if we are force killing all scripts
-        luaL_unref(L, LUA_REGISTRYINDEX, script->lua_ref);
-    }
     hal.util->heap_realloc(_heap, script->name, 0);
     hal.util->heap_realloc(_heap, script, 0);
 }
@@ -281,6 +791,8 @@ void lua_scripts::reschedule_script(script_info *script) {
        return;
     }
 
+    WITH_SEMAPHORE(_scripts_sem);
+
     script->next = nullptr;
     if (scripts == nullptr) {
         scripts = script;
@@ -308,11 +820,33 @@ void lua_scripts::reschedule_script(script_info *script) {
     previous->next = script;
 }
 
-void *lua_scripts::_heap;
-
 void *lua_scripts::alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
-    (void)ud; (void)osize;  /* not used */
-    return hal.util->heap_realloc(_heap, ptr, nsize);
+    lua_scripts *vm = (lua_scripts *)ud;
+    void *ret = hal.util->heap_realloc(vm->_heap, ptr, nsize);
+    // allocations are accounted to the script which last ran, until its
+    // garbage has been collected
+    lua_profile::script_stats *stats = (vm->running != nullptr) ? &vm->running->stats : nullptr;
+    // osize is only the size of the block when ptr is set
+    if (nsize == 0) {
+        if (ptr != nullptr) {
+            vm->heap_used -= osize;
+            if (stats != nullptr) {
+                stats->free_bytes += osize;
+            }
+        }
+    } else if (ret != nullptr) {
+        const size_t old_size = (ptr != nullptr) ? osize : 0;
+        vm->heap_used += nsize - old_size;
+        vm->heap_peak = MAX(vm->heap_peak, vm->heap_used);
+        if (stats == nullptr) {
+            // not accounted
+        } else if (nsize > old_size) {
+            stats->alloc_bytes += nsize - old_size;
+        } else {
+            stats->free_bytes += old_size - nsize;
+        }
+    }
+    return ret;
 }
 
 void lua_scripts::repl_cleanup (void) {
@@ -329,40 +863,70 @@ void lua_scripts::repl_cleanup (void) {
 }
 
 void lua_scripts::run(void) {
-    bool succeeded_initial_load = false;
+    lua_scripts *vm = this;
+    run_group(&vm, 1, 0);
+}
+
+void lua_scripts::run_group(lua_scripts **vms, uint8_t count, uint8_t thread) {
+    for (uint8_t i=0; i<count; i++) {
+        vms[i]->_thread = thread;
+        vms[i]->start();
+    }
+
+    while (AP_Scripting::get_singleton()->enabled()) {
+        lua_scripts *next = nullptr;
+        for (uint8_t i=0; i<count; i++) {
+            lua_scripts *vm = vms[i];
+            if (vm->lua_state != nullptr &&
+                (next == nullptr || vm->next_run_ms() < next->next_run_ms())) {
+                next = vm;
+            }
+        }
+        if (next == nullptr) {
+            // all the VMs have died
+            return;
+        }
+        next->update();
+    }
+}
 
+bool lua_scripts::start(void) {
     if (_heap == nullptr) {
         gcs().send_text(MAV_SEVERITY_INFO, "Lua: Unable to allocate a heap");
-        return;
+        return false;
     }
 
-    // panic should be hooked first
+    // panic should be hooked first, a panic while loading stops the VM
     if (setjmp(panic_jmp)) {
-        if (!succeeded_initial_load) {
-            return;
-        }
-        if (lua_state != nullptr) {
-            lua_close(lua_state); // shutdown the old state
-        }
-        // remove all the old scheduled scripts
-        for (script_info *script = scripts; script != nullptr; script = scripts) {
-            remove_script(nullptr, script);
-        }
-        scripts = nullptr;
-        overtime = false;
-        // end any open REPL sessions
-        repl_cleanup();
+        lua_state = nullptr;
+        return false;
     }
 
-    lua_state = lua_newstate(alloc, NULL);
+    return load_state();
+}
+
+bool lua_scripts::load_state(void) {
+    heap_used = 0;
+    lua_state = lua_newstate(alloc, this);
     lua_State *L = lua_state;
     if (L == nullptr) {
         gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Couldn't allocate a lua state");
-        return;
+        return false;
     }
+    *(lua_scripts **)lua_getextraspace(L) = this;
     lua_atpanic(L, atpanic);
     load_generated_bindings(L);
 
+    const uint32_t load_start_ms = AP_HAL::millis();
+    if (_filename != nullptr) {
+        char *filename = (char *)hal.util->heap_realloc(_heap, nullptr, strlen(_filename) + 1);
+        if (filename != nullptr) {
+            strcpy(filename, _filename);
+            load_file(L, filename, strncmp(filename, "@ROMFS", 6) != 0);
+        }
+        return true;
+    }
+
     // Scan the filesystem in an appropriate manner and autostart scripts
     // Skip those directores disabled with SCR_DIR_DISABLE param
     uint16_t dir_disable = AP_Scripting::get_singleton()->get_disabled_dir();
@@ -377,70 +941,125 @@ void lua_scripts::run(void) {
     }
     if (!loaded) {
         gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: All directory's disabled see SCR_DIR_DISABLE");
+    } else if (_debug_level > 0) {
+        gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: Startup took %u ms, mem %u",
+                        (unsigned int)(AP_HAL::millis() - load_start_ms), (unsigned int)heap_used);
     }
+    return true;
+}
 
-#ifndef __clang_analyzer__
-    succeeded_initial_load = true;
-#endif // __clang_analyzer__
+void lua_scripts::restart(void) {
+    if (lua_state != nullptr) {
+        lua_close(lua_state); // shutdown the old state
+    }
+    // remove all the old scheduled scripts, and the one which was running
+    if (running != nullptr) {
+        remove_script(nullptr, running);
+    }
+    for (script_info *script = scripts; script != nullptr; script = scripts) {
+        remove_script(nullptr, script);
+    }
+    scripts = nullptr;
+    overtime = false;
+    release_bindings();
+    // end any open REPL sessions
+    if (_repl) {
+        repl_cleanup();
+    }
 
-    while (AP_Scripting::get_singleton()->enabled()) {
-        // handle terminal data if we have any
-        if (terminal.session) {
-            doREPL(L);
-            continue;
-        }
+    if (!load_state()) {
+        lua_state = nullptr;
+    }
+}
+
+uint64_t lua_scripts::next_run_ms(void) const {
+    if (_repl && terminal.session) {
+        return 0;
+    }
+    return (scripts != nullptr) ? scripts->next_run_ms : UINT64_MAX;
+}
+
+void lua_scripts::update(void) {
+    // a panic in the state jumps back here, and the scripts are loaded again
+    if (setjmp(panic_jmp)) {
+        restart();
+        return;
+    }
+
+    lua_State *L = lua_state;
+
+    // handle terminal data if we have any
+    if (_repl && terminal.session) {
+        doREPL(L);
+        release_bindings();
+        return;
+    }
 
 #if defined(AP_SCRIPTING_CHECKS) && AP_SCRIPTING_CHECKS >= 1
-        if (lua_gettop(L) != 0) {
-            AP_HAL::panic("Lua: Stack should be empty before running scripts");
-        }
+    if (lua_gettop(L) != 0) {
+        AP_HAL::panic("Lua: Stack should be empty before running scripts");
+    }
 #endif // defined(AP_SCRIPTING_CHECKS) && AP_SCRIPTING_CHECKS >= 1
 
-        if (scripts != nullptr) {
+    if (scripts != nullptr) {
 #if defined(AP_SCRIPTING_CHECKS) && AP_SCRIPTING_CHECKS >= 1
-              // Sanity check that the scripts list is ordered correctly
-              script_info *sanity = scripts;
-              while (sanity->next != nullptr) {
-                  if (sanity->next_run_ms > sanity->next->next_run_ms) {
-                      AP_HAL::panic("Lua: Script tasking order has been violated");
-                  }
-                  sanity = sanity->next;
+          // Sanity check that the scripts list is ordered correctly
+          script_info *sanity = scripts;
+          while (sanity->next != nullptr) {
+              if (sanity->next_run_ms > sanity->next->next_run_ms) {
+                  AP_HAL::panic("Lua: Script tasking order has been violated");
               }
+              sanity = sanity->next;
+          }
 #endif // defined(AP_SCRIPTING_CHECKS) && AP_SCRIPTING_CHECKS >= 1
 
-            // compute delay time
-            uint64_t now_ms = AP_HAL::millis64();
-            if (now_ms < scripts->next_run_ms) {
-                hal.scheduler->delay(scripts->next_run_ms - now_ms);
-            }
+        // compute delay time
+        uint64_t now_ms = AP_HAL::millis64();
+        if (now_ms < scripts->next_run_ms) {
+            hal.scheduler->delay(scripts->next_run_ms - now_ms);
+        }
 
-            if (_debug_level > 1) {
-                gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: Running %s", scripts->name);
-            }
+        if (_debug_level > 1) {
+            gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: Running %s", scripts->name);
+        }
 
-            const int startMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
-            const uint32_t loadEnd = AP_HAL::micros();
+        const int startMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+        const uint32_t loadEnd = AP_HAL::micros();
 
-            run_next_script(L);
+        run_next_script(L);
 
-            const uint32_t runEnd = AP_HAL::micros();
-            const int endMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
-            if (_debug_level > 1) {
-                gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: Time: %u Mem: %d + %d",
-                                                    (unsigned int)(runEnd - loadEnd),
-                                                    (int)endMem,
-                                                    (int)(endMem - startMem));
+        const uint32_t runEnd = AP_HAL::micros();
+        const int endMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+        if (_debug_level > 1) {
+            gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: Time: %u Mem: %d + %d",
+                                                (unsigned int)(runEnd - loadEnd),
+                                                (int)endMem,
+                                                (int)(endMem - startMem));
+        }
+
+        // garbage collect after each script, this shouldn't matter, but seems to resolve a memory leak
+        const uint32_t gc_start_us = AP_HAL::micros();
+        lua_gc(L, LUA_GCCOLLECT, 0);
+        {
+            WITH_SEMAPHORE(_scripts_sem);
+            if (running != nullptr) {
+                running->stats.gc_us += AP_HAL::micros() - gc_start_us;
+                running = nullptr;
             }
+        }
 
-            // garbage collect after each script, this shouldn't matter, but seems to resolve a memory leak
-            lua_gc(L, LUA_GCCOLLECT, 0);
+        // give back the binding lock if a binding raised an error
+        release_bindings();
 
-        } else {
-            if (_debug_level > 0) {
-                gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: No scripts to run");
-            }
-            hal.scheduler->delay(1000);
+        if (AP_HAL::millis() - last_profile_log_ms >= 1000) {
+            last_profile_log_ms = AP_HAL::millis();
+            log_profile();
         }
 
+    } else {
+        if (_debug_level > 0) {
+            gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: No scripts to run");
+        }
+        hal.scheduler->delay(1000);
     }
 }
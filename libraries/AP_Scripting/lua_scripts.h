@@ -20,6 +20,7 @@
 
 #include <AP_Filesystem/posix_compat.h>
 #include "lua_bindings.h"
+#include "lua_profile.h"
 #include <AP_Scripting/AP_Scripting.h>
 
 #ifndef REPL_DIRECTORY
@@ -38,6 +39,10 @@
   #endif //HAL_OS_FATFS_IO
 #endif // SCRIPTING_DIRECTORY
 
+#ifndef AP_SCRIPTING_BYTECODE_CACHE
+  #define AP_SCRIPTING_BYTECODE_CACHE 1
+#endif // AP_SCRIPTING_BYTECODE_CACHE
+
 #ifndef REPL_IN
   #define REPL_IN REPL_DIRECTORY "/in"
 #endif // REPL_IN
@@ -49,7 +54,11 @@
 class lua_scripts
 {
 public:
-    lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, const AP_Int8 &debug_level, struct AP_Scripting::terminal_s &_terminal);
+    // with a filename only that script is run in this VM, otherwise it
+    // runs all the scripts found. repl is set on the VM which handles
+    // the REPL
+    lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, const AP_Int8 &debug_level, struct AP_Scripting::terminal_s &_terminal,
+                const char *filename = nullptr, bool repl = true);
 
     /* Do not allow copies */
     lua_scripts(const lua_scripts &other) = delete;
@@ -61,26 +70,125 @@ public:
     // run scripts, does not return unless an error occured
     void run(void);
 
-    static bool overtime; // script exceeded it's execution slot, and we are bailing out
-private:
+    // run a group of VMs on the calling thread, each time running the
+    // script which is due first. thread is reported in the profile.
+    // Does not return unless all the VMs have died
+    static void run_group(lua_scripts **vms, uint8_t count, uint8_t thread);
 
-    void create_sandbox(lua_State *L);
+#if AP_SCRIPTING_MULTI_VM_ENABLED
+    // find the scripts in the enabled directories, for running each in
+    // its own VM. The names are allocated with malloc
+    static uint8_t find_scripts(char *names[], uint8_t max);
 
-    void repl_cleanup(void);
+    // set when VMs are run on more than one thread. Bindings are then
+    // called with binding_sem held, so the libraries behind them never
+    // see two scripts at once
+    static bool lock_bindings;
+#endif // AP_SCRIPTING_MULTI_VM_ENABLED
+
+    // print the profile of the scripts in this VM
+    void profile_info(ExpandingString &str);
+
+    // print the profile of the bindings called by all VMs
+    static void binding_info(ExpandingString &str);
+
+    // entry to and exit from a binding. These time the call for the
+    // profiler and hold the binding lock while it is in use. They are
+    // plain calls rather than a guard object as a lua error longjmps
+    // out of the binding, skipping any destructors. In that case the
+    // call isn't profiled and the lock is given back by
+    // release_bindings()
+    static uint32_t binding_entry(lua_State *L);
+    static void binding_exit(lua_State *L, const char *name, uint32_t start_us);
+
+protected:
 
     typedef struct script_info {
        int lua_ref;          // reference to the loaded script object
        uint64_t next_run_ms; // time (in milliseconds) the script should next be run at
        char *name;           // filename for the script // FIXME: This information should be available from Lua
+       lua_profile::script_stats stats;
        script_info *next;
     } script_info;
 
-    script_info *load_script(lua_State *L, char *filename);
+    script_info *scripts; // linked list of scripts to be run, sorted by next run time (soonest first)
+    script_info *running; // the script which was last run, until its garbage has been collected
+
+    // protects the scripts list and running from profile_info()
+    HAL_Semaphore _scripts_sem;
+
+private:
+
+    // the VM a state belongs to
+    static lua_scripts *get_vm(lua_State *L) { return *(lua_scripts **)lua_getextraspace(L); }
+
+    // create the state and load the scripts, returns false if the
+    // VM can't be started
+    bool start(void);
+    bool load_state(void);
+
+    // close the state after a panic and load the scripts again
+    void restart(void);
+
+    // time the next script is due, the REPL is always due
+    uint64_t next_run_ms(void) const;
+
+    // run the REPL or the next script, waiting until it is due
+    void update(void);
+
+    void create_sandbox(lua_State *L);
+
+    void repl_cleanup(void);
+
+    // load a script, using the bytecode cache if use_cache is set
+    script_info *load_script(lua_State *L, char *filename, bool use_cache);
+
+#if AP_SCRIPTING_BYTECODE_CACHE
+    /*
+      precompiled bytecode of a script, stored as foo.luac next to
+      foo.lua. The header records the source it was compiled from and
+      the firmware which compiled it, so it is only used by the same
+      firmware while the size, mtime and CRC of the source match
+     */
+    struct PACKED cache_header {
+        uint32_t magic;
+        uint16_t lua_version;
+        uint16_t header_size;
+        char fw_hash[8];
+        uint32_t source_size;
+        uint32_t source_mtime;
+        uint32_t source_crc;
+        uint32_t code_length;
+        uint32_t code_crc;
+    };
+
+    // fill in the source fields of a cache header, returning false if
+    // the source can't be read
+    static bool cache_key(const char *filename, struct cache_header &key);
+    // push the cached function for a script, returning false if there
+    // is no valid cache
+    bool load_cached(lua_State *L, const char *cache_name, const struct cache_header &key);
+    // write the function on the top of the stack to the cache
+    void write_cache(lua_State *L, const char *cache_name, struct cache_header &key);
+    // return true if a directory entry is a cache whose script has gone
+    static bool is_stale_cache(const char *dirname, const char *name);
+    // remove caches whose script has gone
+    static void remove_stale_caches(const char *dirname);
+#endif // AP_SCRIPTING_BYTECODE_CACHE
+
+    // log the cost of loading a script
+    void log_load(const char *filename, bool cached, uint32_t load_us, int32_t mem, uint32_t peak_mem);
 
     void reset_loop_overtime(lua_State *L);
 
     void load_all_scripts_in_dir(lua_State *L, const char *dirname);
 
+    // load a script whose name has been allocated from the heap
+    void load_file(lua_State *L, char *filename, bool use_cache);
+
+    // return true if a directory entry is a script
+    static bool is_script(const char *name);
+
     void run_next_script(lua_State *L);
 
     void remove_script(lua_State *L, script_info *script);
@@ -102,22 +210,58 @@ private:
     int docall(lua_State *L, int narg, int nres) const;
     int sandbox_ref;
 
-    script_info *scripts; // linked list of scripts to be run, sorted by next run time (soonest first)
+    // write the profile of each script to the log
+    void log_profile(void);
+    uint32_t last_profile_log_ms;
+
+    // held by bindings when lock_bindings is set, and around updates to
+    // the binding profile, which the @SYS thread reads
+    static HAL_Semaphore binding_sem;
+#if AP_SCRIPTING_MULTI_VM_ENABLED
+    // times this VM has taken binding_sem. A binding which raises a lua
+    // error doesn't return, so this is given back after each run
+    uint8_t binding_sem_count;
+#endif // AP_SCRIPTING_MULTI_VM_ENABLED
+    void release_bindings(void);
 
     // hook will be run when CPU time for a script is exceeded
     // it must be static to be passed to the C API
     static void hook(lua_State *L, lua_Debug *ar);
 
-    // lua panic handler, will jump back to the start of run
+    // lua panic handler, will jump back to start() or update()
     static int atpanic(lua_State *L);
-    static jmp_buf panic_jmp;
+    jmp_buf panic_jmp;
+
+    bool overtime; // script exceeded it's execution slot, and we are bailing out
 
     lua_State *lua_state;
 
+    // the only script to run in this VM, or nullptr for all of them
+    const char *_filename;
+    // this VM handles the REPL
+    const bool _repl;
+    // the thread running this VM, for the profile
+    uint8_t _thread;
+
     const AP_Int32 & _vm_steps;
     const AP_Int8 & _debug_level;
 
     static void *alloc(void *ud, void *ptr, size_t osize, size_t nsize);
 
-    static void *_heap;
+    void *_heap;
+    // bytes allocated by lua, and the most since it was last reset
+    uint32_t heap_used;
+    uint32_t heap_peak;
 };
+
+// every return from a binding which doesn't raise a lua error must be
+// preceded by SCRIPTING_BINDING_EXIT
+#if AP_SCRIPTING_PROFILE_BINDINGS_ENABLED || AP_SCRIPTING_MULTI_VM_ENABLED
+  #define SCRIPTING_BINDING_ENTRY(L, name) \
+    const char *const _binding_name = name; \
+    const uint32_t _binding_start_us = lua_scripts::binding_entry(L)
+  #define SCRIPTING_BINDING_EXIT(L) lua_scripts::binding_exit(L, _binding_name, _binding_start_us)
+#else
+  #define SCRIPTING_BINDING_ENTRY(L, name)
+  #define SCRIPTING_BINDING_EXIT(L)
+#endif
@@ -41,7 +41,7 @@ const AP_Param::GroupInfo AP_Terrain::var_info[] = {
 
     // @Param: SPACING
     // @DisplayName: Terrain grid spacing
-    // @Description: Distance between terrain grid points in meters. This controls the horizontal resolution of the terrain data that is stored on te SD card and requested from the ground station. If your GCS is using the ArduPilot SRTM database like Mission Planner or MAVProxy, then a resolution of 100 meters is appropriate. Grid spacings lower than 100 meters waste SD card space if the GCS cannot provide that resolution. The grid spacing also controls how much data is kept in memory during flight. A larger grid spacing will allow for a larger amount of data in memory. A grid spacing of 100 meters results in the vehicle keeping 12 grid squares in memory with each grid square having a size of 2.7 kilometers by 3.2 kilometers. Any additional grid squares are stored on the SD once they are fetched from the GCS and will be loaded as needed.
+    // @Description: Distance between terrain grid points in meters. This controls the horizontal resolution of the terrain data that is stored on te SD card and requested from the ground station. If your GCS is using the ArduPilot SRTM database like Mission Planner or MAVProxy, then a resolution of 100 meters is appropriate. Grid spacings lower than 100 meters waste SD card space if the GCS cannot provide that resolution. The grid spacing also controls how much data is kept in memory during flight. A larger grid spacing will allow for a larger amount of data in memory. A grid spacing of 100 meters results in the vehicle keeping 12 grid squares in memory (or TERRAIN_CACHE_SZ where available) with each grid square having a size of 2.7 kilometers by 3.2 kilometers. Any additional grid squares are stored on the SD once they are fetched from the GCS and will be loaded as needed.
     // @Units: m
     // @Increment: 1
     // @User: Advanced
@@ -53,7 +53,17 @@ const AP_Param::GroupInfo AP_Terrain::var_info[] = {
     // @Bitmask: 0:Disable Download
     // @User: Advanced
     AP_GROUPINFO("OPTIONS",   2, AP_Terrain, options, 0),
-    
+
+#if AP_TERRAIN_CACHE_SIZE_PARAM
+    // @Param: CACHE_SZ
+    // @DisplayName: Terrain cache size
+    // @Description: Number of terrain grid blocks kept in memory. Each block uses about 2 kilobytes and covers 28 by 32 grid spacings. A larger cache keeps more of a long mission in memory, so fewer blocks need to be loaded again from the SD card or requested again from the ground station.
+    // @Range: 12 512
+    // @RebootRequired: True
+    // @User: Advanced
+    AP_GROUPINFO("CACHE_SZ",  3, AP_Terrain, config_cache_size, TERRAIN_GRID_BLOCK_CACHE_SIZE),
+#endif
+
     AP_GROUPEND
 };
 
@@ -325,6 +335,9 @@ void AP_Terrain::update(void)
     // check for pending mission data
     update_mission_data();
 
+    // load grids ahead of the vehicle along the mission
+    prefetch_mission_path();
+
     // check for pending rally data
     update_rally_data();
 
@@ -376,6 +389,22 @@ void AP_Terrain::log_terrain_data()
         loaded         : loaded
     };
     AP::logger().WriteBlock(&pkt, sizeof(pkt));
+
+// @LoggerMessage: TERC
+// @Description: Terrain grid cache statistics, logged with TERR
+// @Field: TimeUS: Time since system startup
+// @Field: Size: Number of grid blocks the cache can hold
+// @Field: Hit: Number of grid block lookups found in the cache
+// @Field: Miss: Number of grid block lookups not found in the cache
+// @Field: Pf: Number of grid blocks queued for loading ahead of the vehicle along the mission
+// @Field: PfHit: Number of prefetched grid blocks later used
+    AP::logger().Write("TERC", "TimeUS,Size,Hit,Miss,Pf,PfHit", "s-----", "F-----", "QHIIII",
+                       pkt.time_us,
+                       cache_size,
+                       cache_hits,
+                       cache_misses,
+                       prefetch_count,
+                       prefetch_hits);
 }
 
 /*
@@ -390,13 +419,36 @@ bool AP_Terrain::allocate(void)
     if (cache != nullptr) {
         return true;
     }
-    cache = (struct grid_cache *)calloc(TERRAIN_GRID_BLOCK_CACHE_SIZE, sizeof(cache[0]));
-    if (cache == nullptr) {
+    uint16_t size = TERRAIN_GRID_BLOCK_CACHE_SIZE;
+#if AP_TERRAIN_CACHE_SIZE_PARAM
+    size = constrain_int16(config_cache_size, 12, TERRAIN_GRID_BLOCK_CACHE_SIZE_MAX);
+#endif
+    // hash table is sized to the next power of 2
+    uint16_t hash_size = 1;
+    while (hash_size < size) {
+        hash_size <<= 1;
+    }
+    cache = (struct grid_cache *)calloc(size, sizeof(cache[0]));
+    cache_hash = (uint16_t *)malloc(hash_size * sizeof(cache_hash[0]));
+    if (cache == nullptr || cache_hash == nullptr) {
+        free(cache);
+        free(cache_hash);
+        cache = nullptr;
+        cache_hash = nullptr;
         gcs().send_text(MAV_SEVERITY_CRITICAL, "Terrain: Allocation failed");
         memory_alloc_failed = true;
         return false;
     }
-    cache_size = TERRAIN_GRID_BLOCK_CACHE_SIZE;
+    for (uint16_t i=0; i<hash_size; i++) {
+        cache_hash[i] = TERRAIN_GRID_CACHE_NONE;
+    }
+    cache_hash_size = hash_size;
+    cache_size = size;
+    for (uint16_t i=0; i<size; i++) {
+        cache[i].hash_bucket = TERRAIN_GRID_CACHE_NONE;
+        cache[i].hash_next = TERRAIN_GRID_CACHE_NONE;
+        grid_lru_add(i);
+    }
     return true;
 }
 
@@ -51,8 +51,38 @@
 #define TERRAIN_GRID_BLOCK_SIZE_X (TERRAIN_GRID_MAVLINK_SIZE*TERRAIN_GRID_BLOCK_MUL_X)
 #define TERRAIN_GRID_BLOCK_SIZE_Y (TERRAIN_GRID_MAVLINK_SIZE*TERRAIN_GRID_BLOCK_MUL_Y)
 
-// number of grid_blocks in the LRU memory cache
+// number of grid_blocks in the LRU memory cache. Boards with plenty
+// of memory keep a larger cache, sized by the TERRAIN_CACHE_SZ parameter
+#ifndef AP_TERRAIN_CACHE_SIZE_PARAM
+#define AP_TERRAIN_CACHE_SIZE_PARAM (CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX)
+#endif
+
+#ifndef TERRAIN_GRID_BLOCK_CACHE_SIZE
+#if AP_TERRAIN_CACHE_SIZE_PARAM
+#define TERRAIN_GRID_BLOCK_CACHE_SIZE 64
+#else
 #define TERRAIN_GRID_BLOCK_CACHE_SIZE 12
+#endif
+#endif
+
+// limit on TERRAIN_CACHE_SZ, 2k of memory per grid_block
+#define TERRAIN_GRID_BLOCK_CACHE_SIZE_MAX 512
+
+// marker for the end of a cache hash chain
+#define TERRAIN_GRID_CACHE_NONE UINT16_MAX
+
+// maximum number of grid_blocks queued for disk read by each run of
+// the mission prefetcher
+#define TERRAIN_PREFETCH_MAX_QUEUE 4
+
+// on Linux and SITL grid_blocks are read straight from memory mapped
+// degree files rather than through the IO timer
+#ifndef AP_TERRAIN_MMAP_ENABLED
+#define AP_TERRAIN_MMAP_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX)
+#endif
+
+// number of degree files kept mapped
+#define TERRAIN_MMAP_MAX_FILES 4
 
 // format of grid on disk
 #define TERRAIN_GRID_FORMAT_VERSION 1
@@ -253,8 +283,18 @@ private:
 
         volatile enum GridCacheState state;
 
-        // the last time access was requested to this block, used for LRU
-        uint32_t last_access_ms;
+        // the blocks used just after and just before this one in the
+        // LRU list, or TERRAIN_GRID_CACHE_NONE at its ends
+        uint16_t lru_newer;
+        uint16_t lru_older;
+
+        // hash bucket holding this block and the next block in the
+        // same bucket, or TERRAIN_GRID_CACHE_NONE
+        uint16_t hash_bucket;
+        uint16_t hash_next;
+
+        // loaded by the mission prefetcher and not yet accessed
+        bool prefetched;
     };
 
     /*
@@ -294,6 +334,31 @@ private:
     */
     struct grid_cache &find_grid_cache(const struct grid_info &info);
 
+    /*
+      hashed lookup of a grid in the cache, returns nullptr if not cached
+    */
+    struct grid_cache *lookup_grid_cache(const struct grid_info &info);
+
+    /*
+      take over the cache entry at idx for the grid given by info,
+      initially unpopulated and waiting for a disk read
+    */
+    struct grid_cache &insert_grid_cache(uint16_t idx, const struct grid_info &info);
+
+    /*
+      cache hash table helpers
+    */
+    uint16_t grid_hash_bucket(const struct grid_info &info) const;
+    void grid_hash_remove(uint16_t idx);
+
+    /*
+      cache LRU list helpers. grid_lru_touch() makes a block the most
+      recently used
+    */
+    void grid_lru_add(uint16_t idx);
+    void grid_lru_remove(uint16_t idx);
+    void grid_lru_touch(uint16_t idx);
+
     /*
       calculate bit number in grid_block bitmap. This corresponds to a
       bit representing a 4x4 mavlink transmitted block
@@ -333,6 +398,8 @@ private:
     void open_file(void);
     void seek_offset(void);
     uint32_t east_blocks(struct grid_block &block) const;
+    uint32_t block_offset(struct grid_block &block) const;
+    char *degree_file_name(char *&path, int8_t lat_degrees, int16_t lon_degrees) const;
     void write_block(void);
     void read_block(void);
 
@@ -341,6 +408,37 @@ private:
      */
     void update_mission_data(void);
 
+#if AP_TERRAIN_MMAP_ENABLED
+    /*
+      memory mapped degree files
+     */
+    enum class MappedRead {
+        LOADED,         // grid copied from the mapped file
+        EMPTY,          // grid is not in the file yet
+        UNAVAILABLE     // file is not mapped, use disk IO
+    };
+    struct mapped_file {
+        const uint8_t *data;    // nullptr when the file is not mapped
+        uint32_t length;
+        int8_t lat_degrees;
+        int16_t lon_degrees;
+        uint32_t last_access_ms;
+        bool in_use;            // slot holds a degree file, mapped or not
+        bool missing;           // file does not exist yet
+    };
+    MappedRead read_mapped_block(struct grid_block &block);
+    struct mapped_file *find_mapped_file(int8_t lat_degrees, int16_t lon_degrees);
+    void update_mapped_files(void);
+    void map_degree_file(int8_t lat_degrees, int16_t lon_degrees);
+    void mapped_block_written(struct grid_block &block);
+#endif
+
+    /*
+      queue disk reads for grids along the upcoming mission legs
+     */
+    void prefetch_mission_path(void);
+    bool prefetch_location(const Location &loc, uint8_t &queued);
+
     /*
       check for missing rally data
      */
@@ -351,6 +449,9 @@ private:
     AP_Int8  enable;
     AP_Int16 grid_spacing; // meters between grid points
     AP_Int16 options; // option bits
+#if AP_TERRAIN_CACHE_SIZE_PARAM
+    AP_Int16 config_cache_size; // number of grid_blocks to keep in memory
+#endif
 
     enum class Options {
         DisableDownload = (1U<<0),
@@ -361,9 +462,25 @@ private:
     const AP_Mission &mission;
 
     // cache of grids in memory, LRU
-    uint8_t cache_size = 0;
+    uint16_t cache_size = 0;
     struct grid_cache *cache = nullptr;
 
+    // hash table of cache indexes, each the head of a chain linked
+    // through grid_cache::hash_next. Number of buckets is a power of 2
+    uint16_t *cache_hash = nullptr;
+    uint16_t cache_hash_size;
+
+    // ends of the LRU list linked through grid_cache::lru_newer and
+    // lru_older. The oldest block is the one replaced on a miss
+    uint16_t cache_lru_newest = TERRAIN_GRID_CACHE_NONE;
+    uint16_t cache_lru_oldest = TERRAIN_GRID_CACHE_NONE;
+
+    // cache statistics for logging
+    uint32_t cache_hits;
+    uint32_t cache_misses;
+    uint32_t prefetch_count;
+    uint32_t prefetch_hits;
+
     // a grid_cache block waiting for disk IO
     enum DiskIoState {
         DiskIoIdle      = 0,
@@ -375,6 +492,9 @@ private:
     volatile enum DiskIoState disk_io_state;
     union grid_io_block disk_block;
 
+    // cache index of the block in disk_block
+    uint16_t disk_io_idx;
+
     // last time we asked for more grids
     uint32_t last_request_time_ms[MAVLINK_COMM_NUM_BUFFERS];
 
@@ -419,6 +539,9 @@ private:
     // grid spacing during mission check
     uint16_t last_mission_spacing;
 
+    // last time the mission prefetcher ran
+    uint32_t last_prefetch_ms;
+
     // next rally command to check
     uint16_t next_rally_index;
 
@@ -430,6 +553,25 @@ private:
 
     char *file_path = nullptr;
 
+#if AP_TERRAIN_MMAP_ENABLED
+    // degree files mapped read-only. The IO timer makes and releases
+    // the mappings, the main thread only reads them. Both hold
+    // mapped_sem while looking at mapped_files
+    struct mapped_file mapped_files[TERRAIN_MMAP_MAX_FILES];
+    HAL_Semaphore mapped_sem;
+
+    // degree file the main thread wants mapped, set by the main thread
+    // and cleared by the IO timer with mapped_sem held
+    struct {
+        bool pending;
+        int8_t lat_degrees;
+        int16_t lon_degrees;
+    } map_request;
+
+    // used by the IO timer to name the file being mapped
+    char *map_path = nullptr;
+#endif
+
     // status
     enum TerrainStatus system_status = TerrainStatusDisabled;
 
@@ -38,6 +38,7 @@ void AP_Terrain::check_disk_read(void)
     for (uint16_t i=0; i<cache_size; i++) {
         if (cache[i].state == GRID_CACHE_DISKWAIT) {
             disk_block.block = cache[i].grid;
+            disk_io_idx = i;
             disk_io_state = DiskIoWaitRead;
             return;
         }
@@ -52,6 +53,7 @@ void AP_Terrain::check_disk_write(void)
     for (uint16_t i=0; i<cache_size; i++) {
         if (cache[i].state == GRID_CACHE_DIRTY) {
             disk_block.block = cache[i].grid;
+            disk_io_idx = i;
             disk_io_state = DiskIoWaitWrite;
             return;
         }
@@ -91,7 +93,7 @@ void AP_Terrain::schedule_disk_io(void)
                 cache[cache_idx].grid = disk_block.block;
             }
             cache[cache_idx].state = GRID_CACHE_VALID;
-            cache[cache_idx].last_access_ms = AP_HAL::millis();
+            grid_lru_touch(cache_idx);
         }
         disk_io_state = DiskIoIdle;
         break;
@@ -133,53 +135,65 @@ All file operations are done by the IO thread.
 
 
 /*
-  open the current degree file
+  fill in the path of the degree file for lat_degrees/lon_degrees,
+  allocating path on first use. Returns a pointer to the '/' before
+  the file name within path, or nullptr on failure
  */
-void AP_Terrain::open_file(void)
+char *AP_Terrain::degree_file_name(char *&path, int8_t lat_degrees, int16_t lon_degrees) const
 {
-    struct grid_block &block = disk_block.block;
-    if (fd != -1 && 
-        block.lat_degrees == file_lat_degrees &&
-        block.lon_degrees == file_lon_degrees) {
-        // already open on right file
-        return;
-    }
-    if (file_path == nullptr) {
+    if (path == nullptr) {
         const char* terrain_dir = hal.util->get_custom_terrain_directory();
         if (terrain_dir == nullptr) {
             terrain_dir = HAL_BOARD_TERRAIN_DIRECTORY;
         }
-        if (asprintf(&file_path, "%s/NxxExxx.DAT", terrain_dir) <= 0) {
-            io_failure = true;
-            file_path = nullptr;
-            return;
+        if (asprintf(&path, "%s/NxxExxx.DAT", terrain_dir) <= 0) {
+            path = nullptr;
+            return nullptr;
         }
     }
-    if (file_path == nullptr) {
-        io_failure = true;
-        return;
+    if (path == nullptr) {
+        return nullptr;
     }
-    char *p = &file_path[strlen(file_path)-12];
+    char *p = &path[strlen(path)-12];
     if (*p != '/') {
-        io_failure = true;
-        return;        
+        return nullptr;
     }
     // our fancy templatified MIN macro get gcc 9.3.0 all confused; it
     // thinks there are more digits than there can be so says there's
     // a buffer overflow in the snprintf.  Constrain it long-form:
-    uint32_t lat_tmp = abs((int32_t)block.lat_degrees);
+    uint32_t lat_tmp = abs((int32_t)lat_degrees);
     if (lat_tmp > 99U) {
         lat_tmp = 99U;
     }
-    uint32_t lon_tmp = abs((int32_t)block.lon_degrees);
+    uint32_t lon_tmp = abs((int32_t)lon_degrees);
     if (lon_tmp > 999U) {
         lon_tmp = 999;
     }
     hal.util->snprintf(p, 13, "/%c%02u%c%03u.DAT",
-             block.lat_degrees<0?'S':'N',
+             lat_degrees<0?'S':'N',
              (unsigned)lat_tmp,
-             block.lon_degrees<0?'W':'E',
+             lon_degrees<0?'W':'E',
              (unsigned)lon_tmp);
+    return p;
+}
+
+/*
+  open the current degree file
+ */
+void AP_Terrain::open_file(void)
+{
+    struct grid_block &block = disk_block.block;
+    if (fd != -1 && 
+        block.lat_degrees == file_lat_degrees &&
+        block.lon_degrees == file_lon_degrees) {
+        // already open on right file
+        return;
+    }
+    char *p = degree_file_name(file_path, block.lat_degrees, block.lon_degrees);
+    if (p == nullptr) {
+        io_failure = true;
+        return;
+    }
 
     // create directory if need be
     if (!directory_created) {
@@ -234,14 +248,21 @@ uint32_t AP_Terrain::east_blocks(struct grid_block &block) const
 }
 
 /*
-  seek to the right offset for disk_block
+  offset of a grid_block within its degree file
  */
-void AP_Terrain::seek_offset(void)
+uint32_t AP_Terrain::block_offset(struct grid_block &block) const
 {
-    struct grid_block &block = disk_block.block;
     // work out how many longitude blocks there are at this latitude
     uint32_t blocknum = east_blocks(block) * block.grid_idx_x + block.grid_idx_y;
-    uint32_t file_offset = blocknum * sizeof(union grid_io_block);
+    return blocknum * sizeof(union grid_io_block);
+}
+
+/*
+  seek to the right offset for disk_block
+ */
+void AP_Terrain::seek_offset(void)
+{
+    uint32_t file_offset = block_offset(disk_block.block);
     if (AP::FS().lseek(fd, file_offset, SEEK_SET) != (off_t)file_offset) {
 #if TERRAIN_DEBUG
         hal.console->printf("Seek %lu failed - %s\n",
@@ -275,6 +296,9 @@ void AP_Terrain::write_block(void)
         io_failure = true;
     } else {
         AP::FS().fsync(fd);
+#if AP_TERRAIN_MMAP_ENABLED
+        mapped_block_written(disk_block.block);
+#endif
 #if TERRAIN_DEBUG
         printf("wrote block at %ld %ld ret=%d mask=%07llx\n",
                (long)disk_block.block.lat,
@@ -351,6 +375,10 @@ void AP_Terrain::io_timer(void)
         return;
     }
 
+#if AP_TERRAIN_MMAP_ENABLED
+    update_mapped_files();
+#endif
+
     switch (disk_io_state) {
     case DiskIoIdle:
     case DiskIoDoneRead:
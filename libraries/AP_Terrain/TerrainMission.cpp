@@ -24,6 +24,7 @@
 #include <GCS_MAVLink/GCS.h>
 #include "AP_Terrain.h"
 #include <AP_GPS/AP_GPS.h>
+#include <AP_AHRS/AP_AHRS.h>
 
 #if AP_TERRAIN_AVAILABLE
 
@@ -107,6 +108,101 @@ void AP_Terrain::update_mission_data(void)
     }
 }
 
+/*
+  queue disk reads for grids along the upcoming mission legs, so they
+  are in memory before the vehicle gets there. Grids which are not on
+  disk are then requested from the GCS by send_cache_request()
+ */
+void AP_Terrain::prefetch_mission_path(void)
+{
+    if (mission.state() != AP_Mission::MISSION_RUNNING) {
+        return;
+    }
+    const uint32_t now_ms = AP_HAL::millis();
+    if (now_ms - last_prefetch_ms < 1000) {
+        return;
+    }
+    last_prefetch_ms = now_ms;
+
+    uint16_t index = mission.get_current_nav_index();
+    if (index == AP_MISSION_CMD_INDEX_NONE) {
+        return;
+    }
+
+    Location loc;
+    if (!AP::ahrs().get_position(loc)) {
+        // we don't know where we are
+        return;
+    }
+
+    // sample the path every half grid block so no grid along it is
+    // missed, and look ahead over at most a quarter of the cache so
+    // the grids around the vehicle are not evicted
+    const float step = grid_spacing.get() * TERRAIN_GRID_BLOCK_SPACING_X * 0.5f;
+    uint16_t samples_remaining = cache_size / 2;
+    uint8_t queued = 0;
+
+    while (samples_remaining > 0) {
+        // get next nav waypoint, skipping commands without a location
+        AP_Mission::Mission_Command cmd;
+        if (!mission.read_cmd_from_storage(index, cmd)) {
+            // end of mission
+            return;
+        }
+        index++;
+        if ((cmd.id != MAV_CMD_NAV_WAYPOINT &&
+             cmd.id != MAV_CMD_NAV_SPLINE_WAYPOINT) ||
+            (cmd.content.location.lat == 0 && cmd.content.location.lng == 0)) {
+            continue;
+        }
+
+        // walk along the leg to this waypoint
+        const Location &target = cmd.content.location;
+        while (samples_remaining > 0) {
+            samples_remaining--;
+            if (!prefetch_location(loc, queued)) {
+                return;
+            }
+            if (loc.get_distance(target) <= step) {
+                break;
+            }
+            loc.offset_bearing(loc.get_bearing_to(target) * 0.01f, step);
+        }
+        loc.lat = target.lat;
+        loc.lng = target.lng;
+    }
+}
+
+/*
+  make sure the grid holding loc is in the cache, queueing a disk read
+  if it is not. Returns false when no more grids should be queued
+ */
+bool AP_Terrain::prefetch_location(const Location &loc, uint8_t &queued)
+{
+    struct grid_info info;
+    calculate_grid_info(loc, info);
+
+    struct grid_cache *gcache = lookup_grid_cache(info);
+    if (gcache != nullptr) {
+        // we will need this grid soon, keep it out of LRU eviction
+        grid_lru_touch(gcache - cache);
+        return true;
+    }
+
+    // only replace the oldest grid if nothing is waiting to be read
+    // into it or written from it
+    const uint16_t oldest_i = cache_lru_oldest;
+    if (cache[oldest_i].state == GRID_CACHE_DISKWAIT ||
+        cache[oldest_i].state == GRID_CACHE_DIRTY) {
+        return false;
+    }
+
+    insert_grid_cache(oldest_i, info).prefetched = true;
+    prefetch_count++;
+    queued++;
+    return queued < TERRAIN_PREFETCH_MAX_QUEUE;
+}
+
 /*
   check that we have fetched all rally terrain data
  */
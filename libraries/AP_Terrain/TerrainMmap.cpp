@@ -0,0 +1,219 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  read grid_blocks from memory mapped degree files
+
+  The degree files are mapped read-only and shared, so blocks written
+  by the IO timer with write_block() are seen through the mapping. All
+  filesystem calls, mmap() and munmap() happen in the IO timer. The
+  main thread only copies blocks out of mappings the IO timer has
+  already published in mapped_files
+ */
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Common/AP_Common.h>
+#include <AP_Math/AP_Math.h>
+#include "AP_Terrain.h"
+
+#if AP_TERRAIN_AVAILABLE && AP_TERRAIN_MMAP_ENABLED
+
+#include <AP_Filesystem/AP_Filesystem.h>
+#include <sys/mman.h>
+
+extern const AP_HAL::HAL& hal;
+
+/*
+  copy a grid_block from its mapped degree file. The lat/lon, spacing
+  and indices of block must be filled in. Called from the main thread
+ */
+AP_Terrain::MappedRead AP_Terrain::read_mapped_block(struct grid_block &block)
+{
+    const uint32_t offset = block_offset(block);
+    const uint32_t end = offset + sizeof(union grid_io_block);
+
+    WITH_SEMAPHORE(mapped_sem);
+
+    struct mapped_file *mfile = find_mapped_file(block.lat_degrees, block.lon_degrees);
+    if (mfile == nullptr) {
+        // ask the IO timer to map the file, this grid is read by the
+        // IO timer in the meantime
+        if (!map_request.pending) {
+            map_request.lat_degrees = block.lat_degrees;
+            map_request.lon_degrees = block.lon_degrees;
+            map_request.pending = true;
+        }
+        return MappedRead::UNAVAILABLE;
+    }
+    mfile->last_access_ms = AP_HAL::millis();
+    if (mfile->missing) {
+        // no file yet, the IO timer creates it
+        return MappedRead::EMPTY;
+    }
+    if (mfile->data == nullptr) {
+        return MappedRead::UNAVAILABLE;
+    }
+    if (mfile->length < end) {
+        // this part of the file has not been written yet. The IO
+        // timer extends the mapping when it writes past the end
+        return MappedRead::EMPTY;
+    }
+
+    // copy the block before checking it so the checks see the same
+    // data as the copy, even if the IO timer is writing this block
+    const struct grid_block requested = block;
+    memcpy(&block, &mfile->data[offset], sizeof(block));
+
+    if (!TERRAIN_LATLON_EQUAL(block.lat,requested.lat) ||
+        !TERRAIN_LATLON_EQUAL(block.lon,requested.lon) ||
+        block.bitmap == 0 ||
+        block.spacing != grid_spacing ||
+        block.version != TERRAIN_GRID_FORMAT_VERSION) {
+        // a missing block on disk, as in read_block()
+        block = requested;
+        return MappedRead::EMPTY;
+    }
+    if (block.crc != get_block_crc(block)) {
+        // the block may be part way through a write by the IO
+        // timer. Let the IO timer read it once the write is done
+        block = requested;
+        return MappedRead::UNAVAILABLE;
+    }
+    return MappedRead::LOADED;
+}
+
+/*
+  find the slot holding a degree file, mapped_sem must be held
+ */
+AP_Terrain::mapped_file *AP_Terrain::find_mapped_file(int8_t lat_degrees, int16_t lon_degrees)
+{
+    for (uint8_t i=0; i<TERRAIN_MMAP_MAX_FILES; i++) {
+        if (mapped_files[i].in_use &&
+            mapped_files[i].lat_degrees == lat_degrees &&
+            mapped_files[i].lon_degrees == lon_degrees) {
+            return &mapped_files[i];
+        }
+    }
+    return nullptr;
+}
+
+/*
+  map the degree file requested by the main thread. Called from the
+  IO timer
+ */
+void AP_Terrain::update_mapped_files(void)
+{
+    int8_t lat_degrees;
+    int16_t lon_degrees;
+    {
+        WITH_SEMAPHORE(mapped_sem);
+        if (!map_request.pending) {
+            return;
+        }
+        lat_degrees = map_request.lat_degrees;
+        lon_degrees = map_request.lon_degrees;
+    }
+
+    map_degree_file(lat_degrees, lon_degrees);
+
+    WITH_SEMAPHORE(mapped_sem);
+    map_request.pending = false;
+}
+
+/*
+  extend the mapping of a degree file after the IO timer has written
+  past its end, so the main thread sees the new block. Called from the
+  IO timer
+ */
+void AP_Terrain::mapped_block_written(struct grid_block &block)
+{
+    const uint32_t end = block_offset(block) + sizeof(union grid_io_block);
+    {
+        WITH_SEMAPHORE(mapped_sem);
+        const struct mapped_file *mfile = find_mapped_file(block.lat_degrees, block.lon_degrees);
+        if (mfile == nullptr ||
+            (mfile->data != nullptr && mfile->length >= end)) {
+            // not wanted by the main thread, or already covered
+            return;
+        }
+    }
+    map_degree_file(block.lat_degrees, block.lon_degrees);
+}
+
+/*
+  (re)map a degree file and publish it in mapped_files, replacing the
+  least recently used file if it is not already there. Called from the
+  IO timer
+ */
+void AP_Terrain::map_degree_file(int8_t lat_degrees, int16_t lon_degrees)
+{
+    // map the file before taking mapped_sem so the main thread is not
+    // held up by filesystem calls
+    const uint8_t *data = nullptr;
+    uint32_t length = 0;
+    bool missing = false;
+    if (degree_file_name(map_path, lat_degrees, lon_degrees) != nullptr) {
+        struct stat st;
+        if (AP::FS().stat(map_path, &st) != 0 || st.st_size <= 0) {
+            missing = true;
+        } else {
+            const int map_fd = AP::FS().open(map_path, O_RDONLY);
+            if (map_fd != -1) {
+                // local files are opened by AP_Filesystem_Posix, so
+                // this is an OS file descriptor. The mapping stays
+                // valid after it is closed
+                void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, map_fd, 0);
+                AP::FS().close(map_fd);
+                if (p != MAP_FAILED) {
+                    data = (const uint8_t *)p;
+                    length = st.st_size;
+                }
+            }
+        }
+    }
+
+    // a file that could not be mapped is still recorded so the main
+    // thread does not keep asking for it, its grids use disk IO
+    const uint8_t *old_data;
+    uint32_t old_length;
+    {
+        WITH_SEMAPHORE(mapped_sem);
+        struct mapped_file *mfile = find_mapped_file(lat_degrees, lon_degrees);
+        if (mfile == nullptr) {
+            mfile = &mapped_files[0];
+            for (uint8_t i=1; i<TERRAIN_MMAP_MAX_FILES && mfile->in_use; i++) {
+                if (!mapped_files[i].in_use ||
+                    mapped_files[i].last_access_ms < mfile->last_access_ms) {
+                    mfile = &mapped_files[i];
+                }
+            }
+            mfile->last_access_ms = AP_HAL::millis();
+        }
+        old_data = mfile->data;
+        old_length = mfile->length;
+        mfile->data = data;
+        mfile->length = length;
+        mfile->lat_degrees = lat_degrees;
+        mfile->lon_degrees = lon_degrees;
+        mfile->in_use = true;
+        mfile->missing = missing;
+    }
+
+    // the main thread can no longer see the old mapping
+    if (old_data != nullptr) {
+        munmap((void *)old_data, old_length);
+    }
+}
+
+#endif // AP_TERRAIN_AVAILABLE && AP_TERRAIN_MMAP_ENABLED
@@ -109,24 +109,49 @@ void AP_Terrain::calculate_grid_info(const Location &loc, struct grid_info &info
  */
 AP_Terrain::grid_cache &AP_Terrain::find_grid_cache(const struct grid_info &info)
 {
-    uint16_t oldest_i = 0;
-
     // see if we have that grid
-    for (uint16_t i=0; i<cache_size; i++) {
+    struct grid_cache *gcache = lookup_grid_cache(info);
+    if (gcache != nullptr) {
+        cache_hits++;
+        if (gcache->prefetched) {
+            prefetch_hits++;
+            gcache->prefetched = false;
+        }
+        grid_lru_touch(gcache - cache);
+        return *gcache;
+    }
+    cache_misses++;
+
+    // Not found. Use the oldest grid and make it this grid,
+    // initially unpopulated
+    return insert_grid_cache(cache_lru_oldest, info);
+}
+
+/*
+  hashed lookup of a grid in the cache, returns nullptr if not cached
+ */
+AP_Terrain::grid_cache *AP_Terrain::lookup_grid_cache(const struct grid_info &info)
+{
+    for (uint16_t i=cache_hash[grid_hash_bucket(info)]; i != TERRAIN_GRID_CACHE_NONE; i=cache[i].hash_next) {
         if (TERRAIN_LATLON_EQUAL(cache[i].grid.lat,info.grid_lat) &&
             TERRAIN_LATLON_EQUAL(cache[i].grid.lon,info.grid_lon) &&
             cache[i].grid.spacing == grid_spacing) {
-            cache[i].last_access_ms = AP_HAL::millis();
-            return cache[i];
-        }
-        if (cache[i].last_access_ms < cache[oldest_i].last_access_ms) {
-            oldest_i = i;
+            return &cache[i];
         }
     }
+    return nullptr;
+}
 
-    // Not found. Use the oldest grid and make it this grid,
-    // initially unpopulated
-    struct grid_cache &grid = cache[oldest_i];
+/*
+  take over the cache entry at idx for the grid given by info,
+  initially unpopulated and waiting for a disk read
+ */
+AP_Terrain::grid_cache &AP_Terrain::insert_grid_cache(uint16_t idx, const struct grid_info &info)
+{
+    grid_hash_remove(idx);
+    grid_lru_remove(idx);
+
+    struct grid_cache &grid = cache[idx];
     memset(&grid, 0, sizeof(grid));
 
     grid.grid.lat = info.grid_lat;
@@ -137,19 +162,122 @@ AP_Terrain::grid_cache &AP_Terrain::find_grid_cache(const struct grid_info &info
     grid.grid.lat_degrees = info.lat_degrees;
     grid.grid.lon_degrees = info.lon_degrees;
     grid.grid.version = TERRAIN_GRID_FORMAT_VERSION;
-    grid.last_access_ms = AP_HAL::millis();
+    grid_lru_add(idx);
 
     // mark as waiting for disk read
     grid.state = GRID_CACHE_DISKWAIT;
 
+#if AP_TERRAIN_MMAP_ENABLED
+    // read straight from the mapped degree file rather than waiting
+    // for the IO timer
+    if (read_mapped_block(grid.grid) != MappedRead::UNAVAILABLE) {
+        grid.state = GRID_CACHE_VALID;
+    }
+#endif
+
+    // add to head of hash chain
+    grid.hash_bucket = grid_hash_bucket(info);
+    grid.hash_next = cache_hash[grid.hash_bucket];
+    cache_hash[grid.hash_bucket] = idx;
+
     return grid;
 }
 
+/*
+  hash bucket for a grid. The degree reference and grid indices are
+  used rather than the grid lat/lon as those are only compared to
+  within TERRAIN_LATLON_EQUAL
+ */
+uint16_t AP_Terrain::grid_hash_bucket(const struct grid_info &info) const
+{
+    uint32_t h = info.grid_idx_x * 73856093U;
+    h ^= info.grid_idx_y * 19349663U;
+    h ^= (uint32_t)info.lat_degrees * 83492791U;
+    h ^= (uint32_t)info.lon_degrees * 2654435761U;
+    return (h ^ (h >> 16)) & (cache_hash_size - 1);
+}
+
+/*
+  remove a cache entry from its hash chain
+ */
+void AP_Terrain::grid_hash_remove(uint16_t idx)
+{
+    const uint16_t bucket = cache[idx].hash_bucket;
+    if (bucket == TERRAIN_GRID_CACHE_NONE) {
+        return;
+    }
+    uint16_t *link = &cache_hash[bucket];
+    while (*link != TERRAIN_GRID_CACHE_NONE) {
+        if (*link == idx) {
+            *link = cache[idx].hash_next;
+            break;
+        }
+        link = &cache[*link].hash_next;
+    }
+    cache[idx].hash_bucket = TERRAIN_GRID_CACHE_NONE;
+    cache[idx].hash_next = TERRAIN_GRID_CACHE_NONE;
+}
+
+/*
+  add a cache entry to the LRU list as the most recently used
+ */
+void AP_Terrain::grid_lru_add(uint16_t idx)
+{
+    cache[idx].lru_newer = TERRAIN_GRID_CACHE_NONE;
+    cache[idx].lru_older = cache_lru_newest;
+    if (cache_lru_newest != TERRAIN_GRID_CACHE_NONE) {
+        cache[cache_lru_newest].lru_newer = idx;
+    } else {
+        cache_lru_oldest = idx;
+    }
+    cache_lru_newest = idx;
+}
+
+/*
+  remove a cache entry from the LRU list
+ */
+void AP_Terrain::grid_lru_remove(uint16_t idx)
+{
+    const uint16_t newer = cache[idx].lru_newer;
+    const uint16_t older = cache[idx].lru_older;
+    if (newer != TERRAIN_GRID_CACHE_NONE) {
+        cache[newer].lru_older = older;
+    } else {
+        cache_lru_newest = older;
+    }
+    if (older != TERRAIN_GRID_CACHE_NONE) {
+        cache[older].lru_newer = newer;
+    } else {
+        cache_lru_oldest = newer;
+    }
+    cache[idx].lru_newer = TERRAIN_GRID_CACHE_NONE;
+    cache[idx].lru_older = TERRAIN_GRID_CACHE_NONE;
+}
+
+/*
+  mark a cache entry as the most recently used
+ */
+void AP_Terrain::grid_lru_touch(uint16_t idx)
+{
+    if (idx == cache_lru_newest) {
+        return;
+    }
+    grid_lru_remove(idx);
+    grid_lru_add(idx);
+}
+
 /*
   find cache index of disk_block
  */
 int16_t AP_Terrain::find_io_idx(enum GridCacheState state)
 {
+    // the block normally still sits at the index it was loaded from
+    if (disk_io_idx < cache_size &&
+        TERRAIN_LATLON_EQUAL(disk_block.block.lat,cache[disk_io_idx].grid.lat) &&
+        TERRAIN_LATLON_EQUAL(disk_block.block.lon,cache[disk_io_idx].grid.lon) &&
+        cache[disk_io_idx].state == state) {
+        return disk_io_idx;
+    }
     // try first with given state
     for (uint16_t i=0; i<cache_size; i++) {
         if (TERRAIN_LATLON_EQUAL(disk_block.block.lat,cache[i].grid.lat) &&
@@ -93,7 +93,6 @@ const AP_Param::GroupInfo HarmonicNotchFilterParams::var_info[] = {
  */
 template <class T>
 HarmonicNotchFilter<T>::~HarmonicNotchFilter() {
-    delete[] _filters;
     _num_filters = 0;
     _num_enabled_filters = 0;
 }
@@ -106,7 +105,7 @@ template <class T>
 void HarmonicNotchFilter<T>::init(float sample_freq_hz, float center_freq_hz, float bandwidth_hz, float attenuation_dB)
 {
     // sanity check the input
-    if (_filters == nullptr || is_zero(sample_freq_hz) || isnan(sample_freq_hz)) {
+    if (_filters.num_sections() == 0 || is_zero(sample_freq_hz) || isnan(sample_freq_hz)) {
         return;
     }
 
@@ -149,9 +148,8 @@ void HarmonicNotchFilter<T>::allocate_filters(uint8_t harmonics, bool double_not
         }
     }
     if (_num_filters > 0) {
-        _filters = new NotchFilter<T>[_num_filters];
-        if (_filters == nullptr) {
-            GCS_SEND_TEXT(MAV_SEVERITY_WARNING, "Failed to allocate %u bytes for HarmonicNotchFilter", (unsigned int)(_num_filters * sizeof(NotchFilter<T>)));
+        if (!_filters.allocate(_num_filters)) {
+            GCS_SEND_TEXT(MAV_SEVERITY_WARNING, "Failed to allocate %u bytes for HarmonicNotchFilter", (unsigned int)NotchFilterBank<T>::allocation_size(_num_filters));
             _num_filters = 0;
         }
 
@@ -182,19 +180,19 @@ void HarmonicNotchFilter<T>::update(float center_freq_hz)
             if (!_double_notch) {
                 // only enable the filter if its center frequency is below the nyquist frequency
                 if (notch_center < nyquist_limit) {
-                    _filters[_num_enabled_filters++].init_with_A_and_Q(_sample_freq_hz, notch_center, _A, _Q);
+                    _filters.init_section(_num_enabled_filters++, _sample_freq_hz, notch_center, _A, _Q);
                 }
             } else {
                 float notch_center_double;
                 // only enable the filter if its center frequency is below the nyquist frequency
                 notch_center_double = notch_center * (1.0 - _notch_spread);
                 if (notch_center_double < nyquist_limit) {
-                    _filters[_num_enabled_filters++].init_with_A_and_Q(_sample_freq_hz, notch_center_double, _A, _Q);
+                    _filters.init_section(_num_enabled_filters++, _sample_freq_hz, notch_center_double, _A, _Q);
                 }
                 // only enable the filter if its center frequency is below the nyquist frequency
                 notch_center_double = notch_center * (1.0 + _notch_spread);
                 if (notch_center_double < nyquist_limit) {
-                    _filters[_num_enabled_filters++].init_with_A_and_Q(_sample_freq_hz, notch_center_double, _A, _Q);
+                    _filters.init_section(_num_enabled_filters++, _sample_freq_hz, notch_center_double, _A, _Q);
                 }
             }
         }
@@ -222,19 +220,19 @@ void HarmonicNotchFilter<T>::update(uint8_t num_centers, const float center_freq
         if (!_double_notch) {
             // only enable the filter if its center frequency is below the nyquist frequency
             if (notch_center < nyquist_limit) {
-                _filters[_num_enabled_filters++].init_with_A_and_Q(_sample_freq_hz, notch_center, _A, _Q);
+                _filters.init_section(_num_enabled_filters++, _sample_freq_hz, notch_center, _A, _Q);
             }
         } else {
             float notch_center_double;
             // only enable the filter if its center frequency is below the nyquist frequency
             notch_center_double = notch_center * (1.0 - _notch_spread);
             if (notch_center_double < nyquist_limit) {
-                _filters[_num_enabled_filters++].init_with_A_and_Q(_sample_freq_hz, notch_center_double, _A, _Q);
+                _filters.init_section(_num_enabled_filters++, _sample_freq_hz, notch_center_double, _A, _Q);
             }
             // only enable the filter if its center frequency is below the nyquist frequency
             notch_center_double = notch_center * (1.0 + _notch_spread);
             if (notch_center_double < nyquist_limit) {
-                _filters[_num_enabled_filters++].init_with_A_and_Q(_sample_freq_hz, notch_center_double, _A, _Q);
+                _filters.init_section(_num_enabled_filters++, _sample_freq_hz, notch_center_double, _A, _Q);
             }
         }
     }
@@ -250,11 +248,7 @@ T HarmonicNotchFilter<T>::apply(const T &sample)
         return sample;
     }
 
-    T output = sample;
-    for (uint8_t i = 0; i < _num_enabled_filters; i++) {
-        output = _filters[i].apply(output);
-    }
-    return output;
+    return _filters.apply(sample, _num_enabled_filters);
 }
 
 /*
@@ -267,9 +261,7 @@ void HarmonicNotchFilter<T>::reset()
         return;
     }
 
-    for (uint8_t i = 0; i < _num_filters; i++) {
-        _filters[i].reset();
-    }
+    _filters.reset();
 }
 
 /*
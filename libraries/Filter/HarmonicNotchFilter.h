@@ -18,6 +18,7 @@
 #include <cmath>
 #include <AP_Param/AP_Param.h>
 #include "NotchFilter.h"
+#include "NotchFilterBank.h"
 
 #define HNF_MAX_HARMONICS 8
 #define HNF_MAX_HMNC_BITSET 0xF
@@ -45,7 +46,7 @@ public:
 
 private:
     // underlying bank of notch filters
-    NotchFilter<T>*  _filters;
+    NotchFilterBank<T> _filters;
     // sample frequency for each filter
     float _sample_freq_hz;
     // base double notch bandwidth for each filter
@@ -45,8 +45,12 @@ void NotchFilter<T>::init(float sample_freq_hz, float center_freq_hz, float band
     }
 }
 
+/*
+  calculate the biquad coefficients of the filter
+ */
 template <class T>
-void NotchFilter<T>::init_with_A_and_Q(float sample_freq_hz, float center_freq_hz, float A, float Q)
+bool NotchFilter<T>::calculate_coefficients(float sample_freq_hz, float center_freq_hz, float A, float Q,
+                                            float &b0, float &b1, float &b2, float &a1, float &a2, float &a0_inv)
 {
     if ((center_freq_hz > 0.0) && (center_freq_hz < 0.5 * sample_freq_hz) && (Q > 0.0)) {
         float omega = 2.0 * M_PI * center_freq_hz / sample_freq_hz;
@@ -57,10 +61,15 @@ void NotchFilter<T>::init_with_A_and_Q(float sample_freq_hz, float center_freq_h
         a0_inv =  1.0/(1.0 + alpha);
         a1 = b1;
         a2 =  1.0 - alpha;
-        initialised = true;
-    } else {
-        initialised = false;
+        return true;
     }
+    return false;
+}
+
+template <class T>
+void NotchFilter<T>::init_with_A_and_Q(float sample_freq_hz, float center_freq_hz, float A, float Q)
+{
+    initialised = calculate_coefficients(sample_freq_hz, center_freq_hz, A, Q, b0, b1, b2, a1, a2, a0_inv);
 }
 
 /*
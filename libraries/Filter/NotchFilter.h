@@ -38,6 +38,11 @@ public:
     // calculate attenuation and quality from provided center frequency and bandwidth
     static void calculate_A_and_Q(float center_freq_hz, float bandwidth_hz, float attenuation_dB, float& A, float& Q); 
 
+    // calculate the biquad coefficients from center frequency, attenuation and quality
+    // returns false, leaving the coefficients unchanged, if the center frequency or Q are out of range
+    static bool calculate_coefficients(float sample_freq_hz, float center_freq_hz, float A, float Q,
+                                       float &b0, float &b1, float &b2, float &a1, float &a2, float &a0_inv);
+
 private:
 
     bool initialised;
@@ -0,0 +1,233 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  cascade of notch filters in structure of arrays form
+
+  Section i evaluates
+
+    y = (x*b0[i] + x1*b1[i] + x2*b2[i] - y1*a1[i] - y2*a2[i]) * a0_inv[i]
+
+  in the same order of operations as NotchFilter::apply(), with the
+  multiplies and adds kept separate in the vector code, so that the
+  output matches a cascade of NotchFilter objects bit for bit. The
+  cascade is serial, so the vector lanes are the sample components
+ */
+
+#include "NotchFilterBank.h"
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NOTCH_BANK_NEON 1
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define NOTCH_BANK_SSE 1
+#endif
+
+#if NOTCH_BANK_NEON || NOTCH_BANK_SSE
+// delayed samples are padded to a full vector
+#define NOTCH_BANK_STRIDE(T) 4U
+#else
+#define NOTCH_BANK_STRIDE(T) (sizeof(T) / sizeof(float))
+#endif
+
+#define NOTCH_BANK_MAX_SECTIONS 32
+
+template <class T>
+NotchFilterBank<T>::~NotchFilterBank()
+{
+    delete[] _b0;
+}
+
+/*
+  bytes allocated for num_sections notch filters
+ */
+template <class T>
+uint32_t NotchFilterBank<T>::allocation_size(uint8_t num_sections)
+{
+    return (6U + 4U * NOTCH_BANK_STRIDE(T)) * num_sections * sizeof(float);
+}
+
+/*
+  allocate num_sections notch filters. All sections pass samples
+  through until init_section() is called
+ */
+template <class T>
+bool NotchFilterBank<T>::allocate(uint8_t num_sections)
+{
+    static_assert(sizeof(T) % sizeof(float) == 0 && sizeof(T) <= 4 * sizeof(float), "NotchFilterBank needs one to four float components");
+
+    delete[] _b0;
+    _b0 = nullptr;
+    _num_sections = 0;
+    _initialised_mask = 0;
+
+    if (num_sections == 0 || num_sections > NOTCH_BANK_MAX_SECTIONS) {
+        return false;
+    }
+
+    const uint8_t n = num_sections;
+    const uint8_t stride = NOTCH_BANK_STRIDE(T);
+    float *block = new float[allocation_size(n) / sizeof(float)];
+    if (block == nullptr) {
+        return false;
+    }
+    memset(block, 0, allocation_size(n));
+
+    _b0 = block;
+    _b1 = &block[n];
+    _b2 = &block[2 * n];
+    _a1 = &block[3 * n];
+    _a2 = &block[4 * n];
+    _a0_inv = &block[5 * n];
+    _x1 = &block[6 * n];
+    _x2 = &_x1[stride * n];
+    _y1 = &_x2[stride * n];
+    _y2 = &_y1[stride * n];
+
+    _num_sections = num_sections;
+    return true;
+}
+
+/*
+  set the coefficients of a section, keeping its delayed samples
+ */
+template <class T>
+void NotchFilterBank<T>::init_section(uint8_t idx, float sample_freq_hz, float center_freq_hz, float A, float Q)
+{
+    if (idx >= _num_sections) {
+        return;
+    }
+    if (NotchFilter<T>::calculate_coefficients(sample_freq_hz, center_freq_hz, A, Q,
+                                               _b0[idx], _b1[idx], _b2[idx], _a1[idx], _a2[idx], _a0_inv[idx])) {
+        _initialised_mask |= (1U << idx);
+    } else {
+        _initialised_mask &= ~(1U << idx);
+    }
+}
+
+/*
+  apply a sample to the first count sections in turn
+ */
+template <class T>
+T NotchFilterBank<T>::apply(const T &sample, uint8_t count)
+{
+    count = MIN(count, _num_sections);
+
+    const uint8_t stride = NOTCH_BANK_STRIDE(T);
+    float v[4] {};
+    memcpy(v, &sample, sizeof(T));
+
+#if NOTCH_BANK_NEON
+    float32x4_t x = vld1q_f32(v);
+    for (uint8_t i = 0; i < count; i++) {
+        float *x1 = &_x1[i * stride];
+        float *x2 = &_x2[i * stride];
+        float *y1 = &_y1[i * stride];
+        float *y2 = &_y2[i * stride];
+        const float32x4_t vx1 = vld1q_f32(x1);
+        const float32x4_t vy1 = vld1q_f32(y1);
+        float32x4_t out = x;
+        if (_initialised_mask & (1U << i)) {
+            const float32x4_t vx2 = vld1q_f32(x2);
+            const float32x4_t vy2 = vld1q_f32(y2);
+            out = vmulq_f32(x, vdupq_n_f32(_b0[i]));
+            out = vaddq_f32(out, vmulq_f32(vx1, vdupq_n_f32(_b1[i])));
+            out = vaddq_f32(out, vmulq_f32(vx2, vdupq_n_f32(_b2[i])));
+            out = vsubq_f32(out, vmulq_f32(vy1, vdupq_n_f32(_a1[i])));
+            out = vsubq_f32(out, vmulq_f32(vy2, vdupq_n_f32(_a2[i])));
+            out = vmulq_f32(out, vdupq_n_f32(_a0_inv[i]));
+        }
+        vst1q_f32(x2, vx1);
+        vst1q_f32(x1, x);
+        vst1q_f32(y2, vy1);
+        vst1q_f32(y1, out);
+        x = out;
+    }
+    vst1q_f32(v, x);
+#elif NOTCH_BANK_SSE
+    __m128 x = _mm_loadu_ps(v);
+    for (uint8_t i = 0; i < count; i++) {
+        float *x1 = &_x1[i * stride];
+        float *x2 = &_x2[i * stride];
+        float *y1 = &_y1[i * stride];
+        float *y2 = &_y2[i * stride];
+        const __m128 vx1 = _mm_loadu_ps(x1);
+        const __m128 vy1 = _mm_loadu_ps(y1);
+        __m128 out = x;
+        if (_initialised_mask & (1U << i)) {
+            const __m128 vx2 = _mm_loadu_ps(x2);
+            const __m128 vy2 = _mm_loadu_ps(y2);
+            out = _mm_mul_ps(x, _mm_set1_ps(_b0[i]));
+            out = _mm_add_ps(out, _mm_mul_ps(vx1, _mm_set1_ps(_b1[i])));
+            out = _mm_add_ps(out, _mm_mul_ps(vx2, _mm_set1_ps(_b2[i])));
+            out = _mm_sub_ps(out, _mm_mul_ps(vy1, _mm_set1_ps(_a1[i])));
+            out = _mm_sub_ps(out, _mm_mul_ps(vy2, _mm_set1_ps(_a2[i])));
+            out = _mm_mul_ps(out, _mm_set1_ps(_a0_inv[i]));
+        }
+        _mm_storeu_ps(x2, vx1);
+        _mm_storeu_ps(x1, x);
+        _mm_storeu_ps(y2, vy1);
+        _mm_storeu_ps(y1, out);
+        x = out;
+    }
+    _mm_storeu_ps(v, x);
+#else
+    for (uint8_t i = 0; i < count; i++) {
+        float *x1 = &_x1[i * stride];
+        float *x2 = &_x2[i * stride];
+        float *y1 = &_y1[i * stride];
+        float *y2 = &_y2[i * stride];
+        const bool initialised = _initialised_mask & (1U << i);
+        for (uint8_t c = 0; c < stride; c++) {
+            float out = v[c];
+            if (initialised) {
+                out = (v[c]*_b0[i] + x1[c]*_b1[i] + x2[c]*_b2[i] - y1[c]*_a1[i] - y2[c]*_a2[i]) * _a0_inv[i];
+            }
+            x2[c] = x1[c];
+            x1[c] = v[c];
+            y2[c] = y1[c];
+            y1[c] = out;
+            v[c] = out;
+        }
+    }
+#endif
+
+    T output;
+    memcpy(&output, v, sizeof(T));
+    return output;
+}
+
+/*
+  reset the delayed samples. As in NotchFilter::reset() the last input
+  is kept, and becomes the input before last on the next sample
+ */
+template <class T>
+void NotchFilterBank<T>::reset()
+{
+    if (_b0 == nullptr) {
+        return;
+    }
+    const uint16_t n = _num_sections * NOTCH_BANK_STRIDE(T);
+    memset(_x2, 0, n * sizeof(float));
+    memset(_y1, 0, n * sizeof(float));
+    memset(_y2, 0, n * sizeof(float));
+}
+
+/*
+  instantiate template classes
+ */
+template class NotchFilterBank<float>;
+template class NotchFilterBank<Vector3f>;
@@ -0,0 +1,70 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <AP_Math/AP_Math.h>
+#include "NotchFilter.h"
+
+/*
+  a cascade of notch filters with the coefficients and delayed samples
+  of all sections held in structure of arrays form
+
+  Each section is the NotchFilter biquad, and the output is bit
+  identical to applying the same NotchFilter objects in turn. Where
+  NEON or SSE are available the components of a sample (the three axes
+  of a Vector3f) are filtered together in the lanes of one vector
+ */
+template <class T>
+class NotchFilterBank {
+public:
+    NotchFilterBank() {}
+    ~NotchFilterBank();
+
+    /* Do not allow copies */
+    NotchFilterBank(const NotchFilterBank &other) = delete;
+    NotchFilterBank &operator=(const NotchFilterBank&) = delete;
+
+    // allocate num_sections notch filters, at most 32. Returns false if out of memory
+    bool allocate(uint8_t num_sections);
+    // number of allocated sections
+    uint8_t num_sections() const { return _num_sections; }
+    // bytes allocated for num_sections notch filters
+    static uint32_t allocation_size(uint8_t num_sections);
+
+    // set the coefficients of a section, as NotchFilter::init_with_A_and_Q()
+    // a section with an out of range center frequency or Q passes samples through
+    void init_section(uint8_t idx, float sample_freq_hz, float center_freq_hz, float A, float Q);
+    // apply a sample to the first count sections in turn and return the output
+    T apply(const T &sample, uint8_t count);
+    // reset the delayed samples of all sections, as NotchFilter::reset()
+    void reset();
+
+private:
+    uint8_t _num_sections = 0;
+    // bitmask of sections with valid coefficients
+    uint32_t _initialised_mask = 0;
+
+    // the float arrays share one allocation, starting at _b0. The
+    // coefficients have one entry per section and the delayed samples
+    // one (possibly padded) sample per section
+    float *_b0 = nullptr;
+    float *_b1, *_b2, *_a1, *_a2, *_a0_inv;
+    float *_x1;     // last input
+    float *_x2;     // input before last
+    float *_y1;     // last output
+    float *_y2;     // output before last
+};
+
+typedef NotchFilterBank<Vector3f> NotchFilterBankVector3f;
@@ -0,0 +1,171 @@
+// the notch filter bank must match NotchFilter bit for bit, so
+// floats are compared directly:
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+
+#include <AP_gtest.h>
+
+#include <Filter/NotchFilter.h>
+#include <Filter/NotchFilterBank.h>
+#include <Filter/HarmonicNotchFilter.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#define TEST_SAMPLE_FREQ_HZ 2000.0f
+#define TEST_NUM_SECTIONS 6
+
+// gyro like test signal: motor noise at a few frequencies plus broadband noise
+static Vector3f test_sample(uint32_t n)
+{
+    static uint32_t seed = 1;
+    const float t = n / TEST_SAMPLE_FREQ_HZ;
+    Vector3f noise;
+    for (uint8_t i = 0; i < 3; i++) {
+        seed = seed * 1664525U + 1013904223U;
+        noise[i] = (int32_t(seed >> 8) - (1 << 23)) * (0.05f / (1 << 23));
+    }
+    return Vector3f(sinf(M_2PI * 83 * t) + 0.3f * sinf(M_2PI * 166 * t),
+                    0.5f * sinf(M_2PI * 91 * t + 1.0f) - 0.2f * sinf(M_2PI * 240 * t),
+                    0.1f + 0.7f * sinf(M_2PI * 310 * t)) + noise;
+}
+
+static void expect_same(const Vector3f &expected, const Vector3f &actual, uint32_t n)
+{
+    EXPECT_EQ(expected.x, actual.x) << "sample " << n;
+    EXPECT_EQ(expected.y, actual.y) << "sample " << n;
+    EXPECT_EQ(expected.z, actual.z) << "sample " << n;
+}
+
+// set the same center frequency on section i of the bank and the cascade
+template <class T>
+static void init_both(NotchFilterBank<T> &bank, NotchFilter<T> cascade[], uint8_t i, float center_freq_hz)
+{
+    float A, Q;
+    NotchFilter<T>::calculate_A_and_Q(center_freq_hz, center_freq_hz * 0.5f, 40, A, Q);
+    bank.init_section(i, TEST_SAMPLE_FREQ_HZ, center_freq_hz, A, Q);
+    cascade[i].init_with_A_and_Q(TEST_SAMPLE_FREQ_HZ, center_freq_hz, A, Q);
+}
+
+TEST(NotchFilterBankTest, MatchesCascadeVector3f)
+{
+    NotchFilterBankVector3f bank;
+    NotchFilterVector3f cascade[TEST_NUM_SECTIONS];
+    ASSERT_TRUE(bank.allocate(TEST_NUM_SECTIONS));
+
+    for (uint8_t i = 0; i < TEST_NUM_SECTIONS; i++) {
+        init_both(bank, cascade, i, 80.0f * (i + 1));
+    }
+
+    uint8_t count = TEST_NUM_SECTIONS;
+    for (uint32_t n = 0; n < 4000; n++) {
+        if (n == 1000) {
+            // retune while running, as a dynamic harmonic notch does
+            for (uint8_t i = 0; i < TEST_NUM_SECTIONS; i++) {
+                init_both(bank, cascade, i, 95.0f * (i + 1));
+            }
+        }
+        if (n == 1500) {
+            // a section above nyquist passes samples through
+            init_both(bank, cascade, 2, TEST_SAMPLE_FREQ_HZ * 0.6f);
+        }
+        if (n == 2000) {
+            // fewer enabled sections, the rest keep their state
+            count = 4;
+        }
+        if (n == 2500) {
+            init_both(bank, cascade, 2, 250.0f);
+            count = TEST_NUM_SECTIONS;
+        }
+        if (n == 3000) {
+            bank.reset();
+            for (uint8_t i = 0; i < TEST_NUM_SECTIONS; i++) {
+                cascade[i].reset();
+            }
+        }
+
+        const Vector3f sample = test_sample(n);
+        Vector3f expected = sample;
+        for (uint8_t i = 0; i < count; i++) {
+            expected = cascade[i].apply(expected);
+        }
+        expect_same(expected, bank.apply(sample, count), n);
+    }
+}
+
+TEST(NotchFilterBankTest, MatchesCascadeFloat)
+{
+    NotchFilterBank<float> bank;
+    NotchFilterFloat cascade[3] {};
+    ASSERT_TRUE(bank.allocate(3));
+
+    for (uint8_t i = 0; i < 3; i++) {
+        init_both(bank, cascade, i, 120.0f * (i + 1));
+    }
+
+    for (uint32_t n = 0; n < 2000; n++) {
+        const float sample = test_sample(n).x;
+        float expected = sample;
+        for (uint8_t i = 0; i < 3; i++) {
+            expected = cascade[i].apply(expected);
+        }
+        EXPECT_EQ(expected, bank.apply(sample, 3)) << "sample " << n;
+    }
+}
+
+TEST(NotchFilterBankTest, Allocation)
+{
+    NotchFilterBankVector3f bank;
+    EXPECT_FALSE(bank.allocate(0));
+    EXPECT_FALSE(bank.allocate(33));
+    EXPECT_EQ(0, bank.num_sections());
+
+    // unallocated and uninitialised sections pass samples through
+    const Vector3f sample(1, -2, 3);
+    expect_same(sample, bank.apply(sample, 4), 0);
+    ASSERT_TRUE(bank.allocate(4));
+    EXPECT_EQ(4, bank.num_sections());
+    expect_same(sample, bank.apply(sample, 4), 0);
+}
+
+TEST(HarmonicNotchFilterTest, MatchesCascade)
+{
+    const float center_freq_hz = 80;
+    const float bandwidth_hz = 40;
+    const float attenuation_dB = 30;
+
+    HarmonicNotchFilterVector3f harmonic_notch {};
+    harmonic_notch.allocate_filters(0x7, false);
+    harmonic_notch.init(TEST_SAMPLE_FREQ_HZ, center_freq_hz, bandwidth_hz, attenuation_dB);
+
+    float A, Q;
+    NotchFilterVector3f::calculate_A_and_Q(center_freq_hz, bandwidth_hz, attenuation_dB, A, Q);
+    NotchFilterVector3f cascade[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        cascade[i].init_with_A_and_Q(TEST_SAMPLE_FREQ_HZ, center_freq_hz * (i + 1), A, Q);
+    }
+
+    for (uint32_t n = 0; n < 3000; n++) {
+        if (n == 1000) {
+            harmonic_notch.update(110);
+            for (uint8_t i = 0; i < 3; i++) {
+                cascade[i].init_with_A_and_Q(TEST_SAMPLE_FREQ_HZ, 110.0f * (i + 1), A, Q);
+            }
+        }
+        if (n == 2000) {
+            harmonic_notch.reset();
+            for (uint8_t i = 0; i < 3; i++) {
+                cascade[i].reset();
+            }
+        }
+        const Vector3f sample = test_sample(n);
+        Vector3f expected = sample;
+        for (uint8_t i = 0; i < 3; i++) {
+            expected = cascade[i].apply(expected);
+        }
+        expect_same(expected, harmonic_notch.apply(sample), n);
+    }
+}
+
+AP_GTEST_MAIN()
+
+#pragma GCC diagnostic pop
@@ -125,6 +125,9 @@ public:
     // this is called when we discover we'd like to send something but can't:
     void out_of_space_to_send() { out_of_space_to_send_count++; }
 
+    // this is called with the number of bytes written to the link
+    void bytes_sent(uint32_t count) { tx_bytes += count; }
+
     void send_mission_ack(const mavlink_message_t &msg,
                           MAV_MISSION_TYPE mission_type,
                           MAV_MISSION_RESULT result) const {
@@ -195,12 +198,18 @@ public:
     bool is_high_bandwidth() { return chan == MAVLINK_COMM_0; }
     // return true if this channel has hardware flow control
     bool have_flow_control();
+    // return true if a radio on this link has recently reported its buffer space
+    bool have_radio_status() const;
+    // percentage of link bandwidth to use for a parameter download
+    uint8_t param_bandwidth_share_pct();
+    // log statistics for a completed parameter download
+    void param_fetch_complete();
 
     bool is_active() const {
         return GCS_MAVLINK::active_channel_mask() & (1 << (chan-MAVLINK_COMM_0));
     }
     bool is_streaming() const {
-        return sending_bucket_id != no_bucket_to_send;
+        return streaming_bucket_mask != 0;
     }
 
     mavlink_channel_t get_chan() const { return chan; }
@@ -574,11 +583,15 @@ private:
                                                          // parameters for
                                                          // queued send
     uint32_t                    _queued_parameter_send_time_ms;
+    uint32_t                    _queued_parameter_fetch_start_ms; ///< time the
+                                                                  // current download started
 
     // number of extra ms to add to slow things down for the radio
     uint16_t         stream_slowdown_ms;
     // last reported radio buffer percent available
     uint8_t          last_txbuf = 100;
+    // time RADIO_STATUS was last received on this link
+    uint32_t         last_txbuf_ms;
 
     // perf counters
     AP_HAL::Util::perf_counter_t _perf_packet;
@@ -612,16 +625,70 @@ private:
         Bitmask<MSG_LAST> ap_message_ids;
         uint16_t interval_ms;
         uint16_t last_sent_ms; // from AP_HAL::millis16()
+        // deadline wheel list the bucket is in and the next bucket in
+        // that list, no_bucket_to_send if none
+        uint8_t wheel_list;
+        uint8_t wheel_next;
+        // number of times every message in the bucket has been sent
+        // since the last MAVR log message
+        uint16_t sent_count;
     };
     deferred_message_bucket_t deferred_message_bucket[10];
     static const uint8_t no_bucket_to_send = -1;
     static const ap_message no_message_to_send = (ap_message)-1;
     uint8_t sending_bucket_id = no_bucket_to_send;
     Bitmask<MSG_LAST> bucket_message_ids_to_send;
+    // bitmask of buckets which have messages in them
+    uint16_t streaming_bucket_mask;
 
     ap_message next_deferred_bucket_message_to_send(uint16_t now16_ms);
     void find_next_bucket_to_send(uint16_t now16_ms);
     void remove_message_from_bucket(int8_t bucket, ap_message id);
+    void bucket_sent(uint16_t now16_ms);
+
+    /*
+      deadline wheel of buckets waiting to be sent. Each bucket which
+      is not being sent sits in the slot covering the time it is next
+      due, so finding the next bucket only looks at slots the clock
+      has passed rather than at every bucket. Buckets due after the
+      end of the wheel wait in its last slot and are requeued when it
+      comes around. Buckets from passed slots are moved to the ready
+      list, which is at index deadline_wheel_slots
+     */
+    static const uint8_t deadline_wheel_slots = 32;
+    static const uint8_t deadline_wheel_slot_ms = 8;
+    static const uint8_t deadline_wheel_ready = deadline_wheel_slots;
+    uint8_t deadline_wheel_head[deadline_wheel_slots+1];
+    // start of the next slot to be moved to the ready list, from AP_HAL::millis16()
+    uint16_t deadline_wheel_next_ms;
+    // stream slowdown and multiplier the queued buckets were slotted
+    // with. When either changes every bucket is slotted again
+    uint16_t deadline_wheel_slowdown_ms;
+    uint8_t deadline_wheel_multiplier;
+    void deadline_wheel_init();
+    void deadline_wheel_insert(uint8_t bucket_id, uint16_t now16_ms);
+    void deadline_wheel_remove(uint8_t bucket_id);
+    void deadline_wheel_advance(uint16_t now16_ms);
+    void deadline_wheel_reslot(uint16_t now16_ms);
+    uint16_t ms_before_bucket_due(const deferred_message_bucket_t &bucket, uint16_t now16_ms) const;
+
+    /*
+      byte budget for streamed messages on links without flow
+      control. It fills at the link's bandwidth and is drawn down by
+      the bytes of each streamed message, so streams cannot saturate
+      the link. Parameters, FTP and routed traffic are not counted
+     */
+    struct {
+        int32_t bytes;              // may go negative after a large send
+        uint32_t last_update_ms;
+        uint16_t throttled_count;   // times streams stopped for lack of budget since last MAVR log
+    } tx_budget;
+    // limit on saved up budget, in ms of link bandwidth
+    static const uint16_t tx_budget_max_ms = 100;
+    void update_tx_budget();
+
+    // log achieved against requested rate of each bucket
+    void log_stream_rates(uint32_t elapsed_ms);
 
     // bitmask of IDs the code has spontaneously decided it wants to
     // send out.  Examples include HEARTBEAT (gcs_send_heartbeat)
@@ -661,6 +728,9 @@ private:
     // When sending parameters and waypoints this may be longer than
     // the interval specified in "deferred"
     uint16_t get_reschedule_interval_ms(const deferred_message_bucket_t &deferred) const;
+    // factor streams are slowed by while parameters, mission items or
+    // ftp replies are being sent
+    uint8_t get_reschedule_interval_multiplier() const;
 
     bool do_try_send_message(const ap_message id);
 
@@ -836,6 +906,7 @@ private:
     uint8_t last_tx_seq;
     uint16_t send_packet_count;
     uint16_t out_of_space_to_send_count; // number of times HAVE_PAYLOAD_SPACE and friends have returned false
+    uint32_t tx_bytes; // number of bytes written to the link
 
 #if GCS_DEBUG_SEND_MESSAGE_TIMINGS
     struct {
@@ -99,6 +99,9 @@ GCS_MAVLINK::GCS_MAVLINK(GCS_MAVLINK_Parameters &parameters,
 
 bool GCS_MAVLINK::init(uint8_t instance)
 {
+    // the deadline wheel must be empty before any message interval is set
+    deadline_wheel_init();
+
     // search for serial port
     const AP_SerialManager& serial_manager = AP::serialmanager();
 
@@ -685,6 +688,7 @@ void GCS_MAVLINK::handle_radio_status(const mavlink_message_t &msg, bool log_rad
     }
 
     last_txbuf = packet.txbuf;
+    last_txbuf_ms = now;
 
     // use the state of the transmit buffer in the radio to
     // control the stream rate, giving us adaptive software
@@ -906,27 +910,36 @@ bool GCS_MAVLINK::should_send_message_in_delay_callback(const ap_message id) con
     return false;
 }
 
-uint16_t GCS_MAVLINK::get_reschedule_interval_ms(const deferred_message_bucket_t &deferred) const
+uint8_t GCS_MAVLINK::get_reschedule_interval_multiplier() const
 {
-    uint32_t interval_ms = deferred.interval_ms;
-
-    interval_ms += stream_slowdown_ms;
+    uint8_t multiplier = 1;
 
     // slow most messages down if we're transfering parameters or
     // waypoints:
     if (_queued_parameter) {
         // we are sending parameters, penalize streams:
-        interval_ms *= 4;
+        multiplier *= 4;
     }
     if (requesting_mission_items()) {
         // we are sending requests for waypoints, penalize streams:
-        interval_ms *= 4;
+        multiplier *= 4;
     }
     if (ftp.replies && AP_HAL::millis() - ftp.last_send_ms < 500) {
         // we are sending ftp replies
-        interval_ms *= 4;
+        multiplier *= 4;
     }
 
+    return multiplier;
+}
+
+uint16_t GCS_MAVLINK::get_reschedule_interval_ms(const deferred_message_bucket_t &deferred) const
+{
+    uint32_t interval_ms = deferred.interval_ms;
+
+    interval_ms += stream_slowdown_ms;
+
+    interval_ms *= get_reschedule_interval_multiplier();
+
     if (interval_ms > 60000) {
         return 60000;
     }
@@ -934,7 +947,122 @@ uint16_t GCS_MAVLINK::get_reschedule_interval_ms(const deferred_message_bucket_t
     return interval_ms;
 }
 
-// typical runtime on fmuv3: 5 microseconds for 3 buckets
+// time until a bucket should next be sent, zero if it is due
+uint16_t GCS_MAVLINK::ms_before_bucket_due(const deferred_message_bucket_t &bucket, uint16_t now16_ms) const
+{
+    const uint16_t interval = get_reschedule_interval_ms(bucket);
+    const uint16_t ms_since_last_sent = now16_ms - bucket.last_sent_ms;
+    if (ms_since_last_sent >= interval) {
+        return 0;
+    }
+    return interval - ms_since_last_sent;
+}
+
+void GCS_MAVLINK::deadline_wheel_init()
+{
+    for (uint8_t i=0; i<ARRAY_SIZE(deadline_wheel_head); i++) {
+        deadline_wheel_head[i] = no_bucket_to_send;
+    }
+    for (uint8_t i=0; i<ARRAY_SIZE(deferred_message_bucket); i++) {
+        deferred_message_bucket[i].wheel_list = no_bucket_to_send;
+        deferred_message_bucket[i].wheel_next = no_bucket_to_send;
+    }
+    const uint16_t now16_ms = AP_HAL::millis16();
+    deadline_wheel_next_ms = now16_ms - (now16_ms % deadline_wheel_slot_ms);
+    deadline_wheel_slowdown_ms = stream_slowdown_ms;
+    deadline_wheel_multiplier = get_reschedule_interval_multiplier();
+}
+
+// add a bucket to the wheel slot covering the time it is next due
+void GCS_MAVLINK::deadline_wheel_insert(uint8_t bucket_id, uint16_t now16_ms)
+{
+    deferred_message_bucket_t &bucket = deferred_message_bucket[bucket_id];
+    const uint16_t ms_before_due = ms_before_bucket_due(bucket, now16_ms);
+    const uint16_t due_ms = now16_ms + ms_before_due;
+
+    uint8_t list;
+    if (int16_t(due_ms - deadline_wheel_next_ms) < 0) {
+        // due in a slot which has already been moved to the ready list
+        list = deadline_wheel_ready;
+    } else {
+        // buckets due after the end of the wheel wait in its last slot
+        uint16_t wheel_ms = due_ms - deadline_wheel_next_ms;
+        const uint16_t max_wheel_ms = (deadline_wheel_slots - 1) * deadline_wheel_slot_ms;
+        if (wheel_ms > max_wheel_ms) {
+            wheel_ms = max_wheel_ms;
+        }
+        // 65536 is a multiple of the wheel length, so slots line up
+        // when millis16 wraps
+        list = (uint16_t(deadline_wheel_next_ms + wheel_ms) / deadline_wheel_slot_ms) % deadline_wheel_slots;
+    }
+    bucket.wheel_list = list;
+    bucket.wheel_next = deadline_wheel_head[list];
+    deadline_wheel_head[list] = bucket_id;
+}
+
+// take a bucket off the wheel
+void GCS_MAVLINK::deadline_wheel_remove(uint8_t bucket_id)
+{
+    deferred_message_bucket_t &bucket = deferred_message_bucket[bucket_id];
+    if (bucket.wheel_list == no_bucket_to_send) {
+        return;
+    }
+    uint8_t *link = &deadline_wheel_head[bucket.wheel_list];
+    while (*link != no_bucket_to_send) {
+        if (*link == bucket_id) {
+            *link = bucket.wheel_next;
+            break;
+        }
+        link = &deferred_message_bucket[*link].wheel_next;
+    }
+    bucket.wheel_list = no_bucket_to_send;
+    bucket.wheel_next = no_bucket_to_send;
+}
+
+// move the buckets in slots the clock has reached to the ready list
+void GCS_MAVLINK::deadline_wheel_advance(uint16_t now16_ms)
+{
+    for (uint8_t i=0; i<deadline_wheel_slots; i++) {
+        if (int16_t(now16_ms - deadline_wheel_next_ms) < 0) {
+            return;
+        }
+        const uint8_t slot = (deadline_wheel_next_ms / deadline_wheel_slot_ms) % deadline_wheel_slots;
+        while (deadline_wheel_head[slot] != no_bucket_to_send) {
+            const uint8_t bucket_id = deadline_wheel_head[slot];
+            deferred_message_bucket_t &bucket = deferred_message_bucket[bucket_id];
+            deadline_wheel_head[slot] = bucket.wheel_next;
+            bucket.wheel_list = deadline_wheel_ready;
+            bucket.wheel_next = deadline_wheel_head[deadline_wheel_ready];
+            deadline_wheel_head[deadline_wheel_ready] = bucket_id;
+        }
+        deadline_wheel_next_ms += deadline_wheel_slot_ms;
+    }
+    // we have been away for more than a turn of the wheel; every slot
+    // has been emptied so just catch up
+    if (int16_t(now16_ms - deadline_wheel_next_ms) >= 0) {
+        deadline_wheel_next_ms = now16_ms - (now16_ms % deadline_wheel_slot_ms) + deadline_wheel_slot_ms;
+    }
+}
+
+// slot every queued bucket again for its current reschedule
+// interval. A bucket left in the slot for a longer interval would be
+// sent late
+void GCS_MAVLINK::deadline_wheel_reslot(uint16_t now16_ms)
+{
+    deadline_wheel_slowdown_ms = stream_slowdown_ms;
+    deadline_wheel_multiplier = get_reschedule_interval_multiplier();
+    for (uint8_t i=0; i<ARRAY_SIZE(deferred_message_bucket); i++) {
+        if (deferred_message_bucket[i].wheel_list == no_bucket_to_send) {
+            continue;
+        }
+        deadline_wheel_remove(i);
+        deadline_wheel_insert(i, now16_ms);
+    }
+}
+
+// pick the ready bucket with the earliest deadline which is due.
+// Ready buckets which will not be due until after the current slot
+// are put back on the wheel
 void GCS_MAVLINK::find_next_bucket_to_send(uint16_t now16_ms)
 {
 #if GCS_DEBUG_SEND_MESSAGE_TIMINGS
@@ -942,29 +1070,35 @@ void GCS_MAVLINK::find_next_bucket_to_send(uint16_t now16_ms)
     uint32_t start_us = AP_HAL::micros();
 #endif
 
-    // all done sending this bucket... find another bucket...
     sending_bucket_id = no_bucket_to_send;
-    uint16_t ms_before_send_next_bucket_to_send = UINT16_MAX;
-    for (uint8_t i=0; i<ARRAY_SIZE(deferred_message_bucket); i++) {
-        if (deferred_message_bucket[i].ap_message_ids.count() == 0) {
-            // no entries
-            continue;
-        }
-        const uint16_t interval = get_reschedule_interval_ms(deferred_message_bucket[i]);
-        const uint16_t ms_since_last_sent = now16_ms - deferred_message_bucket[i].last_sent_ms;
-        uint16_t ms_before_send_this_bucket;
-        if (ms_since_last_sent > interval) {
-            // should already have sent this bucket!
-            ms_before_send_this_bucket = 0;
-        } else {
-            ms_before_send_this_bucket = interval - ms_since_last_sent;
-        }
-        if (ms_before_send_this_bucket < ms_before_send_next_bucket_to_send) {
-            sending_bucket_id = i;
-            ms_before_send_next_bucket_to_send = ms_before_send_this_bucket;
+    if (stream_slowdown_ms != deadline_wheel_slowdown_ms ||
+        get_reschedule_interval_multiplier() != deadline_wheel_multiplier) {
+        deadline_wheel_reslot(now16_ms);
+    }
+    deadline_wheel_advance(now16_ms);
+
+    uint16_t latest_ms_since_due = 0;
+    uint8_t bucket_id = deadline_wheel_head[deadline_wheel_ready];
+    while (bucket_id != no_bucket_to_send) {
+        const deferred_message_bucket_t &bucket = deferred_message_bucket[bucket_id];
+        const uint8_t next = bucket.wheel_next;
+        const uint16_t ms_before_due = ms_before_bucket_due(bucket, now16_ms);
+        if (ms_before_due == 0) {
+            const uint16_t ms_since_due = uint16_t(now16_ms - bucket.last_sent_ms) - get_reschedule_interval_ms(bucket);
+            if (sending_bucket_id == no_bucket_to_send || ms_since_due > latest_ms_since_due) {
+                sending_bucket_id = bucket_id;
+                latest_ms_since_due = ms_since_due;
+            }
+        } else if (int16_t(uint16_t(now16_ms + ms_before_due) - deadline_wheel_next_ms) >= 0) {
+            // was due after the end of the wheel when it was queued
+            deadline_wheel_remove(bucket_id);
+            deadline_wheel_insert(bucket_id, now16_ms);
         }
+        bucket_id = next;
     }
+
     if (sending_bucket_id != no_bucket_to_send) {
+        deadline_wheel_remove(sending_bucket_id);
         bucket_message_ids_to_send = deferred_message_bucket[sending_bucket_id].ap_message_ids;
     } else {
         bucket_message_ids_to_send.clearall();
@@ -982,14 +1116,11 @@ void GCS_MAVLINK::find_next_bucket_to_send(uint16_t now16_ms)
 ap_message GCS_MAVLINK::next_deferred_bucket_message_to_send(uint16_t now16_ms)
 {
     if (sending_bucket_id == no_bucket_to_send) {
-        // could happen if all streamrates are zero?
-        return no_message_to_send;
-    }
-
-    const uint16_t ms_since_last_sent = now16_ms - deferred_message_bucket[sending_bucket_id].last_sent_ms;
-    if (ms_since_last_sent < get_reschedule_interval_ms(deferred_message_bucket[sending_bucket_id])) {
-        // not time to send this bucket
-        return no_message_to_send;
+        find_next_bucket_to_send(now16_ms);
+        if (sending_bucket_id == no_bucket_to_send) {
+            // nothing due, or all streamrates are zero
+            return no_message_to_send;
+        }
     }
 
     const int16_t next = bucket_message_ids_to_send.first_set();
@@ -998,12 +1129,54 @@ ap_message GCS_MAVLINK::next_deferred_bucket_message_to_send(uint16_t now16_ms)
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
         AP_HAL::panic("next_deferred_bucket_message_to_send called on empty bucket");
 #endif
-        find_next_bucket_to_send(now16_ms);
+        bucket_sent(now16_ms);
         return no_message_to_send;
     }
     return (ap_message)next;
 }
 
+// every message in the sending bucket has been sent; requeue it for
+// its next interval
+void GCS_MAVLINK::bucket_sent(uint16_t now16_ms)
+{
+    deferred_message_bucket_t &bucket = deferred_message_bucket[sending_bucket_id];
+    // we try to keep output on a regular clock to avoid
+    // user support questions:
+    const uint16_t interval_ms = get_reschedule_interval_ms(bucket);
+    bucket.last_sent_ms += interval_ms;
+    // but we do not want to try to catch up too much:
+    if (uint16_t(now16_ms - bucket.last_sent_ms) > interval_ms) {
+        bucket.last_sent_ms = now16_ms;
+    }
+    bucket.sent_count++;
+    if (bucket.ap_message_ids.count() != 0) {
+        deadline_wheel_insert(sending_bucket_id, now16_ms);
+    }
+    sending_bucket_id = no_bucket_to_send;
+    bucket_message_ids_to_send.clearall();
+}
+
+/*
+  refill the stream byte budget at the link bandwidth
+ */
+void GCS_MAVLINK::update_tx_budget()
+{
+    const uint32_t now_ms = AP_HAL::millis();
+    // bw_in_kilobytes_per_second() is roughly bytes per millisecond
+    const int32_t link_bw = MAX(_port->bw_in_kilobytes_per_second(), 1U);
+    const int32_t max_bytes = link_bw * tx_budget_max_ms;
+
+    const uint32_t elapsed_ms = MIN(now_ms - tx_budget.last_update_ms, uint32_t(tx_budget_max_ms));
+    tx_budget.bytes += link_bw * int32_t(elapsed_ms);
+    if (tx_budget.bytes > max_bytes) {
+        tx_budget.bytes = max_bytes;
+    } else if (tx_budget.bytes < -max_bytes) {
+        // don't hold streams back for more than tx_budget_max_ms after a large send
+        tx_budget.bytes = -max_bytes;
+    }
+    tx_budget.last_update_ms = now_ms;
+}
+
 // call try_send_message if appropriate.  Incorporates debug code to
 // record how long it takes to send a message.  try_send_message is
 // expected to be overridden, not this function.
@@ -1104,6 +1277,8 @@ void GCS_MAVLINK::update_send()
         deferred_messages_initialised = true;
     }
 
+    update_tx_budget();
+
 #if GCS_DEBUG_SEND_MESSAGE_TIMINGS
     uint32_t retry_deferred_body_start = AP_HAL::micros();
 #endif
@@ -1172,21 +1347,29 @@ void GCS_MAVLINK::update_send()
 
         ap_message next = next_deferred_bucket_message_to_send(start16);
         if (next != no_message_to_send) {
+            // streamed messages wait when the link's byte budget has
+            // been used up, leaving the time to other links. Links
+            // with flow control are limited by their buffer space and
+            // don't know their real bandwidth
+            const bool use_tx_budget = !have_flow_control();
+            if (use_tx_budget) {
+                update_tx_budget();
+                if (tx_budget.bytes <= 0) {
+                    tx_budget.throttled_count++;
+                    break;
+                }
+            }
+            const uint32_t tx_bytes_before = tx_bytes;
             if (!do_try_send_message(next)) {
                 break;
             }
+            if (use_tx_budget) {
+                tx_budget.bytes -= tx_bytes - tx_bytes_before;
+            }
             bucket_message_ids_to_send.clear(next);
             if (bucket_message_ids_to_send.count() == 0) {
                 // we sent everything in the bucket.  Reschedule it.
-                // we try to keep output on a regular clock to avoid
-                // user support questions:
-                const uint16_t interval_ms = get_reschedule_interval_ms(deferred_message_bucket[sending_bucket_id]);
-                deferred_message_bucket[sending_bucket_id].last_sent_ms += interval_ms;
-                // but we do not want to try to catch up too much:
-                if (uint16_t(start16 - deferred_message_bucket[sending_bucket_id].last_sent_ms) > interval_ms) {
-                    deferred_message_bucket[sending_bucket_id].last_sent_ms = start16;
-                }
-                find_next_bucket_to_send(start16);
+                bucket_sent(start16);
             }
 #if GCS_DEBUG_SEND_MESSAGE_TIMINGS
                 const uint32_t stop = AP_HAL::micros();
@@ -1226,12 +1409,14 @@ void GCS_MAVLINK::remove_message_from_bucket(int8_t bucket, ap_message id)
         // bucket empty.  Free it:
         deferred_message_bucket[bucket].interval_ms = 0;
         deferred_message_bucket[bucket].last_sent_ms = 0;
+        deadline_wheel_remove(bucket);
+        streaming_bucket_mask &= ~(1U<<bucket);
     }
 
     if (bucket == sending_bucket_id) {
         bucket_message_ids_to_send.clear(id);
         if (bucket_message_ids_to_send.count() == 0) {
-            find_next_bucket_to_send(AP_HAL::millis16());
+            bucket_sent(AP_HAL::millis16());
         } else {
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
             if (deferred_message_bucket[bucket].interval_ms == 0 &&
@@ -1338,17 +1523,16 @@ bool GCS_MAVLINK::set_ap_message_interval(enum ap_message id, uint16_t interval_
     if (closest_bucket_interval_delta != 0 &&
         empty_bucket_id != -1) {
         // allocate a bucket for this interval
+        const uint16_t now16_ms = AP_HAL::millis16();
         deferred_message_bucket[empty_bucket_id].interval_ms = interval_ms;
-        deferred_message_bucket[empty_bucket_id].last_sent_ms = AP_HAL::millis16();
+        deferred_message_bucket[empty_bucket_id].last_sent_ms = now16_ms;
+        deferred_message_bucket[empty_bucket_id].sent_count = 0;
+        deadline_wheel_insert(empty_bucket_id, now16_ms);
         closest_bucket = empty_bucket_id;
     }
 
     deferred_message_bucket[closest_bucket].ap_message_ids.set(id);
-
-    if (sending_bucket_id == no_bucket_to_send) {
-        sending_bucket_id = closest_bucket;
-        bucket_message_ids_to_send = deferred_message_bucket[closest_bucket].ap_message_ids;
-    }
+    streaming_bucket_mask |= (1U<<closest_bucket);
 
     return true;
 }
@@ -1485,6 +1669,7 @@ GCS_MAVLINK::update_receive(uint32_t max_time_us)
     if (is_active() || is_streaming()) {
         if (tnow - last_mavlink_stats_logged > 1000) {
             log_mavlink_stats();
+            log_stream_rates(tnow - last_mavlink_stats_logged);
             last_mavlink_stats_logged = tnow;
         }
     }
@@ -1616,6 +1801,48 @@ void GCS_MAVLINK::log_mavlink_stats()
     AP::logger().WriteBlock(&pkt, sizeof(pkt));
 }
 
+/*
+  log achieved against requested rate of each deferred message
+  bucket, and how often the link's byte budget held streams back
+*/
+void GCS_MAVLINK::log_stream_rates(uint32_t elapsed_ms)
+{
+    if (elapsed_ms == 0) {
+        return;
+    }
+    const uint64_t now_us = AP_HAL::micros64();
+    for (uint8_t i=0; i<ARRAY_SIZE(deferred_message_bucket); i++) {
+        deferred_message_bucket_t &bucket = deferred_message_bucket[i];
+        if (bucket.interval_ms == 0) {
+            continue;
+        }
+        // @LoggerMessage: MAVR
+        // @Description: MAVLink stream rates, one message for each deferred message bucket in use
+        // @Field: TimeUS: Time since system startup
+        // @Field: Chan: mavlink channel number
+        // @Field: Bkt: deferred message bucket number
+        // @Field: NMsg: number of messages streamed in this bucket
+        // @Field: ReqR: requested rate
+        // @Field: ActR: achieved rate of sending every message in the bucket
+        // @Field: Budget: bytes left in the link's stream budget
+        // @Field: Thr: number of times streams on this link were held back by the byte budget
+        AP::logger().Write("MAVR", "TimeUS,Chan,Bkt,NMsg,ReqR,ActR,Budget,Thr",
+                           "s#--zzb-",
+                           "F-------",
+                           "QBBBffiH",
+                           now_us,
+                           uint8_t(chan),
+                           i,
+                           uint8_t(bucket.ap_message_ids.count()),
+                           1000.0f / bucket.interval_ms,
+                           bucket.sent_count * 1000.0f / elapsed_ms,
+                           tx_budget.bytes,
+                           tx_budget.throttled_count);
+        bucket.sent_count = 0;
+    }
+    tx_budget.throttled_count = 0;
+}
+
 /*
   send the SYSTEM_TIME message
  */
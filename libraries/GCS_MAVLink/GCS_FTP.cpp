@@ -29,6 +29,17 @@ struct GCS_MAVLINK::ftp_state GCS_MAVLINK::ftp;
 // timeout for session inactivity
 #define FTP_SESSION_TIMEOUT 3000
 
+// number of requests queued for the worker. Writes carry their offset, so a
+// GCS can keep this many in flight when uploading rather than waiting for
+// each ack
+#ifndef FTP_REQUEST_QUEUE_LEN
+#if HAL_MEM_CLASS >= HAL_MEM_CLASS_500
+#define FTP_REQUEST_QUEUE_LEN 16
+#else
+#define FTP_REQUEST_QUEUE_LEN 5
+#endif
+#endif
+
 bool GCS_MAVLINK::ftp_init(void) {
 
     // check if ftp is disabled for memory savings
@@ -42,7 +53,7 @@ bool GCS_MAVLINK::ftp_init(void) {
         return true;
     }
 
-    ftp.requests = new ObjectBuffer<pending_ftp>(5);
+    ftp.requests = new ObjectBuffer<pending_ftp>(FTP_REQUEST_QUEUE_LEN);
     if (ftp.requests == nullptr) {
         goto failed;
     }
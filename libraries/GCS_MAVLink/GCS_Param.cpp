@@ -47,11 +47,18 @@ GCS_MAVLINK::queued_param_send()
     const uint32_t tnow = AP_HAL::millis();
     const uint32_t tstart = AP_HAL::micros();
 
-    // use at most 30% of bandwidth on parameters. The constant 26 is
-    // 1/(1000 * 1/8 * 0.001 * 0.3)
+    // size the batch to cover the time until we are next called, so
+    // slow links get a few parameters per call rather than one
+    uint32_t elapsed_ms = tnow - _queued_parameter_send_time_ms;
+    const int8_t param_deferred_index = get_deferred_message_index(MSG_NEXT_PARAM);
+    if (param_deferred_index != -1) {
+        elapsed_ms = MAX(elapsed_ms, deferred_message[param_deferred_index].interval_ms);
+    }
+
+    // bw_in_kilobytes_per_second() is roughly bytes per millisecond
     const uint32_t link_bw = _port->bw_in_kilobytes_per_second();
 
-    uint32_t bytes_allowed = link_bw * (tnow - _queued_parameter_send_time_ms) * 26;
+    uint32_t bytes_allowed = link_bw * elapsed_ms * param_bandwidth_share_pct() / 100U;
     const uint16_t size_for_one_param_value_msg = MAVLINK_MSG_ID_PARAM_VALUE_LEN + packet_overhead();
     if (bytes_allowed < size_for_one_param_value_msg) {
         bytes_allowed = size_for_one_param_value_msg;
@@ -61,11 +68,13 @@ GCS_MAVLINK::queued_param_send()
     }
     uint32_t count = bytes_allowed / size_for_one_param_value_msg;
 
-    // when we don't have flow control we really need to keep the
-    // param download very slow, or it tends to stall
-    if (!have_flow_control() && count > 5) {
+    // when we don't have flow control or a radio telling us how full
+    // its buffer is we really need to keep the param download very
+    // slow, or it tends to stall
+    if (!have_flow_control() && !have_radio_status() && count > 5) {
         count = 5;
     }
+
     if (async_replies_sent_count >= count) {
         return;
     }
@@ -83,8 +92,13 @@ GCS_MAVLINK::queued_param_send()
             _queued_parameter_count,
             _queued_parameter_index);
 
-        _queued_parameter = AP_Param::next_scalar(&_queued_parameter_token, &_queued_parameter_type);
         _queued_parameter_index++;
+        _queued_parameter = AP_Param::next_scalar_indexed(&_queued_parameter_token, &_queued_parameter_type, _queued_parameter_index);
+
+        if (_queued_parameter == nullptr) {
+            param_fetch_complete();
+            break;
+        }
 
         if (AP_HAL::micros() - tstart > 1000) {
             // don't use more than 1ms sending blocks of parameters
@@ -95,6 +109,61 @@ GCS_MAVLINK::queued_param_send()
     _queued_parameter_send_time_ms = tnow;
 }
 
+/*
+  return the percentage of the link bandwidth to use for a parameter
+  download. Links with flow control, or radios reporting plenty of
+  free buffer space, get a bigger share. Other streams are slowed
+  down while parameters are being sent (see
+  get_reschedule_interval_ms()), which frees up the extra bandwidth
+ */
+uint8_t GCS_MAVLINK::param_bandwidth_share_pct()
+{
+    if (have_flow_control()) {
+        return 70;
+    }
+    if (!have_radio_status()) {
+        // the old 30% share
+        return 30;
+    }
+    // get_last_txbuf() is the radio's free buffer percentage; the
+    // send loop stops completely below 50%
+    return constrain_int16(int16_t(get_last_txbuf()) - 30, 10, 70);
+}
+
+/*
+  return true if a radio on this link has reported its free buffer
+  space in the last few seconds
+ */
+bool GCS_MAVLINK::have_radio_status() const
+{
+    return last_txbuf_ms != 0 && AP_HAL::millis() - last_txbuf_ms < 5000;
+}
+
+/*
+  record how long a full parameter download took
+ */
+void GCS_MAVLINK::param_fetch_complete()
+{
+    const uint32_t fetch_time_ms = AP_HAL::millis() - _queued_parameter_fetch_start_ms;
+
+    // @LoggerMessage: PRMD
+    // @Description: Parameter download statistics
+    // @Field: TimeUS: Time since system startup
+    // @Field: Chan: mavlink channel the parameters were sent on
+    // @Field: Count: number of parameters sent
+    // @Field: Time: time taken to send all parameters
+    // @Field: Rate: average parameters sent per second
+    AP::logger().Write("PRMD", "TimeUS,Chan,Count,Time,Rate",
+                       "s#-sz",
+                       "F--C-",
+                       "QBHIf",
+                       AP_HAL::micros64(),
+                       uint8_t(chan),
+                       _queued_parameter_index,
+                       fetch_time_ms,
+                       fetch_time_ms > 0 ? _queued_parameter_index * 1000.0f / fetch_time_ms : 0.0f);
+}
+
 /*
   return true if a channel has flow control
  */
@@ -216,6 +285,7 @@ void GCS_MAVLINK::handle_param_request_list(const mavlink_message_t &msg)
     _queued_parameter_index = 0;
     _queued_parameter_count = AP_Param::count_parameters();
     _queued_parameter_send_time_ms = AP_HAL::millis(); // avoid initial flooding
+    _queued_parameter_fetch_start_ms = _queued_parameter_send_time_ms;
 }
 
 void GCS_MAVLINK::handle_param_request_read(const mavlink_message_t &msg)
@@ -206,9 +206,16 @@ void Aircraft::time_advance()
     // backend
     if (last_time_us == time_now_us) {
         time_now_us += frame_time_us;
+    } else if (lockstep) {
+        // time comes from an external simulator, which paces the
+        // simulation
+        ::printf("Lockstep is not available with model %s\n", frame);
+        lockstep = false;
     }
     last_time_us = time_now_us;
-    if (use_time_sync) {
+    if (lockstep) {
+        lockstep_report();
+    } else if (use_time_sync) {
         sync_frame_time();
     }
 }
@@ -272,6 +279,36 @@ void Aircraft::sync_frame_time(void)
     }
 }
 
+/*
+  report the ratio of simulated time to wall clock time since
+  lockstep started, every 10 seconds of wall clock time. The wall
+  clock is only read every 1000 frames, so at tens of thousands of
+  frames a second it costs nothing measurable
+*/
+void Aircraft::lockstep_report(void)
+{
+    frame_counter++;
+    if (frame_counter % 1000 != 0 && lockstep_start_wall_us != 0) {
+        return;
+    }
+    const uint64_t now = get_wall_time_us();
+    if (lockstep_start_wall_us == 0) {
+        lockstep_start_wall_us = now;
+        lockstep_start_time_us = time_now_us;
+        last_lockstep_report_us = now;
+        return;
+    }
+    if (now - last_lockstep_report_us < 10000000ULL) {
+        return;
+    }
+    last_lockstep_report_us = now;
+    const double dt_wall = (now - lockstep_start_wall_us) * 1.0e-6;
+    const double dt_sim = (time_now_us - lockstep_start_time_us) * 1.0e-6;
+    ::printf("Lockstep %s: %.1fs simulated in %.1fs, speedup %.1f\n",
+             frame, dt_sim, dt_wall, dt_sim/dt_wall);
+    fflush(stdout);
+}
+
 /* add noise based on throttle level (from 0..1) */
 void Aircraft::add_noise(float throttle)
 {
@@ -500,6 +537,17 @@ void Aircraft::set_speedup(float speedup)
     setup_frame_time(rate_hz, speedup);
 }
 
+/*
+  enable lockstep. This only applies to the built-in physics models,
+  models that take their time from an external simulator turn it off
+  again on their first step
+ */
+void Aircraft::set_lockstep(bool enable)
+{
+    lockstep = enable;
+    lockstep_start_wall_us = 0;
+}
+
 void Aircraft::update_model(const struct sitl_input &input)
 {
     if (!home_is_set) {
@@ -52,6 +52,13 @@ public:
     void set_speedup(float speedup);
     float get_speedup() const { return target_speedup; }
 
+    /*
+      step on simulated time only, as fast as the CPU allows, rather
+      than pacing the simulation against the wall clock
+     */
+    void set_lockstep(bool enable);
+    bool get_lockstep() const { return lockstep; }
+
     /*
       set instance number
      */
@@ -222,6 +229,7 @@ protected:
     const char *autotest_dir;
     const char *frame;
     bool use_time_sync = true;
+    bool lockstep = false;
     float last_speedup = -1.0f;
     const char *config_ = "";
 
@@ -268,6 +276,9 @@ protected:
        into account desired speedup */
     void sync_frame_time(void);
 
+    /* report the speedup achieved in lockstep */
+    void lockstep_report(void);
+
     /* add noise based on throttle level (from 0..1) */
     void add_noise(float throttle);
 
@@ -301,6 +312,9 @@ private:
     uint64_t last_time_us;
     uint32_t frame_counter;
     uint32_t last_ground_contact_ms;
+    uint64_t lockstep_start_wall_us;
+    uint64_t lockstep_start_time_us;
+    uint64_t last_lockstep_report_us;
 #if defined(__CYGWIN__) || defined(__CYGWIN64__)
     const uint32_t min_sleep_time{20000};
 #else